@@ -0,0 +1,542 @@
+///////////////////////////////////////////////////////////////////////////////
+// batchrenderer.cpp
+// ============
+// render a list of camera poses offscreen and write each view to a PNG file
+///////////////////////////////////////////////////////////////////////////////
+
+#include "BatchRenderer.h"
+#include "PngEncoder.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+// declaration of the global variables and defines
+namespace
+{
+	// read backs in flight - the oldest is mapped when the slot comes
+	// around again, by which time the GPU has long finished it
+	const int g_ReadbackSlots = 3;
+
+	// frames every pose is drawn before the one that is read back,
+	// so the streamed textures and the mesh detail levels have seen
+	// the view once - the read back also waits for the refinements
+	// the upload limit of a frame held back
+	const int g_SettleFrames = 1;
+
+	// longest time to wait for the GPU to finish a read back
+	const GLuint64 g_FenceTimeout = 1000000000; // one second in nanoseconds
+}
+
+/***********************************************************
+ *  BatchRenderer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+BatchRenderer::BatchRenderer()
+{
+	m_width = 0;
+	m_height = 0;
+	m_framebuffer = 0;
+	m_colorBuffer = 0;
+	m_depthBuffer = 0;
+	m_nextSlot = 0;
+	m_pendingSlots = 0;
+	m_poseIndex = 0;
+	m_poseFrames = 0;
+	m_encodingImages = 0;
+	m_bRunning = false;
+	m_writtenImages = 0;
+	m_failedImages = 0;
+	m_startTime = CLOCK::now();
+	m_endTime = m_startTime;
+}
+
+/***********************************************************
+ *  ~BatchRenderer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+BatchRenderer::~BatchRenderer()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  LoadPoses()
+ *
+ *  This method is used for reading the camera poses from a
+ *  text file.  Every line that is not empty or a comment is
+ *  one pose, and a line that can not be read stops the load.
+ ***********************************************************/
+bool BatchRenderer::LoadPoses(const char* filename)
+{
+	std::ifstream file(filename);
+	std::string line;
+	int lineNumber = 0;
+
+	m_poses.clear();
+	if (!file.is_open())
+	{
+		std::cout << "ERROR: could not open the pose file " << filename << std::endl;
+		return(false);
+	}
+
+	while (std::getline(file, line))
+	{
+		lineNumber++;
+
+		size_t comment = line.find('#');
+		if (comment != std::string::npos)
+		{
+			line.erase(comment);
+		}
+
+		std::istringstream entry(line);
+		std::string token;
+		if (!(entry >> token))
+		{
+			continue;
+		}
+		entry.clear();
+		entry.seekg(0);
+
+		CAMERA_POSE pose;
+		entry >> pose.position.x >> pose.position.y >> pose.position.z
+			>> pose.target.x >> pose.target.y >> pose.target.z;
+		if (entry.fail())
+		{
+			std::cout << "ERROR: " << filename << "(" << lineNumber << "): expected <position x y z> <target x y z>" << std::endl;
+			m_poses.clear();
+			return(false);
+		}
+
+		m_poses.push_back(pose);
+	}
+
+	if (m_poses.empty())
+	{
+		std::cout << "ERROR: the pose file " << filename << " has no poses" << std::endl;
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for creating the framebuffer with an
+ *  RGBA color and a depth renderbuffer of the image size,
+ *  the pixel pack buffers of the read backs and the encoder
+ *  threads.
+ ***********************************************************/
+bool BatchRenderer::Create(int width, int height, const char* outputPrefix, int encoderThreadCount)
+{
+	GLint maxSize = 0;
+
+	if (m_framebuffer != 0)
+	{
+		return(true);
+	}
+
+	glGetIntegerv(GL_MAX_RENDERBUFFER_SIZE, &maxSize);
+	if ((width <= 0) || (height <= 0) || (width > maxSize) || (height > maxSize))
+	{
+		std::cout << "ERROR: batch images must be between 1 and " << maxSize << " pixels wide and high" << std::endl;
+		return(false);
+	}
+
+	m_width = width;
+	m_height = height;
+	m_outputPrefix = (NULL != outputPrefix) ? outputPrefix : "";
+
+	glGenRenderbuffers(1, &m_colorBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_colorBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, m_width, m_height);
+	glGenRenderbuffers(1, &m_depthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, m_width, m_height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &m_framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_colorBuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depthBuffer);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "ERROR: the batch framebuffer is not complete (0x" << std::hex << status << std::dec << ")" << std::endl;
+		Destroy();
+		return(false);
+	}
+
+	// the buffers are only read by the CPU, and written by the GPU
+	m_slots.resize(g_ReadbackSlots);
+	for (int i = 0; i < g_ReadbackSlots; i++)
+	{
+		glGenBuffers(1, &m_slots[i].pixelBuffer);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, m_slots[i].pixelBuffer);
+		glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)m_width * m_height * 4, NULL, GL_STREAM_READ);
+		m_slots[i].fence = 0;
+		m_slots[i].pose = -1;
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	m_nextSlot = 0;
+	m_pendingSlots = 0;
+
+	if (encoderThreadCount <= 0)
+	{
+		encoderThreadCount = (int)std::thread::hardware_concurrency() - 1;
+		if (encoderThreadCount < 1)
+		{
+			encoderThreadCount = 1;
+		}
+	}
+
+	m_poseIndex = 0;
+	m_poseFrames = 0;
+	m_writtenImages = 0;
+	m_failedImages = 0;
+	m_startTime = CLOCK::now();
+	m_endTime = m_startTime;
+
+	m_bRunning = true;
+	for (int i = 0; i < encoderThreadCount; i++)
+	{
+		m_encoders.push_back(std::thread(&BatchRenderer::EncoderMain, this));
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for retiring the read backs still in
+ *  flight, waiting for the encoders to write every queued
+ *  image, and releasing the GL objects and the threads.
+ ***********************************************************/
+void BatchRenderer::Destroy()
+{
+	while ((m_pendingSlots > 0) && m_bRunning)
+	{
+		RetireOldestSlot(true);
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		while (m_bRunning && (m_encodingImages > 0))
+		{
+			m_imageFinished.wait(lock);
+		}
+		m_bRunning = false;
+	}
+	m_workAvailable.notify_all();
+
+	for (int i = 0; i < m_encoders.size(); i++)
+	{
+		m_encoders[i].join();
+	}
+	m_encoders.clear();
+
+	for (int i = 0; i < m_freeImages.size(); i++)
+	{
+		delete m_freeImages[i];
+	}
+	m_freeImages.clear();
+
+	for (int i = 0; i < m_slots.size(); i++)
+	{
+		if (m_slots[i].fence != 0)
+		{
+			glDeleteSync(m_slots[i].fence);
+		}
+		glDeleteBuffers(1, &m_slots[i].pixelBuffer);
+	}
+	m_slots.clear();
+	m_pendingSlots = 0;
+
+	if (m_framebuffer != 0)
+	{
+		glDeleteFramebuffers(1, &m_framebuffer);
+		m_framebuffer = 0;
+	}
+	if (m_colorBuffer != 0)
+	{
+		glDeleteRenderbuffers(1, &m_colorBuffer);
+		m_colorBuffer = 0;
+	}
+	if (m_depthBuffer != 0)
+	{
+		glDeleteRenderbuffers(1, &m_depthBuffer);
+		m_depthBuffer = 0;
+	}
+}
+
+/***********************************************************
+ *  IsFinished()
+ *
+ *  This method is used for checking whether every pose was
+ *  drawn and read back.  The encoders may still be writing
+ *  the last images, which Destroy() waits for.
+ ***********************************************************/
+bool BatchRenderer::IsFinished() const
+{
+	return((m_poseIndex >= (int)m_poses.size()) && (m_pendingSlots == 0));
+}
+
+/***********************************************************
+ *  GetCameraPose()
+ *
+ *  This method is used for getting the camera pose of the
+ *  next frame.  The frames after the last pose, which only
+ *  retire the read backs, repeat the last pose.
+ ***********************************************************/
+void BatchRenderer::GetCameraPose(glm::vec3& position, glm::vec3& target) const
+{
+	if (m_poses.empty())
+	{
+		position = glm::vec3(0.0f, 5.0f, 12.0f);
+		target = glm::vec3(0.0f, 0.0f, 0.0f);
+		return;
+	}
+
+	int pose = (m_poseIndex < (int)m_poses.size()) ? m_poseIndex : (int)m_poses.size() - 1;
+	position = m_poses[pose].position;
+	target = m_poses[pose].target;
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for binding the framebuffer and its
+ *  viewport, so that the frame is drawn into the image.
+ ***********************************************************/
+void BatchRenderer::BeginFrame()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glViewport(0, 0, m_width, m_height);
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for reading back the frame when it
+ *  shows a settled pose, and for passing the earlier read
+ *  backs the GPU has finished to the encoders.  The read
+ *  back only queues a copy into a pixel pack buffer, so
+ *  neither step waits for the GPU unless every slot is in
+ *  flight or no pose is left to draw.
+ ***********************************************************/
+void BatchRenderer::EndFrame(bool bSceneReady)
+{
+	bool bCapture = false;
+
+	if (bSceneReady && (m_poseIndex < (int)m_poses.size()))
+	{
+		bCapture = (m_poseFrames >= g_SettleFrames);
+		m_poseFrames++;
+	}
+
+	if (bCapture)
+	{
+		// the slot being reused holds the oldest read back
+		if (m_pendingSlots == g_ReadbackSlots)
+		{
+			RetireOldestSlot(true);
+		}
+
+		READBACK_SLOT& slot = m_slots[m_nextSlot];
+
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffer);
+		glReadBuffer(GL_COLOR_ATTACHMENT0);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pixelBuffer);
+		glPixelStorei(GL_PACK_ALIGNMENT, 4);
+		glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+		slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		slot.pose = m_poseIndex;
+		m_nextSlot = (m_nextSlot + 1) % g_ReadbackSlots;
+		m_pendingSlots++;
+
+		m_poseIndex++;
+		m_poseFrames = 0;
+	}
+
+	// once the last pose is drawn there is nothing left to overlap with
+	bool bWait = (m_poseIndex >= (int)m_poses.size());
+	while ((m_pendingSlots > 0) && RetireOldestSlot(bWait))
+	{
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+/***********************************************************
+ *  RetireOldestSlot()
+ *
+ *  This method is used for copying the pixels of the oldest
+ *  read back out of its pixel pack buffer and queueing them
+ *  for the encoders.  The buffer is only mapped after its
+ *  fence has passed, so the map never stalls the pipeline.
+ ***********************************************************/
+bool BatchRenderer::RetireOldestSlot(bool bWait)
+{
+	if (m_pendingSlots == 0)
+	{
+		return(false);
+	}
+
+	int slotIndex = (m_nextSlot - m_pendingSlots + g_ReadbackSlots) % g_ReadbackSlots;
+	READBACK_SLOT& slot = m_slots[slotIndex];
+
+	// past the timeout the map below waits for the copy instead
+	GLenum result = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, bWait ? g_FenceTimeout : 0);
+	if (!bWait && (result != GL_ALREADY_SIGNALED) && (result != GL_CONDITION_SATISFIED))
+	{
+		return(false);
+	}
+	glDeleteSync(slot.fence);
+	slot.fence = 0;
+	m_pendingSlots--;
+
+	size_t imageSize = (size_t)m_width * m_height * 4;
+	bool bCopied = false;
+	std::vector<unsigned char>* pPixels = AcquireImage();
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pixelBuffer);
+	const void* pMapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)imageSize, GL_MAP_READ_BIT);
+	if (NULL != pMapped)
+	{
+		pPixels->assign((const unsigned char*)pMapped, (const unsigned char*)pMapped + imageSize);
+		bCopied = (glUnmapBuffer(GL_PIXEL_PACK_BUFFER) == GL_TRUE);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (!bCopied)
+	{
+		std::cout << "ERROR: could not map the read back of pose " << slot.pose << std::endl;
+		m_freeImages.push_back(pPixels);
+		m_failedImages++;
+		return(true);
+	}
+
+	ENCODE_JOB job;
+	job.pose = slot.pose;
+	job.pPixels = pPixels;
+	m_encodeQueue.push_back(job);
+	m_encodingImages++;
+	m_workAvailable.notify_one();
+
+	return(true);
+}
+
+/***********************************************************
+ *  AcquireImage()
+ *
+ *  This method is used for getting a buffer for the pixels
+ *  of the next read back.  When the encoders have more than
+ *  one image each to get through, the render loop waits for
+ *  one of them, so the renders can not run ahead of the
+ *  files and fill up the memory.
+ ***********************************************************/
+std::vector<unsigned char>* BatchRenderer::AcquireImage()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	int maxImages = 2 * (int)m_encoders.size();
+
+	while (m_bRunning && (m_encodingImages >= maxImages))
+	{
+		m_imageFinished.wait(lock);
+	}
+
+	if (m_freeImages.empty())
+	{
+		return(new std::vector<unsigned char>());
+	}
+
+	std::vector<unsigned char>* pPixels = m_freeImages.back();
+	m_freeImages.pop_back();
+
+	return(pPixels);
+}
+
+/***********************************************************
+ *  EncoderMain()
+ *
+ *  This method is used for the loop of each encoder thread.
+ *  Every encoder keeps its own PNG encoder, so the working
+ *  memory of one image is reused by the next.
+ ***********************************************************/
+void BatchRenderer::EncoderMain()
+{
+	PngEncoder encoder;
+	char filename[1024];
+
+	for (;;)
+	{
+		ENCODE_JOB job;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+
+			while (m_bRunning && m_encodeQueue.empty())
+			{
+				m_workAvailable.wait(lock);
+			}
+			if (m_encodeQueue.empty())
+			{
+				return;
+			}
+
+			job = m_encodeQueue.front();
+			m_encodeQueue.pop_front();
+		}
+
+		snprintf(filename, sizeof(filename), "%s_%04d.png", m_outputPrefix.c_str(), job.pose);
+
+		// the read back rows start at the bottom of the image
+		bool bWritten = encoder.WriteFile(filename, job.pPixels->data(), m_width, m_height, m_width * 4, true);
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (bWritten)
+		{
+			m_writtenImages++;
+			m_endTime = CLOCK::now();
+		}
+		else
+		{
+			m_failedImages++;
+		}
+		m_freeImages.push_back(job.pPixels);
+		m_encodingImages--;
+		m_imageFinished.notify_all();
+	}
+}
+
+/***********************************************************
+ *  PrintReport()
+ *
+ *  This method is used for printing the number of images
+ *  written and how fast they were written.
+ ***********************************************************/
+void BatchRenderer::PrintReport() const
+{
+	double seconds = std::chrono::duration<double>(m_endTime - m_startTime).count();
+
+	std::cout << "Batch render: " << m_writtenImages << " of " << m_poses.size() << " images at "
+		<< m_width << "x" << m_height << " written to " << m_outputPrefix << "_NNNN.png" << std::endl;
+	if ((m_writtenImages > 0) && (seconds > 0.0))
+	{
+		std::cout << "  " << seconds << " s, " << (m_writtenImages / seconds) << " images/s" << std::endl;
+	}
+	if (m_failedImages > 0)
+	{
+		std::cout << "  FAILED: " << m_failedImages << " images could not be written" << std::endl;
+	}
+}
@@ -0,0 +1,151 @@
+///////////////////////////////////////////////////////////////////////////////
+// batchrenderer.h
+// ============
+// render a list of camera poses offscreen and write each view to a PNG file
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  BatchRenderer
+ *
+ *  This class contains the code for the batch render mode.
+ *  The scene is drawn into a framebuffer object of any size
+ *  instead of the window, once per camera pose from a pose
+ *  file.  The pixels of each view are read back into one of a
+ *  few pixel pack buffers without waiting, and the buffer is
+ *  only mapped frames later once its fence has passed.  The
+ *  mapped pixels are copied out and handed to the encoder
+ *  threads, which write the PNG files while the GPU already
+ *  draws the next views.
+ ***********************************************************/
+class BatchRenderer
+{
+public:
+	// constructor
+	BatchRenderer();
+	// destructor
+	~BatchRenderer();
+
+	// read the camera poses, one per line as <position x y z> and
+	// <target x y z>, with # starting a comment
+	bool LoadPoses(const char* filename);
+	// number of poses read
+	int GetPoseCount() const { return((int)m_poses.size()); }
+
+	// create the framebuffer and the pixel pack buffers and start the
+	// encoder threads, zero picks one per spare CPU core - the files
+	// are named after the output prefix and the pose number
+	bool Create(int width, int height, const char* outputPrefix, int encoderThreadCount = 0);
+	// wait for the remaining images and release everything
+	void Destroy();
+
+	// size of the rendered images
+	int GetWidth() const { return(m_width); }
+	int GetHeight() const { return(m_height); }
+
+	// true once every pose was rendered and read back
+	bool IsFinished() const;
+	// the camera position and the point it looks at for the next frame
+	void GetCameraPose(glm::vec3& position, glm::vec3& target) const;
+
+	// draw the next frame into the framebuffer
+	void BeginFrame();
+	// start the read back of the frame and pass the finished read backs
+	// to the encoders - with bSceneReady false the frame only warms up
+	// the scene and no pose is taken
+	void EndFrame(bool bSceneReady);
+
+	// print the number of images written and the time it took
+	void PrintReport() const;
+	// false when an image could not be written
+	bool HasPassed() const { return(m_failedImages == 0); }
+
+private:
+	typedef std::chrono::steady_clock CLOCK;
+
+	// one camera pose of the pose file
+	struct CAMERA_POSE
+	{
+		glm::vec3 position;
+		glm::vec3 target;
+	};
+
+	// a pixel pack buffer the pixels of a view are read into
+	struct READBACK_SLOT
+	{
+		GLuint pixelBuffer;
+		GLsync fence;
+		int pose;
+	};
+
+	// the pixels of a view waiting for or being written by an encoder
+	struct ENCODE_JOB
+	{
+		int pose;
+		std::vector<unsigned char>* pPixels;
+	};
+
+	// the poses to render, and the output file prefix
+	std::vector<CAMERA_POSE> m_poses;
+	std::string m_outputPrefix;
+
+	// size of the images and the framebuffer
+	int m_width;
+	int m_height;
+	GLuint m_framebuffer;
+	GLuint m_colorBuffer;
+	GLuint m_depthBuffer;
+
+	// the pixel pack buffers, used in turn - the read backs that are
+	// in flight are the m_pendingSlots slots before m_nextSlot
+	std::vector<READBACK_SLOT> m_slots;
+	int m_nextSlot;
+	int m_pendingSlots;
+
+	// the pose the next frame shows, and the frames it was drawn so far
+	int m_poseIndex;
+	int m_poseFrames;
+
+	// the encoder threads and their queue
+	std::vector<std::thread> m_encoders;
+	std::deque<ENCODE_JOB> m_encodeQueue;
+	// image buffers that are not in use, so the copies reuse their room
+	std::vector<std::vector<unsigned char>*> m_freeImages;
+	// guards the queue, the free images and the counts below
+	std::mutex m_mutex;
+	// wakes the encoders when an image is queued or on shutdown
+	std::condition_variable m_workAvailable;
+	// wakes the render thread when an encoder finished an image
+	std::condition_variable m_imageFinished;
+	// images handed to the encoders that are not written yet
+	int m_encodingImages;
+	bool m_bRunning;
+
+	// images written and images that failed
+	int m_writtenImages;
+	int m_failedImages;
+	// time the framebuffer was created and the last image was written
+	CLOCK::time_point m_startTime;
+	CLOCK::time_point m_endTime;
+
+	// the loop of each encoder thread
+	void EncoderMain();
+	// map the oldest read back, waiting for its fence when bWait is true,
+	// and queue its pixels - returns false when it is not done yet
+	bool RetireOldestSlot(bool bWait);
+	// an image buffer for the next copy, waiting for an encoder if
+	// too many images are queued already
+	std::vector<unsigned char>* AcquireImage();
+};
@@ -0,0 +1,175 @@
+///////////////////////////////////////////////////////////////////////////////
+// benchmarkrunner.cpp
+// ============
+// drive a scripted camera path for a fixed number of frames and report timings
+///////////////////////////////////////////////////////////////////////////////
+
+#include "BenchmarkRunner.h"
+#include "HeapCounter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// declaration of the global variables and defines
+namespace
+{
+	// fewest frames rendered before measuring, so driver shader
+	// compiles do not end up in the results - the warm up also
+	// lasts until the texture loads are done
+	const int g_WarmupFrames = 30;
+
+	// the camera circles the desk once per run while moving in
+	// and out, so objects leave and enter the view frustum
+	const glm::vec3 g_PathCenter = glm::vec3(-0.8f, 1.5f, 0.0f);
+	const float g_PathRadius = 11.0f;
+	const float g_PathRadiusSwing = 5.0f;
+	const float g_PathHeight = 5.0f;
+	const float g_PathHeightSwing = 2.0f;
+	const float g_TwoPi = 6.28318530718f;
+}
+
+/***********************************************************
+ *  BenchmarkRunner()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+BenchmarkRunner::BenchmarkRunner(int frameCount, bool bRequireNoAllocations)
+{
+	m_frameCount = (frameCount > 0) ? frameCount : 1;
+	m_warmupFrames = g_WarmupFrames;
+	m_frameIndex = 0;
+	m_lastFrameEnd = CLOCK::now();
+	m_measureStart = m_lastFrameEnd;
+	m_frameMs.reserve(m_frameCount);
+	m_gpuMsTotal = 0.0;
+	m_drawCallTotal = 0.0;
+	m_lastAllocationCount = HeapCounter::GetAllocationCount();
+	m_allocationTotal = 0;
+	m_allocationMax = 0;
+	m_firstAllocatingFrame = -1;
+	m_bRequireNoAllocations = bRequireNoAllocations;
+}
+
+/***********************************************************
+ *  GetCameraPose()
+ *
+ *  This method is used for getting the camera position and
+ *  target of the current frame.  The warm up frames repeat
+ *  the first pose of the path.
+ ***********************************************************/
+void BenchmarkRunner::GetCameraPose(glm::vec3& position, glm::vec3& target) const
+{
+	int pathFrame = std::max(m_frameIndex - m_warmupFrames, 0);
+	float t = (float)pathFrame / (float)m_frameCount;
+	float angle = t * g_TwoPi;
+	float radius = g_PathRadius + g_PathRadiusSwing * std::sin(angle * 2.0f);
+
+	position = g_PathCenter + glm::vec3(
+		radius * std::sin(angle),
+		g_PathHeight + g_PathHeightSwing * std::cos(angle * 3.0f),
+		radius * std::cos(angle));
+	target = g_PathCenter;
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for recording the time and the heap
+ *  allocations since the end of the previous frame, once the
+ *  warm up is over.  While the scene is not ready the warm up
+ *  is extended by a frame, so the decodes and uploads of the
+ *  textures never land in the measured frames.
+ ***********************************************************/
+void BenchmarkRunner::EndFrame(const FrameProfiler::FRAME_STATS& stats, bool bSceneReady)
+{
+	CLOCK::time_point now = CLOCK::now();
+	unsigned long allocationCount = HeapCounter::GetAllocationCount();
+	unsigned long frameAllocations = allocationCount - m_lastAllocationCount;
+
+	if (!bSceneReady && (m_frameIndex < m_warmupFrames))
+	{
+		m_warmupFrames = std::max(m_warmupFrames, m_frameIndex + 2);
+	}
+
+	if (m_frameIndex == m_warmupFrames)
+	{
+		m_measureStart = m_lastFrameEnd;
+	}
+
+	if (m_frameIndex >= m_warmupFrames)
+	{
+		m_frameMs.push_back(std::chrono::duration<double, std::milli>(now - m_lastFrameEnd).count());
+		m_gpuMsTotal += stats.gpuMs[FrameProfiler::GPU_PASS_SCENE];
+		m_drawCallTotal += stats.counters[FrameProfiler::COUNTER_DRAW_CALLS];
+
+		m_allocationTotal += frameAllocations;
+		m_allocationMax = std::max(m_allocationMax, frameAllocations);
+		if ((frameAllocations > 0) && (m_firstAllocatingFrame < 0))
+		{
+			m_firstAllocatingFrame = m_frameIndex - m_warmupFrames;
+		}
+	}
+
+	m_lastAllocationCount = allocationCount;
+	m_lastFrameEnd = now;
+	m_frameIndex++;
+}
+
+/***********************************************************
+ *  PrintReport()
+ *
+ *  This method is used for printing the mean, median, 99th
+ *  percentile and worst frame time of the measured frames,
+ *  and the frames per second over the whole run.
+ ***********************************************************/
+void BenchmarkRunner::PrintReport() const
+{
+	if (m_frameMs.empty())
+	{
+		std::cout << "BENCHMARK: no frames were measured" << std::endl;
+		return;
+	}
+
+	std::vector<double> sorted = m_frameMs;
+	double totalMs = 0.0;
+	int count = (int)sorted.size();
+
+	std::sort(sorted.begin(), sorted.end());
+	for (int i = 0; i < count; i++)
+	{
+		totalMs += sorted[i];
+	}
+
+	// nearest rank percentiles
+	double p50 = sorted[(count - 1) * 50 / 100];
+	double p99 = sorted[(count - 1) * 99 / 100];
+	double wallSeconds = std::chrono::duration<double>(m_lastFrameEnd - m_measureStart).count();
+
+	std::cout << "BENCHMARK: " << count << " frames after " << m_warmupFrames << " warm up frames" << std::endl;
+	std::cout << "BENCHMARK: frame mean " << totalMs / count << " ms" << std::endl;
+	std::cout << "BENCHMARK: frame p50  " << p50 << " ms" << std::endl;
+	std::cout << "BENCHMARK: frame p99  " << p99 << " ms" << std::endl;
+	std::cout << "BENCHMARK: frame max  " << sorted[count - 1] << " ms" << std::endl;
+	std::cout << "BENCHMARK: gpu mean   " << m_gpuMsTotal / count << " ms" << std::endl;
+	std::cout << "BENCHMARK: draws/frame " << m_drawCallTotal / count << std::endl;
+	std::cout << "BENCHMARK: throughput " << ((wallSeconds > 0.0) ? count / wallSeconds : 0.0) << " frames/s" << std::endl;
+	std::cout << "BENCHMARK: heap allocs/frame " << (double)m_allocationTotal / count << " (max " << m_allocationMax << ")" << std::endl;
+
+	if (!HasPassed())
+	{
+		std::cout << "BENCHMARK: FAILED - " << m_allocationTotal << " heap allocations in the measured frames, the first in frame "
+			<< m_firstAllocatingFrame << std::endl;
+	}
+}
+
+/***********************************************************
+ *  HasPassed()
+ *
+ *  This method is used for checking the requirements of the
+ *  run, which for now is only the one on heap allocations.
+ ***********************************************************/
+bool BenchmarkRunner::HasPassed() const
+{
+	return(!m_bRequireNoAllocations || (m_allocationTotal == 0));
+}
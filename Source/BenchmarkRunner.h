@@ -0,0 +1,79 @@
+///////////////////////////////////////////////////////////////////////////////
+// benchmarkrunner.h
+// ============
+// drive a scripted camera path for a fixed number of frames and report timings
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "FrameProfiler.h"
+
+#include <glm/glm.hpp>
+
+#include <chrono>
+#include <vector>
+
+/***********************************************************
+ *  BenchmarkRunner
+ *
+ *  This class contains the code for the benchmark mode.  The
+ *  camera follows a path that depends only on the frame
+ *  number, so every run renders exactly the same frames, and
+ *  the frame times are summarized once the run is over.  The
+ *  heap allocations of the measured frames are counted too,
+ *  and the run can be made to fail when there are any.
+ ***********************************************************/
+class BenchmarkRunner
+{
+public:
+	// constructor - with bRequireNoAllocations the run fails when a
+	// measured frame allocates from the heap
+	BenchmarkRunner(int frameCount, bool bRequireNoAllocations);
+
+	// true once all of the frames were rendered
+	bool IsFinished() const { return(m_frameIndex >= m_warmupFrames + m_frameCount); }
+
+	// the camera position and the point it looks at for the current frame
+	void GetCameraPose(glm::vec3& position, glm::vec3& target) const;
+
+	// record the end of a frame and its profiler measurements - with
+	// bSceneReady false the textures still load, so the warm up goes on
+	void EndFrame(const FrameProfiler::FRAME_STATS& stats, bool bSceneReady);
+
+	// print the frame time statistics of the measured frames
+	void PrintReport() const;
+	// false when the run broke one of its requirements
+	bool HasPassed() const;
+
+private:
+	typedef std::chrono::steady_clock CLOCK;
+
+	// number of measured frames
+	int m_frameCount;
+	// number of frames rendered before measuring starts, at least
+	// g_WarmupFrames and more while the textures load
+	int m_warmupFrames;
+	// the frame being rendered, counting the warm up frames
+	int m_frameIndex;
+	// end time of the previous frame
+	CLOCK::time_point m_lastFrameEnd;
+	// start time of the first measured frame
+	CLOCK::time_point m_measureStart;
+
+	// per measured frame times in milliseconds
+	std::vector<double> m_frameMs;
+	// sums over the measured frames
+	double m_gpuMsTotal;
+	double m_drawCallTotal;
+
+	// heap allocation count at the end of the previous frame
+	unsigned long m_lastAllocationCount;
+	// heap allocations of the measured frames, in total and in the
+	// frame with the most of them
+	unsigned long m_allocationTotal;
+	unsigned long m_allocationMax;
+	// first measured frame that allocated, -1 when none did
+	int m_firstAllocatingFrame;
+	// true when a measured frame may not allocate
+	bool m_bRequireNoAllocations;
+};
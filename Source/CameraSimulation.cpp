@@ -0,0 +1,282 @@
+///////////////////////////////////////////////////////////////////////////////
+// camerasimulation.cpp
+// ============
+// move the camera at a fixed rate on its own thread, apart from rendering
+///////////////////////////////////////////////////////////////////////////////
+
+#include "CameraSimulation.h"
+
+// declaration of the global variables and defines
+namespace
+{
+	// steps the simulation may fall behind, for example while the
+	// process is suspended, before it drops them instead of catching up
+	const int g_MaxLateTicks = 8;
+}
+
+/***********************************************************
+ *  CameraSimulation()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+CameraSimulation::CameraSimulation()
+{
+	m_pCamera = NULL;
+	m_bOrthographic = false;
+	m_appliedMouseX = 0.0;
+	m_appliedMouseY = 0.0;
+	m_appliedScroll = 0.0;
+	m_bRunning = false;
+}
+
+/***********************************************************
+ *  ~CameraSimulation()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+CameraSimulation::~CameraSimulation()
+{
+	Stop();
+	m_pCamera = NULL;
+}
+
+/***********************************************************
+ *  Start()
+ *
+ *  This method is used for starting the simulation thread.
+ *  The current camera is published first, so the renderer
+ *  has a camera before the first step is taken.
+ ***********************************************************/
+void CameraSimulation::Start(Camera* pCamera, bool bOrthographic)
+{
+	if (m_bRunning || (NULL == pCamera))
+	{
+		return;
+	}
+
+	m_pCamera = pCamera;
+	m_bOrthographic = bOrthographic;
+	m_previousState = CaptureState();
+	PublishCamera(CLOCK::now());
+
+	m_bRunning = true;
+	m_thread = std::thread(&CameraSimulation::SimulationMain, this);
+}
+
+/***********************************************************
+ *  Stop()
+ *
+ *  This method is used for stopping and joining the
+ *  simulation thread.  The camera is left where the last
+ *  step put it.
+ ***********************************************************/
+void CameraSimulation::Stop()
+{
+	m_bRunning = false;
+	if (m_thread.joinable())
+	{
+		m_thread.join();
+	}
+}
+
+/***********************************************************
+ *  SetInput()
+ *
+ *  This method is used for handing the latest sampled input
+ *  to the simulation thread.
+ ***********************************************************/
+void CameraSimulation::SetInput(const INPUT_STATE& input)
+{
+	m_input.GetWriteBuffer() = input;
+	m_input.Publish();
+}
+
+/***********************************************************
+ *  GetCameraState()
+ *
+ *  This method is used for getting the camera between the
+ *  last two steps, by how far the time has moved on from the
+ *  last step.  The blend trails the simulation by at most
+ *  one step, in exchange the motion stays smooth at any
+ *  frame rate.
+ ***********************************************************/
+void CameraSimulation::GetCameraState(CAMERA_STATE& state)
+{
+	m_cameraFrames.Update();
+
+	const CAMERA_FRAME& frame = m_cameraFrames.GetReadBuffer();
+	double elapsed = std::chrono::duration<double>(CLOCK::now() - frame.tickTime).count();
+	float alpha = glm::clamp((float)(elapsed * TICK_RATE), 0.0f, 1.0f);
+
+	state.position = glm::mix(frame.previous.position, frame.current.position, alpha);
+	state.front = glm::normalize(glm::mix(frame.previous.front, frame.current.front, alpha));
+	state.up = glm::normalize(glm::mix(frame.previous.up, frame.current.up, alpha));
+	state.zoom = glm::mix(frame.previous.zoom, frame.current.zoom, alpha);
+	state.bOrthographic = frame.current.bOrthographic;
+}
+
+/***********************************************************
+ *  SimulationMain()
+ *
+ *  This method is the loop of the simulation thread.  Every
+ *  step is scheduled from the previous one rather than from
+ *  when the thread woke up, so the rate does not drift.
+ ***********************************************************/
+void CameraSimulation::SimulationMain()
+{
+	const CLOCK::duration step = std::chrono::duration_cast<CLOCK::duration>(
+		std::chrono::duration<double>(1.0 / TICK_RATE));
+	CLOCK::time_point nextTick = CLOCK::now() + step;
+
+	while (m_bRunning)
+	{
+		std::this_thread::sleep_until(nextTick);
+
+		Tick(1.0f / TICK_RATE);
+		PublishCamera(nextTick);
+
+		nextTick += step;
+		CLOCK::time_point now = CLOCK::now();
+		if (now - nextTick > step * g_MaxLateTicks)
+		{
+			nextTick = now;
+		}
+	}
+}
+
+/***********************************************************
+ *  Tick()
+ *
+ *  This method is used for moving the camera by one step of
+ *  the latest sampled input.  The mouse moves the camera by
+ *  the part of its totals that was not applied yet.
+ ***********************************************************/
+void CameraSimulation::Tick(float deltaTime)
+{
+	m_input.Update();
+
+	const INPUT_STATE& input = m_input.GetReadBuffer();
+
+	// process camera zooming in and out
+	if ((input.keys & KEY_FORWARD) != 0)
+	{
+		m_pCamera->ProcessKeyboard(FORWARD, deltaTime);
+	}
+	if ((input.keys & KEY_BACKWARD) != 0)
+	{
+		m_pCamera->ProcessKeyboard(BACKWARD, deltaTime);
+	}
+
+	// process camera panning left and right
+	if ((input.keys & KEY_LEFT) != 0)
+	{
+		m_pCamera->ProcessKeyboard(LEFT, deltaTime);
+	}
+	if ((input.keys & KEY_RIGHT) != 0)
+	{
+		m_pCamera->ProcessKeyboard(RIGHT, deltaTime);
+	}
+
+	// process camera upward and downward movement
+	if ((input.keys & KEY_UP) != 0)
+	{
+		m_pCamera->ProcessKeyboard(UP, deltaTime);
+	}
+	if ((input.keys & KEY_DOWN) != 0)
+	{
+		m_pCamera->ProcessKeyboard(DOWN, deltaTime);
+	}
+
+	// move the 3D camera by the mouse movement since the last step
+	if ((input.mouseX != m_appliedMouseX) || (input.mouseY != m_appliedMouseY))
+	{
+		m_pCamera->ProcessMouseMovement((float)(input.mouseX - m_appliedMouseX), (float)(input.mouseY - m_appliedMouseY));
+		m_appliedMouseX = input.mouseX;
+		m_appliedMouseY = input.mouseY;
+	}
+	if (input.scroll != m_appliedScroll)
+	{
+		m_pCamera->ProcessMouseScroll((float)(input.scroll - m_appliedScroll));
+		m_appliedScroll = input.scroll;
+	}
+
+	// change between different projection views
+	if ((input.keys & KEY_VIEW_P) != 0)
+	{
+		// change to a multi-view orthographic projection
+		m_bOrthographic = true;
+
+		// change the camera settings to show a front orthographic view
+		m_pCamera->Position = glm::vec3(0.0f, 4.0f, 10.0f);
+		m_pCamera->Up = glm::vec3(0.0f, 1.0f, 0.0f);
+		m_pCamera->Front = glm::vec3(0.0f, 0.0f, -1.0f);
+	}
+	if ((input.keys & KEY_VIEW_O) != 0)
+	{
+		// change to a multi-view orthographic projection
+		m_bOrthographic = true;
+
+		// change the camera settings to show a side orthographic view
+		m_pCamera->Position = glm::vec3(10.0f, 4.0f, 0.0f);
+		m_pCamera->Up = glm::vec3(0.0f, 1.0f, 0.0f);
+		m_pCamera->Front = glm::vec3(-1.0f, 0.0f, 0.0f);
+	}
+	if ((input.keys & KEY_VIEW_P) != 0)
+	{
+		// change to a multi-view orthographic projection
+		m_bOrthographic = true;
+
+		// change the camera settings to show a top orthographic view
+		m_pCamera->Position = glm::vec3(0.0f, 7.0f, 0.0f);
+		m_pCamera->Up = glm::vec3(-1.0f, 0.0f, 0.0f);
+		m_pCamera->Front = glm::vec3(0.0f, -1.0f, 0.0f);
+	}
+	if ((input.keys & KEY_VIEW_O) != 0)
+	{
+		// change to perspective projection
+		m_bOrthographic = true;
+
+		// change the camera settings to show a perspective view
+		m_pCamera->Position = glm::vec3(0.0f, 5.5f, 8.0f);
+		m_pCamera->Front = glm::vec3(0.0f, -0.5f, -2.0f);
+		m_pCamera->Up = glm::vec3(0.0f, 1.0f, 0.0f);
+		m_pCamera->Zoom = 80;
+	}
+}
+
+/***********************************************************
+ *  PublishCamera()
+ *
+ *  This method is used for handing the camera of the last
+ *  two steps to the renderer.
+ ***********************************************************/
+void CameraSimulation::PublishCamera(CLOCK::time_point tickTime)
+{
+	CAMERA_FRAME& frame = m_cameraFrames.GetWriteBuffer();
+
+	frame.previous = m_previousState;
+	frame.current = CaptureState();
+	frame.tickTime = tickTime;
+	m_cameraFrames.Publish();
+
+	m_previousState = frame.current;
+}
+
+/***********************************************************
+ *  CaptureState()
+ *
+ *  This method is used for copying the camera values the
+ *  renderer needs.
+ ***********************************************************/
+CameraSimulation::CAMERA_STATE CameraSimulation::CaptureState() const
+{
+	CAMERA_STATE state;
+
+	state.position = m_pCamera->Position;
+	state.front = m_pCamera->Front;
+	state.up = m_pCamera->Up;
+	state.zoom = m_pCamera->Zoom;
+	state.bOrthographic = m_bOrthographic;
+
+	return(state);
+}
@@ -0,0 +1,129 @@
+///////////////////////////////////////////////////////////////////////////////
+// camerasimulation.h
+// ============
+// move the camera at a fixed rate on its own thread, apart from rendering
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "camera.h"
+#include "TripleBuffer.h"
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+/***********************************************************
+ *  CameraSimulation
+ *
+ *  This class contains the code for updating the camera from
+ *  the keyboard and mouse at a fixed rate on a thread of its
+ *  own, so the camera moves the same however long a frame
+ *  takes to render.  GLFW only reads input on the main
+ *  thread, so the main thread samples it and publishes it to
+ *  the simulation, and the simulation publishes the camera
+ *  of its last two steps back.  The renderer blends between
+ *  them by the time passed since the last step.  Both sides
+ *  hand their values over through triple buffers.
+ ***********************************************************/
+class CameraSimulation
+{
+public:
+	// constructor
+	CameraSimulation();
+	// destructor
+	~CameraSimulation();
+
+	// camera steps per second
+	static const int TICK_RATE = 120;
+
+	// the keys held down while the input was sampled
+	enum INPUT_KEY
+	{
+		KEY_FORWARD = 0x01,
+		KEY_BACKWARD = 0x02,
+		KEY_LEFT = 0x04,
+		KEY_RIGHT = 0x08,
+		KEY_UP = 0x10,
+		KEY_DOWN = 0x20,
+		KEY_VIEW_P = 0x40,
+		KEY_VIEW_O = 0x80
+	};
+
+	// the input sampled on the main thread - the mouse values are
+	// running totals, so no movement is lost when a sample is skipped
+	struct INPUT_STATE
+	{
+		uint32_t keys;
+		double mouseX;
+		double mouseY;
+		double scroll;
+	};
+
+	// what the renderer needs of the camera
+	struct CAMERA_STATE
+	{
+		glm::vec3 position;
+		glm::vec3 front;
+		glm::vec3 up;
+		float zoom;
+		bool bOrthographic;
+	};
+
+	// start stepping the camera, which is only touched by the
+	// simulation thread until Stop() returns
+	void Start(Camera* pCamera, bool bOrthographic);
+	// stop and join the simulation thread
+	void Stop();
+	// true while the simulation thread owns the camera
+	bool IsRunning() const { return(m_bRunning); }
+	// the projection picked by the view keys, valid after Stop()
+	bool IsOrthographic() const { return(m_bOrthographic); }
+
+	// hand the latest input to the simulation - main thread only
+	void SetInput(const INPUT_STATE& input);
+	// the camera blended to the current time - render thread only
+	void GetCameraState(CAMERA_STATE& state);
+
+private:
+	typedef std::chrono::steady_clock CLOCK;
+
+	// the camera of the last two steps and when the last one was taken
+	struct CAMERA_FRAME
+	{
+		CAMERA_STATE previous;
+		CAMERA_STATE current;
+		CLOCK::time_point tickTime;
+	};
+
+	// the camera stepped by the simulation thread
+	Camera* m_pCamera;
+	// true while the last view key picked the orthographic projection
+	bool m_bOrthographic;
+	// the mouse totals already applied to the camera
+	double m_appliedMouseX;
+	double m_appliedMouseY;
+	double m_appliedScroll;
+	// the camera of the previous step
+	CAMERA_STATE m_previousState;
+
+	// main thread to simulation thread
+	TripleBuffer<INPUT_STATE> m_input;
+	// simulation thread to render thread
+	TripleBuffer<CAMERA_FRAME> m_cameraFrames;
+
+	std::thread m_thread;
+	std::atomic<bool> m_bRunning;
+
+	// the loop of the simulation thread
+	void SimulationMain();
+	// move the camera by one step of the latest input
+	void Tick(float deltaTime);
+	// publish the camera after a step
+	void PublishCamera(CLOCK::time_point tickTime);
+	// the camera values the renderer needs
+	CAMERA_STATE CaptureState() const;
+};
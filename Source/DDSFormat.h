@@ -0,0 +1,91 @@
+///////////////////////////////////////////////////////////////////////////////
+// ddsformat.h
+// ============
+// layout of the DDS container used for the baked, block compressed textures
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// the first four bytes of every DDS file - "DDS "
+const uint32_t DDS_MAGIC = 0x20534444;
+
+// header flags
+const uint32_t DDSD_CAPS = 0x00000001;
+const uint32_t DDSD_HEIGHT = 0x00000002;
+const uint32_t DDSD_WIDTH = 0x00000004;
+const uint32_t DDSD_PIXELFORMAT = 0x00001000;
+const uint32_t DDSD_MIPMAPCOUNT = 0x00020000;
+const uint32_t DDSD_LINEARSIZE = 0x00080000;
+
+// pixel format flags
+const uint32_t DDPF_FOURCC = 0x00000004;
+
+// capability flags
+const uint32_t DDSCAPS_COMPLEX = 0x00000008;
+const uint32_t DDSCAPS_TEXTURE = 0x00001000;
+const uint32_t DDSCAPS_MIPMAP = 0x00400000;
+
+// four character codes of the supported block formats
+const uint32_t DDS_FOURCC_DXT1 = 0x31545844;	// BC1 - RGB, 8 bytes per block
+const uint32_t DDS_FOURCC_DXT5 = 0x35545844;	// BC3 - RGBA, 16 bytes per block
+
+#pragma pack(push, 1)
+
+// the pixel format part of the DDS header
+struct DDS_PIXELFORMAT
+{
+	uint32_t size;
+	uint32_t flags;
+	uint32_t fourCC;
+	uint32_t RGBBitCount;
+	uint32_t RBitMask;
+	uint32_t GBitMask;
+	uint32_t BBitMask;
+	uint32_t ABitMask;
+};
+
+// the DDS header that follows the magic number - the mip
+// levels follow it from the largest to the smallest
+struct DDS_HEADER
+{
+	uint32_t size;
+	uint32_t flags;
+	uint32_t height;
+	uint32_t width;
+	uint32_t pitchOrLinearSize;
+	uint32_t depth;
+	uint32_t mipMapCount;
+	uint32_t reserved1[11];
+	DDS_PIXELFORMAT pixelFormat;
+	uint32_t caps;
+	uint32_t caps2;
+	uint32_t caps3;
+	uint32_t caps4;
+	uint32_t reserved2;
+};
+
+#pragma pack(pop)
+
+// bytes of one mip level of a block compressed image
+inline uint32_t DDSLevelSize(uint32_t width, uint32_t height, uint32_t blockBytes)
+{
+	return(((width + 3) / 4) * ((height + 3) / 4) * blockBytes);
+}
+
+// path of the baked DDS file that TextureBaker writes next to an image file
+inline std::string BakedTexturePath(const std::string& filename)
+{
+	size_t extension = filename.find_last_of('.');
+	size_t separator = filename.find_last_of("/\\");
+
+	if ((extension == std::string::npos) ||
+		((separator != std::string::npos) && (extension < separator)))
+	{
+		return(filename + ".dds");
+	}
+
+	return(filename.substr(0, extension) + ".dds");
+}
@@ -0,0 +1,133 @@
+///////////////////////////////////////////////////////////////////////////////
+// depthprepass.cpp
+// ============
+// lay down the scene depth first so only visible fragments are shaded
+///////////////////////////////////////////////////////////////////////////////
+
+#include "DepthPrepass.h"
+#include "ShaderProgram.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+/***********************************************************
+ *  DepthPrepass()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+DepthPrepass::DepthPrepass()
+{
+	m_program = 0;
+	m_modelLocation = -1;
+	m_useInstancingLocation = -1;
+	m_useStaticGeometryLocation = -1;
+	m_previousProgram = 0;
+}
+
+/***********************************************************
+ *  ~DepthPrepass()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+DepthPrepass::~DepthPrepass()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for compiling the depth-only program
+ *  and resolving its uniform locations.
+ ***********************************************************/
+bool DepthPrepass::Create(const char* vertexShaderPath, const char* fragmentShaderPath)
+{
+	m_program = ShaderProgram::Load(vertexShaderPath, fragmentShaderPath);
+	if (m_program == 0)
+	{
+		return(false);
+	}
+
+	m_modelLocation = glGetUniformLocation(m_program, "model");
+	m_useInstancingLocation = glGetUniformLocation(m_program, "bUseInstancing");
+	m_useStaticGeometryLocation = glGetUniformLocation(m_program, "bUseStaticGeometry");
+
+	return(true);
+}
+
+/***********************************************************
+ *  BeginDepthPass()
+ *
+ *  This method is used for switching to the depth-only
+ *  program.  The scene program is remembered so the shading
+ *  pass can switch back to it.
+ ***********************************************************/
+void DepthPrepass::BeginDepthPass(bool bUseInstancing, bool bUseStaticGeometry)
+{
+	GLint currentProgram = 0;
+
+	glGetIntegerv(GL_CURRENT_PROGRAM, &currentProgram);
+	m_previousProgram = (GLuint)currentProgram;
+
+	glUseProgram(m_program);
+	glUniform1i(m_useInstancingLocation, bUseInstancing ? 1 : 0);
+	glUniform1i(m_useStaticGeometryLocation, bUseStaticGeometry ? 1 : 0);
+	glUniformMatrix4fv(m_modelLocation, 1, GL_FALSE, glm::value_ptr(glm::mat4(1.0f)));
+
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	glDepthMask(GL_TRUE);
+	glDepthFunc(GL_LESS);
+}
+
+/***********************************************************
+ *  SetModel()
+ *
+ *  This method is used for setting the model matrix of the
+ *  next per-object draw of the depth pass.
+ ***********************************************************/
+void DepthPrepass::SetModel(const glm::mat4& model)
+{
+	glUniformMatrix4fv(m_modelLocation, 1, GL_FALSE, glm::value_ptr(model));
+}
+
+/***********************************************************
+ *  BeginShadingPass()
+ *
+ *  This method is used for switching back to the scene
+ *  program.  Only the fragments at the depth laid down by
+ *  the depth pass pass the test, and the depth buffer is
+ *  left as it is.
+ ***********************************************************/
+void DepthPrepass::BeginShadingPass()
+{
+	glUseProgram(m_previousProgram);
+
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+	glDepthMask(GL_FALSE);
+	glDepthFunc(GL_EQUAL);
+}
+
+/***********************************************************
+ *  EndShadingPass()
+ *
+ *  This method is used for restoring the depth state the
+ *  rest of the frame expects.
+ ***********************************************************/
+void DepthPrepass::EndShadingPass()
+{
+	glDepthMask(GL_TRUE);
+	glDepthFunc(GL_LESS);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the depth-only program.
+ ***********************************************************/
+void DepthPrepass::Destroy()
+{
+	if (m_program != 0)
+	{
+		glDeleteProgram(m_program);
+		m_program = 0;
+	}
+}
@@ -0,0 +1,62 @@
+///////////////////////////////////////////////////////////////////////////////
+// depthprepass.h
+// ============
+// lay down the scene depth first so only visible fragments are shaded
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+/***********************************************************
+ *  DepthPrepass
+ *
+ *  This class contains the code for drawing the scene once
+ *  with a depth-only program before it is shaded.  The
+ *  shading pass then tests for equal depth without writing
+ *  it, so the lighting runs once per pixel no matter how
+ *  many surfaces cover it.  Both vertex shaders declare
+ *  gl_Position invariant, which keeps the two depths equal.
+ *  Only opaque objects work this way - a translucent one
+ *  would hide what is behind it instead of blending over it,
+ *  so scenes with translucent objects are drawn without it.
+ ***********************************************************/
+class DepthPrepass
+{
+public:
+	// constructor
+	DepthPrepass();
+	// destructor
+	~DepthPrepass();
+
+	// compile the depth-only program
+	bool Create(const char* vertexShaderPath, const char* fragmentShaderPath);
+	// the depth-only program, for connecting its uniform blocks
+	GLuint GetProgram() const { return(m_program); }
+	// true once the depth-only program is ready
+	bool IsSupported() const { return(m_program != 0); }
+
+	// switch to the depth-only program with the color writes off,
+	// reading the model matrices the same way as the scene program
+	void BeginDepthPass(bool bUseInstancing, bool bUseStaticGeometry);
+	// set the model matrix of the next per-object depth draw
+	void SetModel(const glm::mat4& model);
+	// switch back to the scene program and test for the laid down depth
+	void BeginShadingPass();
+	// restore the default depth test and depth writes
+	void EndShadingPass();
+
+	// free the program
+	void Destroy();
+
+private:
+	// the depth-only program
+	GLuint m_program;
+	// locations of the uniforms of the depth-only program
+	GLint m_modelLocation;
+	GLint m_useInstancingLocation;
+	GLint m_useStaticGeometryLocation;
+	// the program that was in use before the depth pass
+	GLuint m_previousProgram;
+};
@@ -0,0 +1,124 @@
+///////////////////////////////////////////////////////////////////////////////
+// framearena.cpp
+// ============
+// hand out the scratch memory of one frame from a block that is reused
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameArena.h"
+
+#include <algorithm>
+
+/***********************************************************
+ *  FrameArena()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameArena::FrameArena()
+{
+	m_pBlock = NULL;
+	m_capacity = 0;
+	m_blockUsed = 0;
+	m_usedBytes = 0;
+}
+
+/***********************************************************
+ *  ~FrameArena()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrameArena::~FrameArena()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for allocating the block the frames
+ *  allocate from.
+ ***********************************************************/
+void FrameArena::Create(size_t capacity)
+{
+	Destroy();
+
+	m_capacity = std::max(capacity, (size_t)1024);
+	m_pBlock = new unsigned char[m_capacity];
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the block and any extra
+ *  blocks of the current frame.
+ ***********************************************************/
+void FrameArena::Destroy()
+{
+	for (int i = 0; i < m_overflowBlocks.size(); i++)
+	{
+		delete[] m_overflowBlocks[i];
+	}
+	m_overflowBlocks.clear();
+
+	delete[] m_pBlock;
+	m_pBlock = NULL;
+	m_capacity = 0;
+	m_blockUsed = 0;
+	m_usedBytes = 0;
+}
+
+/***********************************************************
+ *  Allocate()
+ *
+ *  This method is used for handing out room off the front of
+ *  the block.  When the block is full the room comes from an
+ *  extra block of its own instead, which lives until the
+ *  next reset.
+ ***********************************************************/
+void* FrameArena::Allocate(size_t size, size_t alignment)
+{
+	if (alignment < 1)
+	{
+		alignment = 1;
+	}
+
+	size_t offset = ((m_blockUsed + alignment - 1) / alignment) * alignment;
+
+	if ((m_pBlock != NULL) && (offset + size <= m_capacity))
+	{
+		m_usedBytes += (offset - m_blockUsed) + size;
+		m_blockUsed = offset + size;
+		return(m_pBlock + offset);
+	}
+
+	// new[] only aligns for the fundamental types, so the room is
+	// padded for the rest
+	unsigned char* pOverflow = new unsigned char[size + alignment];
+	size_t address = (size_t)pOverflow;
+
+	m_overflowBlocks.push_back(pOverflow);
+	m_usedBytes += size + alignment;
+
+	return(pOverflow + (alignment - address % alignment) % alignment);
+}
+
+/***********************************************************
+ *  Reset()
+ *
+ *  This method is used for releasing everything handed out
+ *  during the frame.  When the frame needed extra blocks, the
+ *  block is replaced by one that holds the whole frame, so
+ *  the same frame fits from then on.
+ ***********************************************************/
+void FrameArena::Reset()
+{
+	if (!m_overflowBlocks.empty())
+	{
+		size_t capacity = std::max(m_capacity * 2, m_usedBytes + m_usedBytes / 2);
+
+		Destroy();
+		Create(capacity);
+	}
+
+	m_blockUsed = 0;
+	m_usedBytes = 0;
+}
@@ -0,0 +1,76 @@
+///////////////////////////////////////////////////////////////////////////////
+// framearena.h
+// ============
+// hand out the scratch memory of one frame from a block that is reused
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+/***********************************************************
+ *  FrameArena
+ *
+ *  This class contains the code for the scratch arrays the
+ *  render passes need for only one frame.  Allocations are
+ *  taken off the front of one block and all of them are
+ *  released at once when the frame is over, so the frame
+ *  loop never goes to the heap for them.  A frame that needs
+ *  more than the block holds gets extra blocks, and the
+ *  block is grown to fit before the next frame, so only the
+ *  first frames of a bigger scene allocate.
+ ***********************************************************/
+class FrameArena
+{
+public:
+	// constructor
+	FrameArena();
+	// destructor
+	~FrameArena();
+
+	// bytes the block starts with
+	static const size_t DEFAULT_CAPACITY = 256 * 1024;
+
+	// allocate the block
+	void Create(size_t capacity = DEFAULT_CAPACITY);
+	// free the block
+	void Destroy();
+
+	// hand out aligned room for this frame, never fails
+	void* Allocate(size_t size, size_t alignment);
+	// release everything handed out since the last reset
+	void Reset();
+
+	// bytes handed out since the last reset
+	size_t GetUsedBytes() const { return(m_usedBytes); }
+
+	// hand out an array of count values set to value - the arena
+	// never runs destructors, so only plain types can be stored
+	template <typename T>
+	T* AllocateArray(int count, const T& value)
+	{
+		static_assert(std::is_trivially_destructible<T>::value, "frame arena arrays are never destroyed");
+
+		T* pArray = (T*)Allocate(sizeof(T) * ((count > 0) ? count : 1), alignof(T));
+		for (int i = 0; i < count; i++)
+		{
+			new (pArray + i) T(value);
+		}
+
+		return(pArray);
+	}
+
+private:
+	// the block every frame allocates from
+	unsigned char* m_pBlock;
+	size_t m_capacity;
+	// bytes handed out of the block this frame
+	size_t m_blockUsed;
+	// bytes handed out this frame, the extra blocks included
+	size_t m_usedBytes;
+	// blocks allocated this frame after the block was full
+	std::vector<unsigned char*> m_overflowBlocks;
+};
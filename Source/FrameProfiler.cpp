@@ -0,0 +1,437 @@
+///////////////////////////////////////////////////////////////////////////////
+// frameprofiler.cpp
+// ============
+// measure the CPU and GPU time of the render loop stages and count draw work
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameProfiler.h"
+
+#include <cstring>
+#include <iostream>
+
+// declaration of the global variables and defines
+namespace
+{
+	// weight of the newest frame in the running averages
+	const double g_AverageWeight = 0.05;
+	// number of frames between two window title summaries
+	const unsigned long g_SummaryInterval = 30;
+
+	// column names of the stages, passes and counters in the CSV trace
+	const char* g_StageNames[FrameProfiler::STAGE_COUNT] =
+	{
+		"prepare_view_ms",
+		"render_scene_ms",
+		"swap_buffers_ms",
+		"poll_events_ms"
+	};
+	const char* g_GpuPassNames[FrameProfiler::GPU_PASS_COUNT] =
+	{
+		"gpu_scene_ms"
+	};
+	const char* g_CounterNames[FrameProfiler::COUNTER_COUNT] =
+	{
+		"draw_calls",
+		"uniform_sets",
+		"texture_binds",
+		"program_switches"
+	};
+
+	// overlay bar layout in pixels - a full frame budget of
+	// 16.7 milliseconds is drawn this wide
+	const int g_OverlayMargin = 10;
+	const int g_OverlayBarHeight = 6;
+	const int g_OverlayBarSpacing = 3;
+	const float g_OverlayBudgetMs = 1000.0f / 60.0f;
+	const int g_OverlayBudgetWidth = 200;
+
+	// overlay bar colors of the stages, the GPU passes and the frame
+	const float g_StageColors[FrameProfiler::STAGE_COUNT][3] =
+	{
+		{ 0.2f, 0.6f, 1.0f },
+		{ 0.2f, 1.0f, 0.4f },
+		{ 1.0f, 0.8f, 0.2f },
+		{ 0.8f, 0.4f, 1.0f }
+	};
+	const float g_GpuPassColor[3] = { 1.0f, 0.3f, 0.3f };
+	const float g_FrameColor[3] = { 0.9f, 0.9f, 0.9f };
+}
+
+int FrameProfiler::s_counters[FrameProfiler::COUNTER_COUNT] = { 0 };
+
+/***********************************************************
+ *  FrameProfiler()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameProfiler::FrameProfiler()
+{
+	memset(&m_currentFrame, 0, sizeof(m_currentFrame));
+	memset(&m_lastFrame, 0, sizeof(m_lastFrame));
+	memset(&m_average, 0, sizeof(m_average));
+	memset(m_queries, 0, sizeof(m_queries));
+	memset(m_bQueryPending, 0, sizeof(m_bQueryPending));
+	memset(m_gpuMs, 0, sizeof(m_gpuMs));
+
+	m_bFrameStarted = false;
+	m_frameNumber = 0;
+	m_summaryFrame = 0;
+	m_queryFrame = 0;
+	m_pTraceFile = NULL;
+}
+
+/***********************************************************
+ *  ~FrameProfiler()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrameProfiler::~FrameProfiler()
+{
+	if (m_queries[0][0] != 0)
+	{
+		glDeleteQueries(QUERY_FRAMES * GPU_PASS_COUNT, &m_queries[0][0]);
+	}
+
+	if (m_pTraceFile != NULL)
+	{
+		fclose(m_pTraceFile);
+		m_pTraceFile = NULL;
+	}
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for creating the GPU timer queries.
+ ***********************************************************/
+void FrameProfiler::Create()
+{
+	glGenQueries(QUERY_FRAMES * GPU_PASS_COUNT, &m_queries[0][0]);
+}
+
+/***********************************************************
+ *  OpenTrace()
+ *
+ *  This method is used for opening the CSV trace file and
+ *  writing its header row.
+ ***********************************************************/
+bool FrameProfiler::OpenTrace(const char* filename)
+{
+#ifdef _MSC_VER
+	if (fopen_s(&m_pTraceFile, filename, "w") != 0)
+	{
+		m_pTraceFile = NULL;
+	}
+#else
+	m_pTraceFile = fopen(filename, "w");
+#endif
+	if (m_pTraceFile == NULL)
+	{
+		std::cout << "Could not open the profiler trace file " << filename << std::endl;
+		return(false);
+	}
+
+	fprintf(m_pTraceFile, "frame,frame_ms");
+	for (int i = 0; i < STAGE_COUNT; i++)
+	{
+		fprintf(m_pTraceFile, ",%s", g_StageNames[i]);
+	}
+	for (int i = 0; i < GPU_PASS_COUNT; i++)
+	{
+		fprintf(m_pTraceFile, ",%s", g_GpuPassNames[i]);
+	}
+	for (int i = 0; i < COUNTER_COUNT; i++)
+	{
+		fprintf(m_pTraceFile, ",%s", g_CounterNames[i]);
+	}
+	fprintf(m_pTraceFile, "\n");
+
+	std::cout << "Writing the profiler trace to " << filename << std::endl;
+	return(true);
+}
+
+/***********************************************************
+ *  ElapsedMs()
+ *
+ *  This method is used for converting the time between two
+ *  time points into milliseconds.
+ ***********************************************************/
+double FrameProfiler::ElapsedMs(CLOCK::time_point start, CLOCK::time_point end)
+{
+	return(std::chrono::duration<double, std::milli>(end - start).count());
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for starting the recording of a new
+ *  frame.  The frame time is measured from one call to the
+ *  next, so it includes everything the loop does.
+ ***********************************************************/
+void FrameProfiler::BeginFrame()
+{
+	CLOCK::time_point now = CLOCK::now();
+
+	if (m_bFrameStarted)
+	{
+		m_lastFrame.frameMs = ElapsedMs(m_frameStart, now);
+	}
+
+	m_frameStart = now;
+	m_bFrameStarted = true;
+
+	memset(m_currentFrame.cpuMs, 0, sizeof(m_currentFrame.cpuMs));
+	memset(s_counters, 0, sizeof(s_counters));
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for finishing the recording of a
+ *  frame.  The GPU results come from the queries of the
+ *  previous frame, so they never stall the CPU.
+ ***********************************************************/
+void FrameProfiler::EndFrame()
+{
+	// the queries of the other frame in flight were issued a frame ago
+	m_queryFrame = (m_queryFrame + 1) % QUERY_FRAMES;
+	ReadGpuQueries(m_queryFrame);
+
+	// the frame time of this frame is only known at the next
+	// BeginFrame, so the row uses the time of the frame before
+	m_currentFrame.frameMs = m_lastFrame.frameMs;
+	memcpy(m_currentFrame.gpuMs, m_gpuMs, sizeof(m_gpuMs));
+	memcpy(m_currentFrame.counters, s_counters, sizeof(s_counters));
+	m_lastFrame = m_currentFrame;
+
+	// keep running averages for the overlay and the summary
+	if (m_frameNumber == 0)
+	{
+		m_average = m_lastFrame;
+	}
+	else
+	{
+		m_average.frameMs += (m_lastFrame.frameMs - m_average.frameMs) * g_AverageWeight;
+		for (int i = 0; i < STAGE_COUNT; i++)
+		{
+			m_average.cpuMs[i] += (m_lastFrame.cpuMs[i] - m_average.cpuMs[i]) * g_AverageWeight;
+		}
+		for (int i = 0; i < GPU_PASS_COUNT; i++)
+		{
+			m_average.gpuMs[i] += (m_lastFrame.gpuMs[i] - m_average.gpuMs[i]) * g_AverageWeight;
+		}
+		memcpy(m_average.counters, m_lastFrame.counters, sizeof(m_average.counters));
+	}
+
+	if (m_pTraceFile != NULL)
+	{
+		WriteTraceRow(m_lastFrame);
+	}
+
+	m_frameNumber++;
+}
+
+/***********************************************************
+ *  BeginStage()
+ *
+ *  This method is used for marking the start of a CPU stage.
+ ***********************************************************/
+void FrameProfiler::BeginStage(CPU_STAGE stage)
+{
+	m_stageStart[stage] = CLOCK::now();
+}
+
+/***********************************************************
+ *  EndStage()
+ *
+ *  This method is used for marking the end of a CPU stage.
+ *  A stage run more than once in a frame adds up.
+ ***********************************************************/
+void FrameProfiler::EndStage(CPU_STAGE stage)
+{
+	m_currentFrame.cpuMs[stage] += ElapsedMs(m_stageStart[stage], CLOCK::now());
+}
+
+/***********************************************************
+ *  BeginGpuPass()
+ *
+ *  This method is used for starting the timer query of a GPU
+ *  pass for the current frame.
+ ***********************************************************/
+void FrameProfiler::BeginGpuPass(GPU_PASS pass)
+{
+	if (m_queries[m_queryFrame][pass] == 0)
+	{
+		return;
+	}
+
+	glBeginQuery(GL_TIME_ELAPSED, m_queries[m_queryFrame][pass]);
+}
+
+/***********************************************************
+ *  EndGpuPass()
+ *
+ *  This method is used for ending the timer query of a GPU
+ *  pass for the current frame.
+ ***********************************************************/
+void FrameProfiler::EndGpuPass(GPU_PASS pass)
+{
+	if (m_queries[m_queryFrame][pass] == 0)
+	{
+		return;
+	}
+
+	glEndQuery(GL_TIME_ELAPSED);
+	m_bQueryPending[m_queryFrame][pass] = true;
+}
+
+/***********************************************************
+ *  ReadGpuQueries()
+ *
+ *  This method is used for reading the finished timer
+ *  queries of a frame in flight.  A result that is not
+ *  available yet is dropped and the previous one is kept.
+ ***********************************************************/
+void FrameProfiler::ReadGpuQueries(int queryFrame)
+{
+	for (int i = 0; i < GPU_PASS_COUNT; i++)
+	{
+		if (m_bQueryPending[queryFrame][i] == false)
+		{
+			continue;
+		}
+
+		GLuint bAvailable = GL_FALSE;
+		glGetQueryObjectuiv(m_queries[queryFrame][i], GL_QUERY_RESULT_AVAILABLE, &bAvailable);
+		if (bAvailable == GL_TRUE)
+		{
+			GLuint64 elapsedNs = 0;
+			glGetQueryObjectui64v(m_queries[queryFrame][i], GL_QUERY_RESULT, &elapsedNs);
+			m_gpuMs[i] = (double)elapsedNs / 1000000.0;
+		}
+		m_bQueryPending[queryFrame][i] = false;
+	}
+}
+
+/***********************************************************
+ *  WriteTraceRow()
+ *
+ *  This method is used for appending one frame to the CSV
+ *  trace file.
+ ***********************************************************/
+void FrameProfiler::WriteTraceRow(const FRAME_STATS& stats) const
+{
+	fprintf(m_pTraceFile, "%lu,%.4f", m_frameNumber, stats.frameMs);
+	for (int i = 0; i < STAGE_COUNT; i++)
+	{
+		fprintf(m_pTraceFile, ",%.4f", stats.cpuMs[i]);
+	}
+	for (int i = 0; i < GPU_PASS_COUNT; i++)
+	{
+		fprintf(m_pTraceFile, ",%.4f", stats.gpuMs[i]);
+	}
+	for (int i = 0; i < COUNTER_COUNT; i++)
+	{
+		fprintf(m_pTraceFile, ",%d", stats.counters[i]);
+	}
+	fprintf(m_pTraceFile, "\n");
+}
+
+/***********************************************************
+ *  DrawOverlay()
+ *
+ *  This method is used for drawing the averaged stage times
+ *  as horizontal bars in the top left corner of the window,
+ *  one per CPU stage, one per GPU pass and one for the whole
+ *  frame, with a mark at the 60 Hz frame budget.  The bars are
+ *  cleared scissor rectangles, so no shader is needed.
+ ***********************************************************/
+void FrameProfiler::DrawOverlay() const
+{
+	GLint viewport[4];
+	GLfloat clearColor[4];
+	int row = 0;
+
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	glGetFloatv(GL_COLOR_CLEAR_VALUE, clearColor);
+	glEnable(GL_SCISSOR_TEST);
+
+	// one bar per row, counted down from the top of the window
+	auto drawBar = [&](int bar, double ms, const float* color)
+	{
+		int width = (int)(ms / g_OverlayBudgetMs * g_OverlayBudgetWidth);
+		int y = viewport[1] + viewport[3] - g_OverlayMargin - (bar + 1) * (g_OverlayBarHeight + g_OverlayBarSpacing);
+
+		if (width < 1)
+		{
+			width = 1;
+		}
+
+		glScissor(viewport[0] + g_OverlayMargin, y, width, g_OverlayBarHeight);
+		glClearColor(color[0], color[1], color[2], 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT);
+	};
+
+	for (int i = 0; i < STAGE_COUNT; i++)
+	{
+		drawBar(row++, m_average.cpuMs[i], g_StageColors[i]);
+	}
+	for (int i = 0; i < GPU_PASS_COUNT; i++)
+	{
+		drawBar(row++, m_average.gpuMs[i], g_GpuPassColor);
+	}
+	drawBar(row++, m_average.frameMs, g_FrameColor);
+
+	// frame budget mark across all of the bars
+	glScissor(
+		viewport[0] + g_OverlayMargin + g_OverlayBudgetWidth,
+		viewport[1] + viewport[3] - g_OverlayMargin - row * (g_OverlayBarHeight + g_OverlayBarSpacing),
+		1,
+		row * (g_OverlayBarHeight + g_OverlayBarSpacing));
+	glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+
+	glDisable(GL_SCISSOR_TEST);
+	glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]);
+}
+
+/***********************************************************
+ *  FormatSummary()
+ *
+ *  This method is used for writing the averaged frame, CPU
+ *  and GPU times and the counters of the last frame into a
+ *  short line of text, every few frames.
+ ***********************************************************/
+bool FrameProfiler::FormatSummary(char* buffer, int bufferSize)
+{
+	if ((m_frameNumber - m_summaryFrame) < g_SummaryInterval)
+	{
+		return(false);
+	}
+	m_summaryFrame = m_frameNumber;
+
+	double cpuMs = 0.0;
+	double gpuMs = 0.0;
+
+	for (int i = 0; i < STAGE_COUNT; i++)
+	{
+		cpuMs += m_average.cpuMs[i];
+	}
+	for (int i = 0; i < GPU_PASS_COUNT; i++)
+	{
+		gpuMs += m_average.gpuMs[i];
+	}
+
+	snprintf(buffer, bufferSize,
+		"%.2f ms (%.0f fps) | cpu %.2f ms | gpu %.2f ms | %d draws | %d uniforms | %d binds | %d programs",
+		m_average.frameMs,
+		(m_average.frameMs > 0.0) ? 1000.0 / m_average.frameMs : 0.0,
+		cpuMs,
+		gpuMs,
+		m_average.counters[COUNTER_DRAW_CALLS],
+		m_average.counters[COUNTER_UNIFORM_SETS],
+		m_average.counters[COUNTER_TEXTURE_BINDS],
+		m_average.counters[COUNTER_PROGRAM_SWITCHES]);
+
+	return(true);
+}
@@ -0,0 +1,144 @@
+///////////////////////////////////////////////////////////////////////////////
+// frameprofiler.h
+// ============
+// measure the CPU and GPU time of the render loop stages and count draw work
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <chrono>
+#include <cstdio>
+
+/***********************************************************
+ *  FrameProfiler
+ *
+ *  This class contains the code for timing the stages of the
+ *  main loop on the CPU, timing the render passes on the GPU
+ *  with timer queries, and counting the draw calls, uniform
+ *  updates and texture binds of each frame.  The results are
+ *  shown as a bar overlay and in the window title, and can be
+ *  streamed to a CSV file with one row per frame.
+ ***********************************************************/
+class FrameProfiler
+{
+public:
+	// constructor
+	FrameProfiler();
+	// destructor
+	~FrameProfiler();
+
+	// the timed CPU stages of the main loop
+	enum CPU_STAGE
+	{
+		STAGE_PREPARE_VIEW = 0,
+		STAGE_RENDER_SCENE,
+		STAGE_SWAP_BUFFERS,
+		STAGE_POLL_EVENTS,
+		STAGE_COUNT
+	};
+
+	// the timed GPU passes of a frame
+	enum GPU_PASS
+	{
+		GPU_PASS_SCENE = 0,
+		GPU_PASS_COUNT
+	};
+
+	// the work counted during a frame
+	enum COUNTER
+	{
+		COUNTER_DRAW_CALLS = 0,
+		COUNTER_UNIFORM_SETS,
+		COUNTER_TEXTURE_BINDS,
+		COUNTER_PROGRAM_SWITCHES,
+		COUNTER_COUNT
+	};
+
+	// the measurements of one frame
+	struct FRAME_STATS
+	{
+		double frameMs;
+		double cpuMs[STAGE_COUNT];
+		double gpuMs[GPU_PASS_COUNT];
+		int counters[COUNTER_COUNT];
+	};
+
+	// create the GPU timer queries - needs a current OpenGL context
+	void Create();
+	// open a CSV file that receives one row per frame
+	bool OpenTrace(const char* filename);
+
+	// mark the start and end of a frame
+	void BeginFrame();
+	void EndFrame();
+
+	// mark the start and end of a CPU stage
+	void BeginStage(CPU_STAGE stage);
+	void EndStage(CPU_STAGE stage);
+
+	// mark the start and end of a GPU pass - passes can not overlap
+	void BeginGpuPass(GPU_PASS pass);
+	void EndGpuPass(GPU_PASS pass);
+
+	// add to a counter of the current frame, from anywhere
+	static void AddCount(COUNTER counter, int amount = 1)
+	{
+		s_counters[counter] += amount;
+	}
+
+	// the measurements of the last finished frame
+	const FRAME_STATS& GetLastFrame() const { return(m_lastFrame); }
+	// the measurements averaged over the recent frames
+	const FRAME_STATS& GetAverage() const { return(m_average); }
+
+	// draw the stage times as bars in the top left corner
+	void DrawOverlay() const;
+	// write a short summary of the averages, returns false
+	// when the summary has not changed since the last call
+	bool FormatSummary(char* buffer, int bufferSize);
+
+private:
+	typedef std::chrono::steady_clock CLOCK;
+
+	// number of frames of GPU queries in flight
+	static const int QUERY_FRAMES = 2;
+
+	// counters of the frame being recorded
+	static int s_counters[COUNTER_COUNT];
+
+	// start times of the frame and of each stage
+	CLOCK::time_point m_frameStart;
+	CLOCK::time_point m_stageStart[STAGE_COUNT];
+	// true once the first frame has started
+	bool m_bFrameStarted;
+
+	// the frame being recorded and the finished results
+	FRAME_STATS m_currentFrame;
+	FRAME_STATS m_lastFrame;
+	FRAME_STATS m_average;
+	// number of finished frames
+	unsigned long m_frameNumber;
+	// frame number of the last summary
+	unsigned long m_summaryFrame;
+
+	// timer queries, one set per frame in flight
+	GLuint m_queries[QUERY_FRAMES][GPU_PASS_COUNT];
+	// true when the query was issued and its result not read yet
+	bool m_bQueryPending[QUERY_FRAMES][GPU_PASS_COUNT];
+	// the frame in flight the queries are issued for
+	int m_queryFrame;
+	// the most recent GPU results, one frame behind the CPU
+	double m_gpuMs[GPU_PASS_COUNT];
+
+	// the CSV trace file, NULL when not tracing
+	FILE* m_pTraceFile;
+
+	// milliseconds between two time points
+	static double ElapsedMs(CLOCK::time_point start, CLOCK::time_point end);
+	// read the results of the queries issued for a frame
+	void ReadGpuQueries(int queryFrame);
+	// append one frame to the CSV trace
+	void WriteTraceRow(const FRAME_STATS& stats) const;
+};
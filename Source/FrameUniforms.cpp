@@ -0,0 +1,156 @@
+///////////////////////////////////////////////////////////////////////////////
+// frameuniforms.cpp
+// ============
+// manage the per-frame camera and light uniform block shared by all shaders
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameUniforms.h"
+
+#include <cstring>
+
+// declaration of the global variables and defines
+namespace
+{
+	// name and binding point of the uniform block in the shaders
+	const char* g_FrameDataBlockName = "FrameData";
+	const GLuint g_FrameDataBinding = 1;
+}
+
+/***********************************************************
+ *  FrameUniforms()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameUniforms::FrameUniforms()
+{
+	m_frameData.view = glm::mat4(1.0f);
+	m_frameData.projection = glm::mat4(1.0f);
+	m_frameData.viewProjection = glm::mat4(1.0f);
+	m_frameData.viewPosition = glm::vec4(0.0f);
+	m_frameData.globalAmbientColor = glm::vec4(0.0f);
+	for (int i = 0; i < MAX_LIGHTS; i++)
+	{
+		SetLightSource(i, glm::vec3(0.0f), glm::vec3(0.0f), glm::vec3(0.0f), 0.0f, 0.0f);
+	}
+
+	m_pStreamBuffer = NULL;
+}
+
+/***********************************************************
+ *  ~FrameUniforms()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrameUniforms::~FrameUniforms()
+{
+	m_pStreamBuffer = NULL;
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for setting the stream buffer the
+ *  block is written into.  The stream buffer owns the memory
+ *  and its synchronization, so there is nothing to create.
+ ***********************************************************/
+void FrameUniforms::Create(StreamBuffer* pStreamBuffer)
+{
+	m_pStreamBuffer = pStreamBuffer;
+}
+
+/***********************************************************
+ *  BindProgram()
+ *
+ *  This method is used for connecting the FrameData uniform
+ *  block of the passed in linked program to the binding point
+ *  of the frame buffer.  Programs without the block are
+ *  left alone.
+ ***********************************************************/
+void FrameUniforms::BindProgram(GLuint programID)
+{
+	GLuint blockIndex = glGetUniformBlockIndex(programID, g_FrameDataBlockName);
+
+	if (blockIndex != GL_INVALID_INDEX)
+	{
+		glUniformBlockBinding(programID, blockIndex, g_FrameDataBinding);
+	}
+}
+
+/***********************************************************
+ *  SetCamera()
+ *
+ *  This method is used for setting the view and projection
+ *  matrices and the camera position of the current frame.
+ ***********************************************************/
+void FrameUniforms::SetCamera(
+	const glm::mat4& view,
+	const glm::mat4& projection,
+	const glm::vec3& viewPosition)
+{
+	m_frameData.view = view;
+	m_frameData.projection = projection;
+	m_frameData.viewProjection = projection * view;
+	m_frameData.viewPosition = glm::vec4(viewPosition, 1.0f);
+}
+
+/***********************************************************
+ *  SetGlobalAmbientColor()
+ *
+ *  This method is used for setting the ambient light color
+ *  that is added to every light source.
+ ***********************************************************/
+void FrameUniforms::SetGlobalAmbientColor(const glm::vec3& color)
+{
+	m_frameData.globalAmbientColor = glm::vec4(color, 1.0f);
+}
+
+/***********************************************************
+ *  SetLightSource()
+ *
+ *  This method is used for setting the values of the light
+ *  source with the passed in index.
+ ***********************************************************/
+void FrameUniforms::SetLightSource(
+	int index,
+	const glm::vec3& position,
+	const glm::vec3& diffuseColor,
+	const glm::vec3& specularColor,
+	float focalStrength,
+	float specularIntensity)
+{
+	if ((index < 0) || (index >= MAX_LIGHTS))
+	{
+		return;
+	}
+
+	LIGHT_SOURCE& light = m_frameData.lightSources[index];
+
+	light.position = position;
+	light.focalStrength = focalStrength;
+	light.diffuseColor = diffuseColor;
+	light.specularIntensity = specularIntensity;
+	light.specularColor = specularColor;
+	light.padding = 0.0f;
+}
+
+/***********************************************************
+ *  Upload()
+ *
+ *  This method is used for writing the whole frame state into
+ *  the stream buffer with a single copy, and binding the
+ *  written range for the draws of this frame.
+ ***********************************************************/
+void FrameUniforms::Upload()
+{
+	StreamBuffer::ALLOCATION allocation;
+
+	if ((NULL == m_pStreamBuffer) ||
+		!m_pStreamBuffer->Allocate(sizeof(FRAME_DATA), m_pStreamBuffer->GetUniformAlignment(), allocation))
+	{
+		return;
+	}
+
+	memcpy(allocation.pData, &m_frameData, sizeof(FRAME_DATA));
+	m_pStreamBuffer->Commit(allocation);
+	glBindBufferRange(GL_UNIFORM_BUFFER, g_FrameDataBinding, m_pStreamBuffer->GetBuffer(), allocation.offset, allocation.size);
+}
@@ -0,0 +1,90 @@
+///////////////////////////////////////////////////////////////////////////////
+// frameuniforms.h
+// ============
+// manage the per-frame camera and light uniform block shared by all shaders
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "StreamBuffer.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+/***********************************************************
+ *  FrameUniforms
+ *
+ *  This class contains the code for keeping the camera and
+ *  light state of the current frame in one std140 uniform
+ *  block, "FrameData", that every shader program binds.  The
+ *  whole block is written once per frame into the stream
+ *  buffer, and the binding point is moved to where it was
+ *  written.
+ ***********************************************************/
+class FrameUniforms
+{
+public:
+	// constructor
+	FrameUniforms();
+	// destructor
+	~FrameUniforms();
+
+	// maximum number of light sources - must match TOTAL_LIGHTS in the shaders
+	static const int MAX_LIGHTS = 4;
+
+	// one light source in the std140 layout of the shader block
+	struct LIGHT_SOURCE
+	{
+		glm::vec3 position;
+		float focalStrength;
+		glm::vec3 diffuseColor;
+		float specularIntensity;
+		glm::vec3 specularColor;
+		float padding;
+	};
+
+	// the FrameData uniform block in the std140 layout
+	struct FRAME_DATA
+	{
+		glm::mat4 view;
+		glm::mat4 projection;
+		glm::mat4 viewProjection;
+		glm::vec4 viewPosition;
+		glm::vec4 globalAmbientColor;
+		LIGHT_SOURCE lightSources[MAX_LIGHTS];
+	};
+
+	// set the stream buffer the block is written into every frame
+	void Create(StreamBuffer* pStreamBuffer);
+	// connect the FrameData block of a linked program to the buffer
+	void BindProgram(GLuint programID);
+
+	// set the camera state of the current frame
+	void SetCamera(
+		const glm::mat4& view,
+		const glm::mat4& projection,
+		const glm::vec3& viewPosition);
+	// set the ambient light color of the scene
+	void SetGlobalAmbientColor(const glm::vec3& color);
+	// set the values of one light source
+	void SetLightSource(
+		int index,
+		const glm::vec3& position,
+		const glm::vec3& diffuseColor,
+		const glm::vec3& specularColor,
+		float focalStrength,
+		float specularIntensity);
+
+	// the frame state set so far
+	const FRAME_DATA& GetFrameData() const { return(m_frameData); }
+
+	// write the frame state into the stream buffer before drawing,
+	// after the stream buffer began the frame
+	void Upload();
+
+private:
+	// the CPU copy of the block for the current frame
+	FRAME_DATA m_frameData;
+	// pointer to the stream buffer holding the block of each frame
+	StreamBuffer* m_pStreamBuffer;
+};
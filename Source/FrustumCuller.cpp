@@ -0,0 +1,234 @@
+///////////////////////////////////////////////////////////////////////////////
+// frustumculler.cpp
+// ============
+// test the bounding spheres of the scene objects against the view frustum
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrustumCuller.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+// SSE is available on every x86 target the project builds for
+#if defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 1)) || defined(__SSE__)
+#define FRUSTUM_CULLER_SSE
+#include <xmmintrin.h>
+#endif
+
+// declaration of the global variables and defines
+namespace
+{
+	// groups of four spheres culled by one job, large enough that
+	// a chunk costs more than handing it to another thread
+	const int g_CullGrainGroups = 256;
+}
+
+/***********************************************************
+ *  FrustumCuller()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrustumCuller::FrustumCuller()
+{
+	for (int i = 0; i < 6; i++)
+	{
+		m_planes[i] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	}
+	m_sphereCount = 0;
+}
+
+/***********************************************************
+ *  SetSpheres()
+ *
+ *  This method is used for storing the bounding spheres to
+ *  test.  The padding entries have a huge negative radius so
+ *  they never pass the test.
+ ***********************************************************/
+void FrustumCuller::SetSpheres(const std::vector<glm::vec4>& spheres)
+{
+	m_sphereCount = (int)spheres.size();
+
+	int paddedCount = (m_sphereCount + 3) & ~3;
+
+	m_centerX.assign(paddedCount, 0.0f);
+	m_centerY.assign(paddedCount, 0.0f);
+	m_centerZ.assign(paddedCount, 0.0f);
+	m_radius.assign(paddedCount, -1.0e30f);
+
+	for (int i = 0; i < m_sphereCount; i++)
+	{
+		m_centerX[i] = spheres[i].x;
+		m_centerY[i] = spheres[i].y;
+		m_centerZ[i] = spheres[i].z;
+		m_radius[i] = spheres[i].w;
+	}
+}
+
+/***********************************************************
+ *  SetSphere()
+ *
+ *  This method is used for replacing the bounding sphere of
+ *  one object, for objects that moved.
+ ***********************************************************/
+void FrustumCuller::SetSphere(int index, const glm::vec4& sphere)
+{
+	if ((index < 0) || (index >= m_sphereCount))
+	{
+		return;
+	}
+
+	m_centerX[index] = sphere.x;
+	m_centerY[index] = sphere.y;
+	m_centerZ[index] = sphere.z;
+	m_radius[index] = sphere.w;
+}
+
+/***********************************************************
+ *  SetFrustum()
+ *
+ *  This method is used for extracting the six clip planes
+ *  from the rows of the view-projection matrix, with the
+ *  OpenGL depth range of -1 to 1.  The planes are normalized
+ *  so the plane distance of a point is in world units.
+ ***********************************************************/
+void FrustumCuller::SetFrustum(const glm::mat4& viewProjection)
+{
+	glm::vec4 rows[4];
+
+	// glm matrices are column major - m[column][row]
+	for (int i = 0; i < 4; i++)
+	{
+		rows[i] = glm::vec4(
+			viewProjection[0][i],
+			viewProjection[1][i],
+			viewProjection[2][i],
+			viewProjection[3][i]);
+	}
+
+	m_planes[0] = rows[3] + rows[0];	// left
+	m_planes[1] = rows[3] - rows[0];	// right
+	m_planes[2] = rows[3] + rows[1];	// bottom
+	m_planes[3] = rows[3] - rows[1];	// top
+	m_planes[4] = rows[3] + rows[2];	// near
+	m_planes[5] = rows[3] - rows[2];	// far
+
+	for (int i = 0; i < 6; i++)
+	{
+		float length = std::sqrt(
+			m_planes[i].x * m_planes[i].x +
+			m_planes[i].y * m_planes[i].y +
+			m_planes[i].z * m_planes[i].z);
+
+		if (length > 0.0f)
+		{
+			m_planes[i] = m_planes[i] / length;
+		}
+	}
+}
+
+/***********************************************************
+ *  Cull()
+ *
+ *  This method is used for flagging every sphere that is at
+ *  least partly inside all six frustum planes.  With a job
+ *  system the spheres are split in runs of whole groups of
+ *  four, so no two threads share an SSE group.
+ ***********************************************************/
+int FrustumCuller::Cull(std::vector<unsigned char>& visible, JobSystem* pJobSystem) const
+{
+	visible.resize(m_sphereCount);
+
+	if (NULL == pJobSystem)
+	{
+		return(CullRange(0, m_sphereCount, visible));
+	}
+
+	std::atomic<int> visibleCount(0);
+
+	pJobSystem->ParallelFor((m_sphereCount + 3) / 4, g_CullGrainGroups,
+		[this, &visible, &visibleCount](int begin, int end)
+		{
+			visibleCount += CullRange(begin * 4, std::min(end * 4, m_sphereCount), visible);
+		});
+
+	return(visibleCount);
+}
+
+/***********************************************************
+ *  CullRange()
+ *
+ *  This method is used for flagging the spheres of a range,
+ *  which starts at a multiple of four.  A sphere is culled
+ *  as soon as its center is further than its radius behind
+ *  any one plane.
+ ***********************************************************/
+int FrustumCuller::CullRange(int begin, int end, std::vector<unsigned char>& visible) const
+{
+	int visibleCount = 0;
+
+#ifdef FRUSTUM_CULLER_SSE
+	__m128 planeX[6];
+	__m128 planeY[6];
+	__m128 planeZ[6];
+	__m128 planeW[6];
+
+	for (int p = 0; p < 6; p++)
+	{
+		planeX[p] = _mm_set1_ps(m_planes[p].x);
+		planeY[p] = _mm_set1_ps(m_planes[p].y);
+		planeZ[p] = _mm_set1_ps(m_planes[p].z);
+		planeW[p] = _mm_set1_ps(m_planes[p].w);
+	}
+
+	for (int i = begin; i < end; i += 4)
+	{
+		__m128 x = _mm_loadu_ps(&m_centerX[i]);
+		__m128 y = _mm_loadu_ps(&m_centerY[i]);
+		__m128 z = _mm_loadu_ps(&m_centerZ[i]);
+		__m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&m_radius[i]));
+		__m128 inside = _mm_cmpeq_ps(x, x);
+
+		for (int p = 0; p < 6; p++)
+		{
+			__m128 distance = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(planeX[p], x), _mm_mul_ps(planeY[p], y)),
+				_mm_add_ps(_mm_mul_ps(planeZ[p], z), planeW[p]));
+
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negRadius));
+		}
+
+		int mask = _mm_movemask_ps(inside);
+
+		for (int j = 0; (j < 4) && (i + j < end); j++)
+		{
+			visible[i + j] = (unsigned char)((mask >> j) & 1);
+			visibleCount += visible[i + j];
+		}
+	}
+#else
+	for (int i = begin; i < end; i++)
+	{
+		unsigned char bInside = 1;
+
+		for (int p = 0; (p < 6) && bInside; p++)
+		{
+			float distance =
+				m_planes[p].x * m_centerX[i] +
+				m_planes[p].y * m_centerY[i] +
+				m_planes[p].z * m_centerZ[i] +
+				m_planes[p].w;
+
+			if (distance < -m_radius[i])
+			{
+				bInside = 0;
+			}
+		}
+
+		visible[i] = bInside;
+		visibleCount += bInside;
+	}
+#endif
+
+	return(visibleCount);
+}
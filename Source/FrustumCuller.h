@@ -0,0 +1,55 @@
+///////////////////////////////////////////////////////////////////////////////
+// frustumculler.h
+// ============
+// test the bounding spheres of the scene objects against the view frustum
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "JobSystem.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  FrustumCuller
+ *
+ *  This class contains the code for testing a fixed set of
+ *  bounding spheres against the six planes of the view
+ *  frustum.  The spheres are kept in structure-of-arrays
+ *  form so four of them are tested at a time with SSE.
+ ***********************************************************/
+class FrustumCuller
+{
+public:
+	// constructor
+	FrustumCuller();
+
+	// set the spheres to test - xyz is the center, w the radius
+	void SetSpheres(const std::vector<glm::vec4>& spheres);
+	// replace one of the spheres set before
+	void SetSphere(int index, const glm::vec4& sphere);
+	// extract the frustum planes from a view-projection matrix
+	void SetFrustum(const glm::mat4& viewProjection);
+	// flag each sphere that touches the frustum, spread over the job
+	// system when there is one, returns the visible count
+	int Cull(std::vector<unsigned char>& visible, JobSystem* pJobSystem = NULL) const;
+
+	// number of spheres being tested
+	int GetSphereCount() const { return(m_sphereCount); }
+
+private:
+	// frustum planes as (normal, distance), normals pointing inside
+	glm::vec4 m_planes[6];
+	// sphere data, padded to a multiple of four entries
+	std::vector<float> m_centerX;
+	std::vector<float> m_centerY;
+	std::vector<float> m_centerZ;
+	std::vector<float> m_radius;
+	// number of spheres without the padding
+	int m_sphereCount;
+
+	// flag the spheres from begin to end
+	int CullRange(int begin, int end, std::vector<unsigned char>& visible) const;
+};
@@ -0,0 +1,286 @@
+///////////////////////////////////////////////////////////////////////////////
+// gpuculler.cpp
+// ============
+// cull the static geometry in a compute shader and draw it from indirect commands
+///////////////////////////////////////////////////////////////////////////////
+
+#include "GpuCuller.h"
+#include "ShaderProgram.h"
+
+#include <cstddef>
+#include <iostream>
+
+// declaration of the global variables and defines
+namespace
+{
+	// storage buffer binding points - must match the compute shader
+	const GLuint g_ObjectBinding = 3;
+	const GLuint g_CommandBinding = 4;
+	const GLuint g_CountBinding = 5;
+	const GLuint g_LodBinding = 6;
+
+	// threads per work group of the compute shader
+	const int g_WorkGroupSize = 64;
+
+	// the layout glMultiDrawElementsIndirect reads
+	struct DRAW_COMMAND
+	{
+		GLuint count;
+		GLuint instanceCount;
+		GLuint firstIndex;
+		GLint baseVertex;
+		GLuint baseInstance;
+	};
+}
+
+/***********************************************************
+ *  GpuCuller()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+GpuCuller::GpuCuller()
+{
+	m_program = 0;
+	m_objectCountLocation = -1;
+	m_pixelsPerUnitLocation = -1;
+	m_lodHysteresisLocation = -1;
+	m_bCompactCommands = false;
+	m_bCoreIndirectCount = false;
+	m_objectBuffer = 0;
+	m_commandBuffer = 0;
+	m_countBuffer = 0;
+	m_lodBuffer = 0;
+	m_objectCount = 0;
+	m_groupCount = 0;
+}
+
+/***********************************************************
+ *  ~GpuCuller()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+GpuCuller::~GpuCuller()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for compiling the culling program and
+ *  choosing how the commands are drawn.  With indirect
+ *  parameters the visible commands are packed and their
+ *  count is read from a buffer, otherwise every object keeps
+ *  a command and the culled ones draw no instances.
+ ***********************************************************/
+bool GpuCuller::Create(const char* computeShaderPath)
+{
+	// compute shaders and multi draw indirect are both core in 4.3
+	if (!GLEW_VERSION_4_3)
+	{
+		std::cout << "INFO: OpenGL 4.3 is not supported, culling the static geometry on the CPU" << std::endl;
+		return(false);
+	}
+
+	m_program = ShaderProgram::LoadCompute(computeShaderPath);
+	if (m_program == 0)
+	{
+		return(false);
+	}
+
+	m_objectCountLocation = glGetUniformLocation(m_program, "objectCount");
+	m_pixelsPerUnitLocation = glGetUniformLocation(m_program, "pixelsPerUnit");
+	m_lodHysteresisLocation = glGetUniformLocation(m_program, "lodHysteresis");
+	// GLEW loads the core and the ARB draw count functions separately,
+	// so a 4.5 driver with the extension only has the ARB one
+	m_bCoreIndirectCount = (GLEW_VERSION_4_6 != 0);
+	m_bCompactCommands = m_bCoreIndirectCount || (GLEW_ARB_indirect_parameters != 0);
+	glProgramUniform1i(m_program, glGetUniformLocation(m_program, "bCompactCommands"), m_bCompactCommands ? 1 : 0);
+	glProgramUniform1fv(m_program, glGetUniformLocation(m_program, "lodPixelSizes"), MESH_LOD_COUNT - 1, MESH_LOD_PIXEL_SIZES);
+	SetLodHysteresis(MESH_LOD_HYSTERESIS);
+
+	glGenBuffers(1, &m_objectBuffer);
+	glGenBuffers(1, &m_commandBuffer);
+	glGenBuffers(1, &m_countBuffer);
+	glGenBuffers(1, &m_lodBuffer);
+
+	return(true);
+}
+
+/***********************************************************
+ *  SetObjects()
+ *
+ *  This method is used for uploading the objects and sizing
+ *  the command buffer for one command per object and the
+ *  count buffer for one count per group.
+ ***********************************************************/
+void GpuCuller::SetObjects(const std::vector<DRAW_OBJECT>& objects, int groupCount)
+{
+	if (!IsSupported())
+	{
+		return;
+	}
+
+	m_objectCount = (int)objects.size();
+	m_groupCount = groupCount;
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_objectBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, objects.size() * sizeof(DRAW_OBJECT), objects.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_commandBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, objects.size() * sizeof(DRAW_COMMAND), NULL, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_countBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, groupCount * sizeof(GLuint), NULL, GL_DYNAMIC_DRAW);
+	// every object starts out at the finest level
+	std::vector<GLuint> lods(objects.size(), 0);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_lodBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, lods.size() * sizeof(GLuint), lods.data(), GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	glProgramUniform1ui(m_program, m_objectCountLocation, (GLuint)m_objectCount);
+}
+
+/***********************************************************
+ *  SetObjectBounds()
+ *
+ *  This method is used for writing the bounding sphere of an
+ *  object that moved.  The rest of the object stays as it
+ *  is, since its index ranges do not change.
+ ***********************************************************/
+void GpuCuller::SetObjectBounds(int object, const glm::vec4& bounds)
+{
+	if (!IsSupported() || (object < 0) || (object >= m_objectCount))
+	{
+		return;
+	}
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_objectBuffer);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, object * sizeof(DRAW_OBJECT) + offsetof(DRAW_OBJECT, bounds),
+		sizeof(glm::vec4), &bounds);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+/***********************************************************
+ *  SetLodHysteresis()
+ *
+ *  This method is used for setting the fraction the projected
+ *  size of an object has to move past a level boundary
+ *  before its detail level changes.  Zero turns it off.
+ ***********************************************************/
+void GpuCuller::SetLodHysteresis(float hysteresis)
+{
+	if (IsSupported())
+	{
+		glProgramUniform1f(m_program, m_lodHysteresisLocation, hysteresis);
+	}
+}
+
+/***********************************************************
+ *  Cull()
+ *
+ *  This method is used for running the culling compute
+ *  shader over all of the objects.  The counts are cleared
+ *  first, once the atomic writes of the previous dispatch
+ *  are done.  The barrier after the dispatch makes the
+ *  commands visible to the draw calls that read them, and
+ *  the detail levels to the dispatch of the next frame.
+ ***********************************************************/
+void GpuCuller::Cull(float pixelsPerUnit)
+{
+	if (!IsSupported() || (m_objectCount == 0))
+	{
+		return;
+	}
+
+	glProgramUniform1f(m_program, m_pixelsPerUnitLocation, pixelsPerUnit);
+
+	if (m_bCompactCommands)
+	{
+		glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_countBuffer);
+		glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, NULL);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	}
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, g_ObjectBinding, m_objectBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, g_CommandBinding, m_commandBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, g_CountBinding, m_countBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, g_LodBinding, m_lodBuffer);
+
+	// the draws use the program of the caller again
+	GLint currentProgram = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &currentProgram);
+	glUseProgram(m_program);
+	glDispatchCompute((m_objectCount + g_WorkGroupSize - 1) / g_WorkGroupSize, 1, 1);
+	glUseProgram((GLuint)currentProgram);
+
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+/***********************************************************
+ *  DrawGroup()
+ *
+ *  This method is used for drawing the commands of a group
+ *  with one multi draw call.  The packed commands are drawn
+ *  up to the count the compute shader wrote.
+ ***********************************************************/
+void GpuCuller::DrawGroup(int group, int firstObject, int objectCount)
+{
+	if (!IsSupported() || (objectCount <= 0))
+	{
+		return;
+	}
+
+	const void* pCommands = (const void*)(firstObject * sizeof(DRAW_COMMAND));
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+	if (m_bCompactCommands)
+	{
+		if (m_bCoreIndirectCount)
+		{
+			glBindBuffer(GL_PARAMETER_BUFFER, m_countBuffer);
+			glMultiDrawElementsIndirectCount(GL_TRIANGLES, GL_UNSIGNED_INT, pCommands,
+				(GLintptr)(group * sizeof(GLuint)), objectCount, 0);
+			glBindBuffer(GL_PARAMETER_BUFFER, 0);
+		}
+		else
+		{
+			glBindBuffer(GL_PARAMETER_BUFFER_ARB, m_countBuffer);
+			glMultiDrawElementsIndirectCountARB(GL_TRIANGLES, GL_UNSIGNED_INT, pCommands,
+				(GLintptr)(group * sizeof(GLuint)), objectCount, 0);
+			glBindBuffer(GL_PARAMETER_BUFFER_ARB, 0);
+		}
+	}
+	else
+	{
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, pCommands, objectCount, 0);
+	}
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the culling program and
+ *  the buffers.
+ ***********************************************************/
+void GpuCuller::Destroy()
+{
+	if (m_program != 0)
+	{
+		glDeleteProgram(m_program);
+		m_program = 0;
+	}
+	if (m_objectBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_objectBuffer);
+		glDeleteBuffers(1, &m_commandBuffer);
+		glDeleteBuffers(1, &m_countBuffer);
+		glDeleteBuffers(1, &m_lodBuffer);
+		m_objectBuffer = 0;
+		m_commandBuffer = 0;
+		m_countBuffer = 0;
+		m_lodBuffer = 0;
+	}
+	m_objectCount = 0;
+	m_groupCount = 0;
+}
@@ -0,0 +1,95 @@
+///////////////////////////////////////////////////////////////////////////////
+// gpuculler.h
+// ============
+// cull the static geometry in a compute shader and draw it from indirect commands
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MeshLod.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  GpuCuller
+ *
+ *  This class contains the code for moving the per-object
+ *  work of drawing the static geometry onto the GPU.  A
+ *  compute shader tests the bounding sphere of every object
+ *  against the view frustum, picks its detail level from its
+ *  projected size and writes an indirect draw command for
+ *  each visible one, so the CPU only issues one
+ *  multi draw call per group no matter how many objects the
+ *  scene holds.
+ ***********************************************************/
+class GpuCuller
+{
+public:
+	// constructor
+	GpuCuller();
+	// destructor
+	~GpuCuller();
+
+	// one object in the std430 layout of the compute shader
+	struct DRAW_OBJECT
+	{
+		// world space bounding sphere - xyz center, w radius
+		glm::vec4 bounds;
+		// index range of every detail level
+		GLuint lodFirstIndex[MESH_LOD_COUNT];
+		GLuint lodIndexCount[MESH_LOD_COUNT];
+		GLuint group;
+		// first command of the group of the object
+		GLuint firstCommand;
+	};
+
+	// compile the culling compute shader, returns false when the
+	// context can not draw from indirect commands
+	bool Create(const char* computeShaderPath);
+	// the culling program, for connecting its uniform blocks
+	GLuint GetProgram() const { return(m_program); }
+	// true once the culling program is ready
+	bool IsSupported() const { return(m_program != 0); }
+
+	// upload the objects, ordered by group, and size the command buffers
+	void SetObjects(const std::vector<DRAW_OBJECT>& objects, int groupCount);
+	// move the bounding sphere of an uploaded object
+	void SetObjectBounds(int object, const glm::vec4& bounds);
+
+	// set how far the projected size has to move before a level changes
+	void SetLodHysteresis(float hysteresis);
+
+	// write the draw commands of the visible objects, the pixels per
+	// unit are the projected size of one unit at a distance of one
+	void Cull(float pixelsPerUnit);
+	// draw the visible objects of a group - the vertex array of the
+	// geometry must be bound
+	void DrawGroup(int group, int firstObject, int objectCount);
+
+	// free the program and the buffers
+	void Destroy();
+
+private:
+	// the culling compute program
+	GLuint m_program;
+	// locations of the uniforms set after the program is created
+	GLint m_objectCountLocation;
+	GLint m_pixelsPerUnitLocation;
+	GLint m_lodHysteresisLocation;
+	// true when the commands are compacted and drawn with a GPU count,
+	// through the 4.6 core entry point or else the ARB extension one
+	bool m_bCompactCommands;
+	bool m_bCoreIndirectCount;
+
+	// buffers of the objects, the commands, the per-group command
+	// counts and the detail level of every object
+	GLuint m_objectBuffer;
+	GLuint m_commandBuffer;
+	GLuint m_countBuffer;
+	GLuint m_lodBuffer;
+	int m_objectCount;
+	int m_groupCount;
+};
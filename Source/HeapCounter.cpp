@@ -0,0 +1,109 @@
+///////////////////////////////////////////////////////////////////////////////
+// heapcounter.cpp
+// ============
+// count the heap allocations made by the threads that run the frame loop
+///////////////////////////////////////////////////////////////////////////////
+
+#include "HeapCounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// declaration of the global variables and defines
+namespace
+{
+	// allocations of the counted threads
+	std::atomic<unsigned long> g_AllocationCount(0);
+	// true on the threads whose allocations are counted
+	thread_local bool t_bThreadTracked = false;
+
+	// allocate for all of the replaced operators, returns NULL on failure
+	void* CountedAllocate(size_t size)
+	{
+		if (t_bThreadTracked)
+		{
+			g_AllocationCount.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		return(malloc((size > 0) ? size : 1));
+	}
+}
+
+/***********************************************************
+ *  SetThreadTracked()
+ *
+ *  This method is used for turning the counting on or off
+ *  for the calling thread.
+ ***********************************************************/
+void HeapCounter::SetThreadTracked(bool bTracked)
+{
+	t_bThreadTracked = bTracked;
+}
+
+/***********************************************************
+ *  GetAllocationCount()
+ *
+ *  This method is used for getting the number of allocations
+ *  the counted threads made so far.
+ ***********************************************************/
+unsigned long HeapCounter::GetAllocationCount()
+{
+	return(g_AllocationCount.load(std::memory_order_relaxed));
+}
+
+// the replaced global allocation operators
+void* operator new(size_t size)
+{
+	void* pMemory = CountedAllocate(size);
+	if (pMemory == NULL)
+	{
+		throw std::bad_alloc();
+	}
+	return(pMemory);
+}
+
+void* operator new[](size_t size)
+{
+	return(operator new(size));
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	return(CountedAllocate(size));
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	return(CountedAllocate(size));
+}
+
+void operator delete(void* pMemory) noexcept
+{
+	free(pMemory);
+}
+
+void operator delete[](void* pMemory) noexcept
+{
+	free(pMemory);
+}
+
+void operator delete(void* pMemory, size_t) noexcept
+{
+	free(pMemory);
+}
+
+void operator delete[](void* pMemory, size_t) noexcept
+{
+	free(pMemory);
+}
+
+void operator delete(void* pMemory, const std::nothrow_t&) noexcept
+{
+	free(pMemory);
+}
+
+void operator delete[](void* pMemory, const std::nothrow_t&) noexcept
+{
+	free(pMemory);
+}
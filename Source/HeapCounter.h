@@ -0,0 +1,27 @@
+///////////////////////////////////////////////////////////////////////////////
+// heapcounter.h
+// ============
+// count the heap allocations made by the threads that run the frame loop
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/***********************************************************
+ *  HeapCounter
+ *
+ *  This class contains the code for counting the calls to
+ *  operator new.  The counting replaces the global operators,
+ *  so it covers the containers and every other allocation of
+ *  the C++ code.  Only the threads that do frame work are
+ *  counted - the main thread and the job workers - so the
+ *  texture decoding threads can allocate without showing up.
+ ***********************************************************/
+class HeapCounter
+{
+public:
+	// count the allocations of the calling thread or stop counting them
+	static void SetThreadTracked(bool bTracked);
+
+	// allocations of the counted threads since the program started
+	static unsigned long GetAllocationCount();
+};
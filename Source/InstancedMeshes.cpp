@@ -0,0 +1,418 @@
+///////////////////////////////////////////////////////////////////////////////
+// instancedmeshes.cpp
+// ============
+// draw many copies of the basic 3D shapes with one instanced draw call
+///////////////////////////////////////////////////////////////////////////////
+
+#include "InstancedMeshes.h"
+
+#include <algorithm>
+#include <cstddef>
+
+// declaration of the global variables and defines
+namespace
+{
+	// vertex attribute locations used in the vertex shader
+	const GLuint g_PositionLocation = 0;
+	const GLuint g_NormalLocation = 1;
+	const GLuint g_TextureCoordinateLocation = 2;
+	// the instance model matrix uses four consecutive locations
+	// and the normal matrix three
+	const GLuint g_InstanceModelLocation = 3;
+	const GLuint g_InstanceIndicesLocation = 7;
+	const GLuint g_InstanceNormalLocation = 9;
+}
+
+/***********************************************************
+ *  InstancedMeshes()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+InstancedMeshes::InstancedMeshes()
+{
+	m_boxMesh = GLmesh();
+	m_planeMesh = GLmesh();
+	m_prismMesh = GLmesh();
+	for (int lod = 0; lod < MESH_LOD_COUNT; lod++)
+	{
+		m_cylinderMeshes[lod] = GLmesh();
+		m_sphereMeshes[lod] = GLmesh();
+		m_torusMeshes[lod] = GLmesh();
+	}
+	m_instanceBuffer = 0;
+	m_instanceCount = 0;
+}
+
+/***********************************************************
+ *  ~InstancedMeshes()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+InstancedMeshes::~InstancedMeshes()
+{
+	DestroyMesh(m_boxMesh);
+	DestroyMesh(m_planeMesh);
+	DestroyMesh(m_prismMesh);
+	for (int lod = 0; lod < MESH_LOD_COUNT; lod++)
+	{
+		DestroyMesh(m_cylinderMeshes[lod]);
+		DestroyMesh(m_sphereMeshes[lod]);
+		DestroyMesh(m_torusMeshes[lod]);
+	}
+
+	if (m_instanceBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_instanceBuffer);
+		m_instanceBuffer = 0;
+	}
+}
+
+/***********************************************************
+ *  UploadMesh()
+ *
+ *  This method is used for creating the vertex array object,
+ *  vertex buffer and index buffer for the passed in mesh
+ *  data.  The vertices are stored packed, at half the size
+ *  of the generated ones, and the vertex array also reads the
+ *  per-instance attributes from the shared instance buffer.
+ ***********************************************************/
+void InstancedMeshes::UploadMesh(const MeshGeometry::MESH_DATA& data, GLmesh& mesh)
+{
+	const GLsizei vertexStride = sizeof(MeshGeometry::PACKED_VERTEX);
+	const GLsizei instanceStride = sizeof(INSTANCE_DATA);
+	std::vector<MeshGeometry::PACKED_VERTEX> vertices;
+
+	MeshGeometry::PackVertices(data, vertices);
+
+	// the instance buffer is shared by all the mesh vertex arrays
+	if (m_instanceBuffer == 0)
+	{
+		glGenBuffers(1, &m_instanceBuffer);
+	}
+
+	glGenVertexArrays(1, &mesh.vao);
+	glBindVertexArray(mesh.vao);
+
+	// per-vertex data
+	glGenBuffers(2, mesh.vbos);
+	glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[0]);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(MeshGeometry::PACKED_VERTEX), vertices.data(), GL_STATIC_DRAW);
+
+	glEnableVertexAttribArray(g_PositionLocation);
+	glVertexAttribPointer(g_PositionLocation, 3, GL_HALF_FLOAT, GL_FALSE, vertexStride,
+		(void*)offsetof(MeshGeometry::PACKED_VERTEX, position));
+	glEnableVertexAttribArray(g_NormalLocation);
+	glVertexAttribPointer(g_NormalLocation, 4, GL_INT_2_10_10_10_REV, GL_TRUE, vertexStride,
+		(void*)offsetof(MeshGeometry::PACKED_VERTEX, normal));
+	glEnableVertexAttribArray(g_TextureCoordinateLocation);
+	glVertexAttribPointer(g_TextureCoordinateLocation, 2, GL_HALF_FLOAT, GL_FALSE, vertexStride,
+		(void*)offsetof(MeshGeometry::PACKED_VERTEX, textureCoordinate));
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.vbos[1]);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, data.indices.size() * sizeof(GLuint), data.indices.data(), GL_STATIC_DRAW);
+	mesh.nIndices = (GLsizei)data.indices.size();
+
+	// per-instance data - the matrices take one location per column
+	glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+	for (GLuint column = 0; column < 4; column++)
+	{
+		glEnableVertexAttribArray(g_InstanceModelLocation + column);
+		glVertexAttribPointer(g_InstanceModelLocation + column, 4, GL_FLOAT, GL_FALSE, instanceStride,
+			(void*)(offsetof(INSTANCE_DATA, model) + column * sizeof(glm::vec4)));
+		glVertexAttribDivisor(g_InstanceModelLocation + column, 1);
+	}
+	glEnableVertexAttribArray(g_InstanceIndicesLocation);
+	glVertexAttribIPointer(g_InstanceIndicesLocation, 2, GL_INT, instanceStride,
+		(void*)offsetof(INSTANCE_DATA, materialIndex));
+	glVertexAttribDivisor(g_InstanceIndicesLocation, 1);
+	for (GLuint column = 0; column < 3; column++)
+	{
+		glEnableVertexAttribArray(g_InstanceNormalLocation + column);
+		glVertexAttribPointer(g_InstanceNormalLocation + column, 3, GL_FLOAT, GL_FALSE, instanceStride,
+			(void*)(offsetof(INSTANCE_DATA, normalMatrix) + column * sizeof(glm::vec3)));
+		glVertexAttribDivisor(g_InstanceNormalLocation + column, 1);
+	}
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/***********************************************************
+ *  DestroyMesh()
+ *
+ *  This method is used for freeing the OpenGL objects of a
+ *  loaded mesh.
+ ***********************************************************/
+void InstancedMeshes::DestroyMesh(GLmesh& mesh)
+{
+	if (mesh.vao != 0)
+	{
+		glDeleteVertexArrays(1, &mesh.vao);
+		glDeleteBuffers(2, mesh.vbos);
+		mesh = GLmesh();
+	}
+}
+
+/***********************************************************
+ *  LoadBoxMesh()
+ *
+ *  This method is used for loading the box mesh into
+ *  OpenGL memory.
+ ***********************************************************/
+void InstancedMeshes::LoadBoxMesh()
+{
+	MeshGeometry::MESH_DATA data;
+
+	MeshGeometry::BuildBoxMesh(data);
+	UploadMesh(data, m_boxMesh);
+}
+
+/***********************************************************
+ *  LoadPlaneMesh()
+ *
+ *  This method is used for loading the plane mesh into
+ *  OpenGL memory.
+ ***********************************************************/
+void InstancedMeshes::LoadPlaneMesh()
+{
+	MeshGeometry::MESH_DATA data;
+
+	MeshGeometry::BuildPlaneMesh(data);
+	UploadMesh(data, m_planeMesh);
+}
+
+/***********************************************************
+ *  LoadPrismMesh()
+ *
+ *  This method is used for loading the prism mesh into
+ *  OpenGL memory.
+ ***********************************************************/
+void InstancedMeshes::LoadPrismMesh()
+{
+	MeshGeometry::MESH_DATA data;
+
+	MeshGeometry::BuildPrismMesh(data);
+	UploadMesh(data, m_prismMesh);
+}
+
+/***********************************************************
+ *  LoadCylinderMesh()
+ *
+ *  This method is used for loading the cylinder mesh into
+ *  OpenGL memory at every detail level.
+ ***********************************************************/
+void InstancedMeshes::LoadCylinderMesh()
+{
+	for (int lod = 0; lod < MESH_LOD_COUNT; lod++)
+	{
+		MeshGeometry::MESH_DATA data;
+
+		MeshGeometry::BuildCylinderMesh(data, MESH_LOD_SEGMENTS[lod]);
+		UploadMesh(data, m_cylinderMeshes[lod]);
+	}
+}
+
+/***********************************************************
+ *  LoadSphereMesh()
+ *
+ *  This method is used for loading the sphere mesh into
+ *  OpenGL memory at every detail level.
+ ***********************************************************/
+void InstancedMeshes::LoadSphereMesh()
+{
+	for (int lod = 0; lod < MESH_LOD_COUNT; lod++)
+	{
+		MeshGeometry::MESH_DATA data;
+
+		MeshGeometry::BuildSphereMesh(data, MESH_LOD_SEGMENTS[lod]);
+		UploadMesh(data, m_sphereMeshes[lod]);
+	}
+}
+
+/***********************************************************
+ *  LoadTorusMesh()
+ *
+ *  This method is used for loading the torus mesh into
+ *  OpenGL memory at every detail level.
+ ***********************************************************/
+void InstancedMeshes::LoadTorusMesh()
+{
+	for (int lod = 0; lod < MESH_LOD_COUNT; lod++)
+	{
+		MeshGeometry::MESH_DATA data;
+
+		MeshGeometry::BuildTorusMesh(data, MESH_LOD_SEGMENTS[lod]);
+		UploadMesh(data, m_torusMeshes[lod]);
+	}
+}
+
+/***********************************************************
+ *  MapInstanceData()
+ *
+ *  This method is used for getting room for the per-instance
+ *  data that the instanced draw methods read from.  The old
+ *  data is orphaned, so the driver never waits for draws
+ *  still reading it, and the mapped memory may be filled by
+ *  any thread until it is unmapped.  Draws select their
+ *  instances by range, so one upload can serve every mesh
+ *  in the scene.
+ ***********************************************************/
+InstancedMeshes::INSTANCE_DATA* InstancedMeshes::MapInstanceData(int instanceCount)
+{
+	INSTANCE_DATA* pInstances = NULL;
+
+	if (m_instanceBuffer == 0)
+	{
+		glGenBuffers(1, &m_instanceBuffer);
+	}
+
+	m_instanceCount = 0;
+	if (instanceCount <= 0)
+	{
+		return(NULL);
+	}
+
+	GLsizeiptr size = instanceCount * sizeof(INSTANCE_DATA);
+
+	glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+	glBufferData(GL_ARRAY_BUFFER, size, NULL, GL_DYNAMIC_DRAW);
+	pInstances = (INSTANCE_DATA*)glMapBufferRange(GL_ARRAY_BUFFER, 0, size,
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	if (pInstances != NULL)
+	{
+		m_instanceCount = (GLsizei)instanceCount;
+	}
+
+	return(pInstances);
+}
+
+/***********************************************************
+ *  UnmapInstanceData()
+ *
+ *  This method is used for handing the filled instance data
+ *  to the draws.  When the driver lost the mapped memory on
+ *  the way the data is gone, so no instances are drawn and
+ *  false tells the caller to fill it again.
+ ***********************************************************/
+bool InstancedMeshes::UnmapInstanceData()
+{
+	if (m_instanceCount == 0)
+	{
+		return(true);
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+	GLboolean bIntact = glUnmapBuffer(GL_ARRAY_BUFFER);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	if (bIntact == GL_FALSE)
+	{
+		m_instanceCount = 0;
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  DrawMeshInstanced()
+ *
+ *  This method is used for drawing a range of instances of
+ *  the passed in mesh with a single draw call.
+ ***********************************************************/
+void InstancedMeshes::DrawMeshInstanced(const GLmesh& mesh, GLuint firstInstance, GLsizei instanceCount)
+{
+	if ((mesh.vao == 0) || (instanceCount <= 0) ||
+		(firstInstance + instanceCount > (GLuint)m_instanceCount))
+	{
+		return;
+	}
+
+	glBindVertexArray(mesh.vao);
+	glDrawElementsInstancedBaseInstance(
+		GL_TRIANGLES,
+		mesh.nIndices,
+		GL_UNSIGNED_INT,
+		NULL,
+		instanceCount,
+		firstInstance);
+	glBindVertexArray(0);
+}
+
+/***********************************************************
+ *  DrawLodMeshInstanced()
+ *
+ *  This method is used for drawing a range of instances of
+ *  one detail level of a curved shape.  A level out of range
+ *  is clamped to the nearest one that exists.
+ ***********************************************************/
+void InstancedMeshes::DrawLodMeshInstanced(const GLmesh* pMeshes, int lod, GLuint firstInstance, GLsizei instanceCount)
+{
+	lod = std::max(0, std::min(lod, MESH_LOD_COUNT - 1));
+	DrawMeshInstanced(pMeshes[lod], firstInstance, instanceCount);
+}
+
+/***********************************************************
+ *  DrawBoxMeshInstanced()
+ *
+ *  This method is used for drawing a range of box instances.
+ ***********************************************************/
+void InstancedMeshes::DrawBoxMeshInstanced(GLuint firstInstance, GLsizei instanceCount)
+{
+	DrawMeshInstanced(m_boxMesh, firstInstance, instanceCount);
+}
+
+/***********************************************************
+ *  DrawPlaneMeshInstanced()
+ *
+ *  This method is used for drawing a range of plane instances.
+ ***********************************************************/
+void InstancedMeshes::DrawPlaneMeshInstanced(GLuint firstInstance, GLsizei instanceCount)
+{
+	DrawMeshInstanced(m_planeMesh, firstInstance, instanceCount);
+}
+
+/***********************************************************
+ *  DrawPrismMeshInstanced()
+ *
+ *  This method is used for drawing a range of prism instances.
+ ***********************************************************/
+void InstancedMeshes::DrawPrismMeshInstanced(GLuint firstInstance, GLsizei instanceCount)
+{
+	DrawMeshInstanced(m_prismMesh, firstInstance, instanceCount);
+}
+
+/***********************************************************
+ *  DrawCylinderMeshInstanced()
+ *
+ *  This method is used for drawing a range of cylinder instances
+ *  at the passed in detail level.
+ ***********************************************************/
+void InstancedMeshes::DrawCylinderMeshInstanced(GLuint firstInstance, GLsizei instanceCount, int lod)
+{
+	DrawLodMeshInstanced(m_cylinderMeshes, lod, firstInstance, instanceCount);
+}
+
+/***********************************************************
+ *  DrawSphereMeshInstanced()
+ *
+ *  This method is used for drawing a range of sphere instances
+ *  at the passed in detail level.
+ ***********************************************************/
+void InstancedMeshes::DrawSphereMeshInstanced(GLuint firstInstance, GLsizei instanceCount, int lod)
+{
+	DrawLodMeshInstanced(m_sphereMeshes, lod, firstInstance, instanceCount);
+}
+
+/***********************************************************
+ *  DrawTorusMeshInstanced()
+ *
+ *  This method is used for drawing a range of torus instances
+ *  at the passed in detail level.
+ ***********************************************************/
+void InstancedMeshes::DrawTorusMeshInstanced(GLuint firstInstance, GLsizei instanceCount, int lod)
+{
+	DrawLodMeshInstanced(m_torusMeshes, lod, firstInstance, instanceCount);
+}
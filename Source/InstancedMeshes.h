@@ -0,0 +1,97 @@
+///////////////////////////////////////////////////////////////////////////////
+// instancedmeshes.h
+// ============
+// draw many copies of the basic 3D shapes with one instanced draw call
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MeshGeometry.h"
+#include "MeshLod.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  InstancedMeshes
+ *
+ *  This class contains the code for loading the basic 3D
+ *  shapes into OpenGL memory together with a shared buffer
+ *  of per-instance data, and for drawing any range of those
+ *  instances with a single draw call.  The curved shapes are
+ *  loaded at every detail level, and a draw picks one.
+ ***********************************************************/
+class InstancedMeshes
+{
+public:
+	// constructor
+	InstancedMeshes();
+	// destructor
+	~InstancedMeshes();
+
+	// the per-instance data read by the vertex shader
+	struct INSTANCE_DATA
+	{
+		glm::mat4 model;
+		// transforms the normals, worked out once per object
+		glm::mat3 normalMatrix;
+		GLint materialIndex;
+		GLint textureSlot;
+	};
+
+	// load the basic shape meshes into OpenGL memory
+	void LoadBoxMesh();
+	void LoadPlaneMesh();
+	void LoadPrismMesh();
+	void LoadCylinderMesh();
+	void LoadSphereMesh();
+	void LoadTorusMesh();
+
+	// map room for the per-instance data used by the draw methods,
+	// returns NULL when there are no instances or it can not be mapped
+	INSTANCE_DATA* MapInstanceData(int instanceCount);
+	// finish writing the mapped instance data, returns false when
+	// it was lost and has to be written again
+	bool UnmapInstanceData();
+
+	// draw a range of instances from the instance data
+	void DrawBoxMeshInstanced(GLuint firstInstance, GLsizei instanceCount);
+	void DrawPlaneMeshInstanced(GLuint firstInstance, GLsizei instanceCount);
+	void DrawPrismMeshInstanced(GLuint firstInstance, GLsizei instanceCount);
+	void DrawCylinderMeshInstanced(GLuint firstInstance, GLsizei instanceCount, int lod = 0);
+	void DrawSphereMeshInstanced(GLuint firstInstance, GLsizei instanceCount, int lod = 0);
+	void DrawTorusMeshInstanced(GLuint firstInstance, GLsizei instanceCount, int lod = 0);
+
+private:
+	// the OpenGL objects of one loaded mesh
+	struct GLmesh
+	{
+		GLuint vao;
+		GLuint vbos[2];
+		GLsizei nIndices;
+	};
+
+	GLmesh m_boxMesh;
+	GLmesh m_planeMesh;
+	GLmesh m_prismMesh;
+	// the curved shapes, one mesh per detail level
+	GLmesh m_cylinderMeshes[MESH_LOD_COUNT];
+	GLmesh m_sphereMeshes[MESH_LOD_COUNT];
+	GLmesh m_torusMeshes[MESH_LOD_COUNT];
+
+	// buffer holding the per-instance data for all meshes
+	GLuint m_instanceBuffer;
+	// number of instances in the instance buffer
+	GLsizei m_instanceCount;
+
+	// create the OpenGL buffers for the generated mesh data
+	void UploadMesh(const MeshGeometry::MESH_DATA& data, GLmesh& mesh);
+	// issue the instanced draw call for a loaded mesh
+	void DrawMeshInstanced(const GLmesh& mesh, GLuint firstInstance, GLsizei instanceCount);
+	// issue the instanced draw call for one detail level of a curved shape
+	void DrawLodMeshInstanced(const GLmesh* pMeshes, int lod, GLuint firstInstance, GLsizei instanceCount);
+	// free the OpenGL objects of a loaded mesh
+	void DestroyMesh(GLmesh& mesh);
+};
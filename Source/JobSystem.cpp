@@ -0,0 +1,234 @@
+///////////////////////////////////////////////////////////////////////////////
+// jobsystem.cpp
+// ============
+// split the per-frame loops over the scene objects across worker threads
+///////////////////////////////////////////////////////////////////////////////
+
+#include "JobSystem.h"
+#include "HeapCounter.h"
+
+#include <algorithm>
+
+/***********************************************************
+ *  JobSystem()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+JobSystem::JobSystem()
+{
+	m_queuedTasks = 0;
+	m_bRunning = false;
+}
+
+/***********************************************************
+ *  ~JobSystem()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+JobSystem::~JobSystem()
+{
+	Stop();
+}
+
+/***********************************************************
+ *  Start()
+ *
+ *  This method is used for starting the worker threads.  The
+ *  calling thread works on every loop as well, so one fewer
+ *  worker is started than there are threads.
+ ***********************************************************/
+void JobSystem::Start(int threadCount)
+{
+	if (m_bRunning)
+	{
+		return;
+	}
+
+	if (threadCount <= 0)
+	{
+		threadCount = (int)std::thread::hardware_concurrency();
+	}
+
+	m_bRunning = true;
+	for (int i = 0; i < threadCount; i++)
+	{
+		m_queues.push_back(new TASK_QUEUE());
+		m_queues.back()->first = 0;
+	}
+	for (int i = 1; i < threadCount; i++)
+	{
+		m_workers.push_back(std::thread(&JobSystem::WorkerMain, this, i));
+	}
+}
+
+/***********************************************************
+ *  Stop()
+ *
+ *  This method is used for stopping and joining the worker
+ *  threads.  No loop is running at that point, since every
+ *  loop finishes before ParallelFor() returns.
+ ***********************************************************/
+void JobSystem::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_wakeMutex);
+		m_bRunning = false;
+	}
+	m_taskAvailable.notify_all();
+
+	for (int i = 0; i < m_workers.size(); i++)
+	{
+		m_workers[i].join();
+	}
+	m_workers.clear();
+
+	for (int i = 0; i < m_queues.size(); i++)
+	{
+		delete m_queues[i];
+	}
+	m_queues.clear();
+}
+
+/***********************************************************
+ *  RunParallel()
+ *
+ *  This method is used for running a job over a range of
+ *  indices.  A range of no more than one chunk, or a job
+ *  system without workers, runs right on the calling thread
+ *  without touching the queues.
+ ***********************************************************/
+void JobSystem::RunParallel(int count, int grainSize, const RANGE_JOB& job)
+{
+	if (count <= 0)
+	{
+		return;
+	}
+	if (grainSize < 1)
+	{
+		grainSize = 1;
+	}
+
+	if ((m_workers.size() == 0) || (count <= grainSize))
+	{
+		job.pRun(job.pJob, 0, count);
+		return;
+	}
+
+	int taskCount = (count + grainSize - 1) / grainSize;
+	std::atomic<int> remaining(taskCount);
+
+	// counted before they are queued, so the count never drops
+	// below the chunks that are really waiting
+	{
+		std::lock_guard<std::mutex> lock(m_wakeMutex);
+		m_queuedTasks += taskCount;
+	}
+
+	// deal the chunks out in runs, so neighbouring indices stay on
+	// one thread unless its queue is stolen from
+	int tasksPerQueue = (taskCount + (int)m_queues.size() - 1) / (int)m_queues.size();
+
+	for (int q = 0; q < m_queues.size(); q++)
+	{
+		std::lock_guard<std::mutex> lock(m_queues[q]->mutex);
+
+		for (int t = q * tasksPerQueue; (t < (q + 1) * tasksPerQueue) && (t < taskCount); t++)
+		{
+			TASK task;
+			task.pJob = &job;
+			task.begin = t * grainSize;
+			task.end = std::min(task.begin + grainSize, count);
+			task.pRemaining = &remaining;
+			m_queues[q]->tasks.push_back(task);
+		}
+	}
+	m_taskAvailable.notify_all();
+
+	// work on the loop until the last chunk is finished, the
+	// chunks still running on the workers only need waiting for
+	while (remaining.load(std::memory_order_acquire) > 0)
+	{
+		if (!RunTask(0))
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+/***********************************************************
+ *  RunTask()
+ *
+ *  This method is used for running one chunk.  A thread takes
+ *  the last chunk of its own queue, and steals the first one
+ *  of another queue when its own is empty.
+ ***********************************************************/
+bool JobSystem::RunTask(int queueIndex)
+{
+	TASK task;
+	bool bFound = false;
+
+	for (int n = 0; (n < m_queues.size()) && !bFound; n++)
+	{
+		TASK_QUEUE* pQueue = m_queues[(queueIndex + n) % m_queues.size()];
+		std::lock_guard<std::mutex> lock(pQueue->mutex);
+
+		if (pQueue->first >= (int)pQueue->tasks.size())
+		{
+			continue;
+		}
+		if (n == 0)
+		{
+			task = pQueue->tasks.back();
+			pQueue->tasks.pop_back();
+		}
+		else
+		{
+			task = pQueue->tasks[pQueue->first];
+			pQueue->first++;
+		}
+		if (pQueue->first >= (int)pQueue->tasks.size())
+		{
+			pQueue->tasks.clear();
+			pQueue->first = 0;
+		}
+		m_queuedTasks--;
+		bFound = true;
+	}
+
+	if (!bFound)
+	{
+		return(false);
+	}
+
+	task.pJob->pRun(task.pJob->pJob, task.begin, task.end);
+	task.pRemaining->fetch_sub(1, std::memory_order_release);
+
+	return(true);
+}
+
+/***********************************************************
+ *  WorkerMain()
+ *
+ *  This method is the loop of each worker thread.  A worker
+ *  sleeps while every queue is empty.  The chunks are frame
+ *  work, so their allocations are counted.
+ ***********************************************************/
+void JobSystem::WorkerMain(int queueIndex)
+{
+	HeapCounter::SetThreadTracked(true);
+
+	while (true)
+	{
+		if (RunTask(queueIndex))
+		{
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_wakeMutex);
+		m_taskAvailable.wait(lock, [this]() { return(!m_bRunning || (m_queuedTasks > 0)); });
+		if (!m_bRunning)
+		{
+			return;
+		}
+	}
+}
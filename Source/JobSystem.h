@@ -0,0 +1,113 @@
+///////////////////////////////////////////////////////////////////////////////
+// jobsystem.h
+// ============
+// split the per-frame loops over the scene objects across worker threads
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  JobSystem
+ *
+ *  This class contains the code for running a loop over a
+ *  range of indices on several threads.  The range is cut
+ *  into chunks that are dealt out to one queue per thread,
+ *  and a thread that runs out of chunks takes them from the
+ *  front of the other queues, so an uneven split still keeps
+ *  every thread busy.  The thread that starts a loop works
+ *  on it too, and only returns once every chunk is done.
+ *  The loop body is only referred to, never copied, and the
+ *  queues keep their room between loops, so running a loop
+ *  does not allocate once the queues have grown.
+ ***********************************************************/
+class JobSystem
+{
+public:
+	// constructor
+	JobSystem();
+	// destructor
+	~JobSystem();
+
+	// start the worker threads, zero picks one per spare CPU core
+	// and one runs every loop on the calling thread
+	void Start(int threadCount = 0);
+	// stop and join the worker threads
+	void Stop();
+
+	// number of threads a loop is spread over, the caller included
+	int GetThreadCount() const { return((int)m_workers.size() + 1); }
+
+	// run the job over the indices from zero to count in chunks of
+	// grain size, calling it with the begin and end index of each
+	// chunk - only the thread that called Start() may call this
+	template <typename JOB>
+	void ParallelFor(int count, int grainSize, const JOB& job)
+	{
+		RANGE_JOB rangeJob;
+
+		rangeJob.pRun = &RunJob<JOB>;
+		rangeJob.pJob = &job;
+		RunParallel(count, grainSize, rangeJob);
+	}
+
+private:
+	// the loop body of a running loop, with the function that
+	// calls it for a chunk
+	struct RANGE_JOB
+	{
+		void (*pRun)(const void* pJob, int begin, int end);
+		const void* pJob;
+	};
+
+	// call the loop body of the type ParallelFor() was called with
+	template <typename JOB>
+	static void RunJob(const void* pJob, int begin, int end)
+	{
+		(*(const JOB*)pJob)(begin, end);
+	}
+
+	// one chunk of a loop
+	struct TASK
+	{
+		const RANGE_JOB* pJob;
+		int begin;
+		int end;
+		// chunks of the loop that are not finished yet
+		std::atomic<int>* pRemaining;
+	};
+
+	// the chunks dealt to one thread, the caller has queue zero -
+	// the chunks from first on are waiting, and the queue is
+	// emptied once the last one is taken
+	struct TASK_QUEUE
+	{
+		std::mutex mutex;
+		std::vector<TASK> tasks;
+		int first;
+	};
+
+	// the worker threads
+	std::vector<std::thread> m_workers;
+	std::vector<TASK_QUEUE*> m_queues;
+	// number of chunks waiting in all of the queues
+	std::atomic<int> m_queuedTasks;
+	// wakes the workers when chunks are queued or on shutdown
+	std::mutex m_wakeMutex;
+	std::condition_variable m_taskAvailable;
+	// true while the workers should keep running
+	bool m_bRunning;
+
+	// run a loop over the queues and wait until it is finished
+	void RunParallel(int count, int grainSize, const RANGE_JOB& job);
+	// the loop of each worker thread
+	void WorkerMain(int queueIndex);
+	// run one chunk from the own queue or another one, returns
+	// false when every queue was empty
+	bool RunTask(int queueIndex);
+};
@@ -0,0 +1,255 @@
+///////////////////////////////////////////////////////////////////////////////
+// lightclusters.cpp
+// ============
+// bin the local lights of the scene into view space clusters on the GPU
+///////////////////////////////////////////////////////////////////////////////
+
+#include "LightClusters.h"
+#include "ShaderProgram.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+// declaration of the global variables and defines
+namespace
+{
+	// storage buffer binding points - must match the shaders
+	const GLuint g_LightBinding = 7;
+	const GLuint g_ClusterBinding = 8;
+
+	// threads per work group of the compute shader
+	const int g_WorkGroupSize = 64;
+
+	const int g_ClusterCount =
+		LightClusters::CLUSTER_TILES_X * LightClusters::CLUSTER_TILES_Y * LightClusters::CLUSTER_SLICES;
+
+	// room of the stream buffer region kept for the frame uniforms and
+	// the cluster setup next to the most lights
+	const GLsizeiptr g_RegionReserve = 16 * 1024;
+	static_assert(LightClusters::MAX_LOCAL_LIGHTS * sizeof(LightClusters::LOCAL_LIGHT) + g_RegionReserve <= StreamBuffer::DEFAULT_REGION_SIZE,
+		"the most local lights must fit into a stream buffer region");
+
+	// the start of the light buffer in the std430 layout of the
+	// shaders, written again every frame
+	struct CLUSTER_SETUP
+	{
+		glm::mat4 inverseProjection;
+		// tiles across, tiles down, depth slices and light count
+		GLuint clusterGrid[4];
+		// tiles per pixel across and down, then the scale and bias
+		// turning the log of the view depth into a slice
+		glm::vec4 clusterScale;
+		// view depth of the near and far planes
+		glm::vec4 depthRange;
+	};
+}
+
+/***********************************************************
+ *  LightClusters()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+LightClusters::LightClusters()
+{
+	m_program = 0;
+	m_pStreamBuffer = NULL;
+	m_clusterBuffer = 0;
+	m_droppedLights = 0;
+}
+
+/***********************************************************
+ *  ~LightClusters()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+LightClusters::~LightClusters()
+{
+	Destroy();
+	m_pStreamBuffer = NULL;
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for compiling the clustering program
+ *  and creating the cluster buffer, which has a fixed size
+ *  of one light count and MAX_CLUSTER_LIGHTS indices for
+ *  every cluster.
+ ***********************************************************/
+bool LightClusters::Create(const char* computeShaderPath, StreamBuffer* pStreamBuffer)
+{
+	if (NULL == pStreamBuffer)
+	{
+		return(false);
+	}
+
+	if (!GLEW_VERSION_4_3)
+	{
+		std::cout << "INFO: OpenGL 4.3 is not supported, drawing without the local lights" << std::endl;
+		return(false);
+	}
+
+	m_program = ShaderProgram::LoadCompute(computeShaderPath);
+	if (m_program == 0)
+	{
+		return(false);
+	}
+
+	m_pStreamBuffer = pStreamBuffer;
+
+	glGenBuffers(1, &m_clusterBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_clusterBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, g_ClusterCount * (MAX_CLUSTER_LIGHTS + 1) * sizeof(GLuint), NULL, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	return(true);
+}
+
+/***********************************************************
+ *  AddLight()
+ *
+ *  This method is used for adding a local light.  Lights
+ *  without a positive radius would reach every cluster, so
+ *  their radius is clamped to a small positive value.  The
+ *  lights past MAX_LOCAL_LIGHTS are left out with a warning,
+ *  since they would not fit into the stream buffer region.
+ ***********************************************************/
+int LightClusters::AddLight(const LOCAL_LIGHT& light)
+{
+	if ((int)m_lights.size() >= MAX_LOCAL_LIGHTS)
+	{
+		// warn once per scene, not once per light
+		if (m_droppedLights == 0)
+		{
+			std::cout << "WARNING: only " << MAX_LOCAL_LIGHTS << " local lights are supported, the rest are left out" << std::endl;
+		}
+		m_droppedLights++;
+		return(-1);
+	}
+
+	m_lights.push_back(light);
+	SetLight((int)m_lights.size() - 1, light);
+
+	return((int)m_lights.size() - 1);
+}
+
+/***********************************************************
+ *  SetLight()
+ *
+ *  This method is used for replacing the values of an added
+ *  light.  The lights are written with the next update.
+ ***********************************************************/
+void LightClusters::SetLight(int index, const LOCAL_LIGHT& light)
+{
+	if ((index < 0) || (index >= (int)m_lights.size()))
+	{
+		return;
+	}
+
+	m_lights[index] = light;
+	m_lights[index].radius = std::max(light.radius, 0.001f);
+}
+
+/***********************************************************
+ *  ClearLights()
+ *
+ *  This method is used for removing all of the lights.
+ ***********************************************************/
+void LightClusters::ClearLights()
+{
+	m_lights.clear();
+	m_droppedLights = 0;
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for writing the cluster setup of the
+ *  current projection and viewport followed by the lights
+ *  into the stream buffer, and running the compute shader
+ *  that fills the light list of every cluster.  The lights
+ *  are few next to the other data of a frame, so they are
+ *  written every frame rather than kept in a buffer of
+ *  their own.  The slices are spaced evenly in the log of
+ *  the view depth, so the clusters near the camera are as
+ *  deep as they are wide.
+ ***********************************************************/
+void LightClusters::Update(const glm::mat4& projection, int viewportWidth, int viewportHeight)
+{
+	if (!IsSupported() || (viewportWidth <= 0) || (viewportHeight <= 0))
+	{
+		return;
+	}
+
+	CLUSTER_SETUP setup;
+	glm::vec4 nearPoint;
+	glm::vec4 farPoint;
+
+	// the near and far planes work for both projection types
+	setup.inverseProjection = glm::inverse(projection);
+	nearPoint = setup.inverseProjection * glm::vec4(0.0f, 0.0f, -1.0f, 1.0f);
+	farPoint = setup.inverseProjection * glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+
+	float nearDepth = std::max(-nearPoint.z / nearPoint.w, 0.001f);
+	float farDepth = std::max(-farPoint.z / farPoint.w, nearDepth * 1.001f);
+	float logDepthRange = std::log(farDepth / nearDepth);
+
+	setup.clusterGrid[0] = CLUSTER_TILES_X;
+	setup.clusterGrid[1] = CLUSTER_TILES_Y;
+	setup.clusterGrid[2] = CLUSTER_SLICES;
+	setup.clusterGrid[3] = (GLuint)m_lights.size();
+	setup.clusterScale = glm::vec4(
+		(float)CLUSTER_TILES_X / (float)viewportWidth,
+		(float)CLUSTER_TILES_Y / (float)viewportHeight,
+		(float)CLUSTER_SLICES / logDepthRange,
+		-(float)CLUSTER_SLICES * std::log(nearDepth) / logDepthRange);
+	setup.depthRange = glm::vec4(nearDepth, farDepth, 0.0f, 0.0f);
+
+	StreamBuffer::ALLOCATION allocation;
+	GLsizeiptr lightBytes = m_lights.size() * sizeof(LOCAL_LIGHT);
+
+	if (!m_pStreamBuffer->Allocate(sizeof(CLUSTER_SETUP) + lightBytes, m_pStreamBuffer->GetStorageAlignment(), allocation))
+	{
+		return;
+	}
+	memcpy(allocation.pData, &setup, sizeof(CLUSTER_SETUP));
+	if (!m_lights.empty())
+	{
+		memcpy(allocation.pData + sizeof(CLUSTER_SETUP), m_lights.data(), lightBytes);
+	}
+	m_pStreamBuffer->Commit(allocation);
+
+	glBindBufferRange(GL_SHADER_STORAGE_BUFFER, g_LightBinding, m_pStreamBuffer->GetBuffer(), allocation.offset, allocation.size);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, g_ClusterBinding, m_clusterBuffer);
+
+	// the draws use the program of the caller again
+	GLint currentProgram = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &currentProgram);
+	glUseProgram(m_program);
+	glDispatchCompute((g_ClusterCount + g_WorkGroupSize - 1) / g_WorkGroupSize, 1, 1);
+	glUseProgram((GLuint)currentProgram);
+
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the clustering program
+ *  and the cluster buffer.  The lights are kept.
+ ***********************************************************/
+void LightClusters::Destroy()
+{
+	if (m_program != 0)
+	{
+		glDeleteProgram(m_program);
+		m_program = 0;
+	}
+	if (m_clusterBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_clusterBuffer);
+		m_clusterBuffer = 0;
+	}
+}
@@ -0,0 +1,98 @@
+///////////////////////////////////////////////////////////////////////////////
+// lightclusters.h
+// ============
+// bin the local lights of the scene into view space clusters on the GPU
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "StreamBuffer.h"
+
+#include <vector>
+
+/***********************************************************
+ *  LightClusters
+ *
+ *  This class contains the code for clustered forward
+ *  lighting.  The view frustum is split into a grid of
+ *  screen tiles and depth slices, and a compute shader
+ *  writes the local lights whose range touches each cluster.
+ *  The fragment shader then only loops over the lights of
+ *  its own cluster, so the cost of a pixel follows the
+ *  lights near it instead of every light in the scene.
+ ***********************************************************/
+class LightClusters
+{
+public:
+	// constructor
+	LightClusters();
+	// destructor
+	~LightClusters();
+
+	// size of the cluster grid - must match the compute shader
+	static const int CLUSTER_TILES_X = 16;
+	static const int CLUSTER_TILES_Y = 9;
+	static const int CLUSTER_SLICES = 24;
+	// most lights one cluster holds - must match MAX_CLUSTER_LIGHTS in the shaders
+	static const int MAX_CLUSTER_LIGHTS = 32;
+	// most local lights of the scene - they are written into the stream
+	// buffer region of every frame, and 1024 of them take 48 KB of the
+	// 64 KB default region, leaving the rest for the other frame data
+	static const int MAX_LOCAL_LIGHTS = 1024;
+
+	// one light with a limited range in the std430 layout of the shaders
+	struct LOCAL_LIGHT
+	{
+		glm::vec3 position;
+		// distance at which the light has faded out completely
+		float radius;
+		glm::vec3 diffuseColor;
+		float specularIntensity;
+		glm::vec3 specularColor;
+		float focalStrength;
+	};
+
+	// compile the clustering compute shader, returns false when the
+	// context has no compute shaders - the lights are streamed
+	// through the stream buffer every frame
+	bool Create(const char* computeShaderPath, StreamBuffer* pStreamBuffer);
+	// the clustering program, for connecting its uniform blocks
+	GLuint GetProgram() const { return(m_program); }
+	// true once the clustering program is ready
+	bool IsSupported() const { return(m_program != 0); }
+
+	// add a light and return its index, -1 once MAX_LOCAL_LIGHTS are added
+	int AddLight(const LOCAL_LIGHT& light);
+	// replace the values of an added light
+	void SetLight(int index, const LOCAL_LIGHT& light);
+	// remove all of the lights
+	void ClearLights();
+	// number of added lights
+	int GetLightCount() const { return((int)m_lights.size()); }
+
+	// bin the lights into the clusters of the current view and bind
+	// the buffers the fragment shader reads - the FrameData block
+	// of the frame must already be bound, and the stream buffer
+	// must be between BeginFrame() and EndFrame()
+	void Update(const glm::mat4& projection, int viewportWidth, int viewportHeight);
+
+	// free the program and the cluster buffer
+	void Destroy();
+
+private:
+	// the clustering compute program
+	GLuint m_program;
+
+	// buffer the per-frame cluster setup and the lights are written to
+	StreamBuffer* m_pStreamBuffer;
+	// buffer of the light count and light indices of every cluster
+	GLuint m_clusterBuffer;
+
+	// the CPU copy of the lights
+	std::vector<LOCAL_LIGHT> m_lights;
+	// lights left out past MAX_LOCAL_LIGHTS
+	int m_droppedLights;
+};
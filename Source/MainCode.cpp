@@ -9,6 +9,9 @@
 
 #include <iostream>         // error handling and output
 #include <cstdlib>          // EXIT_FAILURE
+#include <cstring>          // strcmp
+#include <cstdio>           // snprintf
+#include <algorithm>        // std::max
 
 #include <GL/glew.h>        // GLEW library
 #include "GLFW/glfw3.h"     // GLFW library
@@ -22,6 +25,14 @@
 #include "ViewManager.h"
 #include "ShapeMeshes.h"
 #include "ShaderManager.h"
+#include "ShaderVariants.h"
+#include "FrameUniforms.h"
+#include "StreamBuffer.h"
+#include "FrameProfiler.h"
+#include "BenchmarkRunner.h"
+#include "FrameArena.h"
+#include "HeapCounter.h"
+#include "BatchRenderer.h"
 
 // Namespace for declaring global variables
 namespace
@@ -36,14 +47,67 @@ namespace
 	SceneManager* g_SceneManager = nullptr;
 	// shader manager object for dynamic interaction with the shader code
 	ShaderManager* g_ShaderManager = nullptr;
+	// the scene shader program built for each combination of its features
+	ShaderVariants* g_ShaderVariants = nullptr;
+	// camera and light uniform block shared by all shader programs
+	FrameUniforms* g_FrameUniforms = nullptr;
+	// ring buffer every per-frame upload is written through
+	StreamBuffer* g_StreamBuffer = nullptr;
+	// scratch memory of the current frame, released at every swap
+	FrameArena* g_FrameArena = nullptr;
 	// view manager object for managing the 3D view setup and projection to 2D
 	ViewManager* g_ViewManager = nullptr;
+	// profiler object for timing the stages of the render loop
+	FrameProfiler* g_FrameProfiler = nullptr;
+
+	// profiler options from the command line - the overlay is
+	// toggled at runtime with F1
+	const char* g_ProfileTracePath = nullptr;
+	bool g_bShowProfiler = false;
+	bool g_bProfilerKeyDown = false;
+
+	// benchmark options from the command line - no benchmark
+	// runs while the frame count is zero
+	int g_BenchmarkFrames = 0;
+	bool g_bHiddenWindow = false;
+	// true fails the benchmark when a measured frame allocates
+	bool g_bRequireNoAllocations = false;
+	// benchmark object driving the scripted camera path
+	BenchmarkRunner* g_BenchmarkRunner = nullptr;
+
+	// batch render options from the command line - the window is
+	// not drawn to while a pose file is given
+	const char* g_BatchPosePath = NULL;
+	const char* g_BatchOutputPrefix = "render";
+	int g_BatchWidth = 1920;
+	int g_BatchHeight = 1080;
+	int g_BatchEncoders = 0;
+	// batch object rendering the camera poses into image files
+	BatchRenderer* g_BatchRenderer = nullptr;
+
+	// memory budget of the streamed texture levels in megabytes,
+	// zero lets every texture stream in its full resolution
+	int g_TextureBudgetMB = 64;
+
+	// fraction past a level boundary before a curved shape changes detail
+	float g_LodHysteresis = 0.15f;
+
+	// false draws the scene without the depth pre-pass
+	bool g_bDepthPrepass = true;
+
+	// scene file from the command line, the default scene when NULL
+	const char* g_ScenePath = NULL;
+
+	// threads of the scene job system, zero for one per CPU core
+	int g_JobThreads = 0;
 }
 
 // Function declarations - all functions that are called manually
 // need to be pre-declared at the beginning of the source code.
 bool InitializeGLFW();
 bool InitializeGLEW();
+void ParseCommandLine(int argc, char* argv[]);
+void UpdateProfilerDisplay();
 
 
 /***********************************************************
@@ -54,6 +118,16 @@ bool InitializeGLEW();
  ***********************************************************/
 int main(int argc, char* argv[])
 {
+	// read the options passed on the command line
+	ParseCommandLine(argc, argv);
+
+	// the batch render owns the camera, so it runs without the benchmark
+	if ((g_BatchPosePath != NULL) && (g_BenchmarkFrames > 0))
+	{
+		std::cout << "Ignoring --benchmark in the batch render mode" << std::endl;
+		g_BenchmarkFrames = 0;
+	}
+
 	// if GLFW fails initialization, then terminate the application
 	if (InitializeGLFW() == false)
 	{
@@ -62,12 +136,33 @@ int main(int argc, char* argv[])
 
 	// try to create a new shader manager object
 	g_ShaderManager = new ShaderManager();
+	// create the shader variants, built once the context exists
+	g_ShaderVariants = new ShaderVariants();
+	// create the stream buffer, its storage is created with the context
+	g_StreamBuffer = new StreamBuffer();
+	// create the per-frame uniform block, written to the stream buffer
+	g_FrameUniforms = new FrameUniforms();
+	// create the frame scratch memory
+	g_FrameArena = new FrameArena();
+	g_FrameArena->Create();
 	// try to create a new view manager object
 	g_ViewManager = new ViewManager(
-		g_ShaderManager);
+		g_ShaderManager,
+		g_FrameUniforms);
+
+	// a hidden window still has a working default framebuffer, and
+	// the batch render only needs the window for its context
+	if (g_bHiddenWindow || (g_BatchPosePath != NULL))
+	{
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	}
 
 	// try to create the main display window
 	g_Window = g_ViewManager->CreateDisplayWindow(WINDOW_TITLE);
+	if (g_Window == NULL)
+	{
+		return(EXIT_FAILURE);
+	}
 
 	// if GLEW fails initialization, then terminate the application
 	if (InitializeGLEW() == false)
@@ -75,20 +170,80 @@ int main(int argc, char* argv[])
 		return(EXIT_FAILURE);
 	}
 
-	// load the shader code from the external GLSL files
-	g_ShaderManager->LoadShaders(
+	// the stream buffer the frame block of every variant is bound from
+	g_StreamBuffer->Create();
+	g_FrameUniforms->Create(g_StreamBuffer);
+
+	// load the shader code from the external GLSL files, or the saved
+	// binaries of the programs when the files are unchanged - the scene
+	// builds the other variants when it first draws with them, so only
+	// the full featured one has to be checked here
+	g_ShaderVariants->Create(
 		"shaders/vertexShader.glsl",
 		"shaders/fragmentShader.glsl");
-	g_ShaderManager->use();
+	if (!g_ShaderVariants->Build(ShaderVariants::VARIANT_TEXTURE | ShaderVariants::VARIANT_LIGHTING))
+	{
+		return(EXIT_FAILURE);
+	}
 
 	// try to create a new scene manager object and prepare the 3D scene
-	g_SceneManager = new SceneManager(g_ShaderManager);
+	g_SceneManager = new SceneManager(g_ShaderManager, g_ShaderVariants, g_FrameUniforms, g_StreamBuffer, g_FrameArena);
+	g_SceneManager->SetTextureBudget((size_t)g_TextureBudgetMB * 1024 * 1024);
+	g_SceneManager->SetLodHysteresis(g_LodHysteresis);
+	g_SceneManager->SetDepthPrepass(g_bDepthPrepass);
+	g_SceneManager->SetJobThreads(g_JobThreads);
+	if (g_ScenePath != NULL)
+	{
+		g_SceneManager->SetScenePath(g_ScenePath);
+	}
 	g_SceneManager->PrepareScene();
 
+	// create the profiler once the context exists
+	g_FrameProfiler = new FrameProfiler();
+	g_FrameProfiler->Create();
+	if (NULL != g_ProfileTracePath)
+	{
+		g_FrameProfiler->OpenTrace(g_ProfileTracePath);
+	}
+
+	// the benchmark owns the camera and renders without vsync
+	if (g_BenchmarkFrames > 0)
+	{
+		g_BenchmarkRunner = new BenchmarkRunner(g_BenchmarkFrames, g_bRequireNoAllocations);
+		g_ViewManager->SetInputEnabled(false);
+		glfwSwapInterval(0);
+	}
+
+	// the batch render draws every pose into an image as fast as the
+	// image files are written
+	if (g_BatchPosePath != NULL)
+	{
+		g_BatchRenderer = new BatchRenderer();
+		if (!g_BatchRenderer->LoadPoses(g_BatchPosePath) ||
+			!g_BatchRenderer->Create(g_BatchWidth, g_BatchHeight, g_BatchOutputPrefix, g_BatchEncoders))
+		{
+			return(EXIT_FAILURE);
+		}
+		g_ViewManager->SetInputEnabled(false);
+		g_ViewManager->SetViewSize(g_BatchWidth, g_BatchHeight);
+		glfwSwapInterval(0);
+	}
+
+	// the frame loop runs on this thread, so its allocations count
+	HeapCounter::SetThreadTracked(true);
+
 	// loop will keep running until the application is closed 
 	// or until an error has occurred
 	while (!glfwWindowShouldClose(g_Window))
 	{
+		g_FrameProfiler->BeginFrame();
+
+		// the batch render draws into its own framebuffer
+		if (NULL != g_BatchRenderer)
+		{
+			g_BatchRenderer->BeginFrame();
+		}
+
 		// Enable z-depth
 		glEnable(GL_DEPTH_TEST);
 
@@ -96,21 +251,121 @@ int main(int argc, char* argv[])
 		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+		// move the camera along the benchmark path
+		if (NULL != g_BenchmarkRunner)
+		{
+			glm::vec3 cameraPosition;
+			glm::vec3 cameraTarget;
+
+			g_BenchmarkRunner->GetCameraPose(cameraPosition, cameraTarget);
+			g_ViewManager->SetCameraView(cameraPosition, cameraTarget);
+		}
+		else if (NULL != g_BatchRenderer)
+		{
+			glm::vec3 cameraPosition;
+			glm::vec3 cameraTarget;
+
+			g_BatchRenderer->GetCameraPose(cameraPosition, cameraTarget);
+			g_ViewManager->SetCameraView(cameraPosition, cameraTarget);
+		}
+
 		// convert from 3D object space to 2D view
+		g_FrameProfiler->BeginStage(FrameProfiler::STAGE_PREPARE_VIEW);
 		g_ViewManager->PrepareSceneView();
+		g_FrameProfiler->EndStage(FrameProfiler::STAGE_PREPARE_VIEW);
 
 		// refresh the 3D scene
+		g_FrameProfiler->BeginStage(FrameProfiler::STAGE_RENDER_SCENE);
+		g_FrameProfiler->BeginGpuPass(FrameProfiler::GPU_PASS_SCENE);
+
+		// wait for the stream buffer region of this frame, then write
+		// the camera and lights of this frame in one upload
+		g_StreamBuffer->BeginFrame();
+		g_FrameUniforms->Upload();
+
 		g_SceneManager->RenderScene();
 
+		// the stream buffer region stays in use until these draws finish
+		g_StreamBuffer->EndFrame();
+
+		g_FrameProfiler->EndGpuPass(FrameProfiler::GPU_PASS_SCENE);
+		g_FrameProfiler->EndStage(FrameProfiler::STAGE_RENDER_SCENE);
+
+		// read the frame back once the textures and their streamed
+		// levels are in, the images are written while the next frames
+		// are drawn
+		if (NULL != g_BatchRenderer)
+		{
+			g_BatchRenderer->EndFrame(!g_SceneManager->IsLoadingTextures() && !g_SceneManager->IsStreamingTextures());
+		}
+		else
+		{
+			// show the profiler results on top of the scene
+			UpdateProfilerDisplay();
+		}
 
-		// Flips the the back buffer with the front buffer every frame.
-		glfwSwapBuffers(g_Window);
+		// Flips the the back buffer with the front buffer every frame,
+		// except in the batch render, which never draws to the window
+		g_FrameProfiler->BeginStage(FrameProfiler::STAGE_SWAP_BUFFERS);
+		if (NULL == g_BatchRenderer)
+		{
+			glfwSwapBuffers(g_Window);
+		}
+		g_FrameArena->Reset();
+		g_FrameProfiler->EndStage(FrameProfiler::STAGE_SWAP_BUFFERS);
 
 		// query the latest GLFW events
+		g_FrameProfiler->BeginStage(FrameProfiler::STAGE_POLL_EVENTS);
 		glfwPollEvents();
+		g_FrameProfiler->EndStage(FrameProfiler::STAGE_POLL_EVENTS);
+
+		g_FrameProfiler->EndFrame();
+
+		// stop once the benchmark has rendered all of its frames
+		if (NULL != g_BenchmarkRunner)
+		{
+			g_BenchmarkRunner->EndFrame(g_FrameProfiler->GetLastFrame(), !g_SceneManager->IsLoadingTextures());
+			if (g_BenchmarkRunner->IsFinished())
+			{
+				glfwSetWindowShouldClose(g_Window, true);
+			}
+		}
+
+		// stop once every pose was read back
+		if ((NULL != g_BatchRenderer) && g_BatchRenderer->IsFinished())
+		{
+			glfwSetWindowShouldClose(g_Window, true);
+		}
+	}
+
+	HeapCounter::SetThreadTracked(false);
+
+	// report the benchmark results
+	bool bPassed = true;
+	if (NULL != g_BenchmarkRunner)
+	{
+		g_BenchmarkRunner->PrintReport();
+		bPassed = g_BenchmarkRunner->HasPassed();
+		delete g_BenchmarkRunner;
+		g_BenchmarkRunner = NULL;
+	}
+
+	// wait for the last images and report the batch render
+	if (NULL != g_BatchRenderer)
+	{
+		g_BatchRenderer->Destroy();
+		g_BatchRenderer->PrintReport();
+		bPassed = g_BatchRenderer->HasPassed();
+		delete g_BatchRenderer;
+		g_BatchRenderer = NULL;
 	}
 
 	// clear the allocated manager objects from memory
+	if (NULL != g_FrameProfiler)
+	{
+		delete g_FrameProfiler;
+		g_FrameProfiler = NULL;
+	}
 	if (NULL != g_SceneManager)
 	{
 		delete g_SceneManager;
@@ -121,14 +376,35 @@ int main(int argc, char* argv[])
 		delete g_ViewManager;
 		g_ViewManager = NULL;
 	}
+	if (NULL != g_FrameUniforms)
+	{
+		delete g_FrameUniforms;
+		g_FrameUniforms = NULL;
+	}
+	if (NULL != g_StreamBuffer)
+	{
+		delete g_StreamBuffer;
+		g_StreamBuffer = NULL;
+	}
+	if (NULL != g_FrameArena)
+	{
+		delete g_FrameArena;
+		g_FrameArena = NULL;
+	}
+	if (NULL != g_ShaderVariants)
+	{
+		delete g_ShaderVariants;
+		g_ShaderVariants = NULL;
+	}
 	if (NULL != g_ShaderManager)
 	{
 		delete g_ShaderManager;
 		g_ShaderManager = NULL;
 	}
 
-	// Terminates the program successfully
-	exit(EXIT_SUCCESS); 
+	// Terminates the program, a failed benchmark or batch render is
+	// reported through the exit code
+	exit(bPassed ? EXIT_SUCCESS : EXIT_FAILURE);
 }
 
 /***********************************************************
@@ -183,4 +459,140 @@ bool InitializeGLEW()
 	std::cout << "INFO: OpenGL Version: " << glGetString(GL_VERSION) << "\n" << std::endl;
 
 	return(true);
-}
\ No newline at end of file
+}
+
+/***********************************************************
+ *	ParseCommandLine()
+ *
+ *  This function is used to read the options passed on the
+ *  command line.
+ *
+ *    --profile              show the profiler overlay at start
+ *    --profile-csv <file>   write one CSV row per frame
+ *    --benchmark <frames>   render a scripted camera path and
+ *                           print the frame time statistics
+ *    --require-no-alloc     fail the benchmark when the steady
+ *                           state frame loop allocates
+ *    --hidden               do not show the window
+ *    --texture-budget <MB>  memory for the streamed texture
+ *                           levels, 0 for no limit
+ *    --lod-hysteresis <f>   fraction past a level boundary
+ *                           before a mesh changes detail,
+ *                           0 to switch right at it
+ *    --no-depth-prepass     shade without laying down the
+ *                           depth first
+ *    --scene <file>         the scene file to draw
+ *    --jobs <threads>       threads the per-frame object loops
+ *                           run on, 0 for one per CPU core
+ *    --batch <file>         render every camera pose of the
+ *                           pose file into a PNG image
+ *    --batch-size <w> <h>   size of the batch images in pixels
+ *    --batch-output <name>  the images are named <name>_NNNN.png
+ *    --batch-encoders <n>   threads writing the images, 0 for
+ *                           one per spare CPU core
+ ***********************************************************/
+void ParseCommandLine(int argc, char* argv[])
+{
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--profile") == 0)
+		{
+			g_bShowProfiler = true;
+		}
+		else if ((strcmp(argv[i], "--profile-csv") == 0) && (i + 1 < argc))
+		{
+			g_ProfileTracePath = argv[++i];
+		}
+		else if ((strcmp(argv[i], "--benchmark") == 0) && (i + 1 < argc))
+		{
+			g_BenchmarkFrames = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--require-no-alloc") == 0)
+		{
+			g_bRequireNoAllocations = true;
+		}
+		else if (strcmp(argv[i], "--hidden") == 0)
+		{
+			g_bHiddenWindow = true;
+		}
+		else if ((strcmp(argv[i], "--texture-budget") == 0) && (i + 1 < argc))
+		{
+			g_TextureBudgetMB = std::max(atoi(argv[++i]), 0);
+		}
+		else if ((strcmp(argv[i], "--lod-hysteresis") == 0) && (i + 1 < argc))
+		{
+			g_LodHysteresis = std::max((float)atof(argv[++i]), 0.0f);
+		}
+		else if (strcmp(argv[i], "--no-depth-prepass") == 0)
+		{
+			g_bDepthPrepass = false;
+		}
+		else if ((strcmp(argv[i], "--scene") == 0) && (i + 1 < argc))
+		{
+			g_ScenePath = argv[++i];
+		}
+		else if ((strcmp(argv[i], "--jobs") == 0) && (i + 1 < argc))
+		{
+			g_JobThreads = std::max(atoi(argv[++i]), 0);
+		}
+		else if ((strcmp(argv[i], "--batch") == 0) && (i + 1 < argc))
+		{
+			g_BatchPosePath = argv[++i];
+		}
+		else if ((strcmp(argv[i], "--batch-size") == 0) && (i + 2 < argc))
+		{
+			g_BatchWidth = atoi(argv[++i]);
+			g_BatchHeight = atoi(argv[++i]);
+		}
+		else if ((strcmp(argv[i], "--batch-output") == 0) && (i + 1 < argc))
+		{
+			g_BatchOutputPrefix = argv[++i];
+		}
+		else if ((strcmp(argv[i], "--batch-encoders") == 0) && (i + 1 < argc))
+		{
+			g_BatchEncoders = std::max(atoi(argv[++i]), 0);
+		}
+		else
+		{
+			std::cout << "Ignoring unknown option " << argv[i] << std::endl;
+		}
+	}
+}
+
+/***********************************************************
+ *	UpdateProfilerDisplay()
+ *
+ *  This function is used to toggle the profiler overlay with
+ *  F1, and to draw it and show the summary in the window
+ *  title while it is visible.
+ ***********************************************************/
+void UpdateProfilerDisplay()
+{
+	bool bKeyDown = (glfwGetKey(g_Window, GLFW_KEY_F1) == GLFW_PRESS);
+
+	// toggle once per key press, not once per frame
+	if (bKeyDown && !g_bProfilerKeyDown)
+	{
+		g_bShowProfiler = !g_bShowProfiler;
+		if (!g_bShowProfiler)
+		{
+			glfwSetWindowTitle(g_Window, WINDOW_TITLE);
+		}
+	}
+	g_bProfilerKeyDown = bKeyDown;
+
+	if (!g_bShowProfiler)
+	{
+		return;
+	}
+
+	g_FrameProfiler->DrawOverlay();
+
+	char summary[160];
+	if (g_FrameProfiler->FormatSummary(summary, sizeof(summary)))
+	{
+		char title[256];
+		snprintf(title, sizeof(title), "%s | %s", WINDOW_TITLE, summary);
+		glfwSetWindowTitle(g_Window, title);
+	}
+}
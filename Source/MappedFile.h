@@ -0,0 +1,48 @@
+///////////////////////////////////////////////////////////////////////////////
+// mappedfile.h
+// ============
+// map a file read only into memory
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+
+/***********************************************************
+ *  MappedFile
+ *
+ *  This class contains the code for mapping the whole of a
+ *  file read only into the address space, so its contents
+ *  can be read in place without copying them into a buffer.
+ ***********************************************************/
+class MappedFile
+{
+public:
+	// constructor
+	MappedFile();
+	// destructor
+	~MappedFile();
+
+	// map the passed in file, returns false when it can not be opened
+	bool Open(const char* filename);
+	// unmap the file
+	void Close();
+
+	// the mapped contents and their size in bytes
+	const unsigned char* GetData() const { return(m_pData); }
+	size_t GetSize() const { return(m_size); }
+
+private:
+	// the mapped contents, NULL when nothing is mapped
+	const unsigned char* m_pData;
+	size_t m_size;
+#ifdef _WIN32
+	// handles of the file and of its mapping
+	void* m_hFile;
+	void* m_hMapping;
+#endif
+
+	// mapped files can not be copied
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+};
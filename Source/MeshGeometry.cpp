@@ -0,0 +1,598 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshgeometry.cpp
+// ============
+// generate the vertex and index data for the basic 3D shapes
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MeshGeometry.h"
+
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+// declaration of the global variables and defines
+namespace
+{
+	const float g_Pi = 3.14159265358979f;
+
+	// entries of the post transform vertex cache the triangle order
+	// is tuned for, small enough for every current GPU
+	const int g_VertexCacheSize = 32;
+
+	/***********************************************************
+	 *  ScoreVertex()
+	 *
+	 *  This function is used for rating how much drawing one
+	 *  more triangle with a vertex is worth, from where the
+	 *  vertex sits in the simulated cache and how many of its
+	 *  triangles are left.  The three newest entries score a
+	 *  little lower, so strips do not turn back on themselves,
+	 *  and vertices with few triangles left are finished off.
+	 ***********************************************************/
+	float ScoreVertex(int cachePosition, int remainingTriangles)
+	{
+		float score = 0.0f;
+
+		if (remainingTriangles == 0)
+		{
+			return(-1.0f);
+		}
+
+		if (cachePosition >= 0)
+		{
+			if (cachePosition < 3)
+			{
+				score = 0.75f;
+			}
+			else
+			{
+				score = std::pow(1.0f - (float)(cachePosition - 3) / (float)(g_VertexCacheSize - 3), 1.5f);
+			}
+		}
+
+		return(score + 2.0f / std::sqrt((float)remainingTriangles));
+	}
+}
+
+/***********************************************************
+ *  AddQuad()
+ *
+ *  This method is used for appending a four cornered face,
+ *  given in counter-clockwise order, as two triangles.
+ ***********************************************************/
+void MeshGeometry::AddQuad(
+	MESH_DATA& mesh,
+	glm::vec3 p0, glm::vec3 p1, glm::vec3 p2, glm::vec3 p3,
+	glm::vec3 normal)
+{
+	GLuint first = (GLuint)mesh.vertices.size();
+	VERTEX vertex;
+
+	vertex.normal = normal;
+
+	vertex.position = p0;
+	vertex.textureCoordinate = glm::vec2(0.0f, 0.0f);
+	mesh.vertices.push_back(vertex);
+	vertex.position = p1;
+	vertex.textureCoordinate = glm::vec2(1.0f, 0.0f);
+	mesh.vertices.push_back(vertex);
+	vertex.position = p2;
+	vertex.textureCoordinate = glm::vec2(1.0f, 1.0f);
+	mesh.vertices.push_back(vertex);
+	vertex.position = p3;
+	vertex.textureCoordinate = glm::vec2(0.0f, 1.0f);
+	mesh.vertices.push_back(vertex);
+
+	mesh.indices.push_back(first);
+	mesh.indices.push_back(first + 1);
+	mesh.indices.push_back(first + 2);
+	mesh.indices.push_back(first);
+	mesh.indices.push_back(first + 2);
+	mesh.indices.push_back(first + 3);
+}
+
+/***********************************************************
+ *  AddTriangle()
+ *
+ *  This method is used for appending a three cornered face,
+ *  given in counter-clockwise order.
+ ***********************************************************/
+void MeshGeometry::AddTriangle(
+	MESH_DATA& mesh,
+	glm::vec3 p0, glm::vec3 p1, glm::vec3 p2,
+	glm::vec3 normal)
+{
+	GLuint first = (GLuint)mesh.vertices.size();
+	VERTEX vertex;
+
+	vertex.normal = normal;
+
+	vertex.position = p0;
+	vertex.textureCoordinate = glm::vec2(0.0f, 0.0f);
+	mesh.vertices.push_back(vertex);
+	vertex.position = p1;
+	vertex.textureCoordinate = glm::vec2(1.0f, 0.0f);
+	mesh.vertices.push_back(vertex);
+	vertex.position = p2;
+	vertex.textureCoordinate = glm::vec2(0.5f, 1.0f);
+	mesh.vertices.push_back(vertex);
+
+	mesh.indices.push_back(first);
+	mesh.indices.push_back(first + 1);
+	mesh.indices.push_back(first + 2);
+}
+
+/***********************************************************
+ *  BuildBoxMesh()
+ *
+ *  This method is used for generating a 1x1x1 box centered
+ *  on the origin, with its own normals and texture
+ *  coordinates on each of the six faces.
+ ***********************************************************/
+void MeshGeometry::BuildBoxMesh(MESH_DATA& mesh)
+{
+	const float h = 0.5f;
+
+	mesh.vertices.clear();
+	mesh.indices.clear();
+
+	// front face
+	AddQuad(mesh,
+		glm::vec3(-h, -h, h), glm::vec3(h, -h, h), glm::vec3(h, h, h), glm::vec3(-h, h, h),
+		glm::vec3(0.0f, 0.0f, 1.0f));
+	// back face
+	AddQuad(mesh,
+		glm::vec3(h, -h, -h), glm::vec3(-h, -h, -h), glm::vec3(-h, h, -h), glm::vec3(h, h, -h),
+		glm::vec3(0.0f, 0.0f, -1.0f));
+	// left face
+	AddQuad(mesh,
+		glm::vec3(-h, -h, -h), glm::vec3(-h, -h, h), glm::vec3(-h, h, h), glm::vec3(-h, h, -h),
+		glm::vec3(-1.0f, 0.0f, 0.0f));
+	// right face
+	AddQuad(mesh,
+		glm::vec3(h, -h, h), glm::vec3(h, -h, -h), glm::vec3(h, h, -h), glm::vec3(h, h, h),
+		glm::vec3(1.0f, 0.0f, 0.0f));
+	// top face
+	AddQuad(mesh,
+		glm::vec3(-h, h, h), glm::vec3(h, h, h), glm::vec3(h, h, -h), glm::vec3(-h, h, -h),
+		glm::vec3(0.0f, 1.0f, 0.0f));
+	// bottom face
+	AddQuad(mesh,
+		glm::vec3(-h, -h, -h), glm::vec3(h, -h, -h), glm::vec3(h, -h, h), glm::vec3(-h, -h, h),
+		glm::vec3(0.0f, -1.0f, 0.0f));
+
+	OptimizeVertexCache(mesh);
+}
+
+/***********************************************************
+ *  BuildPlaneMesh()
+ *
+ *  This method is used for generating a 2x2 plane lying in
+ *  the XZ plane and facing up the Y axis.
+ ***********************************************************/
+void MeshGeometry::BuildPlaneMesh(MESH_DATA& mesh)
+{
+	mesh.vertices.clear();
+	mesh.indices.clear();
+
+	AddQuad(mesh,
+		glm::vec3(-1.0f, 0.0f, 1.0f), glm::vec3(1.0f, 0.0f, 1.0f),
+		glm::vec3(1.0f, 0.0f, -1.0f), glm::vec3(-1.0f, 0.0f, -1.0f),
+		glm::vec3(0.0f, 1.0f, 0.0f));
+
+	OptimizeVertexCache(mesh);
+}
+
+/***********************************************************
+ *  BuildPrismMesh()
+ *
+ *  This method is used for generating a 1x1x1 triangular
+ *  prism centered on the origin.  The triangle lies in the
+ *  XY plane with its point up and is extruded along Z.
+ ***********************************************************/
+void MeshGeometry::BuildPrismMesh(MESH_DATA& mesh)
+{
+	const float h = 0.5f;
+	// normals of the two slanted sides
+	const glm::vec3 leftNormal = glm::normalize(glm::vec3(-1.0f, 0.5f, 0.0f));
+	const glm::vec3 rightNormal = glm::normalize(glm::vec3(1.0f, 0.5f, 0.0f));
+
+	mesh.vertices.clear();
+	mesh.indices.clear();
+
+	// front triangle
+	AddTriangle(mesh,
+		glm::vec3(-h, -h, h), glm::vec3(h, -h, h), glm::vec3(0.0f, h, h),
+		glm::vec3(0.0f, 0.0f, 1.0f));
+	// back triangle
+	AddTriangle(mesh,
+		glm::vec3(h, -h, -h), glm::vec3(-h, -h, -h), glm::vec3(0.0f, h, -h),
+		glm::vec3(0.0f, 0.0f, -1.0f));
+	// left slanted side
+	AddQuad(mesh,
+		glm::vec3(-h, -h, -h), glm::vec3(-h, -h, h), glm::vec3(0.0f, h, h), glm::vec3(0.0f, h, -h),
+		leftNormal);
+	// right slanted side
+	AddQuad(mesh,
+		glm::vec3(h, -h, h), glm::vec3(h, -h, -h), glm::vec3(0.0f, h, -h), glm::vec3(0.0f, h, h),
+		rightNormal);
+	// bottom face
+	AddQuad(mesh,
+		glm::vec3(-h, -h, -h), glm::vec3(h, -h, -h), glm::vec3(h, -h, h), glm::vec3(-h, -h, h),
+		glm::vec3(0.0f, -1.0f, 0.0f));
+
+	OptimizeVertexCache(mesh);
+}
+
+/***********************************************************
+ *  BuildCylinderMesh()
+ *
+ *  This method is used for generating a capped cylinder of
+ *  radius 1 standing on the XZ plane and reaching up to y 1.
+ *  The side wraps the texture around once, and each cap maps
+ *  it onto the circle.
+ ***********************************************************/
+void MeshGeometry::BuildCylinderMesh(MESH_DATA& mesh, int segments)
+{
+	mesh.vertices.clear();
+	mesh.indices.clear();
+
+	// the side - one more column than segments for the texture seam
+	for (int i = 0; i <= segments; i++)
+	{
+		float u = (float)i / (float)segments;
+		float angle = u * 2.0f * g_Pi;
+		glm::vec3 normal(std::cos(angle), 0.0f, -std::sin(angle));
+		VERTEX vertex;
+
+		vertex.normal = normal;
+		vertex.position = normal;
+		vertex.textureCoordinate = glm::vec2(u, 0.0f);
+		mesh.vertices.push_back(vertex);
+		vertex.position = normal + glm::vec3(0.0f, 1.0f, 0.0f);
+		vertex.textureCoordinate = glm::vec2(u, 1.0f);
+		mesh.vertices.push_back(vertex);
+	}
+	for (int i = 0; i < segments; i++)
+	{
+		GLuint first = (GLuint)(i * 2);
+
+		mesh.indices.push_back(first);
+		mesh.indices.push_back(first + 2);
+		mesh.indices.push_back(first + 3);
+		mesh.indices.push_back(first);
+		mesh.indices.push_back(first + 3);
+		mesh.indices.push_back(first + 1);
+	}
+
+	// the caps as triangle fans around their centers
+	for (int cap = 0; cap < 2; cap++)
+	{
+		float y = (float)cap;
+		GLuint center = (GLuint)mesh.vertices.size();
+		VERTEX vertex;
+
+		vertex.normal = glm::vec3(0.0f, (cap == 0) ? -1.0f : 1.0f, 0.0f);
+		vertex.position = glm::vec3(0.0f, y, 0.0f);
+		vertex.textureCoordinate = glm::vec2(0.5f, 0.5f);
+		mesh.vertices.push_back(vertex);
+
+		for (int i = 0; i < segments; i++)
+		{
+			float angle = (float)i / (float)segments * 2.0f * g_Pi;
+			float x = std::cos(angle);
+			float z = -std::sin(angle);
+
+			vertex.position = glm::vec3(x, y, z);
+			vertex.textureCoordinate = glm::vec2(0.5f + 0.5f * x, 0.5f - 0.5f * z);
+			mesh.vertices.push_back(vertex);
+		}
+		for (int i = 0; i < segments; i++)
+		{
+			GLuint current = center + 1 + (GLuint)i;
+			GLuint next = center + 1 + (GLuint)((i + 1) % segments);
+
+			// counter-clockwise seen from outside of the cap
+			mesh.indices.push_back(center);
+			mesh.indices.push_back((cap == 0) ? next : current);
+			mesh.indices.push_back((cap == 0) ? current : next);
+		}
+	}
+
+	OptimizeVertexCache(mesh);
+}
+
+/***********************************************************
+ *  BuildSphereMesh()
+ *
+ *  This method is used for generating a sphere of radius 1
+ *  centered on the origin, as rings of latitude from the
+ *  bottom pole to the top pole.  The texture wraps around
+ *  the sphere once.
+ ***********************************************************/
+void MeshGeometry::BuildSphereMesh(MESH_DATA& mesh, int segments)
+{
+	int rings = (segments / 2 > 2) ? segments / 2 : 2;
+
+	mesh.vertices.clear();
+	mesh.indices.clear();
+
+	for (int ring = 0; ring <= rings; ring++)
+	{
+		float v = (float)ring / (float)rings;
+		float latitude = (v - 0.5f) * g_Pi;
+
+		for (int i = 0; i <= segments; i++)
+		{
+			float u = (float)i / (float)segments;
+			float longitude = u * 2.0f * g_Pi;
+			VERTEX vertex;
+
+			vertex.normal = glm::vec3(
+				std::cos(latitude) * std::cos(longitude),
+				std::sin(latitude),
+				-std::cos(latitude) * std::sin(longitude));
+			vertex.position = vertex.normal;
+			vertex.textureCoordinate = glm::vec2(u, v);
+			mesh.vertices.push_back(vertex);
+		}
+	}
+
+	for (int ring = 0; ring < rings; ring++)
+	{
+		for (int i = 0; i < segments; i++)
+		{
+			GLuint first = (GLuint)(ring * (segments + 1) + i);
+			GLuint above = first + (GLuint)(segments + 1);
+
+			// the rings at the poles collapse into a single point,
+			// so only one of their two triangles has an area
+			if (ring > 0)
+			{
+				mesh.indices.push_back(first);
+				mesh.indices.push_back(first + 1);
+				mesh.indices.push_back(above + 1);
+			}
+			if (ring < rings - 1)
+			{
+				mesh.indices.push_back(first);
+				mesh.indices.push_back(above + 1);
+				mesh.indices.push_back(above);
+			}
+		}
+	}
+
+	OptimizeVertexCache(mesh);
+}
+
+/***********************************************************
+ *  BuildTorusMesh()
+ *
+ *  This method is used for generating a torus around the y
+ *  axis, as rings of the tube swept around the main ring.
+ *  The texture wraps once around the ring and once around
+ *  the tube.
+ ***********************************************************/
+void MeshGeometry::BuildTorusMesh(MESH_DATA& mesh, int segments)
+{
+	const float ringRadius = 1.0f;
+	const float tubeRadius = 0.25f;
+	int tubeSegments = (segments / 2 > 3) ? segments / 2 : 3;
+
+	mesh.vertices.clear();
+	mesh.indices.clear();
+
+	for (int ring = 0; ring <= tubeSegments; ring++)
+	{
+		float v = (float)ring / (float)tubeSegments;
+		float tubeAngle = (v * 2.0f - 1.0f) * g_Pi;
+
+		for (int i = 0; i <= segments; i++)
+		{
+			float u = (float)i / (float)segments;
+			float ringAngle = u * 2.0f * g_Pi;
+			glm::vec3 outward = glm::vec3(std::cos(ringAngle), 0.0f, -std::sin(ringAngle));
+			VERTEX vertex;
+
+			vertex.normal = outward * std::cos(tubeAngle) + glm::vec3(0.0f, std::sin(tubeAngle), 0.0f);
+			vertex.position = outward * ringRadius + vertex.normal * tubeRadius;
+			vertex.textureCoordinate = glm::vec2(u, v);
+			mesh.vertices.push_back(vertex);
+		}
+	}
+
+	for (int ring = 0; ring < tubeSegments; ring++)
+	{
+		for (int i = 0; i < segments; i++)
+		{
+			GLuint first = (GLuint)(ring * (segments + 1) + i);
+			GLuint above = first + (GLuint)(segments + 1);
+
+			mesh.indices.push_back(first);
+			mesh.indices.push_back(first + 1);
+			mesh.indices.push_back(above + 1);
+			mesh.indices.push_back(first);
+			mesh.indices.push_back(above + 1);
+			mesh.indices.push_back(above);
+		}
+	}
+
+	OptimizeVertexCache(mesh);
+}
+
+/***********************************************************
+ *  OptimizeVertexCache()
+ *
+ *  This method is used for reordering the triangles of a
+ *  mesh so that they reuse the vertices still in the post
+ *  transform cache, with the greedy vertex scoring of
+ *  linear-speed cache optimization.  Afterwards the vertices
+ *  are renumbered in the order the triangles first use them
+ *  so the vertex fetch also walks the buffer forward.
+ ***********************************************************/
+void MeshGeometry::OptimizeVertexCache(MESH_DATA& mesh)
+{
+	int triangleCount = (int)(mesh.indices.size() / 3);
+	int vertexCount = (int)mesh.vertices.size();
+
+	if (triangleCount < 2)
+	{
+		return;
+	}
+
+	// the triangles of every vertex, as one list per vertex
+	std::vector<int> remaining(vertexCount, 0);
+	std::vector<int> firstTriangle(vertexCount + 1, 0);
+	std::vector<int> vertexTriangles(mesh.indices.size());
+	for (int i = 0; i < mesh.indices.size(); i++)
+	{
+		remaining[mesh.indices[i]]++;
+	}
+	for (int v = 0; v < vertexCount; v++)
+	{
+		firstTriangle[v + 1] = firstTriangle[v] + remaining[v];
+	}
+	std::vector<int> fill(firstTriangle.begin(), firstTriangle.end() - 1);
+	for (int i = 0; i < mesh.indices.size(); i++)
+	{
+		vertexTriangles[fill[mesh.indices[i]]++] = i / 3;
+	}
+
+	std::vector<float> vertexScore(vertexCount);
+	std::vector<float> triangleScore(triangleCount, 0.0f);
+	std::vector<bool> bEmitted(triangleCount, false);
+	for (int v = 0; v < vertexCount; v++)
+	{
+		vertexScore[v] = ScoreVertex(-1, remaining[v]);
+	}
+	for (int i = 0; i < mesh.indices.size(); i++)
+	{
+		triangleScore[i / 3] += vertexScore[mesh.indices[i]];
+	}
+
+	std::vector<GLuint> indices;
+	std::vector<int> cache;
+	int scanStart = 0;
+	indices.reserve(mesh.indices.size());
+
+	while (indices.size() < mesh.indices.size())
+	{
+		// the best triangle touching the cache, or the first one
+		// left when the cache holds nothing useful
+		int best = -1;
+		float bestScore = -1.0f;
+		for (int c = 0; c < cache.size(); c++)
+		{
+			int v = cache[c];
+			for (int t = firstTriangle[v]; t < firstTriangle[v + 1]; t++)
+			{
+				int triangle = vertexTriangles[t];
+				if (!bEmitted[triangle] && (triangleScore[triangle] > bestScore))
+				{
+					best = triangle;
+					bestScore = triangleScore[triangle];
+				}
+			}
+		}
+		if (best < 0)
+		{
+			while (bEmitted[scanStart])
+			{
+				scanStart++;
+			}
+			best = scanStart;
+		}
+
+		bEmitted[best] = true;
+		std::vector<int> newCache;
+		for (int corner = 0; corner < 3; corner++)
+		{
+			GLuint v = mesh.indices[best * 3 + corner];
+			indices.push_back(v);
+			remaining[v]--;
+			newCache.push_back((int)v);
+		}
+		for (int c = 0; c < cache.size(); c++)
+		{
+			if (std::find(newCache.begin(), newCache.end(), cache[c]) == newCache.end())
+			{
+				newCache.push_back(cache[c]);
+			}
+		}
+
+		// rescore the vertices that moved, including the ones pushed
+		// out, and the triangles they still belong to
+		for (int c = 0; c < newCache.size(); c++)
+		{
+			int v = newCache[c];
+			int position = (c < g_VertexCacheSize) ? c : -1;
+			float score = ScoreVertex(position, remaining[v]);
+
+			for (int t = firstTriangle[v]; t < firstTriangle[v + 1]; t++)
+			{
+				triangleScore[vertexTriangles[t]] += score - vertexScore[v];
+			}
+			vertexScore[v] = score;
+		}
+		if (newCache.size() > g_VertexCacheSize)
+		{
+			newCache.resize(g_VertexCacheSize);
+		}
+		cache.swap(newCache);
+	}
+
+	// renumber the vertices in the order they are first used
+	std::vector<int> remap(vertexCount, -1);
+	std::vector<VERTEX> vertices;
+	vertices.reserve(vertexCount);
+	for (int i = 0; i < indices.size(); i++)
+	{
+		if (remap[indices[i]] < 0)
+		{
+			remap[indices[i]] = (int)vertices.size();
+			vertices.push_back(mesh.vertices[indices[i]]);
+		}
+		indices[i] = (GLuint)remap[indices[i]];
+	}
+
+	mesh.vertices.swap(vertices);
+	mesh.indices.swap(indices);
+}
+
+/***********************************************************
+ *  PackNormal()
+ *
+ *  This method is used for packing a normal into the signed
+ *  normalized 10:10:10:2 layout with x in the lowest bits.
+ ***********************************************************/
+GLuint MeshGeometry::PackNormal(const glm::vec3& normal)
+{
+	return((GLuint)glm::packSnorm3x10_1x2(glm::vec4(normal, 0.0f)));
+}
+
+/***********************************************************
+ *  PackVertices()
+ *
+ *  This method is used for converting the vertices of a mesh
+ *  to the compact format.  The shapes are unit sized, so
+ *  half floats keep their positions to within a thousandth
+ *  of a unit before the model matrix scales them.
+ ***********************************************************/
+void MeshGeometry::PackVertices(const MESH_DATA& mesh, std::vector<PACKED_VERTEX>& packed)
+{
+	packed.resize(mesh.vertices.size());
+
+	for (int i = 0; i < mesh.vertices.size(); i++)
+	{
+		const VERTEX& vertex = mesh.vertices[i];
+		PACKED_VERTEX& target = packed[i];
+
+		target.position[0] = glm::packHalf1x16(vertex.position.x);
+		target.position[1] = glm::packHalf1x16(vertex.position.y);
+		target.position[2] = glm::packHalf1x16(vertex.position.z);
+		target.position[3] = glm::packHalf1x16(1.0f);
+		target.normal = PackNormal(vertex.normal);
+		target.textureCoordinate = glm::packHalf2x16(vertex.textureCoordinate);
+	}
+}
@@ -0,0 +1,88 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshgeometry.h
+// ============
+// generate the vertex and index data for the basic 3D shapes
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  MeshGeometry
+ *
+ *  This class contains the code for generating the vertex
+ *  and index data of the unit sized basic 3D shapes.  The
+ *  shapes have the same extents as the ones in ShapeMeshes
+ *  so both can be transformed with the same model matrices.
+ ***********************************************************/
+class MeshGeometry
+{
+public:
+	// one vertex of a mesh - matches the vertex shader inputs
+	struct VERTEX
+	{
+		glm::vec3 position;
+		glm::vec3 normal;
+		glm::vec2 textureCoordinate;
+	};
+
+	// one vertex in half the size of VERTEX - half float position and
+	// texture coordinate and a 10:10:10:2 normal, read by
+	// glVertexAttribPointer as GL_HALF_FLOAT and GL_INT_2_10_10_10_REV
+	struct PACKED_VERTEX
+	{
+		GLushort position[4];
+		GLuint normal;
+		GLuint textureCoordinate;
+	};
+
+	// the vertex and index data of one mesh
+	struct MESH_DATA
+	{
+		std::vector<VERTEX> vertices;
+		std::vector<GLuint> indices;
+	};
+
+	// 1x1x1 box centered on the origin
+	static void BuildBoxMesh(MESH_DATA& mesh);
+	// 2x2 plane in the XZ plane facing up
+	static void BuildPlaneMesh(MESH_DATA& mesh);
+	// 1x1x1 triangular prism centered on the origin
+	static void BuildPrismMesh(MESH_DATA& mesh);
+	// capped cylinder of radius 1 standing from y 0 to y 1, with
+	// the passed in number of segments around its axis
+	static void BuildCylinderMesh(MESH_DATA& mesh, int segments);
+	// sphere of radius 1 centered on the origin, with the passed in
+	// number of segments around its axis and half as many rings
+	static void BuildSphereMesh(MESH_DATA& mesh, int segments);
+	// torus lying in the xz plane with a ring radius of 1 and a tube
+	// radius of 0.25, with the passed in number of segments around
+	// the ring and half as many around the tube
+	static void BuildTorusMesh(MESH_DATA& mesh, int segments);
+
+	// reorder the triangles for the post transform vertex cache and the
+	// vertices for the order they are fetched in - every Build method
+	// already does this for the mesh it builds
+	static void OptimizeVertexCache(MESH_DATA& mesh);
+
+	// pack the vertices of a unit sized mesh into the compact format
+	static void PackVertices(const MESH_DATA& mesh, std::vector<PACKED_VERTEX>& packed);
+	// pack a unit length normal into signed normalized 10:10:10:2 bits
+	static GLuint PackNormal(const glm::vec3& normal);
+
+private:
+	// append a four cornered face as two triangles
+	static void AddQuad(
+		MESH_DATA& mesh,
+		glm::vec3 p0, glm::vec3 p1, glm::vec3 p2, glm::vec3 p3,
+		glm::vec3 normal);
+	// append a three cornered face
+	static void AddTriangle(
+		MESH_DATA& mesh,
+		glm::vec3 p0, glm::vec3 p1, glm::vec3 p2,
+		glm::vec3 normal);
+};
@@ -0,0 +1,53 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshlod.h
+// ============
+// detail levels of the curved shapes and their selection by screen size
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+// the static geometry, the GPU culler and the instanced batches draw
+// the curved shapes at these levels.  The per-object path draws the
+// meshes of ShapeMeshes, which only exist at their one tessellation,
+// so it always shows the shapes at full detail.  The office scene has
+// only flat shapes, so it looks and costs the same on every path.
+
+// number of detail levels of every mesh - must match MESH_LOD_COUNT
+// in the culling compute shader
+const int MESH_LOD_COUNT = 3;
+
+// segments around the axis of the curved shapes at each level
+const int MESH_LOD_SEGMENTS[MESH_LOD_COUNT] = { 48, 16, 8 };
+
+// smallest projected diameter in pixels that still uses each of the
+// finer levels, the coarsest level covers everything below
+const float MESH_LOD_PIXEL_SIZES[MESH_LOD_COUNT - 1] = { 240.0f, 80.0f };
+
+// fraction the projected size has to move past a level boundary
+// before the level changes, so objects right at it do not pop
+const float MESH_LOD_HYSTERESIS = 0.15f;
+
+/***********************************************************
+ *  SelectMeshLod()
+ *
+ *  This function is used for picking the detail level of an
+ *  object from its projected diameter in pixels.  Starting at
+ *  the level of the previous frame, it only moves to a finer
+ *  level once the size is clearly above the boundary, and to
+ *  a coarser level once it is clearly below.
+ ***********************************************************/
+inline int SelectMeshLod(int currentLod, float pixels, float hysteresis)
+{
+	int lod = currentLod;
+
+	while ((lod > 0) && (pixels > MESH_LOD_PIXEL_SIZES[lod - 1] * (1.0f + hysteresis)))
+	{
+		lod--;
+	}
+	while ((lod < MESH_LOD_COUNT - 1) && (pixels < MESH_LOD_PIXEL_SIZES[lod] * (1.0f - hysteresis)))
+	{
+		lod++;
+	}
+
+	return(lod);
+}
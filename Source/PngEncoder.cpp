@@ -0,0 +1,553 @@
+///////////////////////////////////////////////////////////////////////////////
+// pngencoder.cpp
+// ============
+// compress rendered images into PNG files
+///////////////////////////////////////////////////////////////////////////////
+
+#include "PngEncoder.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+// declaration of the global variables and defines
+namespace
+{
+	// the eight bytes every PNG file starts with
+	const unsigned char g_PngSignature[8] = { 0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A };
+
+	// bytes of an RGB pixel
+	const int g_PixelBytes = 3;
+
+	// the deflate window, and the repeats it can reference
+	const int g_WindowSize = 32768;
+	const int g_MinMatch = 3;
+	const int g_MaxMatch = 258;
+	// the bits of the hash over the next three bytes
+	const int g_HashBits = 15;
+	// earlier positions with the same hash that are compared before
+	// the longest repeat so far is taken
+	const int g_MaxChain = 32;
+
+	// the first length and the extra bits of the length codes
+	const unsigned short g_LengthBase[29] =
+	{
+		3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+		35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+	};
+	const unsigned char g_LengthExtra[29] =
+	{
+		0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+		3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+	};
+
+	// the first distance and the extra bits of the distance codes
+	const unsigned short g_DistanceBase[30] =
+	{
+		1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+		257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+		8193, 12289, 16385, 24577
+	};
+	const unsigned char g_DistanceExtra[30] =
+	{
+		0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+		7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+	};
+
+	// writes the bits of a deflate stream, the first bit in the
+	// lowest bit of each byte
+	struct BIT_WRITER
+	{
+		std::vector<unsigned char>* pOut;
+		uint32_t bits;
+		int count;
+
+		// write the lowest bits of a value, the lowest bit first
+		void Write(uint32_t value, int bitCount)
+		{
+			bits |= value << count;
+			count += bitCount;
+			while (count >= 8)
+			{
+				pOut->push_back((unsigned char)(bits & 0xFF));
+				bits >>= 8;
+				count -= 8;
+			}
+		}
+
+		// write a Huffman code, which goes out from its highest bit
+		void WriteCode(uint32_t code, int bitCount)
+		{
+			uint32_t reversed = 0;
+
+			for (int i = 0; i < bitCount; i++)
+			{
+				reversed = (reversed << 1) | ((code >> i) & 1);
+			}
+			Write(reversed, bitCount);
+		}
+
+		// write the bits left in the last byte
+		void Flush()
+		{
+			if (count > 0)
+			{
+				pOut->push_back((unsigned char)(bits & 0xFF));
+			}
+			bits = 0;
+			count = 0;
+		}
+	};
+
+	/***********************************************************
+	 *  WriteSymbol()
+	 *
+	 *  This function is used for writing a literal byte, the end
+	 *  of the block or a length code with the fixed Huffman codes.
+	 ***********************************************************/
+	void WriteSymbol(BIT_WRITER& writer, int symbol)
+	{
+		if (symbol < 144)
+		{
+			writer.WriteCode(0x30 + symbol, 8);
+		}
+		else if (symbol < 256)
+		{
+			writer.WriteCode(0x190 + (symbol - 144), 9);
+		}
+		else if (symbol < 280)
+		{
+			writer.WriteCode(symbol - 256, 7);
+		}
+		else
+		{
+			writer.WriteCode(0xC0 + (symbol - 280), 8);
+		}
+	}
+
+	/***********************************************************
+	 *  WriteMatch()
+	 *
+	 *  This function is used for writing a repeat of earlier
+	 *  bytes as its length and distance codes.
+	 ***********************************************************/
+	void WriteMatch(BIT_WRITER& writer, int length, int distance)
+	{
+		int lengthCode = 28;
+		int distanceCode = 29;
+
+		while (g_LengthBase[lengthCode] > length)
+		{
+			lengthCode--;
+		}
+		while (g_DistanceBase[distanceCode] > distance)
+		{
+			distanceCode--;
+		}
+
+		WriteSymbol(writer, 257 + lengthCode);
+		writer.Write(length - g_LengthBase[lengthCode], g_LengthExtra[lengthCode]);
+		writer.WriteCode(distanceCode, 5);
+		writer.Write(distance - g_DistanceBase[distanceCode], g_DistanceExtra[distanceCode]);
+	}
+
+	/***********************************************************
+	 *  Hash()
+	 *
+	 *  This function is used for hashing the three bytes at a
+	 *  position, the shortest repeat deflate can reference.
+	 ***********************************************************/
+	inline uint32_t Hash(const unsigned char* pBytes)
+	{
+		uint32_t value = ((uint32_t)pBytes[0] << 16) | ((uint32_t)pBytes[1] << 8) | (uint32_t)pBytes[2];
+
+		return((value * 2654435761u) >> (32 - g_HashBits));
+	}
+
+	/***********************************************************
+	 *  Paeth()
+	 *
+	 *  This function is used for predicting a byte from its left,
+	 *  upper and upper left neighbours like the PNG Paeth filter.
+	 ***********************************************************/
+	inline int Paeth(int left, int up, int upLeft)
+	{
+		int estimate = left + up - upLeft;
+		int leftDistance = abs(estimate - left);
+		int upDistance = abs(estimate - up);
+		int upLeftDistance = abs(estimate - upLeft);
+
+		if ((leftDistance <= upDistance) && (leftDistance <= upLeftDistance))
+		{
+			return(left);
+		}
+		if (upDistance <= upLeftDistance)
+		{
+			return(up);
+		}
+		return(upLeft);
+	}
+
+	/***********************************************************
+	 *  PutBigEndian()
+	 *
+	 *  This function is used for appending four bytes with the
+	 *  highest byte first, the byte order of PNG.
+	 ***********************************************************/
+	void PutBigEndian(std::vector<unsigned char>& out, uint32_t value)
+	{
+		out.push_back((unsigned char)(value >> 24));
+		out.push_back((unsigned char)(value >> 16));
+		out.push_back((unsigned char)(value >> 8));
+		out.push_back((unsigned char)value);
+	}
+
+	/***********************************************************
+	 *  Crc32()
+	 *
+	 *  This function is used for computing the CRC the PNG
+	 *  chunks end with.
+	 ***********************************************************/
+	uint32_t Crc32(const unsigned char* pBytes, size_t size)
+	{
+		// built once, on the first call from any encoder thread
+		struct CRC_TABLE
+		{
+			uint32_t entries[256];
+
+			CRC_TABLE()
+			{
+				for (uint32_t n = 0; n < 256; n++)
+				{
+					uint32_t c = n;
+
+					for (int k = 0; k < 8; k++)
+					{
+						c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+					}
+					entries[n] = c;
+				}
+			}
+		};
+		static const CRC_TABLE table;
+
+		uint32_t crc = 0xFFFFFFFFu;
+		for (size_t i = 0; i < size; i++)
+		{
+			crc = table.entries[(crc ^ pBytes[i]) & 0xFF] ^ (crc >> 8);
+		}
+
+		return(crc ^ 0xFFFFFFFFu);
+	}
+
+	/***********************************************************
+	 *  PutChunk()
+	 *
+	 *  This function is used for appending a PNG chunk with its
+	 *  length, type, data and CRC.
+	 ***********************************************************/
+	void PutChunk(std::vector<unsigned char>& out, const char* type, const unsigned char* pData, size_t size)
+	{
+		PutBigEndian(out, (uint32_t)size);
+
+		size_t start = out.size();
+		out.insert(out.end(), type, type + 4);
+		if (size > 0)
+		{
+			out.insert(out.end(), pData, pData + size);
+		}
+
+		PutBigEndian(out, Crc32(&out[start], out.size() - start));
+	}
+}
+
+/***********************************************************
+ *  PngEncoder()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+PngEncoder::PngEncoder()
+{
+}
+
+/***********************************************************
+ *  Encode()
+ *
+ *  This method is used for encoding the passed in pixels into
+ *  a PNG file in memory.
+ ***********************************************************/
+bool PngEncoder::Encode(
+	const unsigned char* pPixels,
+	int width,
+	int height,
+	int rowStride,
+	bool bBottomUp,
+	std::vector<unsigned char>& png)
+{
+	if ((NULL == pPixels) || (width <= 0) || (height <= 0) || (rowStride < width * 4))
+	{
+		return(false);
+	}
+
+	FilterRows(pPixels, width, height, rowStride, bBottomUp);
+	Compress();
+
+	unsigned char header[13];
+	header[0] = (unsigned char)(width >> 24);
+	header[1] = (unsigned char)(width >> 16);
+	header[2] = (unsigned char)(width >> 8);
+	header[3] = (unsigned char)width;
+	header[4] = (unsigned char)(height >> 24);
+	header[5] = (unsigned char)(height >> 16);
+	header[6] = (unsigned char)(height >> 8);
+	header[7] = (unsigned char)height;
+	header[8] = 8;		// bits per channel
+	header[9] = 2;		// RGB
+	header[10] = 0;		// deflate
+	header[11] = 0;		// the five row filters
+	header[12] = 0;		// not interlaced
+
+	png.clear();
+	png.insert(png.end(), g_PngSignature, g_PngSignature + sizeof(g_PngSignature));
+	PutChunk(png, "IHDR", header, sizeof(header));
+	PutChunk(png, "IDAT", m_compressed.data(), m_compressed.size());
+	PutChunk(png, "IEND", NULL, 0);
+
+	return(true);
+}
+
+/***********************************************************
+ *  WriteFile()
+ *
+ *  This method is used for encoding the passed in pixels and
+ *  writing them to a PNG file.
+ ***********************************************************/
+bool PngEncoder::WriteFile(
+	const char* filename,
+	const unsigned char* pPixels,
+	int width,
+	int height,
+	int rowStride,
+	bool bBottomUp)
+{
+	if (!Encode(pPixels, width, height, rowStride, bBottomUp, m_png))
+	{
+		std::cout << "ERROR: could not encode the image " << filename << std::endl;
+		return(false);
+	}
+
+	FILE* pFile = fopen(filename, "wb");
+	if (NULL == pFile)
+	{
+		std::cout << "ERROR: could not open " << filename << " for writing" << std::endl;
+		return(false);
+	}
+
+	bool bWritten = (fwrite(m_png.data(), 1, m_png.size(), pFile) == m_png.size());
+	if (fclose(pFile) != 0)
+	{
+		bWritten = false;
+	}
+	if (!bWritten)
+	{
+		std::cout << "ERROR: could not write " << filename << std::endl;
+	}
+
+	return(bWritten);
+}
+
+/***********************************************************
+ *  FilterRows()
+ *
+ *  This method is used for dropping the alpha of every row,
+ *  running the row through the five PNG filters and keeping
+ *  the one whose bytes are closest to zero, which is the one
+ *  that usually compresses best.
+ ***********************************************************/
+void PngEncoder::FilterRows(const unsigned char* pPixels, int width, int height, int rowStride, bool bBottomUp)
+{
+	const int rowBytes = width * g_PixelBytes;
+
+	m_filtered.resize((size_t)height * (rowBytes + 1));
+	m_row.resize(rowBytes);
+	m_previousRow.assign(rowBytes, 0);
+	m_candidates.resize((size_t)rowBytes * 5);
+
+	for (int y = 0; y < height; y++)
+	{
+		const unsigned char* pSource = pPixels + (size_t)(bBottomUp ? (height - 1 - y) : y) * rowStride;
+		unsigned char* pRow = m_row.data();
+		const unsigned char* pUp = m_previousRow.data();
+
+		for (int x = 0; x < width; x++)
+		{
+			pRow[x * 3 + 0] = pSource[x * 4 + 0];
+			pRow[x * 3 + 1] = pSource[x * 4 + 1];
+			pRow[x * 3 + 2] = pSource[x * 4 + 2];
+		}
+
+		int bestFilter = 0;
+		unsigned long bestSum = 0;
+
+		for (int filter = 0; filter < 5; filter++)
+		{
+			unsigned char* pCandidate = &m_candidates[(size_t)filter * rowBytes];
+			unsigned long sum = 0;
+
+			for (int i = 0; i < rowBytes; i++)
+			{
+				int left = (i >= g_PixelBytes) ? pRow[i - g_PixelBytes] : 0;
+				int upLeft = (i >= g_PixelBytes) ? pUp[i - g_PixelBytes] : 0;
+				int prediction = 0;
+
+				switch (filter)
+				{
+				case 1: prediction = left; break;
+				case 2: prediction = pUp[i]; break;
+				case 3: prediction = (left + pUp[i]) >> 1; break;
+				case 4: prediction = Paeth(left, pUp[i], upLeft); break;
+				}
+
+				pCandidate[i] = (unsigned char)(pRow[i] - prediction);
+				sum += (unsigned long)abs((signed char)pCandidate[i]);
+			}
+
+			if ((filter == 0) || (sum < bestSum))
+			{
+				bestFilter = filter;
+				bestSum = sum;
+			}
+		}
+
+		unsigned char* pOut = &m_filtered[(size_t)y * (rowBytes + 1)];
+		pOut[0] = (unsigned char)bestFilter;
+		memcpy(pOut + 1, &m_candidates[(size_t)bestFilter * rowBytes], rowBytes);
+
+		m_previousRow.swap(m_row);
+	}
+}
+
+/***********************************************************
+ *  Compress()
+ *
+ *  This method is used for deflating the filtered rows into
+ *  one block with the fixed Huffman codes.  Each position
+ *  takes the longest repeat found among the latest earlier
+ *  positions with the same hash inside the window, and every
+ *  position is added to the hash chains as it is passed.
+ ***********************************************************/
+void PngEncoder::Compress()
+{
+	const unsigned char* pData = m_filtered.data();
+	const int size = (int)m_filtered.size();
+	BIT_WRITER writer;
+	uint32_t adlerA = 1;
+	uint32_t adlerB = 0;
+
+	m_compressed.clear();
+	m_compressed.reserve(m_filtered.size() / 2);
+	m_hashHeads.assign((size_t)1 << g_HashBits, -1);
+	m_hashChain.resize(g_WindowSize);
+
+	// zlib header - deflate with a 32K window, no preset dictionary
+	m_compressed.push_back(0x78);
+	m_compressed.push_back(0x01);
+
+	writer.pOut = &m_compressed;
+	writer.bits = 0;
+	writer.count = 0;
+
+	// the only block, with the fixed codes
+	writer.Write(1, 1);
+	writer.Write(1, 2);
+
+	// add a position to the chain of its hash
+	auto insert = [&](int position)
+	{
+		if (position + g_MinMatch <= size)
+		{
+			uint32_t hash = Hash(pData + position);
+
+			m_hashChain[position & (g_WindowSize - 1)] = m_hashHeads[hash];
+			m_hashHeads[hash] = position;
+		}
+	};
+
+	int i = 0;
+	while (i < size)
+	{
+		int bestLength = 0;
+		int bestDistance = 0;
+
+		if (i + g_MinMatch <= size)
+		{
+			int maxLength = (size - i < g_MaxMatch) ? (size - i) : g_MaxMatch;
+			int candidate = m_hashHeads[Hash(pData + i)];
+
+			for (int chain = 0; (chain < g_MaxChain) && (candidate >= 0) && (i - candidate <= g_WindowSize); chain++)
+			{
+				int length = 0;
+
+				while ((length < maxLength) && (pData[candidate + length] == pData[i + length]))
+				{
+					length++;
+				}
+				if (length > bestLength)
+				{
+					bestLength = length;
+					bestDistance = i - candidate;
+					if (length == maxLength)
+					{
+						break;
+					}
+				}
+
+				// a chain entry overwritten by a newer position ends the chain
+				int next = m_hashChain[candidate & (g_WindowSize - 1)];
+				if (next >= candidate)
+				{
+					break;
+				}
+				candidate = next;
+			}
+		}
+
+		if (bestLength >= g_MinMatch)
+		{
+			WriteMatch(writer, bestLength, bestDistance);
+			for (int k = 0; k < bestLength; k++)
+			{
+				insert(i + k);
+			}
+			i += bestLength;
+		}
+		else
+		{
+			WriteSymbol(writer, pData[i]);
+			insert(i);
+			i++;
+		}
+	}
+
+	// end of the block
+	WriteSymbol(writer, 256);
+	writer.Flush();
+
+	// the Adler-32 of the uncompressed bytes closes the zlib stream,
+	// the sums are reduced often enough that they can not overflow
+	for (int start = 0; start < size; start += 5552)
+	{
+		int end = (start + 5552 < size) ? (start + 5552) : size;
+
+		for (int n = start; n < end; n++)
+		{
+			adlerA += pData[n];
+			adlerB += adlerA;
+		}
+		adlerA %= 65521;
+		adlerB %= 65521;
+	}
+	PutBigEndian(m_compressed, (adlerB << 16) | adlerA);
+}
@@ -0,0 +1,68 @@
+///////////////////////////////////////////////////////////////////////////////
+// pngencoder.h
+// ============
+// compress rendered images into PNG files
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <vector>
+
+/***********************************************************
+ *  PngEncoder
+ *
+ *  This class contains the code for writing 8-bit RGB PNG
+ *  files from RGBA pixels the way glReadPixels returns them.
+ *  Every row gets the PNG filter that leaves the smallest
+ *  values, and the filtered rows are deflated with the fixed
+ *  Huffman codes and a hash chain search for repeats.  The
+ *  working memory is kept between images, so an encoder that
+ *  writes one image after another reuses its room.
+ ***********************************************************/
+class PngEncoder
+{
+public:
+	// constructor
+	PngEncoder();
+
+	// encode the RGBA pixels, rowStride bytes apart, into a PNG file in
+	// memory - the alpha is dropped, and with bBottomUp the first row
+	// in memory is the bottom row of the image
+	bool Encode(
+		const unsigned char* pPixels,
+		int width,
+		int height,
+		int rowStride,
+		bool bBottomUp,
+		std::vector<unsigned char>& png);
+	// encode the pixels and write the PNG file
+	bool WriteFile(
+		const char* filename,
+		const unsigned char* pPixels,
+		int width,
+		int height,
+		int rowStride,
+		bool bBottomUp);
+
+private:
+	// the filtered rows, each after its filter type byte
+	std::vector<unsigned char> m_filtered;
+	// the RGB values of the current and the previous row, and the
+	// current row run through each of the five filters
+	std::vector<unsigned char> m_row;
+	std::vector<unsigned char> m_previousRow;
+	std::vector<unsigned char> m_candidates;
+	// the latest position of every hash, and the position before
+	// each position with the same hash
+	std::vector<int> m_hashHeads;
+	std::vector<int> m_hashChain;
+	// the zlib stream of the last image
+	std::vector<unsigned char> m_compressed;
+	// the last encoded file
+	std::vector<unsigned char> m_png;
+
+	// pick and apply the filter of every row
+	void FilterRows(const unsigned char* pPixels, int width, int height, int rowStride, bool bBottomUp);
+	// deflate the filtered rows into a zlib stream
+	void Compress();
+};
@@ -0,0 +1,236 @@
+///////////////////////////////////////////////////////////////////////////////
+// programcache.cpp
+// ============
+// keep the binaries of the linked shader programs on disk between runs
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ProgramCache.h"
+#include "MappedFile.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+// declaration of the global variables and defines
+namespace
+{
+	// the saved programs are stored next to the shader files
+	const char* g_CacheDirectory = "shaders/";
+	const char* g_CacheSuffix = ".program";
+
+	// 64-bit FNV-1a, so unrelated sources practically never share a key
+	const uint64_t g_HashOffset = 14695981039346656037ull;
+	const uint64_t g_HashPrime = 1099511628211ull;
+
+	/***********************************************************
+	 *  HashBytes()
+	 *
+	 *  This function is used for adding bytes to a hash.
+	 ***********************************************************/
+	uint64_t HashBytes(uint64_t hash, const void* pBytes, size_t size)
+	{
+		const unsigned char* pByte = (const unsigned char*)pBytes;
+
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= pByte[i];
+			hash *= g_HashPrime;
+		}
+
+		return(hash);
+	}
+}
+
+/***********************************************************
+ *  IsSupported()
+ *
+ *  This method is used for checking that program binaries
+ *  can be read back and that the driver offers at least one
+ *  format to load them in.
+ ***********************************************************/
+bool ProgramCache::IsSupported()
+{
+	GLint formatCount = 0;
+
+	if (!GLEW_VERSION_4_1 && !GLEW_ARB_get_program_binary)
+	{
+		return(false);
+	}
+
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+
+	return(formatCount > 0);
+}
+
+/***********************************************************
+ *  GetInitialHash()
+ *
+ *  This method is used for getting the value the key of a
+ *  program starts out with, before its stages are added.
+ ***********************************************************/
+uint64_t ProgramCache::GetInitialHash()
+{
+	return(HashBytes(g_HashOffset, &PROGRAM_VERSION, sizeof(PROGRAM_VERSION)));
+}
+
+/***********************************************************
+ *  HashSource()
+ *
+ *  This method is used for adding the type and the source of
+ *  one shader stage to the key of a program.
+ ***********************************************************/
+uint64_t ProgramCache::HashSource(uint64_t hash, GLenum type, const std::string& source)
+{
+	hash = HashBytes(hash, &type, sizeof(type));
+	hash = HashBytes(hash, source.data(), source.size());
+
+	// the terminator keeps the stage boundaries apart
+	return(HashBytes(hash, "", 1));
+}
+
+/***********************************************************
+ *  GetDriverIdentity()
+ *
+ *  This method is used for describing the driver and the GPU.
+ *  A binary saved by one of them can not be loaded by
+ *  another, and a driver update changes the version string.
+ ***********************************************************/
+std::string ProgramCache::GetDriverIdentity()
+{
+	const char* pVendor = (const char*)glGetString(GL_VENDOR);
+	const char* pRenderer = (const char*)glGetString(GL_RENDERER);
+	const char* pVersion = (const char*)glGetString(GL_VERSION);
+
+	std::string identity;
+	identity += (pVendor != NULL) ? pVendor : "";
+	identity += "\n";
+	identity += (pRenderer != NULL) ? pRenderer : "";
+	identity += "\n";
+	identity += (pVersion != NULL) ? pVersion : "";
+
+	return(identity);
+}
+
+/***********************************************************
+ *  GetCachePath()
+ *
+ *  This method is used for naming the file of a program from
+ *  a hash of its name, so every program keeps one file that
+ *  is overwritten whenever its sources change.
+ ***********************************************************/
+std::string ProgramCache::GetCachePath(const char* name)
+{
+	char hashText[17];
+	uint64_t nameHash = HashBytes(g_HashOffset, name, strlen(name));
+
+	snprintf(hashText, sizeof(hashText), "%016llx", (unsigned long long)nameHash);
+
+	return(std::string(g_CacheDirectory) + hashText + g_CacheSuffix);
+}
+
+/***********************************************************
+ *  Load()
+ *
+ *  This method is used for creating a program from its saved
+ *  binary.  The driver may still reject a binary that looks
+ *  right, so the link status decides whether it is used.
+ ***********************************************************/
+GLuint ProgramCache::Load(const char* name, uint64_t sourceHash)
+{
+	if (!IsSupported())
+	{
+		return(0);
+	}
+
+	MappedFile file;
+	if (!file.Open(GetCachePath(name).c_str()) || (file.GetSize() < sizeof(PROGRAM_HEADER)))
+	{
+		return(0);
+	}
+
+	PROGRAM_HEADER header;
+	memcpy(&header, file.GetData(), sizeof(header));
+
+	std::string driver = GetDriverIdentity();
+	const unsigned char* pDriver = file.GetData() + sizeof(PROGRAM_HEADER);
+	const unsigned char* pBinary = pDriver + header.driverSize;
+
+	if ((header.magic != PROGRAM_MAGIC) || (header.version != PROGRAM_VERSION) ||
+		(header.sourceHash != sourceHash) ||
+		((uint64_t)sizeof(PROGRAM_HEADER) + header.driverSize + header.binarySize != file.GetSize()) ||
+		(header.driverSize != driver.size()) ||
+		(memcmp(pDriver, driver.data(), driver.size()) != 0))
+	{
+		return(0);
+	}
+
+	GLint success = 0;
+	GLuint program = glCreateProgram();
+
+	glProgramBinary(program, (GLenum)header.binaryFormat, pBinary, (GLsizei)header.binarySize);
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	if (!success)
+	{
+		std::cout << "INFO: the driver rejected the saved program, building it from source:" << name << std::endl;
+		glDeleteProgram(program);
+		return(0);
+	}
+
+	return(program);
+}
+
+/***********************************************************
+ *  Store()
+ *
+ *  This method is used for saving the binary of a linked
+ *  program with the key it was built for.  A program the
+ *  driver has no binary for is left unsaved.
+ ***********************************************************/
+void ProgramCache::Store(GLuint program, const char* name, uint64_t sourceHash)
+{
+	GLint binarySize = 0;
+
+	if (!IsSupported())
+	{
+		return;
+	}
+
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binarySize);
+	if (binarySize <= 0)
+	{
+		return;
+	}
+
+	std::vector<unsigned char> binary(binarySize);
+	GLenum binaryFormat = 0;
+	GLsizei writtenSize = 0;
+
+	glGetProgramBinary(program, binarySize, &writtenSize, &binaryFormat, binary.data());
+	if (writtenSize <= 0)
+	{
+		return;
+	}
+
+	std::string driver = GetDriverIdentity();
+	PROGRAM_HEADER header;
+	header.magic = PROGRAM_MAGIC;
+	header.version = PROGRAM_VERSION;
+	header.sourceHash = sourceHash;
+	header.binaryFormat = (uint32_t)binaryFormat;
+	header.binarySize = (uint32_t)writtenSize;
+	header.driverSize = (uint32_t)driver.size();
+	header.reserved = 0;
+
+	std::string path = GetCachePath(name);
+	std::ofstream output(path.c_str(), std::ios::binary | std::ios::trunc);
+
+	output.write((const char*)&header, sizeof(header));
+	output.write(driver.data(), driver.size());
+	output.write((const char*)binary.data(), writtenSize);
+	if (!output.good())
+	{
+		std::cout << "Could not save the program binary:" << path << std::endl;
+	}
+}
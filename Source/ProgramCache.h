@@ -0,0 +1,66 @@
+///////////////////////////////////////////////////////////////////////////////
+// programcache.h
+// ============
+// keep the binaries of the linked shader programs on disk between runs
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <string>
+
+/***********************************************************
+ *  ProgramCache
+ *
+ *  This class contains the code for saving a linked program
+ *  with glGetProgramBinary and creating it again from the
+ *  saved binary with glProgramBinary, so later runs skip
+ *  compiling and linking its shaders.  A saved binary is
+ *  only used when it was saved from the same shader sources
+ *  by the same driver and GPU, otherwise the program is
+ *  built from source and saved again.
+ ***********************************************************/
+class ProgramCache
+{
+public:
+	// the first four bytes of every saved program - "PRGB"
+	static const uint32_t PROGRAM_MAGIC = 0x42475250;
+	// changes whenever the file layout changes
+	static const uint32_t PROGRAM_VERSION = 1;
+
+	// true when the context can save and load program binaries
+	static bool IsSupported();
+
+	// hash the source of one stage into the key of a program
+	static uint64_t HashSource(uint64_t hash, GLenum type, const std::string& source);
+	// the key a program hash starts out with
+	static uint64_t GetInitialHash();
+
+	// create the named program from its saved binary, returns 0 when
+	// there is none or it was saved from other sources or by another driver
+	static GLuint Load(const char* name, uint64_t sourceHash);
+	// save the binary of a linked program, which must have been
+	// linked with the retrievable hint
+	static void Store(GLuint program, const char* name, uint64_t sourceHash);
+
+private:
+	// the layout at the start of every saved program, followed by
+	// the driver identity and then the binary
+	struct PROGRAM_HEADER
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t sourceHash;
+		uint32_t binaryFormat;
+		uint32_t binarySize;
+		uint32_t driverSize;
+		uint32_t reserved;
+	};
+
+	// the driver and GPU the binaries are only valid for
+	static std::string GetDriverIdentity();
+	// the file the named program is saved in
+	static std::string GetCachePath(const char* name);
+};
@@ -0,0 +1,631 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenefile.cpp
+// ============
+// load the scene description text through a compiled, memory mapped cache
+//
+//  The text has one entry per line, # starts a comment:
+//
+//    ambient <r g b>
+//    texture <tag> <image file>
+//    material <tag> <ambient r g b> <ambient strength> <diffuse r g b>
+//             <specular r g b> <shininess>
+//    light <slot> <position x y z> <diffuse r g b> <specular r g b>
+//          <focal strength> <specular intensity>
+//    locallight <position x y z> <radius> <diffuse r g b> <specular r g b>
+//               <focal strength> <specular intensity>
+//    group <tag> <rotation x y z> <position x y z>
+//    end
+//    object <mesh> <scale x y z> <rotation x y z> <position x y z> <material>
+//           texture <tag> [<u v>]
+//    object <mesh> <scale x y z> <rotation x y z> <position x y z> <material>
+//           color <r g b a>
+//
+//  The entries between a group and its end are inside the group,
+//  and groups can be inside other groups.  Groups only turn and
+//  move what is inside them, so the objects are never sheared.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneFile.h"
+#include "TagHash.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+// declaration of the global variables and defines
+namespace
+{
+	// the mesh names of the object entries - must match the order
+	// of SceneManager::MESH_ID
+	const char* g_MeshNames[SceneFile::MESH_COUNT] =
+	{
+		"plane",
+		"box",
+		"prism",
+		"cylinder",
+		"sphere",
+		"torus"
+	};
+
+	// the compiled scene is stored next to its text with this suffix
+	const char* g_CompiledSuffix = ".bin";
+
+	/***********************************************************
+	 *  ReadVector()
+	 *
+	 *  This function is used for reading the components of a
+	 *  vector from the remaining tokens of an entry.
+	 ***********************************************************/
+	template<typename VECTOR>
+	bool ReadVector(std::istringstream& entry, VECTOR& value)
+	{
+		for (size_t i = 0; i < sizeof(value) / sizeof(value[0]); i++)
+		{
+			entry >> value[i];
+		}
+
+		return(!entry.fail());
+	}
+
+	/***********************************************************
+	 *  AddString()
+	 *
+	 *  This function is used for appending a string to the
+	 *  string table and returning its offset.
+	 ***********************************************************/
+	uint32_t AddString(std::vector<char>& strings, const std::string& value)
+	{
+		uint32_t offset = (uint32_t)strings.size();
+
+		strings.insert(strings.end(), value.begin(), value.end());
+		strings.push_back('\0');
+
+		return(offset);
+	}
+
+	/***********************************************************
+	 *  AppendRecords()
+	 *
+	 *  This function is used for appending an array of records
+	 *  to the compiled scene and returning their offset.
+	 ***********************************************************/
+	template<typename RECORD>
+	uint32_t AppendRecords(std::vector<unsigned char>& compiled, const std::vector<RECORD>& records)
+	{
+		uint32_t offset = (uint32_t)compiled.size();
+
+		if (!records.empty())
+		{
+			const unsigned char* pRecords = (const unsigned char*)records.data();
+			compiled.insert(compiled.end(), pRecords, pRecords + records.size() * sizeof(RECORD));
+		}
+
+		return(offset);
+	}
+
+	/***********************************************************
+	 *  GetSourceStamp()
+	 *
+	 *  This function is used for reading the size and the last
+	 *  modification time of the scene text.  Returns false when
+	 *  the text does not exist.
+	 ***********************************************************/
+	bool GetSourceStamp(const char* filename, uint64_t& size, int64_t& time)
+	{
+		struct stat status;
+
+		if (stat(filename, &status) != 0)
+		{
+			return(false);
+		}
+
+		size = (uint64_t)status.st_size;
+		time = (int64_t)status.st_mtime;
+
+		return(true);
+	}
+}
+
+/***********************************************************
+ *  SceneFile()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SceneFile::SceneFile()
+{
+	m_pHeader = NULL;
+}
+
+/***********************************************************
+ *  ~SceneFile()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+SceneFile::~SceneFile()
+{
+	Close();
+}
+
+/***********************************************************
+ *  Load()
+ *
+ *  This method is used for loading a scene.  An up to date
+ *  compiled binary is mapped and used in place, otherwise
+ *  the text is compiled and the binary is written for the
+ *  next load.  Without the text an existing binary is used
+ *  as it is, so a scene can ship without its text.
+ ***********************************************************/
+bool SceneFile::Load(const char* filename)
+{
+	std::string compiledPath = std::string(filename) + g_CompiledSuffix;
+	uint64_t sourceSize = 0;
+	int64_t sourceTime = 0;
+
+	Close();
+
+	bool bHaveSource = GetSourceStamp(filename, sourceSize, sourceTime);
+
+	if (m_file.Open(compiledPath.c_str()))
+	{
+		if (IsValid(m_file.GetData(), m_file.GetSize(), bHaveSource, sourceSize, sourceTime))
+		{
+			m_pHeader = (const SCENE_HEADER*)m_file.GetData();
+			std::cout << "Mapped compiled scene:" << compiledPath << ", objects:" << m_pHeader->objectCount << std::endl;
+			return(true);
+		}
+		m_file.Close();
+	}
+
+	if (!bHaveSource)
+	{
+		std::cout << "Could not open scene file:" << filename << std::endl;
+		return(false);
+	}
+
+	bool bClean = Compile(filename, sourceSize, sourceTime, m_compiled);
+	m_pHeader = (const SCENE_HEADER*)m_compiled.data();
+	std::cout << "Compiled scene file:" << filename << ", objects:" << m_pHeader->objectCount << std::endl;
+
+	// a scene with errors is compiled again on every load, so the
+	// errors keep being reported until the text is fixed
+	if (bClean)
+	{
+		std::ofstream output(compiledPath.c_str(), std::ios::binary | std::ios::trunc);
+
+		output.write((const char*)m_compiled.data(), m_compiled.size());
+		if (!output.good())
+		{
+			std::cout << "Could not write compiled scene:" << compiledPath << std::endl;
+		}
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  Close()
+ *
+ *  This method is used for releasing the loaded scene.  The
+ *  records are only needed while the scene is prepared.
+ ***********************************************************/
+void SceneFile::Close()
+{
+	m_pHeader = NULL;
+	m_file.Close();
+	m_compiled.clear();
+	m_compiled.shrink_to_fit();
+}
+
+/***********************************************************
+ *  IsValid()
+ *
+ *  This method is used for checking that a compiled scene has
+ *  the current layout, holds all of its records and strings,
+ *  and when the text exists, was compiled from it as it is.
+ ***********************************************************/
+bool SceneFile::IsValid(const unsigned char* pData, size_t size, bool bCheckSource, uint64_t sourceSize, int64_t sourceTime)
+{
+	if ((pData == NULL) || (size < sizeof(SCENE_HEADER)))
+	{
+		return(false);
+	}
+
+	const SCENE_HEADER* pHeader = (const SCENE_HEADER*)pData;
+
+	if ((pHeader->magic != SCENE_MAGIC) || (pHeader->version != SCENE_VERSION) || (pHeader->fileSize != size))
+	{
+		return(false);
+	}
+
+	if (bCheckSource && ((pHeader->sourceSize != sourceSize) || (pHeader->sourceTime != sourceTime)))
+	{
+		return(false);
+	}
+
+	// every record array and the string table must lie inside the file
+	if (((uint64_t)pHeader->textureOffset + (uint64_t)pHeader->textureCount * sizeof(SCENE_TEXTURE) > size) ||
+		((uint64_t)pHeader->materialOffset + (uint64_t)pHeader->materialCount * sizeof(SCENE_MATERIAL) > size) ||
+		((uint64_t)pHeader->lightOffset + (uint64_t)pHeader->lightCount * sizeof(SCENE_LIGHT) > size) ||
+		((uint64_t)pHeader->groupOffset + (uint64_t)pHeader->groupCount * sizeof(SCENE_GROUP) > size) ||
+		((uint64_t)pHeader->objectOffset + (uint64_t)pHeader->objectCount * sizeof(SCENE_OBJECT) > size) ||
+		((uint64_t)pHeader->stringOffset + pHeader->stringSize > size) ||
+		(pHeader->stringSize == 0) ||
+		(pData[pHeader->stringOffset + pHeader->stringSize - 1] != '\0'))
+	{
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  Compile()
+ *
+ *  This method is used for parsing the scene text into the
+ *  compiled layout - the header, the record arrays and then
+ *  the string table.  Entries with errors are reported with
+ *  their line and left out.  Returns false when there was
+ *  an error.
+ ***********************************************************/
+bool SceneFile::Compile(const char* filename, uint64_t sourceSize, int64_t sourceTime, std::vector<unsigned char>& compiled)
+{
+	std::ifstream input(filename);
+	std::vector<SCENE_TEXTURE> textures;
+	std::vector<SCENE_MATERIAL> materials;
+	std::vector<SCENE_LIGHT> lights;
+	std::vector<SCENE_GROUP> groups;
+	std::vector<SCENE_OBJECT> objects;
+	// the groups that were opened and not ended yet, innermost last
+	std::vector<int32_t> openGroups;
+	// offset zero is the empty string
+	std::vector<char> strings(1, '\0');
+	SCENE_HEADER header;
+	std::string line;
+	int lineNumber = 0;
+	bool bClean = input.good();
+
+	memset((void*)&header, 0, sizeof(header));
+	header.globalAmbientColor = glm::vec3(0.2f, 0.2f, 0.2f);
+
+	while (std::getline(input, line))
+	{
+		lineNumber++;
+
+		size_t comment = line.find('#');
+		if (comment != std::string::npos)
+		{
+			line.erase(comment);
+		}
+
+		std::istringstream entry(line);
+		std::string keyword;
+		bool bValid = true;
+
+		if (!(entry >> keyword))
+		{
+			continue;
+		}
+
+		if (keyword == "ambient")
+		{
+			bValid = ReadVector(entry, header.globalAmbientColor);
+		}
+		else if (keyword == "texture")
+		{
+			SCENE_TEXTURE texture;
+			std::string tag;
+			std::string path;
+
+			bValid = !(entry >> tag >> path).fail();
+			if (bValid)
+			{
+				texture.tagHash = TagHash(tag.c_str());
+				texture.tagOffset = AddString(strings, tag);
+				texture.pathOffset = AddString(strings, path);
+				textures.push_back(texture);
+			}
+		}
+		else if (keyword == "material")
+		{
+			SCENE_MATERIAL material;
+			std::string tag;
+
+			entry >> tag;
+			bValid = ReadVector(entry, material.ambientColor) &&
+				!(entry >> material.ambientStrength).fail() &&
+				ReadVector(entry, material.diffuseColor) &&
+				ReadVector(entry, material.specularColor) &&
+				!(entry >> material.shininess).fail();
+			if (bValid)
+			{
+				material.tagHash = TagHash(tag.c_str());
+				material.tagOffset = AddString(strings, tag);
+				materials.push_back(material);
+			}
+		}
+		else if ((keyword == "light") || (keyword == "locallight"))
+		{
+			SCENE_LIGHT light;
+
+			light.slot = -1;
+			light.radius = 0.0f;
+			if (keyword == "light")
+			{
+				light.type = LIGHT_FRAME;
+				bValid = !(entry >> light.slot).fail() && ReadVector(entry, light.position);
+			}
+			else
+			{
+				light.type = LIGHT_LOCAL;
+				bValid = ReadVector(entry, light.position) && !(entry >> light.radius).fail();
+			}
+			bValid = bValid &&
+				ReadVector(entry, light.diffuseColor) &&
+				ReadVector(entry, light.specularColor) &&
+				!(entry >> light.focalStrength >> light.specularIntensity).fail();
+			if (bValid)
+			{
+				lights.push_back(light);
+			}
+		}
+		else if (keyword == "group")
+		{
+			SCENE_GROUP group;
+			std::string tag;
+
+			entry >> tag;
+			bValid = ReadVector(entry, group.rotation) && ReadVector(entry, group.position);
+			if (bValid)
+			{
+				group.tagHash = TagHash(tag.c_str());
+				group.tagOffset = AddString(strings, tag);
+				group.parent = openGroups.empty() ? -1 : openGroups.back();
+				openGroups.push_back((int32_t)groups.size());
+				groups.push_back(group);
+			}
+		}
+		else if (keyword == "end")
+		{
+			bValid = !openGroups.empty();
+			if (bValid)
+			{
+				openGroups.pop_back();
+			}
+		}
+		else if (keyword == "object")
+		{
+			SCENE_OBJECT object;
+			std::string mesh;
+			std::string material;
+			std::string surface;
+
+			entry >> mesh;
+			object.mesh = 0;
+			while ((object.mesh < (uint32_t)MESH_COUNT) && (mesh != g_MeshNames[object.mesh]))
+			{
+				object.mesh++;
+			}
+
+			object.flags = 0;
+			object.textureTag = 0;
+			object.color = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
+			object.uvScale = glm::vec2(1.0f, 1.0f);
+			object.group = openGroups.empty() ? -1 : openGroups.back();
+			bValid = (object.mesh < (uint32_t)MESH_COUNT) &&
+				ReadVector(entry, object.scale) &&
+				ReadVector(entry, object.rotation) &&
+				ReadVector(entry, object.position) &&
+				!(entry >> material >> surface).fail();
+
+			if (bValid && (surface == "texture"))
+			{
+				std::string tag;
+
+				bValid = !(entry >> tag).fail();
+				object.flags |= OBJECT_TEXTURED;
+				object.textureTag = TagHash(tag.c_str());
+
+				// the texture scale is optional
+				glm::vec2 uvScale;
+				if (ReadVector(entry, uvScale))
+				{
+					object.uvScale = uvScale;
+				}
+			}
+			else if (bValid)
+			{
+				bValid = (surface == "color") && ReadVector(entry, object.color);
+			}
+
+			if (bValid)
+			{
+				object.materialTag = TagHash(material.c_str());
+				objects.push_back(object);
+			}
+		}
+		else
+		{
+			std::cout << "Scene file " << filename << " line " << lineNumber << ": unknown entry " << keyword << std::endl;
+			bClean = false;
+			continue;
+		}
+
+		if (!bValid)
+		{
+			std::cout << "Scene file " << filename << " line " << lineNumber << ": could not read the " << keyword << " entry" << std::endl;
+			bClean = false;
+		}
+	}
+
+	if (!openGroups.empty())
+	{
+		std::cout << "Scene file " << filename << ": " << openGroups.size() << " groups have no end entry" << std::endl;
+		bClean = false;
+	}
+
+	// the records are four byte aligned, the header keeps them aligned
+	compiled.assign(sizeof(SCENE_HEADER), 0);
+	header.textureCount = (uint32_t)textures.size();
+	header.textureOffset = AppendRecords(compiled, textures);
+	header.materialCount = (uint32_t)materials.size();
+	header.materialOffset = AppendRecords(compiled, materials);
+	header.lightCount = (uint32_t)lights.size();
+	header.lightOffset = AppendRecords(compiled, lights);
+	header.groupCount = (uint32_t)groups.size();
+	header.groupOffset = AppendRecords(compiled, groups);
+	header.objectCount = (uint32_t)objects.size();
+	header.objectOffset = AppendRecords(compiled, objects);
+	header.stringSize = (uint32_t)strings.size();
+	header.stringOffset = AppendRecords(compiled, strings);
+
+	header.magic = SCENE_MAGIC;
+	header.version = SCENE_VERSION;
+	header.sourceSize = sourceSize;
+	header.sourceTime = sourceTime;
+	header.fileSize = compiled.size();
+	memcpy(compiled.data(), &header, sizeof(header));
+
+	return(bClean);
+}
+
+/***********************************************************
+ *  GetGlobalAmbientColor()
+ *
+ *  This method is used for getting the ambient light color
+ *  of the scene.
+ ***********************************************************/
+glm::vec3 SceneFile::GetGlobalAmbientColor() const
+{
+	return(IsLoaded() ? m_pHeader->globalAmbientColor : glm::vec3(0.0f));
+}
+
+/***********************************************************
+ *  GetTextureCount()
+ *
+ *  This method is used for getting the number of textures.
+ ***********************************************************/
+int SceneFile::GetTextureCount() const
+{
+	return(IsLoaded() ? (int)m_pHeader->textureCount : 0);
+}
+
+/***********************************************************
+ *  GetTexture()
+ *
+ *  This method is used for getting a texture record.
+ ***********************************************************/
+const SceneFile::SCENE_TEXTURE& SceneFile::GetTexture(int index) const
+{
+	const unsigned char* pData = (const unsigned char*)m_pHeader;
+
+	return(((const SCENE_TEXTURE*)(pData + m_pHeader->textureOffset))[index]);
+}
+
+/***********************************************************
+ *  GetMaterialCount()
+ *
+ *  This method is used for getting the number of materials.
+ ***********************************************************/
+int SceneFile::GetMaterialCount() const
+{
+	return(IsLoaded() ? (int)m_pHeader->materialCount : 0);
+}
+
+/***********************************************************
+ *  GetMaterial()
+ *
+ *  This method is used for getting a material record.
+ ***********************************************************/
+const SceneFile::SCENE_MATERIAL& SceneFile::GetMaterial(int index) const
+{
+	const unsigned char* pData = (const unsigned char*)m_pHeader;
+
+	return(((const SCENE_MATERIAL*)(pData + m_pHeader->materialOffset))[index]);
+}
+
+/***********************************************************
+ *  GetLightCount()
+ *
+ *  This method is used for getting the number of lights.
+ ***********************************************************/
+int SceneFile::GetLightCount() const
+{
+	return(IsLoaded() ? (int)m_pHeader->lightCount : 0);
+}
+
+/***********************************************************
+ *  GetLight()
+ *
+ *  This method is used for getting a light record.
+ ***********************************************************/
+const SceneFile::SCENE_LIGHT& SceneFile::GetLight(int index) const
+{
+	const unsigned char* pData = (const unsigned char*)m_pHeader;
+
+	return(((const SCENE_LIGHT*)(pData + m_pHeader->lightOffset))[index]);
+}
+
+/***********************************************************
+ *  GetGroupCount()
+ *
+ *  This method is used for getting the number of groups.
+ ***********************************************************/
+int SceneFile::GetGroupCount() const
+{
+	return(IsLoaded() ? (int)m_pHeader->groupCount : 0);
+}
+
+/***********************************************************
+ *  GetGroup()
+ *
+ *  This method is used for getting a group record.
+ ***********************************************************/
+const SceneFile::SCENE_GROUP& SceneFile::GetGroup(int index) const
+{
+	const unsigned char* pData = (const unsigned char*)m_pHeader;
+
+	return(((const SCENE_GROUP*)(pData + m_pHeader->groupOffset))[index]);
+}
+
+/***********************************************************
+ *  GetSceneObjectCount()
+ *
+ *  This method is used for getting the number of objects.
+ ***********************************************************/
+int SceneFile::GetSceneObjectCount() const
+{
+	return(IsLoaded() ? (int)m_pHeader->objectCount : 0);
+}
+
+/***********************************************************
+ *  GetSceneObject()
+ *
+ *  This method is used for getting an object record.
+ ***********************************************************/
+const SceneFile::SCENE_OBJECT& SceneFile::GetSceneObject(int index) const
+{
+	const unsigned char* pData = (const unsigned char*)m_pHeader;
+
+	return(((const SCENE_OBJECT*)(pData + m_pHeader->objectOffset))[index]);
+}
+
+/***********************************************************
+ *  GetString()
+ *
+ *  This method is used for getting a string of the string
+ *  table.  The table is checked to end with a terminator
+ *  when the scene is loaded.
+ ***********************************************************/
+const char* SceneFile::GetString(uint32_t offset) const
+{
+	if (!IsLoaded() || (offset >= m_pHeader->stringSize))
+	{
+		return("");
+	}
+
+	return((const char*)m_pHeader + m_pHeader->stringOffset + offset);
+}
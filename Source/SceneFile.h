@@ -0,0 +1,186 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenefile.h
+// ============
+// load the scene description text through a compiled, memory mapped cache
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MappedFile.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  SceneFile
+ *
+ *  This class contains the code for reading the textures,
+ *  materials, lights and objects of a scene from its text
+ *  description.  The first load compiles the text into a
+ *  binary file next to it, made of fixed size records that
+ *  later loads map and read in place without parsing.  The
+ *  binary is rebuilt whenever the text changes.
+ ***********************************************************/
+class SceneFile
+{
+public:
+	// constructor
+	SceneFile();
+	// destructor
+	~SceneFile();
+
+	// the first four bytes of every compiled scene - "SCNB"
+	static const uint32_t SCENE_MAGIC = 0x424E4353;
+	// changes whenever a record layout changes, so old binaries are rebuilt
+	static const uint32_t SCENE_VERSION = 2;
+
+	// number of named meshes - the names in SceneFile.cpp must match
+	// the order of SceneManager::MESH_ID
+	static const int MESH_COUNT = 6;
+
+	// object flags
+	static const uint32_t OBJECT_TEXTURED = 0x00000001;
+
+	// light types
+	enum LIGHT_TYPE
+	{
+		LIGHT_FRAME = 0,
+		LIGHT_LOCAL
+	};
+
+	// the records below are stored as they are in the compiled
+	// scene, the strings are offsets into its string table
+
+	struct SCENE_TEXTURE
+	{
+		uint32_t tagHash;
+		uint32_t tagOffset;
+		uint32_t pathOffset;
+	};
+
+	struct SCENE_MATERIAL
+	{
+		glm::vec3 ambientColor;
+		float ambientStrength;
+		glm::vec3 diffuseColor;
+		glm::vec3 specularColor;
+		float shininess;
+		uint32_t tagHash;
+		uint32_t tagOffset;
+	};
+
+	struct SCENE_LIGHT
+	{
+		uint32_t type;
+		// frame light slot, unused by the local lights
+		int32_t slot;
+		glm::vec3 position;
+		// range of the local lights, unused by the frame lights
+		float radius;
+		glm::vec3 diffuseColor;
+		glm::vec3 specularColor;
+		float focalStrength;
+		float specularIntensity;
+	};
+
+	// a group moves and turns the objects and groups inside it as one,
+	// the groups are stored parents first
+	struct SCENE_GROUP
+	{
+		uint32_t tagHash;
+		uint32_t tagOffset;
+		// the group this one is inside, -1 for none
+		int32_t parent;
+		// rotations around the x, y and z axes in degrees
+		glm::vec3 rotation;
+		glm::vec3 position;
+	};
+
+	struct SCENE_OBJECT
+	{
+		uint32_t mesh;
+		uint32_t flags;
+		glm::vec3 scale;
+		// rotations around the x, y and z axes in degrees
+		glm::vec3 rotation;
+		glm::vec3 position;
+		uint32_t materialTag;
+		uint32_t textureTag;
+		// color of the solid colored objects
+		glm::vec4 color;
+		// texture scale of the textured objects
+		glm::vec2 uvScale;
+		// the group the object is inside, -1 for none - the scale,
+		// rotation and position are relative to the group
+		int32_t group;
+	};
+
+	// the start of every compiled scene, telling where the records are
+	struct SCENE_HEADER
+	{
+		uint32_t magic;
+		uint32_t version;
+		// size and modification time of the text the scene was compiled from
+		uint64_t sourceSize;
+		int64_t sourceTime;
+		// size of the whole compiled scene
+		uint64_t fileSize;
+		glm::vec3 globalAmbientColor;
+		uint32_t textureCount;
+		uint32_t textureOffset;
+		uint32_t materialCount;
+		uint32_t materialOffset;
+		uint32_t lightCount;
+		uint32_t lightOffset;
+		uint32_t groupCount;
+		uint32_t groupOffset;
+		uint32_t objectCount;
+		uint32_t objectOffset;
+		uint32_t stringOffset;
+		uint32_t stringSize;
+	};
+
+	// load the passed in scene text, from its compiled binary when that
+	// is up to date, returns false when neither can be read
+	bool Load(const char* filename);
+	// release the mapped or compiled scene
+	void Close();
+	// true while a scene is loaded
+	bool IsLoaded() const { return(m_pHeader != NULL); }
+
+	// the records of the loaded scene
+	glm::vec3 GetGlobalAmbientColor() const;
+	int GetTextureCount() const;
+	const SCENE_TEXTURE& GetTexture(int index) const;
+	int GetMaterialCount() const;
+	const SCENE_MATERIAL& GetMaterial(int index) const;
+	int GetLightCount() const;
+	const SCENE_LIGHT& GetLight(int index) const;
+	int GetGroupCount() const;
+	const SCENE_GROUP& GetGroup(int index) const;
+	int GetSceneObjectCount() const;
+	const SCENE_OBJECT& GetSceneObject(int index) const;
+	// a string of the string table, empty when the offset is out of range
+	const char* GetString(uint32_t offset) const;
+
+private:
+	// the compiled binary of the scene, when it was mapped
+	MappedFile m_file;
+	// the compiled scene, when it was built by this load
+	std::vector<unsigned char> m_compiled;
+	// the header at the start of whichever of the two is in use
+	const SCENE_HEADER* m_pHeader;
+
+	// check that compiled scene data is complete and was built from
+	// the text with the passed in size and time
+	static bool IsValid(const unsigned char* pData, size_t size, bool bCheckSource, uint64_t sourceSize, int64_t sourceTime);
+	// compile the scene text into the binary layout
+	static bool Compile(const char* filename, uint64_t sourceSize, int64_t sourceTime, std::vector<unsigned char>& compiled);
+
+	// scene files can not be copied
+	SceneFile(const SceneFile&);
+	SceneFile& operator=(const SceneFile&);
+};
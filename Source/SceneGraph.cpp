@@ -0,0 +1,117 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenegraph.cpp
+// ============
+// place the scene objects relative to the groups they belong to
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneGraph.h"
+
+#include <iostream>
+
+/***********************************************************
+ *  SceneGraph()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SceneGraph::SceneGraph()
+{
+	m_bAnyDirty = false;
+}
+
+/***********************************************************
+ *  AddNode()
+ *
+ *  This method is used for adding a node.  A node can only
+ *  be added below a node that already exists, which keeps
+ *  every parent before its children.  Returns -1 when the
+ *  parent does not exist.
+ ***********************************************************/
+int SceneGraph::AddNode(int parent, const glm::mat4& local)
+{
+	if (parent >= GetNodeCount())
+	{
+		std::cout << "ERROR: scene graph node " << parent << " does not exist" << std::endl;
+		return(-1);
+	}
+
+	m_parents.push_back((parent < 0) ? -1 : parent);
+	m_locals.push_back(local);
+	m_worlds.push_back(local);
+	m_dirty.push_back(1);
+	m_bAnyDirty = true;
+
+	return(GetNodeCount() - 1);
+}
+
+/***********************************************************
+ *  SetLocalTransform()
+ *
+ *  This method is used for replacing the local matrix of a
+ *  node and flagging it for the next update.
+ ***********************************************************/
+void SceneGraph::SetLocalTransform(int node, const glm::mat4& local)
+{
+	if ((node < 0) || (node >= GetNodeCount()))
+	{
+		return;
+	}
+
+	m_locals[node] = local;
+	m_dirty[node] = 1;
+	m_bAnyDirty = true;
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing all of the nodes.
+ ***********************************************************/
+void SceneGraph::Clear()
+{
+	m_parents.clear();
+	m_locals.clear();
+	m_worlds.clear();
+	m_dirty.clear();
+	m_changed.clear();
+	m_bAnyDirty = false;
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for computing the world matrices of
+ *  the changed nodes.  A node whose parent changed in this
+ *  pass is flagged as well, and since the parent always
+ *  comes first, the whole subtree below a changed node is
+ *  flagged by the time the pass reaches it.
+ ***********************************************************/
+int SceneGraph::Update()
+{
+	m_changed.clear();
+	if (!m_bAnyDirty)
+	{
+		return(0);
+	}
+
+	for (int i = 0; i < GetNodeCount(); i++)
+	{
+		int parent = m_parents[i];
+
+		if ((m_dirty[i] == 0) && ((parent < 0) || (m_dirty[parent] == 0)))
+		{
+			continue;
+		}
+
+		m_dirty[i] = 1;
+		m_worlds[i] = (parent < 0) ? m_locals[i] : m_worlds[parent] * m_locals[i];
+		m_changed.push_back(i);
+	}
+
+	for (int n = 0; n < m_changed.size(); n++)
+	{
+		m_dirty[m_changed[n]] = 0;
+	}
+	m_bAnyDirty = false;
+
+	return((int)m_changed.size());
+}
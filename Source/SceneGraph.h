@@ -0,0 +1,65 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenegraph.h
+// ============
+// place the scene objects relative to the groups they belong to
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  SceneGraph
+ *
+ *  This class contains the code for the parent and child
+ *  transforms of the scene.  The nodes are kept in one flat
+ *  array where every parent comes before its children, so a
+ *  single pass from the front turns the local matrices into
+ *  world matrices.  Only the nodes that changed and the
+ *  nodes below them are computed again, and an update with
+ *  no changes returns right away.
+ ***********************************************************/
+class SceneGraph
+{
+public:
+	// constructor
+	SceneGraph();
+
+	// add a node below the passed in parent, or a root node for -1,
+	// and return its index - the parent must already be added
+	int AddNode(int parent, const glm::mat4& local);
+	// replace the local matrix of a node, the node and every node
+	// below it change on the next update
+	void SetLocalTransform(int node, const glm::mat4& local);
+	// remove all of the nodes
+	void Clear();
+
+	// number of nodes
+	int GetNodeCount() const { return((int)m_parents.size()); }
+	// the parent of a node, -1 for a root node
+	int GetParent(int node) const { return(m_parents[node]); }
+
+	// compute the world matrices of the changed nodes and the nodes
+	// below them, returns the number of them
+	int Update();
+	// the nodes whose world matrix the last update computed
+	const std::vector<int>& GetChanged() const { return(m_changed); }
+	// the world matrix of a node as of the last update
+	const glm::mat4& GetWorld(int node) const { return(m_worlds[node]); }
+
+private:
+	// the parent of every node, always before it in the array
+	std::vector<int> m_parents;
+	// the matrix of every node relative to its parent
+	std::vector<glm::mat4> m_locals;
+	// the matrix of every node relative to the world
+	std::vector<glm::mat4> m_worlds;
+	// true for the nodes that changed since the last update
+	std::vector<unsigned char> m_dirty;
+	// true when any node changed since the last update
+	bool m_bAnyDirty;
+	// the nodes the last update computed
+	std::vector<int> m_changed;
+};
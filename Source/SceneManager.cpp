@@ -8,6 +8,7 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "SceneManager.h"
+#include "FrameProfiler.h"
 
 #ifndef STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_IMPLEMENTATION
@@ -15,15 +16,88 @@
 #endif
 
 #include <glm/gtx/transform.hpp>
+#include <glm/gtc/matrix_inverse.hpp>
+
+#include <algorithm>
+#include <cfloat>
 
 // declaration of global variables
 namespace
 {
 	const char* g_ModelName = "model";
+	const char* g_NormalMatrixName = "normalMatrix";
 	const char* g_ColorValueName = "objectColor";
-	const char* g_TextureValueName = "objectTexture";
-	const char* g_UseTextureName = "bUseTexture";
-	const char* g_UseLightingName = "bUseLighting";
+	const char* g_TextureValueName = "objectTextures";
+	const char* g_TextureSlotName = "textureSlot";
+	const char* g_UseLocalLightsName = "bUseLocalLights";
+	const char* g_UseInstancingName = "bUseInstancing";
+	const char* g_UseStaticGeometryName = "bUseStaticGeometry";
+	const char* g_MaterialIndexName = "materialIndex";
+	const char* g_UVScaleName = "UVscale";
+
+	// compute shader culling the static geometry on the GPU
+	const char* g_CullShaderPath = "shaders/cullShader.glsl";
+	const char* g_LightClusterShaderPath = "shaders/lightClusterShader.glsl";
+	const char* g_DepthVertexShaderPath = "shaders/depthVertexShader.glsl";
+	const char* g_DepthFragmentShaderPath = "shaders/depthFragmentShader.glsl";
+
+	// the scene drawn when no other scene file is set
+	const char* g_DefaultScenePath = "scenes/office.scene";
+
+	// draw list objects and batches handed to a thread at a time by
+	// the per-frame loops - smaller scenes run on the render thread
+	const int g_JobGrainItems = 512;
+	const int g_JobGrainBatches = 32;
+
+	// detail levels of every mesh - the flat shapes look the same at
+	// any distance, so only the curved ones have coarser levels
+	const int g_MeshLodCounts[] = { 1, 1, 1, MESH_LOD_COUNT, MESH_LOD_COUNT, MESH_LOD_COUNT };
+
+	// the scene has always been lit with the normals of the meshes
+	// as they are, not turned with their objects - world space
+	// normals light rotated objects correctly but change the look
+	// of the scene, so they stay off until that is its own change
+	const bool g_bWorldSpaceNormals = false;
+
+	// the uniform block binding point of the scene materials, and the
+	// number of materials it holds - must match the fragment shader
+	const GLuint g_MaterialBlockBinding = 0;
+	const int g_MaxMaterials = 64;
+
+	// one scene material in the std140 layout of the shader block
+	struct MATERIAL_BLOCK_ENTRY
+	{
+		glm::vec3 ambientColor;
+		float ambientStrength;
+		glm::vec3 diffuseColor;
+		float padding;
+		glm::vec3 specularColor;
+		float shininess;
+	};
+
+	// half extents of the basic shape meshes around their
+	// centers, indexed by mesh ID
+	const glm::vec3 g_MeshHalfExtents[] =
+	{
+		glm::vec3(1.0f, 0.0f, 1.0f),	// MESH_PLANE
+		glm::vec3(0.5f, 0.5f, 0.5f),	// MESH_BOX
+		glm::vec3(0.5f, 0.5f, 0.5f),	// MESH_PRISM
+		glm::vec3(1.0f, 0.5f, 1.0f),	// MESH_CYLINDER
+		glm::vec3(1.0f, 1.0f, 1.0f),	// MESH_SPHERE
+		glm::vec3(1.25f, 0.25f, 1.25f)	// MESH_TORUS
+	};
+
+	// centers of the basic shape meshes in model space - the
+	// cylinder stands on the origin
+	const glm::vec3 g_MeshCenters[] =
+	{
+		glm::vec3(0.0f, 0.0f, 0.0f),	// MESH_PLANE
+		glm::vec3(0.0f, 0.0f, 0.0f),	// MESH_BOX
+		glm::vec3(0.0f, 0.0f, 0.0f),	// MESH_PRISM
+		glm::vec3(0.0f, 0.5f, 0.0f),	// MESH_CYLINDER
+		glm::vec3(0.0f, 0.0f, 0.0f),	// MESH_SPHERE
+		glm::vec3(0.0f, 0.0f, 0.0f)		// MESH_TORUS
+	};
 }
 
 /***********************************************************
@@ -31,19 +105,40 @@ namespace
  *
  *  The constructor for the class
  ***********************************************************/
-SceneManager::SceneManager(ShaderManager* pShaderManager)
+SceneManager::SceneManager(ShaderManager* pShaderManager, ShaderVariants* pShaderVariants, FrameUniforms* pFrameUniforms, StreamBuffer* pStreamBuffer, FrameArena* pFrameArena)
 {
 	m_pShaderManager = pShaderManager;
-	m_basicMeshes = new ShapeMeshes();
-
-	// initialize the texture collection
-	for (int i = 0; i < 16; i++)
+	m_pShaderVariants = pShaderVariants;
+	m_pUniformCache = NULL;
+	m_pFrameUniforms = pFrameUniforms;
+	m_pStreamBuffer = pStreamBuffer;
+	m_pFrameArena = pFrameArena;
+	m_uniformProgram = 0;
+	m_currentVariant = -1;
+	m_bUseLighting = false;
+	m_bUseLocalLights = false;
+	m_bDrawInstanced = false;
+	m_bDrawStaticGeometry = false;
+	for (int i = 0; i < ShaderVariants::VARIANT_COUNT; i++)
 	{
-		m_textureIDs[i].tag = "/0";
-		m_textureIDs[i].ID = -1;
+		m_variantStates[i].program = 0;
+		m_variantStates[i].appliedState.bValid = false;
 	}
-	m_loadedTextures = 0;
-
+	m_basicMeshes = new ShapeMeshes();
+	m_instancedMeshes = new InstancedMeshes();
+	m_textureLoader = new TextureLoader();
+	m_bUseInstancing = true;
+	m_bUseStaticGeometry = true;
+	m_lodHysteresis = MESH_LOD_HYSTERESIS;
+	m_bUseDepthPrepass = true;
+	m_bSceneTranslucent = false;
+	m_scenePath = g_DefaultScenePath;
+	m_jobThreads = 0;
+	m_pixelsPerUnit = 0.0f;
+
+	// nothing has been applied to the shader yet
+	m_appliedState.bValid = false;
+	m_materialBuffer = 0;
 }
 
 /***********************************************************
@@ -54,101 +149,372 @@ SceneManager::SceneManager(ShaderManager* pShaderManager)
 SceneManager::~SceneManager()
 {
 	m_pShaderManager = NULL;
+	m_pShaderVariants = NULL;
+	m_pUniformCache = NULL;
+	m_pFrameUniforms = NULL;
+	m_pStreamBuffer = NULL;
+	m_pFrameArena = NULL;
 	delete m_basicMeshes;
 	m_basicMeshes = NULL;
+	delete m_instancedMeshes;
+	m_instancedMeshes = NULL;
+	// stop the texture loader before its textures are destroyed
+	delete m_textureLoader;
+	m_textureLoader = NULL;
 	// destroy the created OpenGL textures
 	DestroyGLTextures();
+	// free the material uniform buffer
+	if (m_materialBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_materialBuffer);
+		m_materialBuffer = 0;
+	}
 }
 
 /***********************************************************
- *  CreateGLTexture()
+ *  LoadUniformLocations()
  *
- *  This method is used for loading textures from image files,
- *  configuring the texture mapping parameters in OpenGL,
- *  generating the mipmaps, and loading the read texture into
- *  the next available texture slot in memory.
- ***********************************************************/
-bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
-{
-	int width = 0;
-	int height = 0;
-	int colorChannels = 0;
-	GLuint textureID = 0;
-
-	// indicate to always flip images vertically when loaded
-	stbi_set_flip_vertically_on_load(true);
-
-	// try to parse the image data from the specified image file
-	unsigned char* image = stbi_load(
-		filename,
-		&width,
-		&height,
-		&colorChannels,
-		0);
-
-	// if the image was successfully read from the image file
-	if (image)
-	{
-		std::cout << "Successfully loaded image:" << filename << ", width:" << width << ", height:" << height << ", channels:" << colorChannels << std::endl;
-
-		glGenTextures(1, &textureID);
-		glBindTexture(GL_TEXTURE_2D, textureID);
-
-		// set the texture wrapping parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		// set texture filtering parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		// if the loaded image is in RGB format
-		if (colorChannels == 3)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-		// if the loaded image is in RGBA format - it supports transparency
-		else if (colorChannels == 4)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
-		else
+ *  This method is used for resolving the locations of all the
+ *  uniforms that are set while rendering, once per loaded
+ *  shader program, so no names are looked up per draw.
+ ***********************************************************/
+void SceneManager::LoadUniformLocations()
+{
+	m_uniforms.model = m_pUniformCache->GetLocation(g_ModelName);
+	m_uniforms.normalMatrix = m_pUniformCache->GetLocation(g_NormalMatrixName);
+	m_uniforms.objectColor = m_pUniformCache->GetLocation(g_ColorValueName);
+	m_uniforms.objectTextures = m_pUniformCache->GetLocation(g_TextureValueName);
+	m_uniforms.textureSlot = m_pUniformCache->GetLocation(g_TextureSlotName);
+	m_uniforms.useLocalLights = m_pUniformCache->GetLocation(g_UseLocalLightsName);
+	m_uniforms.useInstancing = m_pUniformCache->GetLocation(g_UseInstancingName);
+	m_uniforms.useStaticGeometry = m_pUniformCache->GetLocation(g_UseStaticGeometryName);
+	m_uniforms.materialIndex = m_pUniformCache->GetLocation(g_MaterialIndexName);
+	m_uniforms.UVscale = m_pUniformCache->GetLocation(g_UVScaleName);
+
+	m_uniformProgram = m_pUniformCache->GetProgram();
+
+	// without bindless textures, texture slot i samples texture unit i
+	if (m_uniforms.objectTextures >= 0)
+	{
+		int textureUnits[TextureResidency::MAX_BOUND_TEXTURES];
+
+		for (int i = 0; i < TextureResidency::MAX_BOUND_TEXTURES; i++)
+		{
+			textureUnits[i] = i;
+		}
+		m_pUniformCache->SetIntArrayValue(m_uniforms.objectTextures, textureUnits, TextureResidency::MAX_BOUND_TEXTURES);
+	}
+
+	// the previously applied values belong to the old program
+	m_appliedState.bValid = false;
+}
+
+/***********************************************************
+ *  UseVariant()
+ *
+ *  This method is used for binding the program of a shader
+ *  variant.  Every program keeps its own uniform values, so
+ *  the uniform locations and applied state of the program
+ *  that is left are saved, and the ones of the new program
+ *  are restored.  A variant is built the first time it is
+ *  used and then gets the uniforms that rarely change.
+ ***********************************************************/
+bool SceneManager::UseVariant(int variant)
+{
+	if (variant == m_currentVariant)
+	{
+		return(true);
+	}
+
+	if ((NULL == m_pShaderVariants) || !m_pShaderVariants->Build(variant))
+	{
+		return(false);
+	}
+
+	if (m_currentVariant >= 0)
+	{
+		m_variantStates[m_currentVariant].uniforms = m_uniforms;
+		m_variantStates[m_currentVariant].appliedState = m_appliedState;
+	}
+
+	GLuint program = m_pShaderVariants->GetProgram(variant);
+	VARIANT_STATE& state = m_variantStates[variant];
+
+	glUseProgram(program);
+	m_pUniformCache = m_pShaderVariants->GetUniformCache(variant);
+	m_currentVariant = variant;
+	FrameProfiler::AddCount(FrameProfiler::COUNTER_PROGRAM_SWITCHES);
+
+	if (state.program != program)
+	{
+		if (NULL != m_pFrameUniforms)
 		{
-			std::cout << "Not implemented to handle image with " << colorChannels << " channels" << std::endl;
-			stbi_image_free(image);
-			return false;
+			m_pFrameUniforms->BindProgram(program);
 		}
+		LoadUniformLocations();
+		m_pUniformCache->SetBoolValue(m_uniforms.useLocalLights, m_bUseLocalLights);
+		state.program = program;
+	}
+	else
+	{
+		m_uniforms = state.uniforms;
+		m_appliedState = state.appliedState;
+		m_uniformProgram = program;
+	}
+
+	// the cache skips these when the program already holds them
+	m_pUniformCache->SetBoolValue(m_uniforms.useInstancing, m_bDrawInstanced);
+	m_pUniformCache->SetBoolValue(m_uniforms.useStaticGeometry, m_bDrawStaticGeometry);
+
+	return(true);
+}
+
+/***********************************************************
+ *  GetVariant()
+ *
+ *  This method is used for getting the shader variant of an
+ *  object.  The texture comes from the object, the lighting
+ *  is the same for the whole scene.
+ ***********************************************************/
+int SceneManager::GetVariant(bool bTextured)
+{
+	int variant = 0;
+
+	if (bTextured == true)
+	{
+		variant |= ShaderVariants::VARIANT_TEXTURE;
+	}
+	if (m_bUseLighting == true)
+	{
+		variant |= ShaderVariants::VARIANT_LIGHTING;
+	}
+
+	return(variant);
+}
+
+/***********************************************************
+ *  SetGeometryMode()
+ *
+ *  This method is used for telling the shaders whether the
+ *  model matrices come from the instance data, the baked
+ *  static geometry or the model uniform.  The bound variant
+ *  is set now, the others when they are next bound.
+ ***********************************************************/
+void SceneManager::SetGeometryMode(bool bInstanced, bool bStaticGeometry)
+{
+	m_bDrawInstanced = bInstanced;
+	m_bDrawStaticGeometry = bStaticGeometry;
+
+	if (NULL != m_pUniformCache)
+	{
+		m_pUniformCache->SetBoolValue(m_uniforms.useInstancing, bInstanced);
+		m_pUniformCache->SetBoolValue(m_uniforms.useStaticGeometry, bStaticGeometry);
+	}
+}
+
+/***********************************************************
+ *  InvalidateAppliedState()
+ *
+ *  This method is used for making the next draw with every
+ *  variant set all of its shader state again.
+ ***********************************************************/
+void SceneManager::InvalidateAppliedState()
+{
+	for (int i = 0; i < ShaderVariants::VARIANT_COUNT; i++)
+	{
+		m_variantStates[i].appliedState.bValid = false;
+	}
+	m_appliedState.bValid = false;
+}
+
+/***********************************************************
+ *  CreateGLTexture()
+ *
+ *  This method is used for creating a texture in the next
+ *  available texture slot and queueing its image file on the
+ *  texture loader.  The texture shows a placeholder until the
+ *  image has been decoded and uploaded in the background.
+ ***********************************************************/
+bool SceneManager::CreateGLTexture(const char* filename, const char* tag)
+{
+	uint32_t tagHash = TagHash(tag);
 
-		// generate the texture mipmaps for mapping textures to lower resolutions
-		glGenerateMipmap(GL_TEXTURE_2D);
+	// only bindless textures lift the limit of bound texture units
+	if ((int)m_textureIDs.size() >= m_textureResidency.GetCapacity())
+	{
+		std::cout << "No free texture slot for image:" << filename << std::endl;
+		return false;
+	}
 
-		// free the image data from local memory
-		stbi_image_free(image);
-		glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
+	// the tag handle must identify exactly one texture
+	if (FindTextureSlot(tagHash) >= 0)
+	{
+		std::cout << "Texture tag " << tag << " is already in use, could not load image:" << filename << std::endl;
+		return false;
+	}
 
-		// register the loaded texture and associate it with the special tag string
-		m_textureIDs[m_loadedTextures].ID = textureID;
-		m_textureIDs[m_loadedTextures].tag = tag;
-		m_loadedTextures++;
+	// register the texture and associate it with the special tag string
+	TEXTURE_INFO texture;
+	texture.tag = tag;
+	texture.tagHash = tagHash;
 
-		return true;
+	// baked textures are streamed, their coarse levels are uploaded right away
+	texture.streamIndex = m_textureStreamer.Request(filename);
+	if (texture.streamIndex >= 0)
+	{
+		texture.ID = m_textureStreamer.GetTexture(texture.streamIndex);
+	}
+	else
+	{
+		texture.ID = m_textureLoader->Request(filename);
 	}
+	m_textureIDs.push_back(texture);
 
-	std::cout << "Could not load image:" << filename << std::endl;
+	m_textureResidency.AddTexture(texture.ID, texture.streamIndex >= 0);
 
-	// Error loading the image
-	return false;
+	return true;
 }
 
 /***********************************************************
  *  BindGLTextures()
  *
- *  This method is used for binding the loaded textures to
- *  OpenGL texture memory slots.  There are up to 16 slots.
+ *  This method is used for making the loaded textures
+ *  reachable by the shaders through their texture slots,
+ *  either as resident bindless handles or bound to the
+ *  texture unit of the same number.
  ***********************************************************/
 void SceneManager::BindGLTextures()
 {
-	for (int i = 0; i < m_loadedTextures; i++)
+	m_textureResidency.Bind();
+}
+
+/***********************************************************
+ *  UpdateGLTextures()
+ *
+ *  This method is used for advancing the texture loader and
+ *  the texture streamer, and handing every texture that got
+ *  its final image or new mip levels to the texture residency.
+ *  The residency also deletes the textures the streamer
+ *  replaced, once the GPU no longer reads them.
+ *  The textures are bound again after that, since the uploads
+ *  change the texture bindings.
+ ***********************************************************/
+void SceneManager::UpdateGLTextures()
+{
+	std::vector<GLuint>& settledTextures = m_settledTextures;
+	std::vector<TextureStreamer::TEXTURE_CHANGE>& streamedTextures = m_streamedTextures;
+
+	settledTextures.clear();
+	streamedTextures.clear();
+	m_textureResidency.FreeRetiredTextures();
+	m_textureLoader->Update(settledTextures);
+	m_textureStreamer.Update(streamedTextures);
+	if (settledTextures.empty() && streamedTextures.empty())
+	{
+		return;
+	}
+
+	for (int i = 0; i < settledTextures.size(); i++)
+	{
+		m_textureResidency.SetTextureReady(settledTextures[i]);
+	}
+
+	// the streamer replaces the whole texture when its levels change
+	for (int i = 0; i < streamedTextures.size(); i++)
+	{
+		const TextureStreamer::TEXTURE_CHANGE& change = streamedTextures[i];
+
+		for (int slot = 0; slot < m_textureIDs.size(); slot++)
+		{
+			if (m_textureIDs[slot].streamIndex == change.index)
+			{
+				m_textureIDs[slot].ID = change.newTexture;
+				m_textureResidency.ReplaceTexture(slot, change.newTexture);
+			}
+		}
+		m_textureResidency.DeleteTexture(change.oldTexture);
+	}
+	BindGLTextures();
+}
+
+/***********************************************************
+ *  ComputeProjectedSize()
+ *
+ *  This method is used for estimating how many pixels across
+ *  a bounding sphere shows up in this frame, from the
+ *  distance of its nearest point to the camera.
+ ***********************************************************/
+float SceneManager::ComputeProjectedSize(const glm::vec4& bounds)
+{
+	glm::vec3 viewPosition = glm::vec3(m_pFrameUniforms->GetFrameData().viewPosition);
+
+	// the nearest point of the sphere, the camera may be inside of it
+	float distance = glm::length(glm::vec3(bounds) - viewPosition) - bounds.w;
+	distance = std::max(distance, 0.1f);
+
+	return(2.0f * bounds.w * m_pixelsPerUnit / distance);
+}
+
+/***********************************************************
+ *  RequestTextureDetail()
+ *
+ *  This method is used for estimating how many pixels one
+ *  repeat of its texture covers for every visible textured
+ *  object, from the projected size of its bounding sphere,
+ *  and passing that to the texture streamer.
+ ***********************************************************/
+void SceneManager::RequestTextureDetail()
+{
+	if (NULL == m_pFrameUniforms)
+	{
+		return;
+	}
+
+	m_textureStreamer.BeginFrame();
+	for (int i = 0; i < m_drawList.size(); i++)
+	{
+		const DRAW_ITEM& item = m_drawList[i];
+
+		if ((m_visibleItems[i] == 0) || (item.textureSlot < 0) ||
+			(m_textureIDs[item.textureSlot].streamIndex < 0))
+		{
+			continue;
+		}
+
+		float pixels = ComputeProjectedSize(item.bounds);
+		float repeats = std::max(std::max(item.uvScale.x, item.uvScale.y), 1.0f);
+
+		m_textureStreamer.RequestScreenSize(m_textureIDs[item.textureSlot].streamIndex, pixels / repeats);
+	}
+}
+
+/***********************************************************
+ *  SelectMeshLods()
+ *
+ *  This method is used for picking the detail level of every
+ *  visible curved object from its projected size, for the
+ *  static geometry and the instanced batches.  Culled objects
+ *  keep the level they had, so they do not pop when they
+ *  come back into view.  The flat shapes stay at the finest.
+ ***********************************************************/
+void SceneManager::SelectMeshLods()
+{
+	if (NULL == m_pFrameUniforms)
 	{
-		// bind textures on corresponding texture units
-		glActiveTexture(GL_TEXTURE0 + i);
-		glBindTexture(GL_TEXTURE_2D, m_textureIDs[i].ID);
+		return;
 	}
+
+	m_jobSystem.ParallelFor((int)m_itemLods.size(), g_JobGrainItems,
+		[this](int begin, int end)
+		{
+			for (int i = begin; i < end; i++)
+			{
+				if ((m_visibleItems[i] != 0) && (g_MeshLodCounts[m_drawList[i].mesh] > 1))
+				{
+					m_itemLods[i] = SelectMeshLod(m_itemLods[i], ComputeProjectedSize(m_drawList[i].bounds), m_lodHysteresis);
+				}
+			}
+		});
 }
 
 /***********************************************************
@@ -159,53 +525,50 @@ void SceneManager::BindGLTextures()
  ***********************************************************/
 void SceneManager::DestroyGLTextures()
 {
-	for (int i = 0; i < m_loadedTextures; i++)
+	// the handles must be released before their textures
+	m_textureResidency.Release();
+	m_textureStreamer.Release();
+
+	for (int i = 0; i < m_textureIDs.size(); i++)
 	{
 		glDeleteTextures(1, &m_textureIDs[i].ID);
 	}
+	m_textureIDs.clear();
 }
 
 /***********************************************************
  *  FindTextureID()
  *
  *  This method is used for getting an ID for the previously
- *  loaded texture bitmap associated with the passed in tag.
+ *  loaded texture bitmap associated with the passed in tag hash.
  ***********************************************************/
-int SceneManager::FindTextureID(std::string tag)
+int SceneManager::FindTextureID(uint32_t tagHash)
 {
-	int textureID = -1;
-	int index = 0;
-	bool bFound = false;
+	int textureSlot = FindTextureSlot(tagHash);
 
-	while ((index < m_loadedTextures) && (bFound == false))
+	if (textureSlot < 0)
 	{
-		if (m_textureIDs[index].tag.compare(tag) == 0)
-		{
-			textureID = m_textureIDs[index].ID;
-			bFound = true;
-		}
-		else
-			index++;
+		return(-1);
 	}
 
-	return(textureID);
+	return(m_textureIDs[textureSlot].ID);
 }
 
 /***********************************************************
  *  FindTextureSlot()
  *
  *  This method is used for getting a slot index for the previously
- *  loaded texture bitmap associated with the passed in tag.
+ *  loaded texture bitmap associated with the passed in tag hash.
  ***********************************************************/
-int SceneManager::FindTextureSlot(std::string tag)
+int SceneManager::FindTextureSlot(uint32_t tagHash)
 {
 	int textureSlot = -1;
 	int index = 0;
 	bool bFound = false;
 
-	while ((index < m_loadedTextures) && (bFound == false))
+	while ((index < m_textureIDs.size()) && (bFound == false))
 	{
-		if (m_textureIDs[index].tag.compare(tag) == 0)
+		if (m_textureIDs[index].tagHash == tagHash)
 		{
 			textureSlot = index;
 			bFound = true;
@@ -221,35 +584,94 @@ int SceneManager::FindTextureSlot(std::string tag)
  *  FindMaterial()
  *
  *  This method is used for getting a material from the previously
- *  defined materials list that is associated with the passed in tag.
+ *  defined materials list that is associated with the passed in
+ *  tag hash.  It returns false when no such material is defined.
  ***********************************************************/
-bool SceneManager::FindMaterial(std::string tag, OBJECT_MATERIAL& material)
+bool SceneManager::FindMaterial(uint32_t tagHash, OBJECT_MATERIAL& material)
 {
-	if (m_objectMaterials.size() == 0)
+	int materialIndex = FindMaterialIndex(tagHash);
+
+	if (materialIndex < 0)
 	{
 		return(false);
 	}
 
+	material = m_objectMaterials[materialIndex];
+
+	return(true);
+}
+
+/***********************************************************
+ *  FindMaterialIndex()
+ *
+ *  This method is used for getting the index of a material in
+ *  the previously defined materials list that is associated
+ *  with the passed in tag hash.
+ ***********************************************************/
+int SceneManager::FindMaterialIndex(uint32_t tagHash)
+{
+	int materialIndex = -1;
 	int index = 0;
 	bool bFound = false;
+
 	while ((index < m_objectMaterials.size()) && (bFound == false))
 	{
-		if (m_objectMaterials[index].tag.compare(tag) == 0)
+		if (m_objectMaterials[index].tagHash == tagHash)
 		{
+			materialIndex = index;
 			bFound = true;
-			material.ambientColor = m_objectMaterials[index].ambientColor;
-			material.ambientStrength = m_objectMaterials[index].ambientStrength;
-			material.diffuseColor = m_objectMaterials[index].diffuseColor;
-			material.specularColor = m_objectMaterials[index].specularColor;
-			material.shininess = m_objectMaterials[index].shininess;
 		}
 		else
-		{
 			index++;
+	}
+
+	return(materialIndex);
+}
+
+/***********************************************************
+ *  HashMaterialTags()
+ *
+ *  This method is used for hashing the tags of all the defined
+ *  materials once, so materials can be found by tag hash.  Two
+ *  tags with the same hash are reported, and only the first of
+ *  them can be found.
+ ***********************************************************/
+void SceneManager::HashMaterialTags()
+{
+	for (int i = 0; i < m_objectMaterials.size(); i++)
+	{
+		m_objectMaterials[i].tagHash = TagHash(m_objectMaterials[i].tag.c_str());
+
+		for (int j = 0; j < i; j++)
+		{
+			if (m_objectMaterials[j].tagHash == m_objectMaterials[i].tagHash)
+			{
+				std::cout << "Material tag " << m_objectMaterials[i].tag
+					<< " has the same hash as " << m_objectMaterials[j].tag << std::endl;
+			}
 		}
 	}
+}
 
-	return(true);
+/***********************************************************
+ *  ComputeTransformations()
+ *
+ *  This method is used for calculating the model matrix
+ *  from the passed in transformation values, composed
+ *  directly instead of multiplied out of one matrix per
+ *  step.
+ ***********************************************************/
+glm::mat4 SceneManager::ComputeTransformations(
+	glm::vec3 scaleXYZ,
+	float XrotationDegrees,
+	float YrotationDegrees,
+	float ZrotationDegrees,
+	glm::vec3 positionXYZ)
+{
+	return(TransformBatch::ComposeTransform(
+		scaleXYZ,
+		glm::vec3(XrotationDegrees, YrotationDegrees, ZrotationDegrees),
+		positionXYZ));
 }
 
 /***********************************************************
@@ -265,28 +687,41 @@ void SceneManager::SetTransformations(
 	float ZrotationDegrees,
 	glm::vec3 positionXYZ)
 {
-	// variables for this method
-	glm::mat4 modelView;
-	glm::mat4 scale;
-	glm::mat4 rotationX;
-	glm::mat4 rotationY;
-	glm::mat4 rotationZ;
-	glm::mat4 translation;
-
-	// set the scale value in the transform buffer
-	scale = glm::scale(scaleXYZ);
-	// set the rotation values in the transform buffer
-	rotationX = glm::rotate(glm::radians(XrotationDegrees), glm::vec3(1.0f, 0.0f, 0.0f));
-	rotationY = glm::rotate(glm::radians(YrotationDegrees), glm::vec3(0.0f, 1.0f, 0.0f));
-	rotationZ = glm::rotate(glm::radians(ZrotationDegrees), glm::vec3(0.0f, 0.0f, 1.0f));
-	// set the translation value in the transform buffer
-	translation = glm::translate(positionXYZ);
+	SetTransformations(ComputeTransformations(
+		scaleXYZ,
+		XrotationDegrees,
+		YrotationDegrees,
+		ZrotationDegrees,
+		positionXYZ));
+}
 
-	modelView = translation * rotationZ * rotationY * rotationX * scale;
+/***********************************************************
+ *  SetTransformations()
+ *
+ *  This method is used for setting the transform buffer
+ *  using the passed in, already calculated model matrix.
+ ***********************************************************/
+void SceneManager::SetTransformations(
+	const glm::mat4& modelView)
+{
+	SetTransformations(modelView, ComputeNormalMatrix(modelView));
+}
 
-	if (NULL != m_pShaderManager)
+/***********************************************************
+ *  SetTransformations()
+ *
+ *  This method is used for setting the transform buffer
+ *  using the passed in, already calculated model and normal
+ *  matrices.
+ ***********************************************************/
+void SceneManager::SetTransformations(
+	const glm::mat4& modelView,
+	const glm::mat3& normalMatrix)
+{
+	if (NULL != m_pUniformCache)
 	{
-		m_pShaderManager->setMat4Value(g_ModelName, modelView);
+		m_pUniformCache->SetMat4Value(m_uniforms.model, modelView);
+		m_pUniformCache->SetMat3Value(m_uniforms.normalMatrix, normalMatrix);
 	}
 }
 
@@ -310,10 +745,9 @@ void SceneManager::SetShaderColor(
 	currentColor.b = blueColorValue;
 	currentColor.a = alphaValue;
 
-	if (NULL != m_pShaderManager)
+	if (UseVariant(GetVariant(false)))
 	{
-		m_pShaderManager->setIntValue(g_UseTextureName, false);
-		m_pShaderManager->setVec4Value(g_ColorValueName, currentColor);
+		m_pUniformCache->SetVec4Value(m_uniforms.objectColor, currentColor);
 	}
 }
 
@@ -324,15 +758,28 @@ void SceneManager::SetShaderColor(
  *  associated with the passed in ID into the shader.
  ***********************************************************/
 void SceneManager::SetShaderTexture(
-	std::string textureTag)
+	const char* textureTag)
 {
-	if (NULL != m_pShaderManager)
+	if (UseVariant(GetVariant(true)))
 	{
-		m_pShaderManager->setIntValue(g_UseTextureName, true);
-
 		int textureID = -1;
-		textureID = FindTextureSlot(textureTag);
-		m_pShaderManager->setSampler2DValue(g_TextureValueName, textureID);
+		textureID = FindTextureSlot(TagHash(textureTag));
+		m_pUniformCache->SetIntValue(m_uniforms.textureSlot, textureID);
+	}
+}
+
+/***********************************************************
+ *  SetShaderTexture()
+ *
+ *  This method is used for setting the texture data in the
+ *  passed in, already resolved texture slot into the shader.
+ ***********************************************************/
+void SceneManager::SetShaderTexture(
+	int textureSlot)
+{
+	if (UseVariant(GetVariant(true)))
+	{
+		m_pUniformCache->SetIntValue(m_uniforms.textureSlot, textureSlot);
 	}
 }
 
@@ -344,556 +791,1359 @@ void SceneManager::SetShaderTexture(
  ***********************************************************/
 void SceneManager::SetTextureUVScale(float u, float v)
 {
-	if (NULL != m_pShaderManager)
+	if (NULL != m_pUniformCache)
 	{
-		m_pShaderManager->setVec2Value("UVscale", glm::vec2(u, v));
+		m_pUniformCache->SetVec2Value(m_uniforms.UVscale, glm::vec2(u, v));
 	}
 }
 
 /***********************************************************
  *  SetShaderMaterial()
  *
- *  This method is used for passing the material values
- *  into the shader.
+ *  This method is used for selecting the material associated
+ *  with the passed in tag in the shader.
  ***********************************************************/
 void SceneManager::SetShaderMaterial(
-	std::string materialTag)
+	const char* materialTag)
 {
-	if (m_objectMaterials.size() > 0)
-	{
-		OBJECT_MATERIAL material;
-		bool bReturn = false;
-
-		bReturn = FindMaterial(materialTag, material);
-		if (bReturn == true)
-		{
-			m_pShaderManager->setVec3Value("material.ambientColor", material.ambientColor);
-			m_pShaderManager->setFloatValue("material.ambientStrength", material.ambientStrength);
-			m_pShaderManager->setVec3Value("material.diffuseColor", material.diffuseColor);
-			m_pShaderManager->setVec3Value("material.specularColor", material.specularColor);
-			m_pShaderManager->setFloatValue("material.shininess", material.shininess);
-		}
-	}
+	SetShaderMaterial(FindMaterialIndex(TagHash(materialTag)));
 }
 
-/**************************************************************/
-/*** STUDENTS CAN MODIFY the code in the methods BELOW for  ***/
-/*** preparing and rendering their own 3D replicated scenes.***/
-/*** Please refer to the code in the OpenGL sample project  ***/
-/*** for assistance.                                        ***/
-/**************************************************************/
-
 /***********************************************************
- *  LoadSceneTextures()
+ *  SetShaderMaterial()
  *
- *  This method is used for preparing the 3D scene by loading
- *  the shapes, textures in memory to support the 3D scene
- *  rendering
+ *  This method is used for selecting the material at the
+ *  passed in, already resolved index in the shader.  All the
+ *  material values already live in the material uniform
+ *  buffer, so only the index needs to be passed.
  ***********************************************************/
-void SceneManager::LoadSceneTextures()
+void SceneManager::SetShaderMaterial(
+	int materialIndex)
 {
-	bool bReturn = false;
-	//Create textures by loading texture jpg from folder for all necessary
-	bReturn = CreateGLTexture("textures/Wood-Floor_texture2.jpg", "floor");
-	bReturn = CreateGLTexture("textures/Monitor-Screen_texture.jpg", "screen");
-	bReturn = CreateGLTexture("textures/Desk_texture2.jpg", "desk");
-	bReturn = CreateGLTexture("textures/Keyboard_texture.jpg", "keyboard");
-	bReturn = CreateGLTexture("textures/glass_texture.jpg", "glass");
-
-	// after the texture image data is loaded into memory, the
-	// loaded textures need to be bound to texture slots - there
-	// are a total of 16 available slots for scene textures
-	BindGLTextures();
+	if ((NULL != m_pUniformCache) &&
+		(materialIndex >= 0) && (materialIndex < m_objectMaterials.size()))
+	{
+		m_pUniformCache->SetIntValue(m_uniforms.materialIndex, materialIndex);
+	}
 }
 
-void SceneManager::LoadSceneMaterials()
+/***********************************************************
+ *  UploadSceneMaterials()
+ *
+ *  This method is used for copying all of the defined object
+ *  materials into the material uniform buffer that the
+ *  fragment shader indexes by material index.
+ ***********************************************************/
+void SceneManager::UploadSceneMaterials()
 {
+	std::vector<MATERIAL_BLOCK_ENTRY> entries(g_MaxMaterials);
 
-	// Floor Material
-	OBJECT_MATERIAL floorMaterial;
-	floorMaterial.tag = "floorMaterial";
-	floorMaterial.ambientColor = glm::vec3(0.2f, 0.2f, 0.2f);
-	floorMaterial.ambientStrength = 0.5f;
-	floorMaterial.diffuseColor = glm::vec3(0.8f, 0.8f, 0.8f);
-	floorMaterial.specularColor = glm::vec3(1.0f, 1.0f, 1.0f);
-	floorMaterial.shininess = 32.0f; // Increased shininess
-	m_objectMaterials.push_back(floorMaterial);
-
-	// Desk Material
-	OBJECT_MATERIAL deskMaterial;
-	deskMaterial.tag = "deskMaterial";
-	deskMaterial.ambientColor = glm::vec3(0.3f, 0.3f, 0.3f);
-	deskMaterial.ambientStrength = 0.5f;
-	deskMaterial.diffuseColor = glm::vec3(0.6f, 0.3f, 0.3f);
-	deskMaterial.specularColor = glm::vec3(0.5f, 0.5f, 0.5f);
-	deskMaterial.shininess = 16.0f; // Moderately shiny
-	m_objectMaterials.push_back(deskMaterial);
-
-	// Keyboard Material
-	OBJECT_MATERIAL keyboardMaterial;
-	keyboardMaterial.tag = "keyboardMaterial";
-	keyboardMaterial.ambientColor = glm::vec3(0.2f, 0.2f, 0.2f);
-	keyboardMaterial.ambientStrength = 0.5f;
-	keyboardMaterial.diffuseColor = glm::vec3(0.7f, 0.7f, 0.7f);
-	keyboardMaterial.specularColor = glm::vec3(1.0f, 1.0f, 1.0f);
-	keyboardMaterial.shininess = 32.0f; 
-	m_objectMaterials.push_back(keyboardMaterial);
-
-	// Monitor Material
-	OBJECT_MATERIAL monitorMaterial;
-	monitorMaterial.tag = "monitorMaterial";
-	monitorMaterial.ambientColor = glm::vec3(0.2f, 0.2f, 0.2f);
-	monitorMaterial.ambientStrength = 0.5f;
-	monitorMaterial.diffuseColor = glm::vec3(0.9f, 0.9f, 0.9f);
-	monitorMaterial.specularColor = glm::vec3(1.0f, 1.0f, 1.0f);
-	monitorMaterial.shininess = 128.0f; // Highly shiny for a reflective look
-	m_objectMaterials.push_back(monitorMaterial);
-
-	// Screen Material (Glass-like reflective surface)
-	OBJECT_MATERIAL screenMaterial;
-	screenMaterial.tag = "screenMaterial";
-	screenMaterial.ambientColor = glm::vec3(0.1f, 0.1f, 0.1f);
-	screenMaterial.ambientStrength = 0.5f;
-	screenMaterial.diffuseColor = glm::vec3(0.5f, 0.5f, 0.5f);
-	screenMaterial.specularColor = glm::vec3(1.0f, 1.0f, 1.0f);
-	screenMaterial.shininess = 256.0f; // Very shiny for strong reflections
-	m_objectMaterials.push_back(screenMaterial);
-}
+	if (m_objectMaterials.size() > g_MaxMaterials)
+	{
+		std::cout << "Only the first " << g_MaxMaterials << " of " << m_objectMaterials.size()
+			<< " materials fit in the material buffer" << std::endl;
+	}
+
+	for (int i = 0; (i < m_objectMaterials.size()) && (i < g_MaxMaterials); i++)
+	{
+		const OBJECT_MATERIAL& material = m_objectMaterials[i];
+
+		entries[i].ambientColor = material.ambientColor;
+		entries[i].ambientStrength = material.ambientStrength;
+		entries[i].diffuseColor = material.diffuseColor;
+		entries[i].padding = 0.0f;
+		entries[i].specularColor = material.specularColor;
+		entries[i].shininess = material.shininess;
+	}
+
+	if (m_materialBuffer == 0)
+	{
+		glGenBuffers(1, &m_materialBuffer);
+	}
 
+	glBindBuffer(GL_UNIFORM_BUFFER, m_materialBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, entries.size() * sizeof(MATERIAL_BLOCK_ENTRY), entries.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	// the fragment shader block is declared with this binding point
+	glBindBufferBase(GL_UNIFORM_BUFFER, g_MaterialBlockBinding, m_materialBuffer);
+}
 
 /***********************************************************
- *  PrepareScene()
+ *  AddDrawItem()
  *
- *  This method is used for preparing the 3D scene by loading
- *  the shapes, textures in memory to support the 3D scene
- *  rendering
+ *  This method is used for adding a textured object to the
+ *  retained draw list.  The material and texture slot are
+ *  resolved once here instead of every frame, from the passed
+ *  in tag hashes, and the object gets a scene graph node in
+ *  the passed in group, or at the root for -1.
  ***********************************************************/
-void SceneManager::PrepareScene()
+void SceneManager::AddDrawItem(
+	MESH_ID mesh,
+	glm::vec3 scaleXYZ,
+	float XrotationDegrees,
+	float YrotationDegrees,
+	float ZrotationDegrees,
+	glm::vec3 positionXYZ,
+	uint32_t materialTag,
+	uint32_t textureTag,
+	float u,
+	float v,
+	int groupNode)
 {
-	
-	// load the materials for the 3D scene
-	LoadSceneMaterials();
-	
-	// load the textures for the 3D scene
-	LoadSceneTextures();
-
-	// Setup Scene Lights
-	SetupSceneLights();
+	DRAW_ITEM item;
+
+	// the matrix and bounds are filled in by the next transform update
+	item.node = AddObjectNode(
+		groupNode,
+		scaleXYZ,
+		glm::vec3(XrotationDegrees, YrotationDegrees, ZrotationDegrees),
+		positionXYZ);
+	item.model = glm::mat4(1.0f);
+	item.normalMatrix = glm::mat3(1.0f);
+	item.color = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
+	item.uvScale = glm::vec2(u, v);
+	item.mesh = mesh;
+	item.materialIndex = FindMaterialIndex(materialTag);
+	item.textureSlot = FindTextureSlot(textureTag);
+	item.variant = GetVariant(item.textureSlot >= 0);
+	item.bounds = glm::vec4(0.0f);
+
+	m_nodeItems[item.node] = (int)m_drawList.size();
+	m_drawList.push_back(item);
+}
 
-	// only one instance of a particular mesh needs to be
-	// loaded in memory no matter how many times it is drawn
-	// in the rendered 3D scene
+/***********************************************************
+ *  AddDrawItem()
+ *
+ *  This method is used for adding a solid colored object to
+ *  the retained draw list.
+ ***********************************************************/
+void SceneManager::AddDrawItem(
+	MESH_ID mesh,
+	glm::vec3 scaleXYZ,
+	float XrotationDegrees,
+	float YrotationDegrees,
+	float ZrotationDegrees,
+	glm::vec3 positionXYZ,
+	uint32_t materialTag,
+	glm::vec4 color,
+	int groupNode)
+{
+	DRAW_ITEM item;
+
+	// the matrix and bounds are filled in by the next transform update
+	item.node = AddObjectNode(
+		groupNode,
+		scaleXYZ,
+		glm::vec3(XrotationDegrees, YrotationDegrees, ZrotationDegrees),
+		positionXYZ);
+	item.model = glm::mat4(1.0f);
+	item.normalMatrix = glm::mat3(1.0f);
+	item.color = color;
+	item.uvScale = glm::vec2(1.0f, 1.0f);
+	item.mesh = mesh;
+	item.materialIndex = FindMaterialIndex(materialTag);
+	item.textureSlot = -1;
+	item.variant = GetVariant(false);
+	item.bounds = glm::vec4(0.0f);
+
+	m_nodeItems[item.node] = (int)m_drawList.size();
+	m_drawList.push_back(item);
+}
 
-	m_basicMeshes->LoadPlaneMesh();
-	m_basicMeshes->LoadBoxMesh();
-	m_basicMeshes->LoadPrismMesh();
+/***********************************************************
+ *  SortDrawList()
+ *
+ *  This method is used for ordering the retained draw list by
+ *  shader state - shader variant, texture slot, mesh and then
+ *  material - so consecutive draws share as much state as
+ *  possible.  The variant comes first since a program switch
+ *  costs the most, the material last since instanced batches
+ *  read it from the instance data.  The sort is stable, so
+ *  objects with identical state keep their authored order.
+ ***********************************************************/
+void SceneManager::SortDrawList()
+{
+	std::stable_sort(m_drawList.begin(), m_drawList.end(),
+		[](const DRAW_ITEM& a, const DRAW_ITEM& b)
+		{
+			if (a.variant != b.variant)
+				return(a.variant < b.variant);
+			if (a.textureSlot != b.textureSlot)
+				return(a.textureSlot < b.textureSlot);
+			if (a.mesh != b.mesh)
+				return(a.mesh < b.mesh);
+			return(a.materialIndex < b.materialIndex);
+		});
 }
 
 /***********************************************************
- *  RenderScene()
+ *  AddObjectNode()
  *
- *  This method is used for rendering the 3D scene by
- *  transforming and drawing the basic 3D shapes
+ *  This method is used for adding the scene graph node of a
+ *  draw list object, with its transform in the batch that
+ *  composes the local matrices of the objects.
  ***********************************************************/
-void SceneManager::RenderScene()
+int SceneManager::AddObjectNode(int groupNode, const glm::vec3& scaleXYZ, const glm::vec3& rotationDegrees, const glm::vec3& positionXYZ)
 {
+	int node = m_sceneGraph.AddNode(groupNode, glm::mat4(1.0f));
 
+	if (node < 0)
+	{
+		node = m_sceneGraph.AddNode(-1, glm::mat4(1.0f));
+	}
 
-	// declare the variables for the transformations
-	glm::vec3 scaleXYZ;
-	float XrotationDegrees = 0.0f;
-	float YrotationDegrees = 0.0f;
-	float ZrotationDegrees = 0.0f;
-	glm::vec3 positionXYZ;
+	m_transformNodes.push_back(node);
+	m_transforms.AddTransform(scaleXYZ, rotationDegrees, positionXYZ);
+	m_nodeTags.push_back(0);
+	m_nodeItems.push_back(-1);
 
-	// Set up the floor plane
+	return(node);
+}
+
+/***********************************************************
+ *  UpdateTransforms()
+ *
+ *  This method is used for composing the local matrices of
+ *  the objects whose own transform changed, and then the
+ *  world matrices of the changed nodes and everything below
+ *  them.  The objects among those get their model matrix
+ *  and bounding sphere moved, their instance data is built
+ *  again on the next frame, and they are baked again into
+ *  the static geometry and the GPU culler objects.  Nothing
+ *  is done while no node changed, so a scene that stands
+ *  still costs nothing.
+ ***********************************************************/
+bool SceneManager::UpdateTransforms()
+{
+	if (m_transforms.Update(&m_jobSystem) > 0)
 	{
-		scaleXYZ = glm::vec3(50.0f, 1.0f, 50.0f);
-		XrotationDegrees = 0.0f;
-		YrotationDegrees = 0.0f;
-		ZrotationDegrees = 0.0f;
-		positionXYZ = glm::vec3(0.0f, -1.0f, 0.0f);
+		const std::vector<int>& changedTransforms = m_transforms.GetChanged();
 
-		SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-		//SetShaderColor(1.0f, 1.0f, 1.0f, 1.0f); // White color for the floor
-		SetShaderMaterial("floorMaterial");
-		SetShaderTexture("floor");
-		SetTextureUVScale(10.0, 10.0);
+		for (int n = 0; n < changedTransforms.size(); n++)
+		{
+			m_sceneGraph.SetLocalTransform(m_transformNodes[changedTransforms[n]], m_transforms.GetModel(changedTransforms[n]));
+		}
+	}
 
-		// draw the mesh with transformation values - this plane is used for the base
-		m_basicMeshes->DrawPlaneMesh();
+	if (m_sceneGraph.Update() == 0)
+	{
+		return(false);
 	}
 
-	
+	const std::vector<int>& changedNodes = m_sceneGraph.GetChanged();
 
-	// Corner piece - prism to connect the two desk surfaces
+	for (int n = 0; n < changedNodes.size(); n++)
 	{
-		scaleXYZ = glm::vec3(12.0f, 0.5f, 7.0f); // Adjust dimensions to fill the gap
-		XrotationDegrees = 0.0f;
-		YrotationDegrees = 1.8f; // Rotate to align correctly
-		ZrotationDegrees = 0.0f;
-		positionXYZ = glm::vec3(-0.8f, 0.5f, -1.5f); // Position to fill the gap
+		int itemIndex = m_nodeItems[changedNodes[n]];
 
-		SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-		//SetShaderColor(0.75f, 0.68f, 2.85f, 1.0f); // Lavender color for the desk
-		SetShaderMaterial("deskMaterial");
-		SetShaderTexture("desk");
-		SetTextureUVScale(1.0, 1.0);
+		if (itemIndex < 0)
+		{
+			continue;
+		}
 
-		// draw the mesh with transformation values 
-		m_basicMeshes->DrawPrismMesh();
+		DRAW_ITEM& item = m_drawList[itemIndex];
+
+		item.model = m_sceneGraph.GetWorld(changedNodes[n]);
+		item.normalMatrix = ComputeNormalMatrix(item.model);
+		item.bounds = ComputeBoundingSphere(item.mesh, item.model);
+		m_frustumCuller.SetSphere(itemIndex, item.bounds);
+
+		// nothing is baked yet while the scene loads
+		m_staticGeometry.UpdateMesh(itemIndex, m_staticMeshes[item.mesh], g_MeshLodCounts[item.mesh], item.model,
+			item.normalMatrix, item.uvScale, item.materialIndex, item.textureSlot, item.color);
+		m_gpuCuller.SetObjectBounds(m_staticGeometry.GetItemPiece(itemIndex), item.bounds);
 	}
 
-	
+	m_instancedVisibility.clear();
 
-	// Keyboard Base - prism to act as base for keyboard 
+	return(true);
+}
+
+/***********************************************************
+ *  FindSceneGroup()
+ *
+ *  This method is used for finding the scene graph node of a
+ *  group of the loaded scene by its tag hash.  Object nodes
+ *  have no tag, so they are never found.
+ ***********************************************************/
+int SceneManager::FindSceneGroup(uint32_t tagHash) const
+{
+	for (int node = 0; node < m_nodeTags.size(); node++)
 	{
-		scaleXYZ = glm::vec3(9.0f, 0.3f, 3.0f); // Adjust dimensions to fill the gap
-		XrotationDegrees = 0.0f;
-		YrotationDegrees = 1.8f; // Rotate to align correctly
-		ZrotationDegrees = 0.0f;
-		positionXYZ = glm::vec3(-0.8f, 1.0f, 1.5f); // Position to the corner
+		if ((m_nodeTags[node] == tagHash) && (m_nodeItems[node] < 0))
+		{
+			return(node);
+		}
+	}
 
-		SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
+	return(-1);
+}
 
-		// Apply the color for the rest of the keyboard (excluding the top face)
-		SetShaderColor(192.0f / 255.0f, 192.0f / 255.0f, 192.0f / 255.0f, 1.0f); // Silver color for the desk
-		SetShaderMaterial("keyboardMaterial");
-		m_basicMeshes->DrawBoxMesh();
+/***********************************************************
+ *  SetSceneGroupTransform()
+ *
+ *  This method is used for turning and moving a group.  Only
+ *  the group node changes, the objects inside it follow on
+ *  the next update.
+ ***********************************************************/
+void SceneManager::SetSceneGroupTransform(
+	int group,
+	float XrotationDegrees,
+	float YrotationDegrees,
+	float ZrotationDegrees,
+	glm::vec3 positionXYZ)
+{
+	if ((group < 0) || (group >= m_nodeItems.size()) || (m_nodeItems[group] >= 0))
+	{
+		return;
+	}
 
-		// Now, apply the texture only to the top face
-		glm::vec3 topFaceScale = glm::vec3(9.0f, 0.1f, 3.0f); // Set the scale for the top face
-		glm::vec3 topFacePosition = glm::vec3(-0.8f, 1.15f, 1.5f); // Slightly raise the position to cover the top face
+	m_sceneGraph.SetLocalTransform(group, TransformBatch::ComposeTransform(
+		glm::vec3(1.0f, 1.0f, 1.0f),
+		glm::vec3(XrotationDegrees, YrotationDegrees, ZrotationDegrees),
+		positionXYZ));
+}
 
-		SetTransformations(topFaceScale, XrotationDegrees, YrotationDegrees, ZrotationDegrees, topFacePosition);
-		SetShaderTexture("keyboard");
-		SetTextureUVScale(1.0, 1.0);
+/***********************************************************
+ *  BuildDrawBatches()
+ *
+ *  This method is used for splitting the sorted draw list into
+ *  runs of objects that share the same mesh and shader state,
+ *  and for handing the bounding spheres of the objects to the
+ *  frustum culler.
+ ***********************************************************/
+void SceneManager::BuildDrawBatches()
+{
+	std::vector<glm::vec4> spheres;
 
-		m_basicMeshes->DrawBoxMesh();
+	m_drawBatches.clear();
+	spheres.reserve(m_drawList.size());
+
+	for (int i = 0; i < m_drawList.size(); i++)
+	{
+		const DRAW_ITEM& item = m_drawList[i];
+
+		spheres.push_back(item.bounds);
+
+		// extend the current batch while nothing but the transform changes
+		if (m_drawBatches.size() > 0)
+		{
+			const DRAW_ITEM& first = m_drawList[m_drawBatches.back().firstItem];
+
+			// the material index is part of the instance data, so
+			// objects with different materials still share a batch
+			if ((item.mesh == first.mesh) &&
+				(item.variant == first.variant) &&
+				(item.textureSlot == first.textureSlot) &&
+				((item.textureSlot >= 0) ? (item.uvScale == first.uvScale) : (item.color == first.color)))
+			{
+				m_drawBatches.back().itemCount++;
+				continue;
+			}
+		}
+
+		DRAW_BATCH batch;
+		batch.firstItem = i;
+		batch.itemCount = 1;
+		m_drawBatches.push_back(batch);
 	}
 
+	m_frustumCuller.SetSpheres(spheres);
+
+	// the instance data is built on the first frame
+	m_instancedVisibility.clear();
+	m_visibleBatches.clear();
+}
 
-	// Desk surface part 1 - left part of the L-shape
+/***********************************************************
+ *  BuildVisibleBatches()
+ *
+ *  This method is used for packing the per-instance data of
+ *  the visible objects of every batch next to each other, so
+ *  each batch still draws one consecutive range per detail
+ *  level.  It is only called when the set of visible objects
+ *  or their levels have changed.  The batches are counted
+ *  first, so every range knows where it starts and the job
+ *  threads can fill them at once.
+ ***********************************************************/
+void SceneManager::BuildVisibleBatches()
+{
+	int rangeCount = (int)m_drawBatches.size() * MESH_LOD_COUNT;
+	int* pVisibleCounts = m_pFrameArena->AllocateArray<int>(rangeCount, 0);
+	int* pFirstInstances = m_pFrameArena->AllocateArray<int>(rangeCount, 0);
+	int instanceCount = 0;
+
+	// count the visible objects of every batch at every level
+	m_jobSystem.ParallelFor((int)m_drawBatches.size(), g_JobGrainBatches,
+		[this, pVisibleCounts](int begin, int end)
+		{
+			for (int b = begin; b < end; b++)
+			{
+				const DRAW_BATCH& batch = m_drawBatches[b];
+
+				for (int i = batch.firstItem; i < batch.firstItem + batch.itemCount; i++)
+				{
+					if (m_visibleItems[i] != 0)
+					{
+						pVisibleCounts[b * MESH_LOD_COUNT + m_itemLods[i]]++;
+					}
+				}
+			}
+		});
+
+	// give every batch its range of the instance data per level
+	m_visibleBatches.clear();
+	for (int range = 0; range < rangeCount; range++)
 	{
-		scaleXYZ = glm::vec3(15.0f, 0.5f, 8.8f); // Reduced dimensions
-		XrotationDegrees = 0.0f;
-		YrotationDegrees = 45.0f;
-		ZrotationDegrees = 0.0f;
-		positionXYZ = glm::vec3(-8.8f, 0.5f, 4.0f); // Position adjusted to align with the other box
+		pFirstInstances[range] = instanceCount;
+		if (pVisibleCounts[range] > 0)
+		{
+			VISIBLE_BATCH visibleBatch;
 
-		SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-		//SetShaderColor(0.75f, 0.68f, 2.85f, 1.0f); // Lavender color for the desk
-		SetShaderMaterial("deskMaterial");
-		SetShaderTexture("desk");
-		SetTextureUVScale(1.0, 1.0);
+			visibleBatch.batch = range / MESH_LOD_COUNT;
+			visibleBatch.lod = range % MESH_LOD_COUNT;
+			visibleBatch.firstInstance = instanceCount;
+			visibleBatch.instanceCount = pVisibleCounts[range];
+			m_visibleBatches.push_back(visibleBatch);
+		}
+		instanceCount += pVisibleCounts[range];
+	}
 
-		// draw the mesh with transformation values 
-		m_basicMeshes->DrawBoxMesh();
+	// the ranges do not overlap, so the batches are written into
+	// the mapped instance buffer in parallel
+	InstancedMeshes::INSTANCE_DATA* pInstances = m_instancedMeshes->MapInstanceData(instanceCount);
+
+	if (NULL != pInstances)
+	{
+		m_jobSystem.ParallelFor((int)m_drawBatches.size(), g_JobGrainBatches,
+			[this, pFirstInstances, pInstances](int begin, int end)
+			{
+				for (int b = begin; b < end; b++)
+				{
+					const DRAW_BATCH& batch = m_drawBatches[b];
+					InstancedMeshes::INSTANCE_DATA* pLodInstances[MESH_LOD_COUNT];
+
+					for (int lod = 0; lod < MESH_LOD_COUNT; lod++)
+					{
+						pLodInstances[lod] = pInstances + pFirstInstances[b * MESH_LOD_COUNT + lod];
+					}
+
+					for (int i = batch.firstItem; i < batch.firstItem + batch.itemCount; i++)
+					{
+						if (m_visibleItems[i] == 0)
+						{
+							continue;
+						}
+
+						const DRAW_ITEM& item = m_drawList[i];
+						InstancedMeshes::INSTANCE_DATA instance;
+
+						instance.model = item.model;
+						instance.normalMatrix = item.normalMatrix;
+						instance.materialIndex = item.materialIndex;
+						instance.textureSlot = item.textureSlot;
+						*pLodInstances[m_itemLods[i]]++ = instance;
+					}
+				}
+			});
 	}
 
-	// Desk surface part 2 - right part of the L-shape, rotated -45 degrees
+	// the instance data could not be written, so nothing is drawn
+	// instanced and it is built again on the next frame
+	if ((instanceCount > 0) && ((NULL == pInstances) || !m_instancedMeshes->UnmapInstanceData()))
 	{
-		scaleXYZ = glm::vec3(15.0f, 0.5f, 8.8f); // Reduced dimensions
-		XrotationDegrees = 0.0f;
-		YrotationDegrees = -45.0f; // Rotate -45 degrees to form L-shape
-		ZrotationDegrees = 0.0f;
-		positionXYZ = glm::vec3(7.0f, 0.5f, 4.0f); // Position adjusted to align with the other box
+		m_visibleBatches.clear();
+		m_instancedVisibility.clear();
+		return;
+	}
 
-		SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-		//SetShaderColor(0.75f, 0.68f, 2.85f, 1.0f); // Lavender color for the desk
-		SetShaderMaterial("deskMaterial");
-		SetShaderTexture("desk");
-		SetTextureUVScale(1.0, 1.0);
+	m_instancedVisibility = m_visibleItems;
+	m_instancedLods = m_itemLods;
+}
 
-		// draw the mesh with transformation values 
-		m_basicMeshes->DrawBoxMesh();
+/***********************************************************
+ *  BuildStaticGeometry()
+ *
+ *  This method is used for baking every draw list object into
+ *  the static geometry.  The objects of the scene rarely move
+ *  once they are placed, so their model matrices are applied
+ *  to the mesh vertices here instead of in every frame.  The
+ *  meshes are kept for baking the objects that do move again.
+ ***********************************************************/
+void SceneManager::BuildStaticGeometry()
+{
+	MeshGeometry::BuildPlaneMesh(m_staticMeshes[MESH_PLANE][0]);
+	MeshGeometry::BuildBoxMesh(m_staticMeshes[MESH_BOX][0]);
+	MeshGeometry::BuildPrismMesh(m_staticMeshes[MESH_PRISM][0]);
+	for (int lod = 0; lod < MESH_LOD_COUNT; lod++)
+	{
+		MeshGeometry::BuildCylinderMesh(m_staticMeshes[MESH_CYLINDER][lod], MESH_LOD_SEGMENTS[lod]);
+		MeshGeometry::BuildSphereMesh(m_staticMeshes[MESH_SPHERE][lod], MESH_LOD_SEGMENTS[lod]);
+		MeshGeometry::BuildTorusMesh(m_staticMeshes[MESH_TORUS][lod], MESH_LOD_SEGMENTS[lod]);
 	}
 
-	// Upper-Corner piece - prism to connect the two upper-desk surfaces
+	for (int i = 0; i < m_drawList.size(); i++)
 	{
-		scaleXYZ = glm::vec3(10.0f, 0.5f, 2.5f); // Adjust dimensions to fill the gap
-		XrotationDegrees = 0.0f;
-		YrotationDegrees = 1.8f; // Rotate to align correctly
-		ZrotationDegrees = 0.0f;
-		positionXYZ = glm::vec3(-0.8f, 2.0f, -1.5f); // Position to fill the gap
-
-		SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-		//SetShaderColor(0.75f, 0.68f, 2.85f, 1.0f); // Lavender color for the desk
-		SetShaderMaterial("deskMaterial");
-		SetShaderTexture("desk");
-		SetTextureUVScale(1.0, 1.0);
+		const DRAW_ITEM& item = m_drawList[i];
 
-		// draw the mesh with transformation values 
-		m_basicMeshes->DrawBoxMesh();
+		m_staticGeometry.AddMesh(i, m_staticMeshes[item.mesh], g_MeshLodCounts[item.mesh], item.model,
+			item.normalMatrix, item.uvScale, item.materialIndex, item.textureSlot, item.color);
 	}
+	m_staticGeometry.Upload();
+	m_itemLods.assign(m_drawList.size(), 0);
 
-	// Upper Corner portion of the desk supports
+	// hand the objects to the GPU culler in the same group order
+	if (m_gpuCuller.Create(g_CullShaderPath))
 	{
-		glm::vec3 scaleXYZ = glm::vec3(0.5f, 1.0f, 0.4f); // Thicker and shorter dimensions
-		float XrotationDegrees = 0.0f;
-		float YrotationDegrees = 1.8f;
-		float ZrotationDegrees = 0.0f;
-		glm::vec3 positionXYZ = glm::vec3(-1.0f, 1.5f, -2.0f); // Position on the desk
+		std::vector<GpuCuller::DRAW_OBJECT> objects;
 
-		SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-		//SetShaderColor(0.75f, 0.68f, 2.85f, 1.0f); // Lavender color for the desk
-		SetShaderMaterial("deskMaterial");
-		SetShaderTexture("desk");
-		SetTextureUVScale(1.0, 1.0);
+		if (NULL != m_pFrameUniforms)
+		{
+			m_pFrameUniforms->BindProgram(m_gpuCuller.GetProgram());
+		}
+		m_gpuCuller.SetLodHysteresis(m_lodHysteresis);
 
-		// draw the mesh with transformation values 
-		m_basicMeshes->DrawBoxMesh();
+		for (int group = 0; group < m_staticGeometry.GetGroupCount(); group++)
+		{
+			int firstPiece = m_staticGeometry.GetGroupFirstPiece(group);
+
+			for (int i = firstPiece; i < firstPiece + m_staticGeometry.GetGroupPieceCount(group); i++)
+			{
+				const StaticGeometry::PIECE& piece = m_staticGeometry.GetPiece(i);
+				GpuCuller::DRAW_OBJECT object;
+
+				object.bounds = m_drawList[piece.itemIndex].bounds;
+				for (int lod = 0; lod < MESH_LOD_COUNT; lod++)
+				{
+					object.lodFirstIndex[lod] = piece.firstIndex[lod];
+					object.lodIndexCount[lod] = (GLuint)piece.indexCount[lod];
+				}
+				object.group = (GLuint)group;
+				object.firstCommand = (GLuint)firstPiece;
+				objects.push_back(object);
+			}
+		}
+		m_gpuCuller.SetObjects(objects, m_staticGeometry.GetGroupCount());
 	}
+}
 
+/***********************************************************
+ *  CullStaticGeometry()
+ *
+ *  This method is used for finding the visible objects of
+ *  the static geometry and their detail levels, once per
+ *  frame for both the depth and the shading pass.  When the
+ *  GPU culler is ready it writes the draw commands, otherwise
+ *  the levels are picked here for the visibility of the CPU
+ *  frustum culler.
+ ***********************************************************/
+void SceneManager::CullStaticGeometry()
+{
+	if (m_gpuCuller.IsSupported())
+	{
+		m_gpuCuller.Cull(m_pixelsPerUnit);
+	}
+	else
+	{
+		SelectMeshLods();
+	}
+}
 
-	// Desk upper-surface part 1 - left part of the L-shape
+/***********************************************************
+ *  DrawStaticGeometry()
+ *
+ *  This method is used for drawing the groups of the static
+ *  geometry in the passed in order, with one draw call per
+ *  texture slot.  The depth pass only needs the positions,
+ *  so it skips the variant switch between the draws.
+ ***********************************************************/
+void SceneManager::DrawStaticGeometry(bool bDepthOnly, const std::vector<int>& groupOrder)
+{
+	if (m_gpuCuller.IsSupported())
 	{
-		scaleXYZ = glm::vec3(14.0f, 0.5f, 2.5f); // Reduced dimensions
-		XrotationDegrees = 0.0f;
-		YrotationDegrees = 45.0f;
-		ZrotationDegrees = 0.0f;
-		positionXYZ = glm::vec3(-9.8f, 2.0f, 3.0f); // Position adjusted to align with the other box
+		m_staticGeometry.BindVertexArray();
+	}
 
-		SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-		//SetShaderColor(0.75f, 0.68f, 2.85f, 1.0f); // Lavender color for the desk
-		SetShaderMaterial("deskMaterial");
-		SetShaderTexture("desk");
-		SetTextureUVScale(1.0, 1.0);
+	for (int n = 0; n < groupOrder.size(); n++)
+	{
+		int i = groupOrder[n];
 
-		// draw the mesh with transformation values 
-		m_basicMeshes->DrawBoxMesh();
+		if ((bDepthOnly == false) && UseVariant(GetVariant(m_staticGeometry.GetGroupTextureSlot(i) >= 0)))
+		{
+			// the vertices are in world space with their texture scale applied
+			SetTransformations(glm::mat4(1.0f));
+			SetTextureUVScale(1.0f, 1.0f);
+		}
+
+		if (m_gpuCuller.IsSupported())
+		{
+			m_gpuCuller.DrawGroup(i, m_staticGeometry.GetGroupFirstPiece(i), m_staticGeometry.GetGroupPieceCount(i));
+			FrameProfiler::AddCount(FrameProfiler::COUNTER_DRAW_CALLS);
+		}
+		else if (m_staticGeometry.DrawGroup(i, m_visibleItems, m_itemLods))
+		{
+			FrameProfiler::AddCount(FrameProfiler::COUNTER_DRAW_CALLS);
+		}
 	}
 
-	// Upper Left portion of the desk supports
+	if (m_gpuCuller.IsSupported())
 	{
-		glm::vec3 scaleXYZ = glm::vec3(0.5f, 1.0f, 0.4f); // Thicker and shorter dimensions
-		float XrotationDegrees = 0.0f;
-		float YrotationDegrees = 45.0f;
-		float ZrotationDegrees = 0.0f;
-		glm::vec3 positionXYZ = glm::vec3(-11.4f, 1.5f, 4.0f); // Position on the desk
+		m_staticGeometry.UnbindVertexArray();
+	}
+}
+
+/***********************************************************
+ *  RenderStaticGeometry()
+ *
+ *  This method is used for shading the visible objects of
+ *  the static geometry.  The vertices hold everything else,
+ *  so only the shader variant is switched between the draws.
+ ***********************************************************/
+void SceneManager::RenderStaticGeometry(const std::vector<int>& groupOrder)
+{
+	SetGeometryMode(false, true);
 
-		SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-		//SetShaderColor(0.75f, 0.68f, 2.85f, 1.0f); // Lavender color for the desk
-		SetShaderMaterial("deskMaterial");
-		SetShaderTexture("desk");
-		SetTextureUVScale(1.0, 1.0);
+	DrawStaticGeometry(false, groupOrder);
 
-		// draw the mesh with transformation values 
-		m_basicMeshes->DrawBoxMesh();
+	SetGeometryMode(false, false);
+
+	// the draws above changed uniforms behind the applied state
+	InvalidateAppliedState();
+}
+
+/***********************************************************
+ *  SortFrontToBack()
+ *
+ *  This method is used for ordering the opaque draws by the
+ *  camera distance of their nearest visible object, so the
+ *  depth test rejects the hidden fragments of the later
+ *  draws before they are shaded.  Batches and groups are as
+ *  near as their nearest visible object.
+ ***********************************************************/
+void SceneManager::SortFrontToBack(bool bUseStaticGeometry)
+{
+	glm::vec3 viewPosition(0.0f);
+
+	if (NULL != m_pFrameUniforms)
+	{
+		viewPosition = glm::vec3(m_pFrameUniforms->GetFrameData().viewPosition);
+	}
+
+	m_itemDistances.resize(m_drawList.size());
+	m_jobSystem.ParallelFor((int)m_drawList.size(), g_JobGrainItems,
+		[this, &viewPosition](int begin, int end)
+		{
+			for (int i = begin; i < end; i++)
+			{
+				m_itemDistances[i] = glm::length(glm::vec3(m_drawList[i].bounds) - viewPosition);
+			}
+		});
+
+	m_visibleOrder.clear();
+	for (int i = 0; i < m_drawList.size(); i++)
+	{
+		if (m_visibleItems[i] != 0)
+		{
+			m_visibleOrder.push_back(i);
+		}
 	}
 
-	// Desk upper-surface part 2 - right part of the L-shape, rotated -45 degrees
+	// equal distances keep the lower index first, the same order a
+	// stable sort of the ascending indices gives, without the buffer
+	// a stable sort allocates
+	const std::vector<float>& distances = m_itemDistances;
+	m_drawOrder = m_visibleOrder;
+	std::sort(m_drawOrder.begin(), m_drawOrder.end(),
+		[&distances](int a, int b)
+		{
+			return((distances[a] < distances[b]) || ((distances[a] == distances[b]) && (a < b)));
+		});
+
+	if (bUseStaticGeometry == true)
 	{
-		scaleXYZ = glm::vec3(14.0f, 0.5f, 2.5f); // Reduced dimensions
-		XrotationDegrees = 0.0f;
-		YrotationDegrees = -45.0f; // Rotate -45 degrees to form L-shape
-		ZrotationDegrees = 0.0f;
-		positionXYZ = glm::vec3(8.0f, 2.0f, 3.0f); // Position adjusted to align with the other box
+		float* pGroupDistances = m_pFrameArena->AllocateArray<float>(m_staticGeometry.GetGroupCount(), FLT_MAX);
 
-		SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-		//SetShaderColor(0.75f, 0.68f, 2.85f, 1.0f); // Lavender color for the desk
-		SetShaderMaterial("deskMaterial");
-		SetShaderTexture("desk");
-		SetTextureUVScale(1.0, 1.0);
+		m_groupOrder.clear();
+		m_groupStateOrder.clear();
+		for (int group = 0; group < m_staticGeometry.GetGroupCount(); group++)
+		{
+			int firstPiece = m_staticGeometry.GetGroupFirstPiece(group);
+
+			for (int i = firstPiece; i < firstPiece + m_staticGeometry.GetGroupPieceCount(group); i++)
+			{
+				int item = m_staticGeometry.GetPiece(i).itemIndex;
+
+				if (m_visibleItems[item] != 0)
+				{
+					pGroupDistances[group] = std::min(pGroupDistances[group], distances[item]);
+				}
+			}
+			m_groupOrder.push_back(group);
+			m_groupStateOrder.push_back(group);
+		}
+		std::sort(m_groupOrder.begin(), m_groupOrder.end(),
+			[pGroupDistances](int a, int b)
+			{
+				return((pGroupDistances[a] < pGroupDistances[b]) || ((pGroupDistances[a] == pGroupDistances[b]) && (a < b)));
+			});
+	}
+	else if (m_bUseInstancing == true)
+	{
+		float* pBatchDistances = m_pFrameArena->AllocateArray<float>((int)m_drawBatches.size(), FLT_MAX);
 
-		// draw the mesh with transformation values 
-		m_basicMeshes->DrawBoxMesh();
+		for (int n = 0; n < m_visibleBatches.size(); n++)
+		{
+			const DRAW_BATCH& batch = m_drawBatches[m_visibleBatches[n].batch];
+
+			for (int i = batch.firstItem; i < batch.firstItem + batch.itemCount; i++)
+			{
+				if (m_visibleItems[i] != 0)
+				{
+					pBatchDistances[m_visibleBatches[n].batch] = std::min(pBatchDistances[m_visibleBatches[n].batch], distances[i]);
+				}
+			}
+		}
+		std::sort(m_visibleBatches.begin(), m_visibleBatches.end(),
+			[pBatchDistances](const VISIBLE_BATCH& a, const VISIBLE_BATCH& b)
+			{
+				if (pBatchDistances[a.batch] != pBatchDistances[b.batch])
+				{
+					return(pBatchDistances[a.batch] < pBatchDistances[b.batch]);
+				}
+				return((a.batch < b.batch) || ((a.batch == b.batch) && (a.lod < b.lod)));
+			});
 	}
+}
 
-	// Upper Right portion of the desk supports
+/***********************************************************
+ *  RenderDepthPrepass()
+ *
+ *  This method is used for drawing the depth of every visible
+ *  object nearest first with the depth-only program, the same
+ *  way the shading pass draws them, and switching back to
+ *  the scene program for the shading pass.
+ ***********************************************************/
+void SceneManager::RenderDepthPrepass(bool bUseStaticGeometry)
+{
+	if (bUseStaticGeometry == true)
 	{
-		glm::vec3 scaleXYZ = glm::vec3(0.5f, 1.0f, 0.4f); // Thicker and shorter dimensions
-		float XrotationDegrees = 0.0f;
-		float YrotationDegrees = -45.0f;
-		float ZrotationDegrees = 0.0f;
-		glm::vec3 positionXYZ = glm::vec3(12.4f, 1.5f, 7.5f); // Position on the desk
+		m_depthPrepass.BeginDepthPass(false, true);
+		DrawStaticGeometry(true, m_groupOrder);
+	}
+	else if (m_bUseInstancing == true)
+	{
+		m_depthPrepass.BeginDepthPass(true, false);
+		for (int i = 0; i < m_visibleBatches.size(); i++)
+		{
+			const VISIBLE_BATCH& visibleBatch = m_visibleBatches[i];
+			const DRAW_ITEM& item = m_drawList[m_drawBatches[visibleBatch.batch].firstItem];
 
-		SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-		//SetShaderColor(0.75f, 0.68f, 2.85f, 1.0f); // Lavender color for the desk
-		SetShaderMaterial("deskMaterial");
-		SetShaderTexture("desk");
-		SetTextureUVScale(1.0, 1.0);
+			DrawMeshInstanced(item.mesh, visibleBatch.lod, visibleBatch.firstInstance, visibleBatch.instanceCount);
+		}
+	}
+	else
+	{
+		m_depthPrepass.BeginDepthPass(false, false);
+		for (int n = 0; n < m_drawOrder.size(); n++)
+		{
+			const DRAW_ITEM& item = m_drawList[m_drawOrder[n]];
 
-		// draw the mesh with transformation values 
-		m_basicMeshes->DrawBoxMesh();
+			m_depthPrepass.SetModel(item.model);
+			DrawMesh(item.mesh);
+		}
 	}
 
-	// Monitor Base 1 Corner
+	m_depthPrepass.BeginShadingPass();
+}
+
+/***********************************************************
+ *  ComputeBoundingSphere()
+ *
+ *  This method is used for calculating a world space sphere
+ *  that encloses the passed in mesh after it is transformed
+ *  by the model matrix.  The radius uses the largest axis
+ *  scale, so it stays conservative under rotation.
+ ***********************************************************/
+glm::vec4 SceneManager::ComputeBoundingSphere(int mesh, const glm::mat4& model)
+{
+	glm::vec3 halfExtents = g_MeshHalfExtents[mesh];
+	glm::vec3 center = glm::vec3(model * glm::vec4(g_MeshCenters[mesh], 1.0f));
+
+	float scale = glm::length(glm::vec3(model[0]));
+	scale = std::max(scale, glm::length(glm::vec3(model[1])));
+	scale = std::max(scale, glm::length(glm::vec3(model[2])));
+
+	return(glm::vec4(center, glm::length(halfExtents) * scale));
+}
+
+/***********************************************************
+ *  ComputeNormalMatrix()
+ *
+ *  This method is used for calculating the normal matrix
+ *  every draw path passes to the shader.  The scene is lit
+ *  with the untransformed normals, so this is the identity
+ *  unless world space normals are turned on.  There a
+ *  rotation with an equal scale on every axis keeps the
+ *  normals perpendicular, and the shader normalizes them
+ *  anyway, so the upper part of the model matrix is used as
+ *  it is.  Only other scales need the inverse transpose.
+ ***********************************************************/
+glm::mat3 SceneManager::ComputeNormalMatrix(const glm::mat4& model)
+{
+	if (!g_bWorldSpaceNormals)
 	{
-		scaleXYZ = glm::vec3(2.0f, 0.1f, 1.0f); // Base of the monitor
-		XrotationDegrees = 0.0f;
-		YrotationDegrees = 1.8f;
-		ZrotationDegrees = 0.0f;
-		positionXYZ = glm::vec3(-0.8f, 2.4f, -1.9f); // Adjust position as necessary
+		return(glm::mat3(1.0f));
+	}
 
-		SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-		SetShaderColor(192.0f / 255.0f, 192.0f / 255.0f, 192.0f / 255.0f, 1.0f); // Silver color for the base
-		m_basicMeshes->DrawBoxMesh();
+	glm::mat3 basis = glm::mat3(model);
+	float lengths[3];
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		lengths[axis] = glm::dot(basis[axis], basis[axis]);
 	}
 
-	// Monitor Stand 1 Corner
+	float tolerance = 1e-4f * std::max(std::max(lengths[0], lengths[1]), lengths[2]);
+	bool bUniform =
+		(std::abs(lengths[0] - lengths[1]) <= tolerance) &&
+		(std::abs(lengths[0] - lengths[2]) <= tolerance) &&
+		(std::abs(glm::dot(basis[0], basis[1])) <= tolerance) &&
+		(std::abs(glm::dot(basis[0], basis[2])) <= tolerance) &&
+		(std::abs(glm::dot(basis[1], basis[2])) <= tolerance);
+
+	if (bUniform)
 	{
-		scaleXYZ = glm::vec3(0.2f, 2.0f, 0.2f); // Stand of the monitor
-		XrotationDegrees = 0.0f; 
-		YrotationDegrees = 1.8f;
-		ZrotationDegrees = 0.0f; 
-		positionXYZ = glm::vec3(-0.8f, 2.8f, -2.0f); // Adjust position above the base 
+		return(basis);
+	}
 
-		SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ); 
-		SetShaderColor(192.0f / 255.0f, 192.0f / 255.0f, 192.0f / 255.0f, 1.0f); // Silver color for the stand 
-		m_basicMeshes->DrawBoxMesh(); 
+	return(glm::inverseTranspose(basis));
+}
+
+/***********************************************************
+ *  ApplyDrawState()
+ *
+ *  This method is used for passing the material, texture and
+ *  color of the draw item into the shader, skipping every
+ *  uniform that already holds the needed value from the
+ *  previous draw.
+ ***********************************************************/
+void SceneManager::ApplyDrawState(const DRAW_ITEM& item)
+{
+	// the variant decides between texture and color, and every
+	// variant remembers its own applied state
+	if (!UseVariant(item.variant))
+	{
+		return;
 	}
 
-	// Monitor Screen 1 - Thin White Screen
+	bool bForce = (m_appliedState.bValid == false);
+
+	// instanced draws read the material index from the instance data
+	if ((m_bUseInstancing == false) &&
+		(bForce || (item.materialIndex != m_appliedState.materialIndex)))
 	{
-		glm::vec3 scaleXYZ = glm::vec3(9.0f, 2.0f, 0.2f); // Slightly smaller scale for the white screen
-		float XrotationDegrees = 0.0f;
-		float YrotationDegrees = 1.8f;
-		float ZrotationDegrees = 0.0f;
-		glm::vec3 positionXYZ = glm::vec3(-1.0f, 4.5f, -1.54f); // Slightly in front of the black screen
+		SetShaderMaterial(item.materialIndex);
+		m_appliedState.materialIndex = item.materialIndex;
+	}
 
-		SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-		//SetShaderColor(1.0f, 1.0f, 1.0f, 1.0f); // White color for the SetShaderTexture("screen"); //Screensaver placeholder
-		SetShaderMaterial("screenMaterial");
-		SetShaderTexture("screen"); //Screensaver placeholder
-		//SetShaderTexture("glass");
-		SetTextureUVScale(1.0, 1.0);
+	if (item.textureSlot >= 0)
+	{
+		// instanced draws read the texture slot from the instance data
+		if ((m_bUseInstancing == false) &&
+			(bForce || (item.textureSlot != m_appliedState.textureSlot)))
+		{
+			m_pUniformCache->SetIntValue(m_uniforms.textureSlot, item.textureSlot);
+		}
+		if (bForce || (item.uvScale != m_appliedState.uvScale))
+		{
+			SetTextureUVScale(item.uvScale.x, item.uvScale.y);
+			m_appliedState.uvScale = item.uvScale;
+		}
+	}
+	else
+	{
+		if (bForce || (item.color != m_appliedState.color))
+		{
+			m_pUniformCache->SetVec4Value(m_uniforms.objectColor, item.color);
+			m_appliedState.color = item.color;
+		}
+	}
+	m_appliedState.textureSlot = item.textureSlot;
+	m_appliedState.bValid = true;
+}
 
-		// draw the mesh with transformation values - this plane is used for the base
+/***********************************************************
+ *  DrawMesh()
+ *
+ *  This method is used for drawing the basic shape mesh
+ *  associated with the passed in mesh ID.
+ ***********************************************************/
+void SceneManager::DrawMesh(int mesh)
+{
+	FrameProfiler::AddCount(FrameProfiler::COUNTER_DRAW_CALLS);
+
+	switch (mesh)
+	{
+	case MESH_PLANE:
+		m_basicMeshes->DrawPlaneMesh();
+		break;
+	case MESH_BOX:
 		m_basicMeshes->DrawBoxMesh();
+		break;
+	case MESH_PRISM:
+		m_basicMeshes->DrawPrismMesh();
+		break;
+	case MESH_CYLINDER:
+		m_basicMeshes->DrawCylinderMesh();
+		break;
+	case MESH_SPHERE:
+		m_basicMeshes->DrawSphereMesh();
+		break;
+	case MESH_TORUS:
+		m_basicMeshes->DrawTorusMesh();
+		break;
+	default:
+		break;
 	}
+}
 
+/**************************************************************/
+/*** STUDENTS CAN MODIFY the code in the methods BELOW for  ***/
+/*** preparing and rendering their own 3D replicated scenes.***/
+/*** Please refer to the code in the OpenGL sample project  ***/
+/*** for assistance.                                        ***/
+/**************************************************************/
 
-	// Monitor Screen 1 Corner
+/***********************************************************
+ *  LoadSceneTextures()
+ *
+ *  This method is used for preparing the 3D scene by loading
+ *  the shapes, textures in memory to support the 3D scene
+ *  rendering
+ ***********************************************************/
+void SceneManager::LoadSceneTextures()
+{
+	// create the textures listed in the scene file
+	for (int i = 0; i < m_sceneFile.GetTextureCount(); i++)
 	{
-		scaleXYZ = glm::vec3(10.0f, 3.0f, 0.4f); // Screen of the monitor
-		XrotationDegrees = 0.0f;
-		YrotationDegrees = 1.8f; 
-		ZrotationDegrees = 0.0f;
-		positionXYZ = glm::vec3(-1.0f, 4.5f, -1.7f); // Position above the stand
+		const SceneFile::SCENE_TEXTURE& texture = m_sceneFile.GetTexture(i);
 
-		SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-		SetShaderColor(192.0f / 255.0f, 192.0f / 255.0f, 192.0f / 255.0f, 1.0f); // Silver color for the screen
-		m_basicMeshes->DrawBoxMesh();
+		CreateGLTexture(m_sceneFile.GetString(texture.pathOffset), m_sceneFile.GetString(texture.tagOffset));
 	}
 
-	// Monitor Base 2 Left
+	// every texture settles once and changes its levels at most
+	// once per frame, so the lists never grow while rendering
+	m_settledTextures.reserve(m_textureIDs.size());
+	m_streamedTextures.reserve(m_textureIDs.size());
+
+	// after the textures are created, they need to be made
+	// reachable by the shaders through their texture slots
+	BindGLTextures();
+}
+
+/***********************************************************
+ *  LoadSceneMaterials()
+ *
+ *  This method is used for defining the materials listed in
+ *  the scene file.
+ ***********************************************************/
+void SceneManager::LoadSceneMaterials()
+{
+	for (int i = 0; i < m_sceneFile.GetMaterialCount(); i++)
 	{
-		scaleXYZ = glm::vec3(2.0f, 0.1f, 1.0f); // Base of the monitor
-		XrotationDegrees = 0.0f;
-		YrotationDegrees = 45.0f;
-		ZrotationDegrees = 0.0f;
-		positionXYZ = glm::vec3(-11.0f, 2.4f, 2.92f); // Adjust position as necessary
+		const SceneFile::SCENE_MATERIAL& sceneMaterial = m_sceneFile.GetMaterial(i);
+		OBJECT_MATERIAL material;
 
-		SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-		SetShaderColor(192.0f / 255.0f, 192.0f / 255.0f, 192.0f / 255.0f, 1.0f); // Silver color for the base
-		m_basicMeshes->DrawBoxMesh();
+		material.tag = m_sceneFile.GetString(sceneMaterial.tagOffset);
+		material.ambientColor = sceneMaterial.ambientColor;
+		material.ambientStrength = sceneMaterial.ambientStrength;
+		material.diffuseColor = sceneMaterial.diffuseColor;
+		material.specularColor = sceneMaterial.specularColor;
+		material.shininess = sceneMaterial.shininess;
+		m_objectMaterials.push_back(material);
+	}
+
+	// the materials never change, so their tags are hashed
+	// and they are uploaded only once
+	HashMaterialTags();
+	UploadSceneMaterials();
+}
+
+
+/***********************************************************
+ *  PrepareScene()
+ *
+ *  This method is used for preparing the 3D scene by loading
+ *  the shapes, textures in memory to support the 3D scene
+ *  rendering
+ ***********************************************************/
+void SceneManager::PrepareScene()
+{
+	// the depth-only program of the depth pre-pass
+	if (m_depthPrepass.Create(g_DepthVertexShaderPath, g_DepthFragmentShaderPath) && (NULL != m_pFrameUniforms))
+	{
+		m_pFrameUniforms->BindProgram(m_depthPrepass.GetProgram());
 	}
+	
+	// the textures, materials, lights and objects all come from
+	// the scene file, which is only needed until they are loaded
+	if (!m_sceneFile.Load(m_scenePath.c_str()))
+	{
+		std::cout << "Drawing an empty scene, could not load scene file:" << m_scenePath << std::endl;
+	}
+
+	// load the materials for the 3D scene
+	LoadSceneMaterials();
+	
+	// load the textures for the 3D scene
+	m_textureLoader->Start();
+	m_jobSystem.Start(m_jobThreads);
+	m_textureResidency.Create();
+	LoadSceneTextures();
 
-	// Monitor Stand 2 Left
+	// Setup Scene Lights
+	SetupSceneLights();
+
+	// only one instance of a particular mesh needs to be
+	// loaded in memory no matter how many times it is drawn
+	// in the rendered 3D scene
+
+	m_basicMeshes->LoadPlaneMesh();
+	m_basicMeshes->LoadBoxMesh();
+	m_basicMeshes->LoadPrismMesh();
+	m_basicMeshes->LoadCylinderMesh();
+	m_basicMeshes->LoadSphereMesh();
+	m_basicMeshes->LoadTorusMesh();
+
+	m_instancedMeshes->LoadPlaneMesh();
+	m_instancedMeshes->LoadBoxMesh();
+	m_instancedMeshes->LoadPrismMesh();
+	m_instancedMeshes->LoadCylinderMesh();
+	m_instancedMeshes->LoadSphereMesh();
+	m_instancedMeshes->LoadTorusMesh();
+
+	// the scene objects are static, so they are transformed
+	// and resolved once here rather than on every frame
+	LoadSceneObjects();
+
+	m_sceneFile.Close();
+}
+
+/***********************************************************
+ *  LoadSceneObjects()
+ *
+ *  This method is used for building the retained draw list
+ *  from the objects of the scene file.  The materials and
+ *  textures must already be loaded so their tags resolve.
+ ***********************************************************/
+void SceneManager::LoadSceneObjects()
+{
+	m_drawList.clear();
+	m_drawList.reserve(m_sceneFile.GetSceneObjectCount());
+	m_transforms.Clear();
+	m_transformNodes.clear();
+	m_sceneGraph.Clear();
+	m_nodeTags.clear();
+	m_nodeItems.clear();
+
+	// the groups come first, each after the group it is inside, so
+	// the group index of the scene is also its scene graph node
+	for (int i = 0; i < m_sceneFile.GetGroupCount(); i++)
 	{
-		scaleXYZ = glm::vec3(0.2f, 2.0f, 0.2f); // Stand of the monitor
-		XrotationDegrees = 0.0f;
-		YrotationDegrees = 45.0f;
-		ZrotationDegrees = 0.0f;
-		positionXYZ = glm::vec3(-11.0f, 2.8f, 2.6f); // Adjust position above the base 
+		const SceneFile::SCENE_GROUP& group = m_sceneFile.GetGroup(i);
 
-		SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-		SetShaderColor(192.0f / 255.0f, 192.0f / 255.0f, 192.0f / 255.0f, 1.0f); // Silver color for the stand 
-		m_basicMeshes->DrawBoxMesh();
+		m_sceneGraph.AddNode((group.parent < i) ? group.parent : -1, TransformBatch::ComposeTransform(
+			glm::vec3(1.0f, 1.0f, 1.0f), group.rotation, group.position));
+		m_nodeTags.push_back(group.tagHash);
+		m_nodeItems.push_back(-1);
 	}
 
-	// Monitor Screen 2 - Thin White Screen
+	for (int i = 0; i < m_sceneFile.GetSceneObjectCount(); i++)
 	{
-		glm::vec3 scaleXYZ = glm::vec3(8.8f, 2.0f, 0.2f); // Slightly smaller scale for the white screen
-		float XrotationDegrees = 0.0f;
-		float YrotationDegrees = 45.0f;
-		float ZrotationDegrees = 0.0f;
-		glm::vec3 positionXYZ = glm::vec3(-10.25f, 4.5f, 3.5f); // Slightly in front of the black screen
+		const SceneFile::SCENE_OBJECT& object = m_sceneFile.GetSceneObject(i);
+
+		// a compiled scene from another build may name meshes this one lacks
+		if (object.mesh >= (uint32_t)SceneFile::MESH_COUNT)
+		{
+			continue;
+		}
 
-		SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-		//SetShaderColor(1.0f, 1.0f, 1.0f, 1.0f); // White color for the screen
-		SetShaderMaterial("screenMaterial");
-		SetShaderTexture("screen"); //Screensaver placeholder
-		SetTextureUVScale(1.0, 1.0);
+		int groupNode = (object.group < m_sceneFile.GetGroupCount()) ? object.group : -1;
 
-		// draw the mesh with transformation values - this plane is used for the base
-		m_basicMeshes->DrawBoxMesh();
+		if ((object.flags & SceneFile::OBJECT_TEXTURED) != 0)
+		{
+			AddDrawItem((MESH_ID)object.mesh, object.scale, object.rotation.x, object.rotation.y, object.rotation.z,
+				object.position, object.materialTag, object.textureTag, object.uvScale.x, object.uvScale.y, groupNode);
+		}
+		else
+		{
+			AddDrawItem((MESH_ID)object.mesh, object.scale, object.rotation.x, object.rotation.y, object.rotation.z,
+				object.position, object.materialTag, object.color, groupNode);
+		}
 	}
 
+	// all of the model matrices are composed in one pass
+	UpdateTransforms();
 
-	// Monitor Screen 2 Left
+	// group the objects by shader state for submission
+	SortDrawList();
+	for (int i = 0; i < m_drawList.size(); i++)
 	{
-		scaleXYZ = glm::vec3(10.0f, 3.0f, 0.4f); // Screen of the monitor
-		XrotationDegrees = 0.0f;
-		YrotationDegrees = 45.0f;
-		ZrotationDegrees = 0.0f;
-		positionXYZ = glm::vec3(-10.8f, 4.5f, 3.0f); // Position above the stand
-
-		SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-		SetShaderColor(192.0f / 255.0f, 192.0f / 255.0f, 192.0f / 255.0f, 1.0f); // Silver color for the screen
-		m_basicMeshes->DrawBoxMesh();
+		m_nodeItems[m_drawList[i].node] = i;
 	}
+	BuildDrawBatches();
+	BuildStaticGeometry();
 
-	// Monitor Base 3 Right
+	// the textures are opaque, so only the object colors can blend
+	m_bSceneTranslucent = false;
+	for (int i = 0; i < m_drawList.size(); i++)
+	{
+		m_bSceneTranslucent = m_bSceneTranslucent || (m_drawList[i].color.a < 1.0f);
+	}
+	if (m_bSceneTranslucent && m_bUseDepthPrepass)
 	{
-		scaleXYZ = glm::vec3(2.0f, 0.1f, 1.0f); // Base of the monitor
-		XrotationDegrees = 0.0f;
-		YrotationDegrees = -45.0f;
-		ZrotationDegrees = 0.0f;
-		positionXYZ = glm::vec3(8.8f, 2.4f, 2.6f); // Adjust position as necessary
+		std::cout << "INFO: The scene has translucent objects, drawing it without the depth pre-pass" << std::endl;
+	}
+}
 
-		SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-		SetShaderColor(192.0f / 255.0f, 192.0f / 255.0f, 192.0f / 255.0f, 1.0f); // Silver color for the base
-		m_basicMeshes->DrawBoxMesh();
+/***********************************************************
+ *  SetTextureBudget()
+ *
+ *  This method is used for setting how much memory the mip
+ *  levels of the streamed textures may take up together.
+ ***********************************************************/
+void SceneManager::SetTextureBudget(size_t budgetBytes)
+{
+	m_textureStreamer.SetBudget(budgetBytes);
+}
+
+/***********************************************************
+ *  SetLodHysteresis()
+ *
+ *  This method is used for setting how far the projected size
+ *  of a curved shape has to move past a level boundary
+ *  before its detail level changes.
+ ***********************************************************/
+void SceneManager::SetLodHysteresis(float hysteresis)
+{
+	m_lodHysteresis = std::max(hysteresis, 0.0f);
+	m_gpuCuller.SetLodHysteresis(m_lodHysteresis);
+}
+
+/***********************************************************
+ *  SetDepthPrepass()
+ *
+ *  This method is used for turning the depth pre-pass on or
+ *  off.  Without it the draws still go nearest first.  A
+ *  scene with translucent objects never uses it.
+ ***********************************************************/
+void SceneManager::SetDepthPrepass(bool bUseDepthPrepass)
+{
+	m_bUseDepthPrepass = bUseDepthPrepass;
+}
+
+/***********************************************************
+ *  SetJobThreads()
+ *
+ *  This method is used for setting the number of threads the
+ *  job system is started with by PrepareScene().
+ ***********************************************************/
+void SceneManager::SetJobThreads(int threadCount)
+{
+	m_jobThreads = std::max(threadCount, 0);
+}
+
+/***********************************************************
+ *  IsLoadingTextures()
+ *
+ *  This method is used for checking whether the texture
+ *  loader still has images to decode or upload.
+ ***********************************************************/
+bool SceneManager::IsLoadingTextures() const
+{
+	return((NULL != m_textureLoader) && (m_textureLoader->GetPendingCount() > 0));
+}
+
+/***********************************************************
+ *  IsStreamingTextures()
+ *
+ *  This method is used for checking whether the texture
+ *  streamer left textures short of the levels the view
+ *  asked for, because of the upload limit of a frame.
+ ***********************************************************/
+bool SceneManager::IsStreamingTextures() const
+{
+	return(m_textureStreamer.GetPendingCount() > 0);
+}
+
+/***********************************************************
+ *  SetScenePath()
+ *
+ *  This method is used for choosing the scene file that is
+ *  loaded by PrepareScene().
+ ***********************************************************/
+void SceneManager::SetScenePath(const char* scenePath)
+{
+	m_scenePath = scenePath;
+}
+
+/***********************************************************
+ *  RenderScene()
+ *
+ *  This method is used for rendering the 3D scene by
+ *  walking the state-sorted retained draw list and drawing
+ *  the basic 3D shapes with their precomputed transformations,
+ *  either one instanced draw per batch or one draw per object
+ ***********************************************************/
+void SceneManager::RenderScene()
+{
+	if ((NULL == m_pShaderVariants) || (NULL == m_pFrameArena))
+	{
+		return;
 	}
 
-	// Monitor Stand 3 Right
+	// swap in the texture images that finished loading
+	UpdateGLTextures();
+
+	// compose the matrices of the objects that moved since the last frame
+	UpdateTransforms();
+
+	// the uniforms may have been changed outside of this method
+	// since the last frame, so the first draw sets all of them
+	InvalidateAppliedState();
+
+	// flag the objects inside the view frustum of this frame
+	if (NULL != m_pFrameUniforms)
 	{
-		scaleXYZ = glm::vec3(0.2f, 2.0f, 0.2f); // Stand of the monitor
-		XrotationDegrees = 0.0f;
-		YrotationDegrees = -45.0f;
-		ZrotationDegrees = 0.0f;
-		positionXYZ = glm::vec3(8.8f, 2.8f, 2.4f); // Adjust position above the base 
+		GLint viewport[4];
 
-		SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-		SetShaderColor(192.0f / 255.0f, 192.0f / 255.0f, 192.0f / 255.0f, 1.0f); // Silver color for the stand 
-		m_basicMeshes->DrawBoxMesh();
+		m_frustumCuller.SetFrustum(m_pFrameUniforms->GetFrameData().viewProjection);
+
+		// the projected sizes of the texture and mesh detail levels
+		glGetIntegerv(GL_VIEWPORT, viewport);
+		m_pixelsPerUnit = m_pFrameUniforms->GetFrameData().projection[1][1] * 0.5f * (float)viewport[3];
+
+		// the local lights are binned for the view of this frame
+		m_lightClusters.Update(m_pFrameUniforms->GetFrameData().projection, viewport[2], viewport[3]);
 	}
+	m_frustumCuller.Cull(m_visibleItems, &m_jobSystem);
 
-	// Monitor Screen 3 - Thin White Screen
+	// the streamed textures refine for what is visible this frame
+	RequestTextureDetail();
+
+	// the whole draw list is baked, so no object needs its own draw
+	bool bUseStaticGeometry = (m_bUseStaticGeometry == true) && !m_staticGeometry.IsEmpty();
+	bool bUseDepthPrepass = (m_bUseDepthPrepass == true) && m_depthPrepass.IsSupported() && !m_bSceneTranslucent;
+
+	if (bUseStaticGeometry == true)
 	{
-		glm::vec3 scaleXYZ = glm::vec3(8.8f, 2.0f, 0.2f); // Slightly smaller scale for the white screen
-		float XrotationDegrees = 0.0f;
-		float YrotationDegrees = -45.0f; // Opposite rotation to fit on the other side
-		float ZrotationDegrees = 0.0f;
-		glm::vec3 positionXYZ = glm::vec3(8.4f, 4.55f, 3.5f); // Adjust position to fit on the right monitor
+		CullStaticGeometry();
+	}
+	else if (m_bUseInstancing == true)
+	{
+		// the instance data only holds the visible objects at their
+		// levels, so it is rebuilt when an object enters or leaves
+		// the frustum or changes its level
+		SelectMeshLods();
+		if ((m_visibleItems != m_instancedVisibility) || (m_itemLods != m_instancedLods))
+		{
+			BuildVisibleBatches();
+		}
+	}
+	SortFrontToBack(bUseStaticGeometry);
 
-		SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-		//SetShaderColor(1.0f, 1.0f, 1.0f, 1.0f); // White color for the screen
-		SetShaderMaterial("screenMaterial");
-		SetShaderTexture("screen"); //Screensaver placeholder
-		SetTextureUVScale(1.0, 1.0);
+	// both passes draw the same geometry, so the shading pass only
+	// shades the fragments that are left in front
+	if (bUseDepthPrepass == true)
+	{
+		RenderDepthPrepass(bUseStaticGeometry);
+	}
 
-		// draw the mesh with transformation values - this plane is used for the base
-		m_basicMeshes->DrawBoxMesh();
+	if (bUseStaticGeometry == true)
+	{
+		// once the depth is laid down the order no longer saves any
+		// shading, so the groups are drawn in state order
+		RenderStaticGeometry(bUseDepthPrepass ? m_groupStateOrder : m_groupOrder);
 	}
+	else if (m_bUseInstancing == true)
+	{
+		// the model matrices come from the instance data
+		SetGeometryMode(true, false);
 
+		for (int i = 0; i < m_visibleBatches.size(); i++)
+		{
+			const VISIBLE_BATCH& visibleBatch = m_visibleBatches[i];
+			const DRAW_ITEM& item = m_drawList[m_drawBatches[visibleBatch.batch].firstItem];
 
-	// Monitor Screen 3 Right
+			ApplyDrawState(item);
+			DrawMeshInstanced(item.mesh, visibleBatch.lod, visibleBatch.firstInstance, visibleBatch.instanceCount);
+		}
+
+		SetGeometryMode(false, false);
+	}
+	else
 	{
-		scaleXYZ = glm::vec3(10.0f, 3.0f, 0.4f); // Screen of the monitor
-		XrotationDegrees = 0.0f;
-		YrotationDegrees = -45.0f;
-		ZrotationDegrees = 0.0f;
-		positionXYZ = glm::vec3(8.8f, 4.5f, 3.0f); // Position above the stand
+		// once the depth is laid down the order no longer saves any
+		// shading, so the state sorted draw list order is cheaper
+		const std::vector<int>& order = bUseDepthPrepass ? m_visibleOrder : m_drawOrder;
 
-		SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-		SetShaderColor(192.0f / 255.0f, 192.0f / 255.0f, 192.0f / 255.0f, 1.0f); // Silver color for the screen
-		m_basicMeshes->DrawBoxMesh();
+		// culled objects are not in the order, so they skip all of
+		// their uniform updates
+		for (int n = 0; n < order.size(); n++)
+		{
+			const DRAW_ITEM& item = m_drawList[order[n]];
+
+			SetTransformations(item.model, item.normalMatrix);
+			ApplyDrawState(item);
+
+			// draw the mesh with transformation values
+			DrawMesh(item.mesh);
+		}
 	}
 
-	
+	if (bUseDepthPrepass == true)
+	{
+		m_depthPrepass.EndShadingPass();
+	}
+}
+
+/***********************************************************
+ *  DrawMeshInstanced()
+ *
+ *  This method is used for drawing a range of the instance
+ *  data, all using the passed in mesh ID and detail level,
+ *  with one instanced draw call.  The flat shapes only have
+ *  the one level.
+ ***********************************************************/
+void SceneManager::DrawMeshInstanced(int mesh, int lod, int firstInstance, int instanceCount)
+{
+	FrameProfiler::AddCount(FrameProfiler::COUNTER_DRAW_CALLS);
+
+	switch (mesh)
+	{
+	case MESH_PLANE:
+		m_instancedMeshes->DrawPlaneMeshInstanced(firstInstance, instanceCount);
+		break;
+	case MESH_BOX:
+		m_instancedMeshes->DrawBoxMeshInstanced(firstInstance, instanceCount);
+		break;
+	case MESH_PRISM:
+		m_instancedMeshes->DrawPrismMeshInstanced(firstInstance, instanceCount);
+		break;
+	case MESH_CYLINDER:
+		m_instancedMeshes->DrawCylinderMeshInstanced(firstInstance, instanceCount, lod);
+		break;
+	case MESH_SPHERE:
+		m_instancedMeshes->DrawSphereMeshInstanced(firstInstance, instanceCount, lod);
+		break;
+	case MESH_TORUS:
+		m_instancedMeshes->DrawTorusMeshInstanced(firstInstance, instanceCount, lod);
+		break;
+	default:
+		break;
+	}
 }
 
 /***********************************************************
@@ -905,62 +2155,48 @@ void SceneManager::RenderScene()
 
 void SceneManager::SetupSceneLights()
 {
-	if (m_pShaderManager == NULL) return;
+	if (m_pFrameUniforms == NULL) return;
 
-	// Enable lighting
-	m_pShaderManager->setBoolValue("bUseLighting", true);
+	// Enable lighting - the objects are drawn with the lit variants
+	m_bUseLighting = true;
 
 	// Global ambient light
-	glm::vec3 globalAmbient(0.2f, 0.2f, 0.2f); // Moderate ambient light
-	m_pShaderManager->setVec3Value("globalAmbientColor", globalAmbient);
-
-	// Light 0 - Key Light (main soft white light from above)
-	glm::vec3 keyLightPos(0.0f, 12.0f, 0.0f);
-	glm::vec3 keyLightDiffuse(0.4f, 0.4f, 0.4f); // Increased brightness
-	glm::vec3 keyLightSpecular(7.0f, 7.0f, 7.0f);
-	m_pShaderManager->setVec3Value("lightSources[0].position", keyLightPos);
-	m_pShaderManager->setVec3Value("lightSources[0].diffuseColor", keyLightDiffuse);
-	m_pShaderManager->setVec3Value("lightSources[0].specularColor", keyLightSpecular);
-	m_pShaderManager->setFloatValue("lightSources[0].focalStrength", 32.0f);
-	m_pShaderManager->setFloatValue("lightSources[0].specularIntensity", 0.2f); // Increased specular intensity
-
-	// Light 1 - Warm Light under the upper part of the desk (soft yellow glow)
-	glm::vec3 warmLightPos(-9.8f, 2.0f, 3.0f); // Adjusted position
-	glm::vec3 warmLightDiffuse(1.0f, 0.85f, 0.5f); // Soft yellow color
-	glm::vec3 warmLightSpecular(1.0f, 0.85f, 0.5f);
-	m_pShaderManager->setVec3Value("lightSources[1].position", warmLightPos);
-	m_pShaderManager->setVec3Value("lightSources[1].diffuseColor", warmLightDiffuse);
-	m_pShaderManager->setVec3Value("lightSources[1].specularColor", warmLightSpecular);
-	m_pShaderManager->setFloatValue("lightSources[1].focalStrength", 32.0f);
-	m_pShaderManager->setFloatValue("lightSources[1].specularIntensity", 0.2f); // Softer specular intensity
-
-	// Light 2 - Monitor Light (Left monitor)
-	glm::vec3 leftMonitorPos(8.0f, 2.0f, 3.0f); // Adjusted position
-	glm::vec3 leftMonitorDiffuse(0.6f, 0.8f, 1.0f); // Cool light color
-	glm::vec3 leftMonitorSpecular(0.6f, 0.8f, 1.0f);
-	m_pShaderManager->setVec3Value("lightSources[2].position", leftMonitorPos);
-	m_pShaderManager->setVec3Value("lightSources[2].diffuseColor", leftMonitorDiffuse);
-	m_pShaderManager->setVec3Value("lightSources[2].specularColor", leftMonitorSpecular);
-	m_pShaderManager->setFloatValue("lightSources[2].focalStrength", 32.0f);
-	m_pShaderManager->setFloatValue("lightSources[2].specularIntensity", 0.2f); // Increased intensity
-
-	// Light 3 - Monitor Light (Center monitor)
-	//glm::vec3 centerMonitorPos(-0.8f, 2.0f, -1.5f); // Adjusted position
-	//glm::vec3 centerMonitorDiffuse(0.6f, 0.8f, 1.0f); // Cool light color
-	//glm::vec3 centerMonitorSpecular(0.6f, 0.8f, 1.0f);
-	//m_pShaderManager->setVec3Value("lightSources[3].position", centerMonitorPos);
-	//m_pShaderManager->setVec3Value("lightSources[3].diffuseColor", centerMonitorDiffuse);
-	//m_pShaderManager->setVec3Value("lightSources[3].specularColor", centerMonitorSpecular);
-	//m_pShaderManager->setFloatValue("lightSources[3].focalStrength", 32.0f);
-	//m_pShaderManager->setFloatValue("lightSources[3].specularIntensity", 0.2f); // Increased intensity
-
-	// Light 4 - Monitor Light (Right monitor)
-	//glm::vec3 rightMonitorPos(1.5f, 1.2f, 0.0f); // Adjusted position
-	//glm::vec3 rightMonitorDiffuse(0.6f, 0.8f, 1.0f); // Cool light color
-	//glm::vec3 rightMonitorSpecular(0.6f, 0.8f, 1.0f);
-	//m_pShaderManager->setVec3Value("lightSources[4].position", rightMonitorPos);
-	//m_pShaderManager->setVec3Value("lightSources[4].diffuseColor", rightMonitorDiffuse);
-	//m_pShaderManager->setVec3Value("lightSources[4].specularColor", rightMonitorSpecular);
-	//m_pShaderManager->setFloatValue("lightSources[4].focalStrength", 32.0f);
-	//m_pShaderManager->setFloatValue("lightSources[4].specularIntensity", 0.2f); // Increased intensity
+	m_pFrameUniforms->SetGlobalAmbientColor(m_sceneFile.GetGlobalAmbientColor());
+
+	// the local lights only reach the objects near them, so they
+	// are clustered instead of taking one of the frame light slots
+	m_lightClusters.ClearLights();
+	if (m_lightClusters.IsSupported() || m_lightClusters.Create(g_LightClusterShaderPath, m_pStreamBuffer))
+	{
+		m_pFrameUniforms->BindProgram(m_lightClusters.GetProgram());
+	}
+
+	for (int i = 0; i < m_sceneFile.GetLightCount(); i++)
+	{
+		const SceneFile::SCENE_LIGHT& light = m_sceneFile.GetLight(i);
+
+		if (light.type == SceneFile::LIGHT_LOCAL)
+		{
+			LightClusters::LOCAL_LIGHT localLight;
+			localLight.position = light.position;
+			localLight.radius = light.radius;
+			localLight.diffuseColor = light.diffuseColor;
+			localLight.specularColor = light.specularColor;
+			localLight.focalStrength = light.focalStrength;
+			localLight.specularIntensity = light.specularIntensity;
+			m_lightClusters.AddLight(localLight);
+		}
+		else
+		{
+			m_pFrameUniforms->SetLightSource(light.slot, light.position, light.diffuseColor, light.specularColor,
+				light.focalStrength, light.specularIntensity);
+		}
+	}
+
+	// every variant gets this when it is first bound
+	m_bUseLocalLights = m_lightClusters.IsSupported();
+	if (NULL != m_pUniformCache)
+	{
+		m_pUniformCache->SetBoolValue(m_uniforms.useLocalLights, m_bUseLocalLights);
+	}
 }
\ No newline at end of file
@@ -10,7 +10,25 @@
 #pragma once
 
 #include "ShaderManager.h"
+#include "UniformCache.h"
+#include "ShaderVariants.h"
+#include "FrameUniforms.h"
 #include "ShapeMeshes.h"
+#include "InstancedMeshes.h"
+#include "StaticGeometry.h"
+#include "GpuCuller.h"
+#include "LightClusters.h"
+#include "DepthPrepass.h"
+#include "SceneFile.h"
+#include "FrustumCuller.h"
+#include "TransformBatch.h"
+#include "SceneGraph.h"
+#include "JobSystem.h"
+#include "FrameArena.h"
+#include "TextureLoader.h"
+#include "TextureResidency.h"
+#include "TextureStreamer.h"
+#include "TagHash.h"
 
 #include <string>
 #include <vector>
@@ -25,14 +43,17 @@ class SceneManager
 {
 public:
 	// constructor
-	SceneManager(ShaderManager *pShaderManager);
+	SceneManager(ShaderManager *pShaderManager, ShaderVariants* pShaderVariants, FrameUniforms* pFrameUniforms, StreamBuffer* pStreamBuffer, FrameArena* pFrameArena);
 	// destructor
 	~SceneManager();
 
 	struct TEXTURE_INFO
 	{
 		std::string tag;
+		uint32_t tagHash;
 		uint32_t ID;
+		// index on the texture streamer, -1 when fully resident
+		int streamIndex;
 	};
 
 	struct OBJECT_MATERIAL
@@ -43,31 +64,247 @@ public:
 		glm::vec3 specularColor;
 		float shininess;
 		std::string tag;
+		uint32_t tagHash;
+	};
+
+	// identifiers for the basic shape meshes used in the scene
+	enum MESH_ID
+	{
+		MESH_PLANE = 0,
+		MESH_BOX,
+		MESH_PRISM,
+		MESH_CYLINDER,
+		MESH_SPHERE,
+		MESH_TORUS
+	};
+
+	// one object in the retained draw list - everything needed
+	// to draw it is resolved once when the scene is prepared
+	struct DRAW_ITEM
+	{
+		glm::mat4 model;
+		// transforms the normals, kept next to the model matrix so
+		// it is only worked out when the object moves
+		glm::mat3 normalMatrix;
+		glm::vec4 color;
+		glm::vec2 uvScale;
+		int mesh;
+		int materialIndex;
+		int textureSlot;
+		// the shader variant the object is drawn with
+		int variant;
+		// world space bounding sphere - xyz center, w radius
+		glm::vec4 bounds;
+		// the scene graph node placing the object
+		int node;
+	};
+
+	// a run of consecutive draw list objects that share the same
+	// mesh and shader state, drawn with one instanced draw call
+	struct DRAW_BATCH
+	{
+		int firstItem;
+		int itemCount;
+	};
+
+	// the objects of one batch that survived frustum culling and
+	// share a detail level, stored consecutively in the instance data
+	struct VISIBLE_BATCH
+	{
+		int batch;
+		int lod;
+		int firstInstance;
+		int instanceCount;
+	};
+
+	// cached locations of the uniforms set while rendering
+	struct UNIFORM_LOCATIONS
+	{
+		GLint model;
+		GLint normalMatrix;
+		GLint objectColor;
+		GLint objectTextures;
+		GLint textureSlot;
+		GLint useLocalLights;
+		GLint useInstancing;
+		GLint useStaticGeometry;
+		GLint materialIndex;
+		GLint UVscale;
+	};
+
+	// the shader state applied by the last submitted draw,
+	// used for skipping redundant uniform updates
+	struct SHADER_STATE
+	{
+		glm::vec4 color;
+		glm::vec2 uvScale;
+		int materialIndex;
+		int textureSlot;
+		bool bValid;
+	};
+
+	// what each shader variant was left with when another one was
+	// bound, so switching back only sets what differs
+	struct VARIANT_STATE
+	{
+		UNIFORM_LOCATIONS uniforms;
+		SHADER_STATE appliedState;
+		GLuint program;
 	};
 
 private:
 	// pointer to shader manager object
 	ShaderManager* m_pShaderManager;
+	// pointer to the programs built for the shader features
+	ShaderVariants* m_pShaderVariants;
+	// pointer to the uniform location cache of the bound variant
+	UniformCache* m_pUniformCache;
+	// pointer to the per-frame uniform block holding the lights
+	FrameUniforms* m_pFrameUniforms;
+	// pointer to the buffer the per-frame data is streamed through
+	StreamBuffer* m_pStreamBuffer;
+	// pointer to the scratch memory of the current frame
+	FrameArena* m_pFrameArena;
+	// uniform locations resolved from the cache
+	UNIFORM_LOCATIONS m_uniforms;
+	// the program the uniform locations were resolved for
+	GLuint m_uniformProgram;
+	// the bound shader variant, -1 before the first one
+	int m_currentVariant;
+	// the saved state of every variant
+	VARIANT_STATE m_variantStates[ShaderVariants::VARIANT_COUNT];
+	// true when the scene has lights, so the lit variants are used
+	bool m_bUseLighting;
+	// true when the local light clusters are filled each frame
+	bool m_bUseLocalLights;
+	// the geometry source every bound variant reads its matrices from
+	bool m_bDrawInstanced;
+	bool m_bDrawStaticGeometry;
 	// pointer to basic shapes object
 	ShapeMeshes* m_basicMeshes;
-	// total number of loaded textures
-	int m_loadedTextures;
-	// loaded textures info
-	TEXTURE_INFO m_textureIDs[16];
+	// pointer to the instanced basic shapes object
+	InstancedMeshes* m_instancedMeshes;
+	// pointer to the background texture loader
+	TextureLoader* m_textureLoader;
+	// makes the loaded textures reachable by slot from the shaders
+	TextureResidency m_textureResidency;
+	// streams the mip levels of the baked textures
+	TextureStreamer m_textureStreamer;
+	// the textures that settled or changed their levels this frame
+	std::vector<GLuint> m_settledTextures;
+	std::vector<TextureStreamer::TEXTURE_CHANGE> m_streamedTextures;
+	// true when the draw list is submitted in instanced batches
+	bool m_bUseInstancing;
+	// true when the draw list is drawn from the baked static geometry
+	bool m_bUseStaticGeometry;
+	// the draw list objects baked into world space, and the detail
+	// levels of every mesh they are baked from again when they move
+	StaticGeometry m_staticGeometry;
+	MeshGeometry::MESH_DATA m_staticMeshes[MESH_TORUS + 1][MESH_LOD_COUNT];
+	// culls the static geometry and writes its draws on the GPU
+	GpuCuller m_gpuCuller;
+	// bins the local lights into view space clusters
+	LightClusters m_lightClusters;
+	// draws the scene depth before it is shaded
+	DepthPrepass m_depthPrepass;
+	// true when the scene depth is laid down before the shading pass
+	bool m_bUseDepthPrepass;
+	// true when an object of the scene is translucent, which the depth
+	// pre-pass can not draw
+	bool m_bSceneTranslucent;
+	// the scene file the textures, materials, lights and objects are read from
+	std::string m_scenePath;
+	SceneFile m_sceneFile;
+	// loaded textures info, indexed by texture slot
+	std::vector<TEXTURE_INFO> m_textureIDs;
 	// defined object materials
 	std::vector<OBJECT_MATERIAL> m_objectMaterials;
+	// uniform buffer holding all of the defined materials
+	GLuint m_materialBuffer;
+	// retained list of scene objects to draw every frame
+	std::vector<DRAW_ITEM> m_drawList;
+	// the scale, rotation and position of every draw list object
+	// relative to its group, and the scene graph node of each
+	TransformBatch m_transforms;
+	std::vector<int> m_transformNodes;
+	// the groups and objects of the scene, and for every node the
+	// tag hash of its group or the draw list index of its object
+	SceneGraph m_sceneGraph;
+	std::vector<uint32_t> m_nodeTags;
+	std::vector<int> m_nodeItems;
+	// instanced batches covering the whole draw list
+	std::vector<DRAW_BATCH> m_drawBatches;
+	// frustum test of the draw list bounding spheres
+	FrustumCuller m_frustumCuller;
+	// spreads the per-frame loops over the draw list across threads
+	JobSystem m_jobSystem;
+	// number of threads the job system is started with, 0 for one per core
+	int m_jobThreads;
+	// per draw list object, nonzero when it is inside the frustum
+	std::vector<unsigned char> m_visibleItems;
+	// visibility and detail levels the instance data was last built for
+	std::vector<unsigned char> m_instancedVisibility;
+	std::vector<int> m_instancedLods;
+	// the batches with at least one visible object
+	std::vector<VISIBLE_BATCH> m_visibleBatches;
+	// per draw list object, the detail level it was last drawn at
+	std::vector<int> m_itemLods;
+	// per draw list object, the camera distance of this frame
+	std::vector<float> m_itemDistances;
+	// the visible objects in draw list order and nearest first
+	std::vector<int> m_visibleOrder;
+	std::vector<int> m_drawOrder;
+	// the static geometry groups in state order and nearest first
+	std::vector<int> m_groupStateOrder;
+	std::vector<int> m_groupOrder;
+	// fraction past a level boundary before a detail level changes
+	float m_lodHysteresis;
+	// pixels covered by one unit of length at a distance of one
+	float m_pixelsPerUnit;
+	// shader state left behind by the last submitted draw
+	SHADER_STATE m_appliedState;
 
-	// load texture images and convert to OpenGL texture data
-	bool CreateGLTexture(const char* filename, std::string tag);
-	// bind loaded OpenGL textures to slots in memory
+	// resolve the locations of the uniforms set while rendering
+	void LoadUniformLocations();
+	// bind the program of a shader variant, building it on first use
+	bool UseVariant(int variant);
+	// the shader variant an object with or without a texture is drawn with
+	int GetVariant(bool bTextured);
+	// tell the bound and every later variant where the matrices come from
+	void SetGeometryMode(bool bInstanced, bool bStaticGeometry);
+	// forget the shader state applied to every variant
+	void InvalidateAppliedState();
+
+	// create a texture and queue its image on the texture loader
+	bool CreateGLTexture(const char* filename, const char* tag);
+	// make the loaded OpenGL textures reachable by the shaders
 	void BindGLTextures();
+	// hand the textures the loader finished to the residency
+	void UpdateGLTextures();
+	// tell the texture streamer how large the visible objects show their textures
+	void RequestTextureDetail();
+	// projected diameter in pixels of a bounding sphere in this frame
+	float ComputeProjectedSize(const glm::vec4& bounds);
+	// pick the detail level of every visible object of the static geometry
+	void SelectMeshLods();
 	// free the loaded OpenGL textures
 	void DestroyGLTextures();
-	// find a loaded texture by tag
-	int FindTextureID(std::string tag);
-	int FindTextureSlot(std::string tag);
-	// find a defined material by tag
-	bool FindMaterial(std::string tag, OBJECT_MATERIAL& material);
+	// find a loaded texture by tag hash
+	int FindTextureID(uint32_t tagHash);
+	int FindTextureSlot(uint32_t tagHash);
+	// find a defined material by tag hash
+	bool FindMaterial(uint32_t tagHash, OBJECT_MATERIAL& material);
+	int FindMaterialIndex(uint32_t tagHash);
+	// hash the tags of the defined materials
+	void HashMaterialTags();
+
+	// calculate the model matrix from the transformation values
+	glm::mat4 ComputeTransformations(
+		glm::vec3 scaleXYZ,
+		float XrotationDegrees,
+		float YrotationDegrees,
+		float ZrotationDegrees,
+		glm::vec3 positionXYZ);
 
 	// set the transformation values 
 	// into the transform buffer
@@ -77,6 +314,11 @@ private:
 		float YrotationDegrees,
 		float ZrotationDegrees,
 		glm::vec3 positionXYZ);
+	void SetTransformations(
+		const glm::mat4& modelView);
+	void SetTransformations(
+		const glm::mat4& modelView,
+		const glm::mat3& normalMatrix);
 
 	// set the color values into the shader
 	void SetShaderColor(
@@ -87,7 +329,9 @@ private:
 
 	// set the texture data into the shader
 	void SetShaderTexture(
-		std::string textureTag);
+		const char* textureTag);
+	void SetShaderTexture(
+		int textureSlot);
 
 	// set the UV scale for the texture mapping
 	void SetTextureUVScale(
@@ -95,13 +339,114 @@ private:
 
 	// set the object material into the shader
 	void SetShaderMaterial(
-		std::string materialTag);
+		const char* materialTag);
+	void SetShaderMaterial(
+		int materialIndex);
+
+	// copy the defined materials into the material uniform buffer
+	void UploadSceneMaterials();
+
+	// add a textured object to the retained draw list
+	void AddDrawItem(
+		MESH_ID mesh,
+		glm::vec3 scaleXYZ,
+		float XrotationDegrees,
+		float YrotationDegrees,
+		float ZrotationDegrees,
+		glm::vec3 positionXYZ,
+		uint32_t materialTag,
+		uint32_t textureTag,
+		float u = 1.0f,
+		float v = 1.0f,
+		int groupNode = -1);
+
+	// add a solid colored object to the retained draw list
+	void AddDrawItem(
+		MESH_ID mesh,
+		glm::vec3 scaleXYZ,
+		float XrotationDegrees,
+		float YrotationDegrees,
+		float ZrotationDegrees,
+		glm::vec3 positionXYZ,
+		uint32_t materialTag,
+		glm::vec4 color,
+		int groupNode = -1);
+
+	// add the scene graph node of a new draw list object
+	int AddObjectNode(int groupNode, const glm::vec3& scaleXYZ, const glm::vec3& rotationDegrees, const glm::vec3& positionXYZ);
+
+	// order the draw list so draws sharing shader state are adjacent
+	void SortDrawList();
+
+	// compose the model matrices of the objects that moved, returns
+	// false when none did
+	bool UpdateTransforms();
+
+	// group the sorted draw list into instanced batches
+	void BuildDrawBatches();
+	// pack the visible objects of every batch into the instance data
+	void BuildVisibleBatches();
+	// bake the draw list objects into the static geometry
+	void BuildStaticGeometry();
+	// cull the static geometry and pick its detail levels for this frame
+	void CullStaticGeometry();
+	// draw the visible static geometry groups in the passed in order,
+	// without their texture switches for the depth pass
+	void DrawStaticGeometry(bool bDepthOnly, const std::vector<int>& groupOrder);
+	// draw the visible objects of the static geometry
+	void RenderStaticGeometry(const std::vector<int>& groupOrder);
+	// order the visible objects, batches and groups nearest first
+	void SortFrontToBack(bool bUseStaticGeometry);
+	// lay down the depth of the visible objects with the depth-only program
+	void RenderDepthPrepass(bool bUseStaticGeometry);
+	// bounding sphere of a mesh placed with a model matrix
+	glm::vec4 ComputeBoundingSphere(int mesh, const glm::mat4& model);
+	// calculate the matrix that transforms the normals of an object
+	glm::mat3 ComputeNormalMatrix(const glm::mat4& model);
+
+	// set only the shader state that differs from the last draw
+	void ApplyDrawState(const DRAW_ITEM& item);
+
+	// draw the basic shape mesh with the passed in ID
+	void DrawMesh(int mesh);
+	// draw a range of the instance data of the same mesh
+	void DrawMeshInstanced(int mesh, int lod, int firstInstance, int instanceCount);
 
 	// setup the scene lights
 	void SetupSceneLights();  // Added this line
 
 public:
 
+	// set the memory budget of the streamed texture levels, zero for no limit
+	void SetTextureBudget(size_t budgetBytes);
+	// set how far past a level boundary the curved shapes change detail, zero for none
+	void SetLodHysteresis(float hysteresis);
+	// turn the depth pre-pass before the shading pass on or off
+	void SetDepthPrepass(bool bUseDepthPrepass);
+	// set the scene file loaded by PrepareScene()
+	void SetScenePath(const char* scenePath);
+	// set the threads the per-frame object loops run on, zero for one
+	// per CPU core and one for none besides the render thread
+	void SetJobThreads(int threadCount);
+	// true while texture images are still being loaded, so the scene
+	// is drawn with some of their placeholders
+	bool IsLoadingTextures() const;
+	// true while the texture streamer still has finer levels to read
+	// for the view of the last frame
+	bool IsStreamingTextures() const;
+
+	// find the group of the loaded scene with the passed in tag hash,
+	// returns -1 when there is none
+	int FindSceneGroup(uint32_t tagHash) const;
+	// turn and move a group with everything inside it, relative to
+	// the group it is inside
+	void SetSceneGroupTransform(
+		int group,
+		float XrotationDegrees,
+		float YrotationDegrees,
+		float ZrotationDegrees,
+		glm::vec3 positionXYZ);
+
 	// The following methods are for the students to 
 	// customize for their own 3D scene
 	void PrepareScene();
@@ -112,5 +457,8 @@ public:
 
 	// load all of the needed materials before rendering
 	void LoadSceneMaterials();
+
+	// build the retained draw list of scene objects
+	void LoadSceneObjects();
 	
 };
\ No newline at end of file
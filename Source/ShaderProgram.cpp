@@ -0,0 +1,229 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaderprogram.cpp
+// ============
+// compile and link the shader programs, through the program cache
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ShaderProgram.h"
+#include "ProgramCache.h"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+/***********************************************************
+ *  ReadSource()
+ *
+ *  This method is used for reading the whole of a shader
+ *  file.  Returns false and prints the path when it fails.
+ ***********************************************************/
+bool ShaderProgram::ReadSource(const char* shaderPath, std::string& source)
+{
+	std::ifstream file(shaderPath);
+	std::stringstream text;
+
+	if (!file.is_open())
+	{
+		std::cout << "Could not open shader:" << shaderPath << std::endl;
+		return(false);
+	}
+	text << file.rdbuf();
+	source = text.str();
+
+	return(true);
+}
+
+/***********************************************************
+ *  AddDefines()
+ *
+ *  This method is used for specializing a shader source by
+ *  defining macros right after its version line, which has
+ *  to stay the first line of the source.
+ ***********************************************************/
+void ShaderProgram::AddDefines(std::string& source, const std::string& defines)
+{
+	std::istringstream names(defines);
+	std::string defineLines;
+	std::string name;
+
+	while (names >> name)
+	{
+		defineLines += "#define " + name + "\n";
+	}
+	if (defineLines.empty())
+	{
+		return;
+	}
+
+	size_t insert = 0;
+	if (source.compare(0, 8, "#version") == 0)
+	{
+		insert = source.find('\n');
+		insert = (insert == std::string::npos) ? source.size() : insert + 1;
+	}
+	source.insert(insert, defineLines);
+}
+
+/***********************************************************
+ *  CompileShader()
+ *
+ *  This method is used for compiling one shader stage.
+ *  Returns 0 and prints the log when it fails.
+ ***********************************************************/
+GLuint ShaderProgram::CompileShader(GLenum type, const std::string& source, const char* shaderPath)
+{
+	GLint success = 0;
+	char infoLog[512];
+	const char* pText = source.c_str();
+
+	GLuint shader = glCreateShader(type);
+	glShaderSource(shader, 1, &pText, NULL);
+	glCompileShader(shader);
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+	if (!success)
+	{
+		glGetShaderInfoLog(shader, sizeof(infoLog), NULL, infoLog);
+		std::cout << "ERROR: shader compilation failed:" << shaderPath << std::endl << infoLog << std::endl;
+		glDeleteShader(shader);
+		return(0);
+	}
+
+	return(shader);
+}
+
+/***********************************************************
+ *  LinkProgram()
+ *
+ *  This method is used for linking the compiled stages into
+ *  a program.  The stages are freed either way, and 0 is
+ *  returned with the log printed when any of them is missing
+ *  or the link fails.
+ ***********************************************************/
+GLuint ShaderProgram::LinkProgram(const GLuint* shaders, int shaderCount, const char* name)
+{
+	GLint success = 0;
+	char infoLog[512];
+	bool bComplete = true;
+
+	for (int i = 0; i < shaderCount; i++)
+	{
+		bComplete = bComplete && (shaders[i] != 0);
+	}
+	if (!bComplete)
+	{
+		for (int i = 0; i < shaderCount; i++)
+		{
+			glDeleteShader(shaders[i]);
+		}
+		return(0);
+	}
+
+	GLuint program = glCreateProgram();
+	// the binary can only be read back when this is set before linking
+	if (ProgramCache::IsSupported())
+	{
+		glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+	for (int i = 0; i < shaderCount; i++)
+	{
+		glAttachShader(program, shaders[i]);
+	}
+	glLinkProgram(program);
+	for (int i = 0; i < shaderCount; i++)
+	{
+		glDeleteShader(shaders[i]);
+	}
+
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	if (!success)
+	{
+		glGetProgramInfoLog(program, sizeof(infoLog), NULL, infoLog);
+		std::cout << "ERROR: program linking failed:" << name << std::endl << infoLog << std::endl;
+		glDeleteProgram(program);
+		return(0);
+	}
+
+	return(program);
+}
+
+/***********************************************************
+ *  BuildProgram()
+ *
+ *  This method is used for building a program from its stage
+ *  files.  The key of the program cache is a hash of every
+ *  source, so an edited shader misses the cache and the
+ *  program is compiled again and saved over the old binary.
+ *  The defines are part of the sources and of the name, so
+ *  every variant of the same files is saved on its own.
+ ***********************************************************/
+GLuint ShaderProgram::BuildProgram(const GLenum* types, const char* const* shaderPaths, int stageCount, const char* defines)
+{
+	std::string sources[MAX_PROGRAM_STAGES];
+	std::string name;
+	uint64_t sourceHash = ProgramCache::GetInitialHash();
+
+	for (int i = 0; i < stageCount; i++)
+	{
+		if (!ReadSource(shaderPaths[i], sources[i]))
+		{
+			return(0);
+		}
+		AddDefines(sources[i], defines);
+		sourceHash = ProgramCache::HashSource(sourceHash, types[i], sources[i]);
+		name += (i > 0) ? "+" : "";
+		name += shaderPaths[i];
+	}
+	if (defines[0] != '\0')
+	{
+		name += std::string(" [") + defines + "]";
+	}
+
+	GLuint program = ProgramCache::Load(name.c_str(), sourceHash);
+	if (program != 0)
+	{
+		return(program);
+	}
+
+	GLuint shaders[MAX_PROGRAM_STAGES];
+	for (int i = 0; i < stageCount; i++)
+	{
+		shaders[i] = CompileShader(types[i], sources[i], shaderPaths[i]);
+	}
+
+	program = LinkProgram(shaders, stageCount, name.c_str());
+	if (program != 0)
+	{
+		ProgramCache::Store(program, name.c_str(), sourceHash);
+	}
+
+	return(program);
+}
+
+/***********************************************************
+ *  LoadCompute()
+ *
+ *  This method is used for building a program from a single
+ *  compute shader file.
+ ***********************************************************/
+GLuint ShaderProgram::LoadCompute(const char* computeShaderPath)
+{
+	const GLenum types[1] = { GL_COMPUTE_SHADER };
+	const char* shaderPaths[1] = { computeShaderPath };
+
+	return(BuildProgram(types, shaderPaths, 1, ""));
+}
+
+/***********************************************************
+ *  Load()
+ *
+ *  This method is used for building a program from a vertex
+ *  and a fragment shader file.
+ ***********************************************************/
+GLuint ShaderProgram::Load(const char* vertexShaderPath, const char* fragmentShaderPath, const char* defines)
+{
+	const GLenum types[2] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+	const char* shaderPaths[2] = { vertexShaderPath, fragmentShaderPath };
+
+	return(BuildProgram(types, shaderPaths, 2, (defines != NULL) ? defines : ""));
+}
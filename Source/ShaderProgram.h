@@ -0,0 +1,44 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaderprogram.h
+// ============
+// compile and link the shader programs, through the program cache
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <string>
+
+/***********************************************************
+ *  ShaderProgram
+ *
+ *  This class contains the code for building the shader
+ *  programs from their shader files.  Programs are created
+ *  from the program cache when it holds them for the current
+ *  sources, and saved to it after they are linked.
+ ***********************************************************/
+class ShaderProgram
+{
+public:
+	// most shader stages one program is built from
+	static const int MAX_PROGRAM_STAGES = 2;
+
+	// compile and link a compute program from a file, returns 0 when it fails
+	static GLuint LoadCompute(const char* computeShaderPath);
+	// compile and link a vertex and fragment program with the space separated
+	// macro names defined in both stages, returns 0 when it fails
+	static GLuint Load(const char* vertexShaderPath, const char* fragmentShaderPath, const char* defines = "");
+
+private:
+	// read the source of a shader file, returns false when it can not be opened
+	static bool ReadSource(const char* shaderPath, std::string& source);
+	// put a define line for each of the macro names after the version line
+	static void AddDefines(std::string& source, const std::string& defines);
+	// build a program from its stage files, going through the program cache
+	static GLuint BuildProgram(const GLenum* types, const char* const* shaderPaths, int stageCount, const char* defines);
+	// compile one shader stage, returns 0 when it fails
+	static GLuint CompileShader(GLenum type, const std::string& source, const char* shaderPath);
+	// link the compiled stages and free them, returns 0 when it fails
+	static GLuint LinkProgram(const GLuint* shaders, int shaderCount, const char* name);
+};
@@ -0,0 +1,166 @@
+///////////////////////////////////////////////////////////////////////////////
+// shadervariants.cpp
+// ============
+// build the specialized variants of the scene shader program
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ShaderVariants.h"
+#include "ShaderProgram.h"
+
+#include <iostream>
+
+// declaration of the global variables and defines
+namespace
+{
+	// number of feature flags, and the macro each one defines
+	const int g_FlagCount = 2;
+	const char* g_FlagDefines[g_FlagCount] =
+	{
+		"USE_TEXTURE",
+		"USE_LIGHTING"
+	};
+}
+
+/***********************************************************
+ *  ShaderVariants()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ShaderVariants::ShaderVariants()
+{
+	for (int i = 0; i < VARIANT_COUNT; i++)
+	{
+		m_programs[i] = 0;
+		m_bFailed[i] = false;
+	}
+}
+
+/***********************************************************
+ *  ~ShaderVariants()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ShaderVariants::~ShaderVariants()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for setting the shader files of the
+ *  variants.  The programs are built on demand.
+ ***********************************************************/
+void ShaderVariants::Create(const char* vertexShaderPath, const char* fragmentShaderPath)
+{
+	Destroy();
+
+	m_vertexShaderPath = vertexShaderPath;
+	m_fragmentShaderPath = fragmentShaderPath;
+}
+
+/***********************************************************
+ *  GetDefines()
+ *
+ *  This method is used for listing the macro names of the
+ *  feature flags that are set for a variant.
+ ***********************************************************/
+std::string ShaderVariants::GetDefines(int variant)
+{
+	std::string defines;
+
+	for (int i = 0; i < g_FlagCount; i++)
+	{
+		if ((variant & (1 << i)) != 0)
+		{
+			defines += defines.empty() ? "" : " ";
+			defines += g_FlagDefines[i];
+		}
+	}
+
+	return(defines);
+}
+
+/***********************************************************
+ *  Build()
+ *
+ *  This method is used for building the program of a variant
+ *  and caching the locations of its uniforms.  A variant
+ *  that failed once is not built again, so a broken shader
+ *  reports its errors a single time.
+ ***********************************************************/
+bool ShaderVariants::Build(int variant)
+{
+	if ((variant < 0) || (variant >= VARIANT_COUNT) || m_bFailed[variant])
+	{
+		return(false);
+	}
+	if (m_programs[variant] != 0)
+	{
+		return(true);
+	}
+
+	std::string defines = GetDefines(variant);
+
+	m_programs[variant] = ShaderProgram::Load(m_vertexShaderPath.c_str(), m_fragmentShaderPath.c_str(), defines.c_str());
+	if (m_programs[variant] == 0)
+	{
+		std::cout << "ERROR: could not build the shader variant [" << defines << "]" << std::endl;
+		m_bFailed[variant] = true;
+		return(false);
+	}
+
+	m_uniformCaches[variant].LoadProgram(m_programs[variant]);
+
+	return(true);
+}
+
+/***********************************************************
+ *  GetProgram()
+ *
+ *  This method is used for getting the program of a variant.
+ ***********************************************************/
+GLuint ShaderVariants::GetProgram(int variant) const
+{
+	if ((variant < 0) || (variant >= VARIANT_COUNT))
+	{
+		return(0);
+	}
+
+	return(m_programs[variant]);
+}
+
+/***********************************************************
+ *  GetUniformCache()
+ *
+ *  This method is used for getting the uniform locations of
+ *  a variant.
+ ***********************************************************/
+UniformCache* ShaderVariants::GetUniformCache(int variant)
+{
+	if ((variant < 0) || (variant >= VARIANT_COUNT))
+	{
+		return(NULL);
+	}
+
+	return(&m_uniformCaches[variant]);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the programs of all the
+ *  variants.
+ ***********************************************************/
+void ShaderVariants::Destroy()
+{
+	for (int i = 0; i < VARIANT_COUNT; i++)
+	{
+		if (m_programs[i] != 0)
+		{
+			glDeleteProgram(m_programs[i]);
+			m_programs[i] = 0;
+		}
+		m_bFailed[i] = false;
+	}
+}
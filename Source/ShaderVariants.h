@@ -0,0 +1,68 @@
+///////////////////////////////////////////////////////////////////////////////
+// shadervariants.h
+// ============
+// build the specialized variants of the scene shader program
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "UniformCache.h"
+
+#include <GL/glew.h>
+
+#include <string>
+
+/***********************************************************
+ *  ShaderVariants
+ *
+ *  This class contains the code for building the scene
+ *  shaders once for every combination of their features.
+ *  Each feature flag turns on a define, so a variant has no
+ *  runtime branches for the features it was built without.
+ *  Variants are built the first time they are asked for and
+ *  each keeps the uniform locations of its own program.
+ ***********************************************************/
+class ShaderVariants
+{
+public:
+	// constructor
+	ShaderVariants();
+	// destructor
+	~ShaderVariants();
+
+	// the features a variant is built for - the defines are listed
+	// in ShaderVariants.cpp and must match the shaders
+	enum VARIANT_FLAG
+	{
+		VARIANT_TEXTURE = 0x1,
+		VARIANT_LIGHTING = 0x2
+	};
+	// number of feature combinations
+	static const int VARIANT_COUNT = 4;
+
+	// set the shader files every variant is built from
+	void Create(const char* vertexShaderPath, const char* fragmentShaderPath);
+	// build a variant unless it is built already, returns false when it
+	// fails to build, and keeps failing without trying again
+	bool Build(int variant);
+	// the program of a built variant, 0 before it is built
+	GLuint GetProgram(int variant) const;
+	// the uniform locations of a built variant
+	UniformCache* GetUniformCache(int variant);
+
+	// free the programs of all the variants
+	void Destroy();
+
+private:
+	// the shader files of the variants
+	std::string m_vertexShaderPath;
+	std::string m_fragmentShaderPath;
+	// the program and uniform locations of every variant
+	GLuint m_programs[VARIANT_COUNT];
+	UniformCache m_uniformCaches[VARIANT_COUNT];
+	// true for the variants that failed to build
+	bool m_bFailed[VARIANT_COUNT];
+
+	// the macro names defined for a variant
+	static std::string GetDefines(int variant);
+};
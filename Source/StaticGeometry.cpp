@@ -0,0 +1,379 @@
+///////////////////////////////////////////////////////////////////////////////
+// staticgeometry.cpp
+// ============
+// merge rarely moving objects into one pre-transformed vertex and index buffer
+///////////////////////////////////////////////////////////////////////////////
+
+#include "StaticGeometry.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+
+// declaration of the global variables and defines
+namespace
+{
+	// vertex attribute locations used in the vertex shader - the
+	// indices share their location with the per-instance ones
+	const GLuint g_PositionLocation = 0;
+	const GLuint g_NormalLocation = 1;
+	const GLuint g_TextureCoordinateLocation = 2;
+	const GLuint g_IndicesLocation = 7;
+	const GLuint g_ColorLocation = 8;
+}
+
+/***********************************************************
+ *  StaticGeometry()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+StaticGeometry::StaticGeometry()
+{
+	m_vao = 0;
+	m_vbos[0] = 0;
+	m_vbos[1] = 0;
+}
+
+/***********************************************************
+ *  ~StaticGeometry()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+StaticGeometry::~StaticGeometry()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  AddMesh()
+ *
+ *  This method is used for appending the detail levels of a
+ *  mesh transformed into world space.  The vertices of all of
+ *  the levels are kept next to each other, so the object can
+ *  be baked again in place when it moves.
+ ***********************************************************/
+void StaticGeometry::AddMesh(
+	int itemIndex,
+	const MeshGeometry::MESH_DATA* pLods,
+	int lodCount,
+	const glm::mat4& model,
+	const glm::mat3& normalMatrix,
+	glm::vec2 uvScale,
+	int materialIndex,
+	int textureSlot,
+	glm::vec4 color)
+{
+	PIECE piece;
+
+	piece.itemIndex = itemIndex;
+	piece.textureSlot = textureSlot;
+	piece.firstVertex = (GLuint)m_vertices.size();
+
+	for (int lod = 0; lod < MESH_LOD_COUNT; lod++)
+	{
+		// the missing levels share the range of the coarsest one
+		if (lod >= lodCount)
+		{
+			piece.firstIndex[lod] = piece.firstIndex[lodCount - 1];
+			piece.indexCount[lod] = piece.indexCount[lodCount - 1];
+			continue;
+		}
+
+		const MeshGeometry::MESH_DATA& mesh = pLods[lod];
+		GLuint firstVertex = (GLuint)m_vertices.size();
+
+		piece.firstIndex[lod] = (GLuint)m_indices.size();
+		piece.indexCount[lod] = (GLsizei)mesh.indices.size();
+
+		BakeVertices(mesh, model, normalMatrix, uvScale, materialIndex, textureSlot, color, m_vertices);
+		for (int i = 0; i < mesh.indices.size(); i++)
+		{
+			m_indices.push_back(firstVertex + mesh.indices[i]);
+		}
+	}
+	piece.vertexCount = (GLsizei)(m_vertices.size() - piece.firstVertex);
+	m_pieces.push_back(piece);
+}
+
+/***********************************************************
+ *  BakeVertices()
+ *
+ *  This method is used for transforming the vertices of one
+ *  detail level into world space.  The normals use the normal
+ *  matrix of the object, the same one the other draw paths
+ *  pass to the shader, so every path lights alike, and the
+ *  texture coordinates are scaled up front.
+ ***********************************************************/
+void StaticGeometry::BakeVertices(
+	const MeshGeometry::MESH_DATA& mesh,
+	const glm::mat4& model,
+	const glm::mat3& normalMatrix,
+	glm::vec2 uvScale,
+	int materialIndex,
+	int textureSlot,
+	glm::vec4 color,
+	std::vector<BAKED_VERTEX>& vertices)
+{
+	for (int i = 0; i < mesh.vertices.size(); i++)
+	{
+		const MeshGeometry::VERTEX& vertex = mesh.vertices[i];
+		BAKED_VERTEX baked;
+
+		baked.position = glm::vec3(model * glm::vec4(vertex.position, 1.0f));
+		baked.normal = MeshGeometry::PackNormal(glm::normalize(normalMatrix * vertex.normal));
+		baked.textureCoordinate = vertex.textureCoordinate * uvScale;
+		baked.materialIndex = (GLshort)materialIndex;
+		baked.textureSlot = (GLshort)textureSlot;
+		for (int channel = 0; channel < 4; channel++)
+		{
+			float value = glm::clamp(color[channel], 0.0f, 1.0f);
+			baked.color[channel] = (GLubyte)(value * 255.0f + 0.5f);
+		}
+		vertices.push_back(baked);
+	}
+}
+
+/***********************************************************
+ *  Upload()
+ *
+ *  This method is used for ordering the added objects by
+ *  texture slot, so every group is one run of the index
+ *  buffer, and for creating the vertex array object, vertex
+ *  buffer and index buffer.  The world space data is freed
+ *  once it is uploaded.
+ ***********************************************************/
+void StaticGeometry::Upload()
+{
+	const GLsizei vertexStride = sizeof(BAKED_VERTEX);
+	std::vector<PIECE> pieces = m_pieces;
+	std::vector<GLuint> indices;
+
+	Destroy();
+	if (pieces.empty())
+	{
+		return;
+	}
+
+	std::stable_sort(pieces.begin(), pieces.end(),
+		[](const PIECE& a, const PIECE& b)
+		{
+			return(a.textureSlot < b.textureSlot);
+		});
+
+	// copy the index ranges in group order, the levels of an
+	// object stay next to each other
+	indices.reserve(m_indices.size());
+	for (int i = 0; i < pieces.size(); i++)
+	{
+		PIECE& piece = pieces[i];
+		PIECE source = piece;
+
+		for (int lod = 0; lod < MESH_LOD_COUNT; lod++)
+		{
+			// a level sharing the range of the previous one is copied once
+			if ((lod > 0) && (source.firstIndex[lod] == source.firstIndex[lod - 1]))
+			{
+				piece.firstIndex[lod] = piece.firstIndex[lod - 1];
+				continue;
+			}
+
+			piece.firstIndex[lod] = (GLuint)indices.size();
+			indices.insert(indices.end(),
+				m_indices.begin() + source.firstIndex[lod],
+				m_indices.begin() + source.firstIndex[lod] + source.indexCount[lod]);
+		}
+
+		if (m_groups.empty() || (m_groups.back().textureSlot != piece.textureSlot))
+		{
+			GROUP group;
+			group.textureSlot = piece.textureSlot;
+			group.firstPiece = i;
+			group.pieceCount = 0;
+			m_groups.push_back(group);
+		}
+		m_groups.back().pieceCount++;
+	}
+
+	glGenVertexArrays(1, &m_vao);
+	glBindVertexArray(m_vao);
+
+	glGenBuffers(2, m_vbos);
+	glBindBuffer(GL_ARRAY_BUFFER, m_vbos[0]);
+	glBufferData(GL_ARRAY_BUFFER, m_vertices.size() * sizeof(BAKED_VERTEX), m_vertices.data(), GL_STATIC_DRAW);
+
+	glEnableVertexAttribArray(g_PositionLocation);
+	glVertexAttribPointer(g_PositionLocation, 3, GL_FLOAT, GL_FALSE, vertexStride,
+		(void*)offsetof(BAKED_VERTEX, position));
+	glEnableVertexAttribArray(g_NormalLocation);
+	glVertexAttribPointer(g_NormalLocation, 4, GL_INT_2_10_10_10_REV, GL_TRUE, vertexStride,
+		(void*)offsetof(BAKED_VERTEX, normal));
+	glEnableVertexAttribArray(g_TextureCoordinateLocation);
+	glVertexAttribPointer(g_TextureCoordinateLocation, 2, GL_FLOAT, GL_FALSE, vertexStride,
+		(void*)offsetof(BAKED_VERTEX, textureCoordinate));
+	glEnableVertexAttribArray(g_IndicesLocation);
+	glVertexAttribIPointer(g_IndicesLocation, 2, GL_SHORT, vertexStride,
+		(void*)offsetof(BAKED_VERTEX, materialIndex));
+	glEnableVertexAttribArray(g_ColorLocation);
+	glVertexAttribPointer(g_ColorLocation, 4, GL_UNSIGNED_BYTE, GL_TRUE, vertexStride,
+		(void*)offsetof(BAKED_VERTEX, color));
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_vbos[1]);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	m_pieces = pieces;
+	m_vertices = std::vector<BAKED_VERTEX>();
+	m_indices = std::vector<GLuint>();
+
+	for (int i = 0; i < m_pieces.size(); i++)
+	{
+		int itemIndex = m_pieces[i].itemIndex;
+
+		if (itemIndex >= (int)m_itemPieces.size())
+		{
+			m_itemPieces.resize(itemIndex + 1, -1);
+		}
+		m_itemPieces[itemIndex] = i;
+	}
+}
+
+/***********************************************************
+ *  UpdateMesh()
+ *
+ *  This method is used for baking an uploaded object again
+ *  after it moved.  Only its own range of the vertex buffer
+ *  is written, and the index ranges stay the same, so the
+ *  groups and the GPU culler objects are still valid.
+ ***********************************************************/
+void StaticGeometry::UpdateMesh(
+	int itemIndex,
+	const MeshGeometry::MESH_DATA* pLods,
+	int lodCount,
+	const glm::mat4& model,
+	const glm::mat3& normalMatrix,
+	glm::vec2 uvScale,
+	int materialIndex,
+	int textureSlot,
+	glm::vec4 color)
+{
+	int pieceIndex = GetItemPiece(itemIndex);
+
+	if (pieceIndex < 0)
+	{
+		return;
+	}
+
+	const PIECE& piece = m_pieces[pieceIndex];
+
+	m_updateVertices.clear();
+	for (int lod = 0; lod < lodCount; lod++)
+	{
+		BakeVertices(pLods[lod], model, normalMatrix, uvScale, materialIndex, textureSlot, color, m_updateVertices);
+	}
+
+	// a different mesh would not fit into the range of the object
+	if (m_updateVertices.size() != piece.vertexCount)
+	{
+		std::cout << "ERROR: The baked object " << itemIndex << " changed its vertex count" << std::endl;
+		return;
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, m_vbos[0]);
+	glBufferSubData(GL_ARRAY_BUFFER, piece.firstVertex * sizeof(BAKED_VERTEX),
+		m_updateVertices.size() * sizeof(BAKED_VERTEX), m_updateVertices.data());
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/***********************************************************
+ *  GetItemPiece()
+ *
+ *  This method is used for finding the uploaded piece of an
+ *  added object by its item index.
+ ***********************************************************/
+int StaticGeometry::GetItemPiece(int itemIndex) const
+{
+	if ((m_vao == 0) || (itemIndex < 0) || (itemIndex >= m_itemPieces.size()))
+	{
+		return(-1);
+	}
+
+	return(m_itemPieces[itemIndex]);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the OpenGL objects of the
+ *  baked geometry and forgetting the groups.
+ ***********************************************************/
+void StaticGeometry::Destroy()
+{
+	if (m_vao != 0)
+	{
+		glDeleteVertexArrays(1, &m_vao);
+		glDeleteBuffers(2, m_vbos);
+		m_vao = 0;
+		m_vbos[0] = 0;
+		m_vbos[1] = 0;
+	}
+	m_groups.clear();
+	m_itemPieces.clear();
+}
+
+/***********************************************************
+ *  DrawGroup()
+ *
+ *  This method is used for drawing the visible objects of a
+ *  group at their detail levels.  Objects whose ranges are
+ *  next to each other in the index buffer are merged, and
+ *  all of the ranges are drawn with one multi draw call.
+ ***********************************************************/
+bool StaticGeometry::DrawGroup(
+	int group,
+	const std::vector<unsigned char>& visibleItems,
+	const std::vector<int>& itemLods)
+{
+	const GROUP& drawGroup = m_groups[group];
+
+	m_drawCounts.clear();
+	m_drawOffsets.clear();
+
+	GLuint rangeEnd = 0;
+	for (int i = drawGroup.firstPiece; i < drawGroup.firstPiece + drawGroup.pieceCount; i++)
+	{
+		const PIECE& piece = m_pieces[i];
+
+		if (visibleItems[piece.itemIndex] == 0)
+		{
+			continue;
+		}
+
+		int lod = itemLods[piece.itemIndex];
+		GLuint firstIndex = piece.firstIndex[lod];
+
+		if (!m_drawCounts.empty() && (rangeEnd == firstIndex))
+		{
+			m_drawCounts.back() += piece.indexCount[lod];
+		}
+		else
+		{
+			m_drawCounts.push_back(piece.indexCount[lod]);
+			m_drawOffsets.push_back((const void*)(firstIndex * sizeof(GLuint)));
+		}
+		rangeEnd = firstIndex + piece.indexCount[lod];
+	}
+
+	if (m_drawCounts.empty())
+	{
+		return(false);
+	}
+
+	glBindVertexArray(m_vao);
+	glMultiDrawElements(GL_TRIANGLES, m_drawCounts.data(), GL_UNSIGNED_INT,
+		m_drawOffsets.data(), (GLsizei)m_drawCounts.size());
+	glBindVertexArray(0);
+
+	return(true);
+}
@@ -0,0 +1,162 @@
+///////////////////////////////////////////////////////////////////////////////
+// staticgeometry.h
+// ============
+// merge rarely moving objects into one pre-transformed vertex and index buffer
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MeshGeometry.h"
+#include "MeshLod.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  StaticGeometry
+ *
+ *  This class contains the code for baking objects into world
+ *  space once, so they need no model matrix while rendering.
+ *  An object that moves later has just its own vertices baked
+ *  again in place.  Every vertex carries the material index,
+ *  texture slot and color of its object.  The objects are
+ *  grouped by texture slot and every group is drawn with one
+ *  multi draw call covering just its visible objects, each at
+ *  its own detail level.
+ ***********************************************************/
+class StaticGeometry
+{
+public:
+	// constructor
+	StaticGeometry();
+	// destructor
+	~StaticGeometry();
+
+	// one baked vertex - matches the vertex shader inputs.  The
+	// world space position and the scaled texture coordinate keep
+	// full floats, the normal is 10:10:10:2, the indices are shorts
+	// and the color is 8 bit per channel
+	struct BAKED_VERTEX
+	{
+		glm::vec3 position;
+		GLuint normal;
+		glm::vec2 textureCoordinate;
+		GLshort materialIndex;
+		GLshort textureSlot;
+		GLubyte color[4];
+	};
+
+	// transform the detail levels of a mesh into world space and
+	// append them, the normals by the normal matrix of the object,
+	// the item index is the one used for the visibility and the
+	// detail level of the object - shapes with fewer levels
+	// than MESH_LOD_COUNT repeat their coarsest one
+	void AddMesh(
+		int itemIndex,
+		const MeshGeometry::MESH_DATA* pLods,
+		int lodCount,
+		const glm::mat4& model,
+		const glm::mat3& normalMatrix,
+		glm::vec2 uvScale,
+		int materialIndex,
+		int textureSlot,
+		glm::vec4 color);
+
+	// group the added objects and create the OpenGL buffers, once
+	void Upload();
+	// bake an uploaded object again at a new model matrix, with the
+	// same detail levels and values it was added with
+	void UpdateMesh(
+		int itemIndex,
+		const MeshGeometry::MESH_DATA* pLods,
+		int lodCount,
+		const glm::mat4& model,
+		const glm::mat3& normalMatrix,
+		glm::vec2 uvScale,
+		int materialIndex,
+		int textureSlot,
+		glm::vec4 color);
+	// free the OpenGL buffers
+	void Destroy();
+
+	// true when nothing has been uploaded
+	bool IsEmpty() const { return(m_groups.empty()); }
+
+	// the groups sharing a texture slot, -1 for the solid colored one
+	int GetGroupCount() const { return((int)m_groups.size()); }
+	int GetGroupTextureSlot(int group) const { return(m_groups[group].textureSlot); }
+
+	// draw the objects of a group that are flagged visible at their
+	// detail levels, returns false when none of them is visible
+	bool DrawGroup(
+		int group,
+		const std::vector<unsigned char>& visibleItems,
+		const std::vector<int>& itemLods);
+
+	// the index ranges of the detail levels of one added object
+	struct PIECE
+	{
+		int itemIndex;
+		int textureSlot;
+		GLuint firstIndex[MESH_LOD_COUNT];
+		GLsizei indexCount[MESH_LOD_COUNT];
+		// the vertices of all of the levels, which stay in the order
+		// they were added
+		GLuint firstVertex;
+		GLsizei vertexCount;
+	};
+
+	// the uploaded objects, ordered by group, for drawing them elsewhere
+	int GetPieceCount() const { return((int)m_pieces.size()); }
+	const PIECE& GetPiece(int piece) const { return(m_pieces[piece]); }
+	// the piece of an added object, -1 when it was not uploaded
+	int GetItemPiece(int itemIndex) const;
+	int GetGroupFirstPiece(int group) const { return(m_groups[group].firstPiece); }
+	int GetGroupPieceCount(int group) const { return(m_groups[group].pieceCount); }
+	// bind or unbind the vertex array of the baked geometry
+	void BindVertexArray() const { glBindVertexArray(m_vao); }
+	void UnbindVertexArray() const { glBindVertexArray(0); }
+
+private:
+
+	// the consecutive pieces sharing a texture slot
+	struct GROUP
+	{
+		int textureSlot;
+		int firstPiece;
+		int pieceCount;
+	};
+
+	// world space data of the added objects until they are uploaded
+	std::vector<BAKED_VERTEX> m_vertices;
+	std::vector<GLuint> m_indices;
+	// the added objects, ordered by group after the upload
+	std::vector<PIECE> m_pieces;
+	std::vector<GROUP> m_groups;
+	// the piece of every item index after the upload
+	std::vector<int> m_itemPieces;
+
+	// the OpenGL objects of the baked geometry
+	GLuint m_vao;
+	GLuint m_vbos[2];
+
+	// ranges passed to the multi draw call, kept to avoid allocations
+	std::vector<GLsizei> m_drawCounts;
+	std::vector<const void*> m_drawOffsets;
+	// vertices of an object baked again, kept to avoid allocations
+	std::vector<BAKED_VERTEX> m_updateVertices;
+
+	// transform the vertices of one detail level into world space
+	// and append them
+	static void BakeVertices(
+		const MeshGeometry::MESH_DATA& mesh,
+		const glm::mat4& model,
+		const glm::mat3& normalMatrix,
+		glm::vec2 uvScale,
+		int materialIndex,
+		int textureSlot,
+		glm::vec4 color,
+		std::vector<BAKED_VERTEX>& vertices);
+};
@@ -0,0 +1,227 @@
+///////////////////////////////////////////////////////////////////////////////
+// streambuffer.cpp
+// ============
+// stream the per-frame data to the GPU through one persistently mapped buffer
+///////////////////////////////////////////////////////////////////////////////
+
+#include "StreamBuffer.h"
+
+#include <algorithm>
+#include <iostream>
+
+// declaration of the global variables and defines
+namespace
+{
+	// longest time to wait for the GPU to release a buffer region
+	const GLuint64 g_FenceTimeout = 1000000000; // one second in nanoseconds
+}
+
+/***********************************************************
+ *  StreamBuffer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+StreamBuffer::StreamBuffer()
+{
+	m_buffer = 0;
+	m_pMappedBuffer = NULL;
+	m_regionSize = 0;
+	m_region = 0;
+	m_regionUsed = 0;
+	for (int i = 0; i < FRAME_REGIONS; i++)
+	{
+		m_regionFences[i] = 0;
+	}
+	m_uniformAlignment = 1;
+	m_storageAlignment = 1;
+	m_bReportedFull = false;
+}
+
+/***********************************************************
+ *  ~StreamBuffer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+StreamBuffer::~StreamBuffer()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for creating the buffer.  With OpenGL
+ *  4.4 it holds one region per frame in flight and stays
+ *  mapped until it is destroyed, otherwise it holds the one
+ *  region the staged data is copied into.
+ ***********************************************************/
+void StreamBuffer::Create(GLsizeiptr regionSize)
+{
+	GLint alignment = 0;
+
+	Destroy();
+
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	m_uniformAlignment = (alignment > 1) ? alignment : 1;
+	alignment = 0;
+	glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	m_storageAlignment = (alignment > 1) ? alignment : 1;
+
+	// every region starts on a boundary both kinds of ranges accept
+	GLsizeiptr regionAlignment = std::max(m_uniformAlignment, m_storageAlignment);
+	m_regionSize = ((regionSize + regionAlignment - 1) / regionAlignment) * regionAlignment;
+
+	glGenBuffers(1, &m_buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+
+	if (GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage)
+	{
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+		glBufferStorage(GL_COPY_WRITE_BUFFER, m_regionSize * FRAME_REGIONS, NULL, flags);
+		m_pMappedBuffer = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, m_regionSize * FRAME_REGIONS, flags);
+	}
+	if (m_pMappedBuffer == NULL)
+	{
+		// immutable storage can not be specified again, so the
+		// staged fallback starts over with a fresh buffer
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		glDeleteBuffers(1, &m_buffer);
+		glGenBuffers(1, &m_buffer);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+		glBufferData(GL_COPY_WRITE_BUFFER, m_regionSize, NULL, GL_DYNAMIC_DRAW);
+		m_staging.resize(m_regionSize);
+	}
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the fences and the buffer.
+ ***********************************************************/
+void StreamBuffer::Destroy()
+{
+	for (int i = 0; i < FRAME_REGIONS; i++)
+	{
+		if (m_regionFences[i] != 0)
+		{
+			glDeleteSync(m_regionFences[i]);
+			m_regionFences[i] = 0;
+		}
+	}
+
+	if (m_buffer != 0)
+	{
+		if (m_pMappedBuffer != NULL)
+		{
+			glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+			glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+			m_pMappedBuffer = NULL;
+		}
+		glDeleteBuffers(1, &m_buffer);
+		m_buffer = 0;
+	}
+
+	m_staging.clear();
+	m_region = 0;
+	m_regionUsed = 0;
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for waiting until the GPU has finished
+ *  reading the region of this frame in the frame that last
+ *  used it.  With enough regions in flight the fence has
+ *  long passed and this returns right away.
+ ***********************************************************/
+void StreamBuffer::BeginFrame()
+{
+	m_regionUsed = 0;
+
+	if (m_regionFences[m_region] != 0)
+	{
+		glClientWaitSync(m_regionFences[m_region], GL_SYNC_FLUSH_COMMANDS_BIT, g_FenceTimeout);
+		glDeleteSync(m_regionFences[m_region]);
+		m_regionFences[m_region] = 0;
+	}
+}
+
+/***********************************************************
+ *  Allocate()
+ *
+ *  This method is used for handing out room in the region of
+ *  the current frame.  The offset is aligned within the
+ *  whole buffer, so it can be bound as a buffer range.
+ ***********************************************************/
+bool StreamBuffer::Allocate(GLsizeiptr size, GLsizeiptr alignment, ALLOCATION& allocation)
+{
+	if ((m_buffer == 0) || (size <= 0))
+	{
+		return(false);
+	}
+	if (alignment < 1)
+	{
+		alignment = 1;
+	}
+
+	GLsizeiptr regionStart = (m_pMappedBuffer != NULL) ? m_region * m_regionSize : 0;
+	GLsizeiptr offset = (((regionStart + m_regionUsed) + alignment - 1) / alignment) * alignment;
+
+	if (offset + size > regionStart + m_regionSize)
+	{
+		if (!m_bReportedFull)
+		{
+			std::cout << "ERROR: the stream buffer region of " << m_regionSize << " bytes is full" << std::endl;
+			m_bReportedFull = true;
+		}
+		return(false);
+	}
+
+	allocation.offset = offset;
+	allocation.size = size;
+	allocation.pData = (m_pMappedBuffer != NULL) ? m_pMappedBuffer + offset : m_staging.data() + offset;
+	m_regionUsed = offset + size - regionStart;
+
+	return(true);
+}
+
+/***********************************************************
+ *  Commit()
+ *
+ *  This method is used for making a written allocation
+ *  visible to the GPU.  The mapping is coherent, so only the
+ *  staged data needs a copy.
+ ***********************************************************/
+void StreamBuffer::Commit(const ALLOCATION& allocation)
+{
+	if ((m_pMappedBuffer != NULL) || (m_buffer == 0))
+	{
+		return;
+	}
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, allocation.offset, allocation.size, allocation.pData);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for fencing the region of the current
+ *  frame after all of its draws were submitted, and moving
+ *  on to the next region.
+ ***********************************************************/
+void StreamBuffer::EndFrame()
+{
+	if (m_pMappedBuffer == NULL)
+	{
+		return;
+	}
+
+	m_regionFences[m_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	m_region = (m_region + 1) % FRAME_REGIONS;
+}
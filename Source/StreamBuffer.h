@@ -0,0 +1,88 @@
+///////////////////////////////////////////////////////////////////////////////
+// streambuffer.h
+// ============
+// stream the per-frame data to the GPU through one persistently mapped buffer
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <vector>
+
+/***********************************************************
+ *  StreamBuffer
+ *
+ *  This class contains the code for handing out room for the
+ *  data that is written again every frame - the frame block,
+ *  the light cluster setup and whatever later passes need.
+ *  The buffer holds one region per frame in flight and stays
+ *  mapped for its whole lifetime, so the data is written
+ *  straight into memory the GPU reads.  A fence after the
+ *  draws of a frame tells when its region may be reused, so
+ *  the driver never has to synchronize on its own.  Without
+ *  OpenGL 4.4 the data is staged in memory and copied into a
+ *  single region instead.
+ ***********************************************************/
+class StreamBuffer
+{
+public:
+	// constructor
+	StreamBuffer();
+	// destructor
+	~StreamBuffer();
+
+	// number of buffer regions, one per frame in flight
+	static const int FRAME_REGIONS = 3;
+	// bytes every frame may allocate
+	static const GLsizeiptr DEFAULT_REGION_SIZE = 64 * 1024;
+
+	// room handed out for this frame - pData may be written until
+	// the draws reading it are submitted
+	struct ALLOCATION
+	{
+		unsigned char* pData;
+		GLintptr offset;
+		GLsizeiptr size;
+	};
+
+	// create and map the buffer - needs a current OpenGL context
+	void Create(GLsizeiptr regionSize = DEFAULT_REGION_SIZE);
+	// unmap and free the buffer
+	void Destroy();
+
+	// wait until the GPU is done with the region of this frame
+	void BeginFrame();
+	// hand out room in the region of this frame, returns false when
+	// the region is full
+	bool Allocate(GLsizeiptr size, GLsizeiptr alignment, ALLOCATION& allocation);
+	// finish writing an allocation before it is drawn with
+	void Commit(const ALLOCATION& allocation);
+	// fence the region after the draws of the frame were submitted
+	void EndFrame();
+
+	// the buffer the allocations are bound from
+	GLuint GetBuffer() const { return(m_buffer); }
+	// offset alignments of uniform and storage buffer ranges
+	GLsizeiptr GetUniformAlignment() const { return(m_uniformAlignment); }
+	GLsizeiptr GetStorageAlignment() const { return(m_storageAlignment); }
+
+private:
+	// the buffer object
+	GLuint m_buffer;
+	// persistently mapped pointer to the buffer, NULL when not supported
+	unsigned char* m_pMappedBuffer;
+	// the staged data of the frame when the buffer is not mapped
+	std::vector<unsigned char> m_staging;
+	// size of one region
+	GLsizeiptr m_regionSize;
+	// region of the current frame and how much of it is handed out
+	int m_region;
+	GLsizeiptr m_regionUsed;
+	// fences marking when the GPU has finished reading each region
+	GLsync m_regionFences[FRAME_REGIONS];
+	GLsizeiptr m_uniformAlignment;
+	GLsizeiptr m_storageAlignment;
+	// true once a full region has been reported
+	bool m_bReportedFull;
+};
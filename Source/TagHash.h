@@ -0,0 +1,30 @@
+///////////////////////////////////////////////////////////////////////////////
+// taghash.h
+// ============
+// hash the string tags of textures and materials into integer handles
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+
+/***********************************************************
+ *  TagHash()
+ *
+ *  This function is used for hashing a texture or material
+ *  tag with 32-bit FNV-1a.  It is constexpr, so hashes of
+ *  literal tags can be computed at compile time.
+ ***********************************************************/
+constexpr uint32_t TagHash(const char* tag)
+{
+	uint32_t hash = 2166136261u;
+
+	while (*tag != '\0')
+	{
+		hash ^= (uint8_t)(*tag);
+		hash *= 16777619u;
+		tag++;
+	}
+
+	return(hash);
+}
@@ -0,0 +1,421 @@
+///////////////////////////////////////////////////////////////////////////////
+// textureloader.cpp
+// ============
+// decode texture images on worker threads and upload them through pixel buffers
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureLoader.h"
+
+#include "stb_image.h"
+
+#include <cstring>
+#include <iostream>
+
+// declaration of the global variables and defines
+namespace
+{
+	// mid gray texel shown until the real image is uploaded
+	const unsigned char g_PlaceholderTexel[4] = { 128, 128, 128, 255 };
+}
+
+/***********************************************************
+ *  TextureLoader()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TextureLoader::TextureLoader()
+{
+	m_bRunning = false;
+}
+
+/***********************************************************
+ *  ~TextureLoader()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+TextureLoader::~TextureLoader()
+{
+	Stop();
+}
+
+/***********************************************************
+ *  Start()
+ *
+ *  This method is used for starting the worker threads.  The
+ *  vertical flip of stb_image is a global setting, so it is
+ *  set here once before any worker can decode.
+ ***********************************************************/
+void TextureLoader::Start(int threadCount)
+{
+	if (m_bRunning)
+	{
+		return;
+	}
+
+	if (threadCount <= 0)
+	{
+		threadCount = (int)std::thread::hardware_concurrency() - 1;
+		if (threadCount < 1)
+		{
+			threadCount = 1;
+		}
+	}
+
+	// indicate to always flip images vertically when loaded
+	stbi_set_flip_vertically_on_load(true);
+
+	m_bRunning = true;
+	for (int i = 0; i < threadCount; i++)
+	{
+		m_workers.push_back(std::thread(&TextureLoader::WorkerMain, this));
+	}
+}
+
+/***********************************************************
+ *  Stop()
+ *
+ *  This method is used for stopping and joining the worker
+ *  threads, and for dropping every unfinished request.  The
+ *  textures keep whatever image they hold at that point.
+ ***********************************************************/
+void TextureLoader::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bRunning = false;
+		m_workQueue.clear();
+	}
+	m_workAvailable.notify_all();
+
+	for (int i = 0; i < m_workers.size(); i++)
+	{
+		m_workers[i].join();
+	}
+	m_workers.clear();
+
+	for (int i = 0; i < m_requests.size(); i++)
+	{
+		ReleaseRequest(m_requests[i]);
+		delete m_requests[i];
+	}
+	m_requests.clear();
+}
+
+/***********************************************************
+ *  Request()
+ *
+ *  This method is used for creating the texture of an image
+ *  file.  The texture holds the placeholder texel and the
+ *  image file is queued for decoding.  The returned texture
+ *  ID stays the same when the real image replaces the
+ *  placeholder.
+ ***********************************************************/
+GLuint TextureLoader::Request(const char* filename)
+{
+	LOAD_REQUEST* pRequest = NULL;
+	GLuint textureID = 0;
+
+	glGenTextures(1, &textureID);
+	glBindTexture(GL_TEXTURE_2D, textureID);
+
+	// set the texture wrapping parameters
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	// set texture filtering parameters
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, g_PlaceholderTexel);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	pRequest = new LOAD_REQUEST();
+	pRequest->filename = filename;
+	pRequest->textureID = textureID;
+	pRequest->pPixels = NULL;
+	pRequest->width = 0;
+	pRequest->height = 0;
+	pRequest->colorChannels = 0;
+	pRequest->pixelBuffer = 0;
+	pRequest->pMappedBuffer = NULL;
+
+	m_requests.push_back(pRequest);
+	QueueWork(pRequest, REQUEST_DECODING);
+
+	return(textureID);
+}
+
+/***********************************************************
+ *  QueueWork()
+ *
+ *  This method is used for moving a request to a worker step
+ *  and waking a worker for it.
+ ***********************************************************/
+void TextureLoader::QueueWork(LOAD_REQUEST* pRequest, REQUEST_STATE state)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		pRequest->state = state;
+		m_workQueue.push_back(pRequest);
+	}
+	m_workAvailable.notify_one();
+}
+
+/***********************************************************
+ *  WorkerMain()
+ *
+ *  This method is used as the loop of each worker thread.  It
+ *  waits for queued requests and runs the step matching the
+ *  state of each one.
+ ***********************************************************/
+void TextureLoader::WorkerMain()
+{
+	for (;;)
+	{
+		LOAD_REQUEST* pRequest = NULL;
+
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_workAvailable.wait(lock, [this]() { return(!m_bRunning || !m_workQueue.empty()); });
+
+			if (!m_bRunning)
+			{
+				return;
+			}
+
+			pRequest = m_workQueue.front();
+			m_workQueue.pop_front();
+		}
+
+		if (pRequest->state == REQUEST_DECODING)
+		{
+			DecodeImage(pRequest);
+		}
+		else if (pRequest->state == REQUEST_COPYING)
+		{
+			CopyToPixelBuffer(pRequest);
+		}
+	}
+}
+
+/***********************************************************
+ *  DecodeImage()
+ *
+ *  This method is used for reading and decoding the image
+ *  file of a request on a worker thread.
+ ***********************************************************/
+void TextureLoader::DecodeImage(LOAD_REQUEST* pRequest)
+{
+	int width = 0;
+	int height = 0;
+	int colorChannels = 0;
+
+	// try to parse the image data from the specified image file
+	unsigned char* image = stbi_load(
+		pRequest->filename.c_str(),
+		&width,
+		&height,
+		&colorChannels,
+		0);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (image == NULL)
+	{
+		std::cout << "Could not load image:" << pRequest->filename << std::endl;
+		pRequest->state = REQUEST_FAILED;
+		return;
+	}
+
+	if ((colorChannels != 3) && (colorChannels != 4))
+	{
+		std::cout << "Not implemented to handle image with " << colorChannels << " channels" << std::endl;
+		stbi_image_free(image);
+		pRequest->state = REQUEST_FAILED;
+		return;
+	}
+
+	std::cout << "Successfully loaded image:" << pRequest->filename << ", width:" << width << ", height:" << height << ", channels:" << colorChannels << std::endl;
+
+	pRequest->pPixels = image;
+	pRequest->width = width;
+	pRequest->height = height;
+	pRequest->colorChannels = colorChannels;
+	pRequest->state = REQUEST_DECODED;
+}
+
+/***********************************************************
+ *  CopyToPixelBuffer()
+ *
+ *  This method is used for copying the decoded pixels of a
+ *  request into its mapped pixel buffer on a worker thread,
+ *  and freeing the decoded image afterwards.
+ ***********************************************************/
+void TextureLoader::CopyToPixelBuffer(LOAD_REQUEST* pRequest)
+{
+	size_t size = (size_t)pRequest->width * pRequest->height * pRequest->colorChannels;
+
+	memcpy(pRequest->pMappedBuffer, pRequest->pPixels, size);
+	stbi_image_free(pRequest->pPixels);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	pRequest->pPixels = NULL;
+	pRequest->state = REQUEST_COPIED;
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for advancing the requests whose
+ *  worker step has finished.  Decoded images get a mapped
+ *  pixel buffer to be copied into, and copied images are
+ *  uploaded from their pixel buffer.  Finished and failed
+ *  requests are removed, and their textures are reported
+ *  as settled.
+ ***********************************************************/
+void TextureLoader::Update(std::vector<GLuint>& settledTextures)
+{
+	for (int i = 0; i < m_requests.size(); )
+	{
+		LOAD_REQUEST* pRequest = m_requests[i];
+		REQUEST_STATE state;
+		bool bFinished = false;
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			state = pRequest->state;
+		}
+
+		// no worker holds a request in these states, so the
+		// main thread can change it without the lock
+		if (state == REQUEST_DECODED)
+		{
+			MapPixelBuffer(pRequest);
+		}
+		else if (state == REQUEST_COPIED)
+		{
+			UploadTexture(pRequest);
+			bFinished = true;
+		}
+		else if (state == REQUEST_FAILED)
+		{
+			ReleaseRequest(pRequest);
+			bFinished = true;
+		}
+
+		if (bFinished)
+		{
+			settledTextures.push_back(pRequest->textureID);
+			delete pRequest;
+			m_requests.erase(m_requests.begin() + i);
+			continue;
+		}
+		i++;
+	}
+}
+
+/***********************************************************
+ *  MapPixelBuffer()
+ *
+ *  This method is used for creating and mapping the pixel
+ *  buffer of a decoded image, and queueing the copy into it.
+ ***********************************************************/
+void TextureLoader::MapPixelBuffer(LOAD_REQUEST* pRequest)
+{
+	GLsizeiptr size = (GLsizeiptr)pRequest->width * pRequest->height * pRequest->colorChannels;
+
+	glGenBuffers(1, &pRequest->pixelBuffer);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pRequest->pixelBuffer);
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+	pRequest->pMappedBuffer = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	if (pRequest->pMappedBuffer == NULL)
+	{
+		std::cout << "Could not map the pixel buffer for image:" << pRequest->filename << std::endl;
+		std::lock_guard<std::mutex> lock(m_mutex);
+		pRequest->state = REQUEST_FAILED;
+		return;
+	}
+
+	QueueWork(pRequest, REQUEST_COPYING);
+}
+
+/***********************************************************
+ *  UploadTexture()
+ *
+ *  This method is used for replacing the placeholder of a
+ *  request with the image in its pixel buffer, and for
+ *  generating the texture mipmaps.  The copy from the buffer
+ *  into the texture runs on the GPU.
+ ***********************************************************/
+void TextureLoader::UploadTexture(LOAD_REQUEST* pRequest)
+{
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pRequest->pixelBuffer);
+	glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+	pRequest->pMappedBuffer = NULL;
+
+	glBindTexture(GL_TEXTURE_2D, pRequest->textureID);
+
+	// RGB rows are not always a multiple of four bytes long
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	// if the loaded image is in RGB format
+	if (pRequest->colorChannels == 3)
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, pRequest->width, pRequest->height, 0, GL_RGB, GL_UNSIGNED_BYTE, 0);
+	// if the loaded image is in RGBA format - it supports transparency
+	else
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, pRequest->width, pRequest->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	// generate the texture mipmaps for mapping textures to lower resolutions
+	glGenerateMipmap(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	// the buffer is only freed once the GPU has finished the upload
+	glDeleteBuffers(1, &pRequest->pixelBuffer);
+	pRequest->pixelBuffer = 0;
+	pRequest->state = REQUEST_FINISHED;
+}
+
+/***********************************************************
+ *  ReleaseRequest()
+ *
+ *  This method is used for freeing the decoded image and the
+ *  pixel buffer a request still holds.
+ ***********************************************************/
+void TextureLoader::ReleaseRequest(LOAD_REQUEST* pRequest)
+{
+	if (pRequest->pPixels != NULL)
+	{
+		stbi_image_free(pRequest->pPixels);
+		pRequest->pPixels = NULL;
+	}
+
+	if (pRequest->pixelBuffer != 0)
+	{
+		if (pRequest->pMappedBuffer != NULL)
+		{
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pRequest->pixelBuffer);
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			pRequest->pMappedBuffer = NULL;
+		}
+		glDeleteBuffers(1, &pRequest->pixelBuffer);
+		pRequest->pixelBuffer = 0;
+	}
+}
+
+/***********************************************************
+ *  GetPendingCount()
+ *
+ *  This method is used for getting the number of requests
+ *  that still have work left.
+ ***********************************************************/
+int TextureLoader::GetPendingCount() const
+{
+	return((int)m_requests.size());
+}
@@ -0,0 +1,106 @@
+///////////////////////////////////////////////////////////////////////////////
+// textureloader.h
+// ============
+// decode texture images on worker threads and upload them through pixel buffers
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  TextureLoader
+ *
+ *  This class contains the code for loading texture images
+ *  without blocking the render loop.  Each requested texture
+ *  gets a small placeholder image right away.  Worker
+ *  threads decode the image file and copy the pixels into a
+ *  mapped pixel buffer object, and the main thread only maps
+ *  and unmaps the buffer and starts the upload from it.
+ *  Textures baked by TextureBaker are streamed by the
+ *  TextureStreamer instead.
+ ***********************************************************/
+class TextureLoader
+{
+public:
+	// constructor
+	TextureLoader();
+	// destructor
+	~TextureLoader();
+
+	// start the worker threads, zero picks one per spare CPU core
+	void Start(int threadCount = 0);
+	// stop the worker threads and drop the unfinished requests
+	void Stop();
+
+	// create a texture holding the placeholder and queue its image file
+	GLuint Request(const char* filename);
+
+	// advance the finished requests - must be called on the GL thread,
+	// appends the textures that got their final image or failed
+	void Update(std::vector<GLuint>& settledTextures);
+
+	// number of requests that are not finished yet
+	int GetPendingCount() const;
+
+private:
+	// the steps a request goes through
+	enum REQUEST_STATE
+	{
+		REQUEST_DECODING = 0,	// queued for or being decoded by a worker
+		REQUEST_DECODED,		// pixels in memory, needs a pixel buffer
+		REQUEST_COPYING,		// queued for or being copied by a worker
+		REQUEST_COPIED,			// pixels in the pixel buffer, needs the upload
+		REQUEST_FINISHED,
+		REQUEST_FAILED
+	};
+
+	// one texture being loaded
+	struct LOAD_REQUEST
+	{
+		std::string filename;
+		GLuint textureID;
+		REQUEST_STATE state;
+		// decoded image, owned by the request until it is copied
+		unsigned char* pPixels;
+		int width;
+		int height;
+		int colorChannels;
+		// pixel buffer the image is uploaded from
+		GLuint pixelBuffer;
+		void* pMappedBuffer;
+	};
+
+	// the worker threads
+	std::vector<std::thread> m_workers;
+	// all requests - only the main thread adds or removes entries
+	std::vector<LOAD_REQUEST*> m_requests;
+	// requests waiting for a worker, in order
+	std::deque<LOAD_REQUEST*> m_workQueue;
+	// guards the work queue and the request states
+	mutable std::mutex m_mutex;
+	// wakes the workers when work is queued or on shutdown
+	std::condition_variable m_workAvailable;
+	// true while the workers should keep running
+	bool m_bRunning;
+
+	// the loop of each worker thread
+	void WorkerMain();
+	// decode or copy one request on a worker
+	void DecodeImage(LOAD_REQUEST* pRequest);
+	void CopyToPixelBuffer(LOAD_REQUEST* pRequest);
+	// hand a request to the workers
+	void QueueWork(LOAD_REQUEST* pRequest, REQUEST_STATE state);
+	// main thread steps of a request
+	void MapPixelBuffer(LOAD_REQUEST* pRequest);
+	void UploadTexture(LOAD_REQUEST* pRequest);
+	// free the memory and the pixel buffer of a request
+	void ReleaseRequest(LOAD_REQUEST* pRequest);
+};
@@ -0,0 +1,374 @@
+///////////////////////////////////////////////////////////////////////////////
+// textureresidency.cpp
+// ============
+// make the scene textures reachable from the shaders by integer index
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureResidency.h"
+#include "FrameProfiler.h"
+
+#include <iostream>
+
+// declaration of the global variables and defines
+namespace
+{
+	// storage buffer binding point of the texture handles - must
+	// match the fragment shader
+	const GLuint g_TextureHandleBinding = 2;
+
+	// mid gray texel of the bindless placeholder texture
+	const unsigned char g_PlaceholderTexel[4] = { 128, 128, 128, 255 };
+
+	// longest wait for the GPU to finish with the replaced textures
+	// on release
+	const GLuint64 g_FenceTimeout = 1000000000; // one second in nanoseconds
+
+	// replaced handles and textures kept per texture - a texture is
+	// replaced at most once per frame, which retires its handle and
+	// the texture, and the fences pass within the frames in flight
+	const int g_RetiredPerTexture = 8;
+}
+
+/***********************************************************
+ *  TextureResidency()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TextureResidency::TextureResidency()
+{
+	m_bBindless = false;
+	m_handleBuffer = 0;
+	m_handleCapacity = 0;
+	m_placeholderTexture = 0;
+	m_placeholderHandle = 0;
+	m_bDirty = false;
+}
+
+/***********************************************************
+ *  ~TextureResidency()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+TextureResidency::~TextureResidency()
+{
+	Release();
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for choosing between the bindless and
+ *  the bound path.  The bindless path needs a placeholder
+ *  texture, since a texture can not be given new image data
+ *  once it has a handle.
+ ***********************************************************/
+void TextureResidency::Create()
+{
+	m_bBindless = (GLEW_ARB_bindless_texture != 0);
+	if (!m_bBindless)
+	{
+		std::cout << "INFO: Bindless textures are not supported, using " << MAX_BOUND_TEXTURES << " bound texture units" << std::endl;
+		return;
+	}
+
+	glGenTextures(1, &m_placeholderTexture);
+	glBindTexture(GL_TEXTURE_2D, m_placeholderTexture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, g_PlaceholderTexel);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	m_placeholderHandle = glGetTextureHandleARB(m_placeholderTexture);
+	glMakeTextureHandleResidentARB(m_placeholderHandle);
+
+	// the buffer gets room for the first handles right away, so it
+	// can be bound before any texture was added
+	glGenBuffers(1, &m_handleBuffer);
+	m_bDirty = true;
+	UploadHandles();
+}
+
+/***********************************************************
+ *  GetCapacity()
+ *
+ *  This method is used for getting the largest number of
+ *  textures the active path can address.
+ ***********************************************************/
+int TextureResidency::GetCapacity() const
+{
+	if (m_bBindless)
+	{
+		return(1 << 20);
+	}
+
+	return(MAX_BOUND_TEXTURES);
+}
+
+/***********************************************************
+ *  AddTexture()
+ *
+ *  This method is used for adding a texture at the next
+ *  index.  A texture that is ready gets its handle right away.
+ ***********************************************************/
+int TextureResidency::AddTexture(GLuint textureID, bool bReady)
+{
+	m_textures.push_back(textureID);
+	m_handles.push_back(0);
+	// sized here, so the uploads and replacements while rendering
+	// never allocate
+	m_uploadHandles.push_back(0);
+	m_retiredTextures.reserve(m_textures.size() * g_RetiredPerTexture);
+
+	if (bReady)
+	{
+		SetTextureReady(textureID);
+	}
+	m_bDirty = true;
+
+	return((int)m_textures.size() - 1);
+}
+
+/***********************************************************
+ *  SetTextureReady()
+ *
+ *  This method is used for creating and making resident the
+ *  handle of a texture that holds its final image.  The bound
+ *  path has nothing to do, since the texture units already
+ *  point at the texture objects.
+ ***********************************************************/
+void TextureResidency::SetTextureReady(GLuint textureID)
+{
+	if (!m_bBindless)
+	{
+		return;
+	}
+
+	for (int i = 0; i < m_textures.size(); i++)
+	{
+		if ((m_textures[i] == textureID) && (m_handles[i] == 0))
+		{
+			m_handles[i] = glGetTextureHandleARB(textureID);
+			glMakeTextureHandleResidentARB(m_handles[i]);
+			m_bDirty = true;
+		}
+	}
+}
+
+/***********************************************************
+ *  ReplaceTexture()
+ *
+ *  This method is used for putting a texture at the index of
+ *  another one.  The draws already submitted may still read
+ *  the replaced texture through its handle, so the handle is
+ *  fenced and only made non resident once the fence has
+ *  passed, a few frames later.
+ ***********************************************************/
+void TextureResidency::ReplaceTexture(int index, GLuint textureID)
+{
+	if ((index < 0) || (index >= m_textures.size()))
+	{
+		return;
+	}
+
+	if (m_handles[index] != 0)
+	{
+		RETIRED_TEXTURE retired;
+		retired.textureID = 0;
+		retired.handle = m_handles[index];
+		retired.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		m_retiredTextures.push_back(retired);
+		m_handles[index] = 0;
+	}
+	m_textures[index] = textureID;
+	m_bDirty = true;
+
+	SetTextureReady(textureID);
+}
+
+/***********************************************************
+ *  DeleteTexture()
+ *
+ *  This method is used for deleting a texture that was
+ *  replaced.  Deleting a texture frees its handles, so in the
+ *  bindless path it waits behind a fence like the handles do.
+ *  The bound path deletes it right away, since the driver
+ *  keeps a bound texture alive for the draws in flight.
+ ***********************************************************/
+void TextureResidency::DeleteTexture(GLuint textureID)
+{
+	RETIRED_TEXTURE retired;
+	retired.textureID = textureID;
+	retired.handle = 0;
+	retired.fence = 0;
+
+	if (!m_bBindless)
+	{
+		FreeTexture(retired);
+		return;
+	}
+
+	retired.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	m_retiredTextures.push_back(retired);
+}
+
+/***********************************************************
+ *  FreeRetiredTextures()
+ *
+ *  This method is used for freeing the replaced handles and
+ *  textures whose fence has passed.  The fences are checked without
+ *  waiting, and since they pass in order the check stops at
+ *  the first one that has not.
+ ***********************************************************/
+void TextureResidency::FreeRetiredTextures()
+{
+	int freed = 0;
+
+	while (freed < m_retiredTextures.size())
+	{
+		GLenum result = glClientWaitSync(m_retiredTextures[freed].fence, 0, 0);
+
+		if ((result != GL_ALREADY_SIGNALED) && (result != GL_CONDITION_SATISFIED))
+		{
+			break;
+		}
+		FreeTexture(m_retiredTextures[freed]);
+		freed++;
+	}
+	m_retiredTextures.erase(m_retiredTextures.begin(), m_retiredTextures.begin() + freed);
+}
+
+/***********************************************************
+ *  FreeTexture()
+ *
+ *  This method is used for making a replaced handle non
+ *  resident or deleting a replaced texture.
+ ***********************************************************/
+void TextureResidency::FreeTexture(const RETIRED_TEXTURE& retired)
+{
+	if (retired.fence != 0)
+	{
+		glDeleteSync(retired.fence);
+	}
+	if (retired.handle != 0)
+	{
+		glMakeTextureHandleNonResidentARB(retired.handle);
+	}
+	if (retired.textureID != 0)
+	{
+		glDeleteTextures(1, &retired.textureID);
+	}
+}
+
+/***********************************************************
+ *  Bind()
+ *
+ *  This method is used for making the textures reachable by
+ *  the shaders.  The bindless path binds the handle buffer,
+ *  writing it first when a handle changed.  The bound path
+ *  binds texture i to texture unit i.
+ ***********************************************************/
+void TextureResidency::Bind()
+{
+	if (m_bBindless)
+	{
+		if (m_bDirty)
+		{
+			UploadHandles();
+		}
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, g_TextureHandleBinding, m_handleBuffer);
+		return;
+	}
+
+	for (int i = 0; (i < m_textures.size()) && (i < MAX_BOUND_TEXTURES); i++)
+	{
+		// bind textures on corresponding texture units
+		glActiveTexture(GL_TEXTURE0 + i);
+		glBindTexture(GL_TEXTURE_2D, m_textures[i]);
+		FrameProfiler::AddCount(FrameProfiler::COUNTER_TEXTURE_BINDS);
+	}
+	m_bDirty = false;
+}
+
+/***********************************************************
+ *  UploadHandles()
+ *
+ *  This method is used for writing the handle of every
+ *  texture, or the placeholder handle for the textures that
+ *  still load, into the storage buffer.  The buffer starts
+ *  with room for 16 handles and grows in powers of two.
+ ***********************************************************/
+void TextureResidency::UploadHandles()
+{
+	std::vector<GLuint64>& handles = m_uploadHandles;
+
+	for (int i = 0; i < m_textures.size(); i++)
+	{
+		handles[i] = (m_handles[i] != 0) ? m_handles[i] : m_placeholderHandle;
+	}
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_handleBuffer);
+	if ((m_handleCapacity == 0) || (m_handleCapacity < (int)handles.size()))
+	{
+		m_handleCapacity = 16;
+		while (m_handleCapacity < (int)handles.size())
+		{
+			m_handleCapacity *= 2;
+		}
+		glBufferData(GL_SHADER_STORAGE_BUFFER, m_handleCapacity * sizeof(GLuint64), NULL, GL_DYNAMIC_DRAW);
+	}
+	if (!handles.empty())
+	{
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, handles.size() * sizeof(GLuint64), handles.data());
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	m_bDirty = false;
+}
+
+/***********************************************************
+ *  Release()
+ *
+ *  This method is used for making every handle non resident
+ *  and freeing the handle buffer and the placeholder.  It
+ *  must run before the textures are deleted.  The replaced
+ *  handles and textures are freed here too, after waiting
+ *  for the GPU.
+ ***********************************************************/
+void TextureResidency::Release()
+{
+	for (int i = 0; i < m_retiredTextures.size(); i++)
+	{
+		glClientWaitSync(m_retiredTextures[i].fence, GL_SYNC_FLUSH_COMMANDS_BIT, g_FenceTimeout);
+		FreeTexture(m_retiredTextures[i]);
+	}
+	m_retiredTextures.clear();
+
+	for (int i = 0; i < m_handles.size(); i++)
+	{
+		if (m_handles[i] != 0)
+		{
+			glMakeTextureHandleNonResidentARB(m_handles[i]);
+			m_handles[i] = 0;
+		}
+	}
+	m_textures.clear();
+	m_handles.clear();
+	m_uploadHandles.clear();
+
+	if (m_placeholderHandle != 0)
+	{
+		glMakeTextureHandleNonResidentARB(m_placeholderHandle);
+		m_placeholderHandle = 0;
+	}
+	if (m_placeholderTexture != 0)
+	{
+		glDeleteTextures(1, &m_placeholderTexture);
+		m_placeholderTexture = 0;
+	}
+	if (m_handleBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_handleBuffer);
+		m_handleBuffer = 0;
+	}
+	m_handleCapacity = 0;
+}
@@ -0,0 +1,95 @@
+///////////////////////////////////////////////////////////////////////////////
+// textureresidency.h
+// ============
+// make the scene textures reachable from the shaders by integer index
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  TextureResidency
+ *
+ *  This class contains the code for letting the shaders pick
+ *  a scene texture by its index alone.  With bindless
+ *  textures every texture gets a resident handle stored in a
+ *  storage buffer, so there is no limit on the number of
+ *  textures and nothing to bind per draw.  Without them the
+ *  textures are bound once to consecutive texture units that
+ *  an array of samplers in the shader covers.
+ ***********************************************************/
+class TextureResidency
+{
+public:
+	// constructor
+	TextureResidency();
+	// destructor
+	~TextureResidency();
+
+	// number of textures the bound texture unit fallback can address
+	// - must match MAX_BOUND_TEXTURES in the fragment shader
+	static const int MAX_BOUND_TEXTURES = 16;
+
+	// pick the bindless or the bound path - needs a current OpenGL context
+	void Create();
+	// true when the textures are addressed through bindless handles
+	bool IsBindless() const { return(m_bBindless); }
+	// largest number of textures the active path can address
+	int GetCapacity() const;
+
+	// add a texture, returns its index - textures that are still
+	// loading show a placeholder in the bindless path until they are ready
+	int AddTexture(GLuint textureID, bool bReady);
+	// mark a texture as holding its final image
+	void SetTextureReady(GLuint textureID);
+	// put a texture that holds its final image at an existing index
+	void ReplaceTexture(int index, GLuint textureID);
+	// delete a replaced texture once the draws in flight are done with it
+	void DeleteTexture(GLuint textureID);
+	// free the replaced handles and textures the GPU is done with
+	void FreeRetiredTextures();
+
+	// make the textures reachable by the shaders
+	void Bind();
+
+	// release the handles - the textures themselves are not deleted
+	void Release();
+
+private:
+	// a replaced handle or texture the draws in flight may still read
+	struct RETIRED_TEXTURE
+	{
+		GLuint textureID;
+		GLuint64 handle;
+		GLsync fence;
+	};
+
+	// true when bindless textures are in use
+	bool m_bBindless;
+	// the scene textures by index
+	std::vector<GLuint> m_textures;
+	// the resident handle of each texture, 0 while it still loads
+	std::vector<GLuint64> m_handles;
+	// the handles written into the storage buffer, one per texture
+	std::vector<GLuint64> m_uploadHandles;
+	// storage buffer of the handles the shaders read
+	GLuint m_handleBuffer;
+	// size of the storage buffer in handles
+	int m_handleCapacity;
+	// texture and resident handle shown while a texture loads
+	GLuint m_placeholderTexture;
+	GLuint64 m_placeholderHandle;
+	// true when the storage buffer needs to be written again
+	bool m_bDirty;
+	// the replaced handles and textures, oldest first
+	std::vector<RETIRED_TEXTURE> m_retiredTextures;
+
+	// write the handle of every texture into the storage buffer
+	void UploadHandles();
+	// make a replaced handle non resident or delete a replaced texture
+	void FreeTexture(const RETIRED_TEXTURE& retired);
+};
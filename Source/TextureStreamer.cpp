@@ -0,0 +1,461 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturestreamer.cpp
+// ============
+// keep only the mip levels of the baked textures that the view needs resident
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureStreamer.h"
+#include "DDSFormat.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+// declaration of the global variables and defines
+namespace
+{
+	// the largest size of the finest level a texture starts out with
+	const uint32_t g_CoarseLevelSize = 64;
+
+	// bytes read from the baked files per frame for finer levels - one
+	// texture is always refined, even when its levels need more
+	const size_t g_MaxUploadBytesPerFrame = 4 * 1024 * 1024;
+
+	// size of a mip level along one axis
+	uint32_t LevelDimension(uint32_t size, int level)
+	{
+		return(std::max<uint32_t>(size >> level, 1));
+	}
+}
+
+/***********************************************************
+ *  TextureStreamer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TextureStreamer::TextureStreamer()
+{
+	m_budgetBytes = 0;
+	m_residentBytes = 0;
+	m_pendingCount = 0;
+}
+
+/***********************************************************
+ *  ~TextureStreamer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+TextureStreamer::~TextureStreamer()
+{
+	Release();
+}
+
+/***********************************************************
+ *  SetBudget()
+ *
+ *  This method is used for setting the memory budget of the
+ *  resident levels.  The budget is met by the next update.
+ ***********************************************************/
+void TextureStreamer::SetBudget(size_t budgetBytes)
+{
+	m_budgetBytes = budgetBytes;
+}
+
+/***********************************************************
+ *  Request()
+ *
+ *  This method is used for opening the baked DDS file next
+ *  to the passed in image and uploading its coarse levels.
+ *  The file stays mapped, so the finer levels can be read
+ *  from it later.
+ ***********************************************************/
+int TextureStreamer::Request(const char* filename)
+{
+	if (!GLEW_EXT_texture_compression_s3tc)
+	{
+		return(-1);
+	}
+
+	STREAMED_TEXTURE* pTexture = new STREAMED_TEXTURE();
+	pTexture->filename = BakedTexturePath(filename);
+	pTexture->pFile = new MappedFile();
+	pTexture->textureID = 0;
+
+	if (!OpenBakedFile(pTexture))
+	{
+		delete pTexture->pFile;
+		delete pTexture;
+		return(-1);
+	}
+
+	// start out with the finest level that is still small
+	pTexture->coarsestLevel = 0;
+	while ((pTexture->coarsestLevel < pTexture->levelCount - 1) &&
+		(std::max(LevelDimension(pTexture->width, pTexture->coarsestLevel),
+			LevelDimension(pTexture->height, pTexture->coarsestLevel)) > g_CoarseLevelSize))
+	{
+		pTexture->coarsestLevel++;
+	}
+	pTexture->residentLevel = pTexture->levelCount;
+	pTexture->wantedLevel = pTexture->coarsestLevel;
+	pTexture->bSeen = false;
+
+	SetResidentLevel(pTexture, pTexture->coarsestLevel);
+	m_residentBytes += GetChainBytes(pTexture, pTexture->residentLevel);
+	m_textures.push_back(pTexture);
+
+	std::cout << "Streaming baked image:" << pTexture->filename << ", width:" << pTexture->width << ", height:" << pTexture->height << ", levels:" << pTexture->levelCount << std::endl;
+
+	return((int)m_textures.size() - 1);
+}
+
+/***********************************************************
+ *  OpenBakedFile()
+ *
+ *  This method is used for mapping a baked DDS file and
+ *  reading the format and the location of every mip level.
+ *  Returns false when there is no usable baked file.
+ ***********************************************************/
+bool TextureStreamer::OpenBakedFile(STREAMED_TEXTURE* pTexture)
+{
+	uint32_t blockBytes = 0;
+
+	if (!pTexture->pFile->Open(pTexture->filename.c_str()))
+	{
+		return(false);
+	}
+
+	const unsigned char* pData = pTexture->pFile->GetData();
+	size_t size = pTexture->pFile->GetSize();
+	DDS_HEADER header;
+
+	if (size < sizeof(uint32_t) + sizeof(DDS_HEADER))
+	{
+		std::cout << "Baked texture is too small:" << pTexture->filename << std::endl;
+		return(false);
+	}
+
+	uint32_t magic;
+	memcpy(&magic, pData, sizeof(magic));
+	memcpy(&header, pData + sizeof(magic), sizeof(header));
+
+	if ((magic != DDS_MAGIC) || (header.size != sizeof(DDS_HEADER)) ||
+		((header.pixelFormat.flags & DDPF_FOURCC) == 0))
+	{
+		std::cout << "Not a block compressed DDS file:" << pTexture->filename << std::endl;
+		return(false);
+	}
+
+	if (header.pixelFormat.fourCC == DDS_FOURCC_DXT1)
+	{
+		pTexture->format = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+		blockBytes = 8;
+	}
+	else if (header.pixelFormat.fourCC == DDS_FOURCC_DXT5)
+	{
+		pTexture->format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+		blockBytes = 16;
+	}
+	else
+	{
+		std::cout << "Not implemented to handle the block format of " << pTexture->filename << std::endl;
+		return(false);
+	}
+
+	pTexture->width = header.width;
+	pTexture->height = header.height;
+	pTexture->levelCount = ((header.flags & DDSD_MIPMAPCOUNT) && (header.mipMapCount > 0)) ? (int)header.mipMapCount : 1;
+
+	// the levels follow the header from the largest to the smallest
+	size_t offset = sizeof(uint32_t) + sizeof(DDS_HEADER);
+	for (int level = 0; level < pTexture->levelCount; level++)
+	{
+		uint32_t levelSize = DDSLevelSize(LevelDimension(header.width, level), LevelDimension(header.height, level), blockBytes);
+
+		pTexture->levelOffsets.push_back(offset);
+		pTexture->levelSizes.push_back(levelSize);
+		offset += levelSize;
+	}
+	if (offset > size)
+	{
+		std::cout << "Baked texture is truncated:" << pTexture->filename << std::endl;
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  GetTexture()
+ *
+ *  This method is used for getting the texture that holds the
+ *  resident levels of a streamed texture.  It changes every
+ *  time the resident levels change.
+ ***********************************************************/
+GLuint TextureStreamer::GetTexture(int index) const
+{
+	if ((index < 0) || (index >= m_textures.size()))
+	{
+		return(0);
+	}
+
+	return(m_textures[index]->textureID);
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for forgetting the screen sizes that
+ *  were passed in for the previous frame.  A texture that is
+ *  not seen again keeps its levels until the budget needs
+ *  them.
+ ***********************************************************/
+void TextureStreamer::BeginFrame()
+{
+	for (int i = 0; i < m_textures.size(); i++)
+	{
+		m_textures[i]->wantedLevel = m_textures[i]->coarsestLevel;
+		m_textures[i]->bSeen = false;
+	}
+}
+
+/***********************************************************
+ *  RequestScreenSize()
+ *
+ *  This method is used for passing in how many pixels one
+ *  repeat of a texture covers on screen.  The finest level
+ *  needed is the one with about one texel per pixel.
+ ***********************************************************/
+void TextureStreamer::RequestScreenSize(int index, float pixelsPerRepeat)
+{
+	if ((index < 0) || (index >= m_textures.size()))
+	{
+		return;
+	}
+
+	STREAMED_TEXTURE* pTexture = m_textures[index];
+	float texelsPerPixel = (float)std::max(pTexture->width, pTexture->height) / std::max(pixelsPerRepeat, 1.0f);
+	int level = (int)std::floor(std::log2(std::max(texelsPerPixel, 1.0f)));
+
+	level = std::min(level, pTexture->coarsestLevel);
+	pTexture->wantedLevel = std::min(pTexture->wantedLevel, level);
+	pTexture->bSeen = true;
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for changing the resident levels.
+ *  Textures get the finer levels the view asked for, except
+ *  where the budget would be exceeded - then the finest
+ *  levels that are the least needed are dropped first, the
+ *  ones finer than the view needs before the ones textures
+ *  that are seen need, and the biggest before the smaller.
+ *  Levels are never dropped while the budget holds, so a
+ *  texture does not stream the same levels in and out.
+ ***********************************************************/
+void TextureStreamer::Update(std::vector<TEXTURE_CHANGE>& changes)
+{
+	std::vector<int>& targetLevels = m_targetLevels;
+	std::vector<int>& refinements = m_refinements;
+	size_t totalBytes = 0;
+
+	targetLevels.resize(m_textures.size());
+
+	for (int i = 0; i < m_textures.size(); i++)
+	{
+		const STREAMED_TEXTURE* pTexture = m_textures[i];
+
+		targetLevels[i] = pTexture->residentLevel;
+		if (pTexture->bSeen)
+		{
+			targetLevels[i] = std::min(pTexture->wantedLevel, pTexture->residentLevel);
+		}
+		totalBytes += GetChainBytes(pTexture, targetLevels[i]);
+	}
+
+	// drop the least needed finest level until the budget holds
+	while ((m_budgetBytes > 0) && (totalBytes > m_budgetBytes))
+	{
+		int victim = -1;
+		bool bVictimSurplus = false;
+		uint32_t victimBytes = 0;
+
+		for (int i = 0; i < m_textures.size(); i++)
+		{
+			const STREAMED_TEXTURE* pTexture = m_textures[i];
+
+			if (targetLevels[i] >= pTexture->coarsestLevel)
+			{
+				continue;
+			}
+
+			int neededLevel = pTexture->bSeen ? pTexture->wantedLevel : pTexture->coarsestLevel;
+			bool bSurplus = (targetLevels[i] < neededLevel);
+			uint32_t bytes = pTexture->levelSizes[targetLevels[i]];
+
+			if ((victim < 0) || (bSurplus && !bVictimSurplus) ||
+				((bSurplus == bVictimSurplus) && (bytes > victimBytes)))
+			{
+				victim = i;
+				bVictimSurplus = bSurplus;
+				victimBytes = bytes;
+			}
+		}
+
+		// every texture is down to its coarse levels
+		if (victim < 0)
+		{
+			break;
+		}
+
+		totalBytes -= victimBytes;
+		targetLevels[victim]++;
+	}
+
+	// dropping levels only copies on the GPU, so all of them happen now
+	refinements.clear();
+	for (int i = 0; i < m_textures.size(); i++)
+	{
+		STREAMED_TEXTURE* pTexture = m_textures[i];
+
+		if (targetLevels[i] > pTexture->residentLevel)
+		{
+			TEXTURE_CHANGE change;
+			change.index = i;
+			change.oldTexture = pTexture->textureID;
+			SetResidentLevel(pTexture, targetLevels[i]);
+			change.newTexture = pTexture->textureID;
+			changes.push_back(change);
+		}
+		else if (targetLevels[i] < pTexture->residentLevel)
+		{
+			refinements.push_back(i);
+		}
+	}
+
+	// refine the textures missing the most levels first
+	std::sort(refinements.begin(), refinements.end(),
+		[&](int a, int b)
+		{
+			return((m_textures[a]->residentLevel - targetLevels[a]) > (m_textures[b]->residentLevel - targetLevels[b]));
+		});
+
+	size_t uploadedBytes = 0;
+	m_pendingCount = (int)refinements.size();
+	for (int i = 0; i < refinements.size(); i++)
+	{
+		STREAMED_TEXTURE* pTexture = m_textures[refinements[i]];
+		size_t bytes = GetChainBytes(pTexture, targetLevels[refinements[i]]) - GetChainBytes(pTexture, pTexture->residentLevel);
+
+		if ((uploadedBytes > 0) && (uploadedBytes + bytes > g_MaxUploadBytesPerFrame))
+		{
+			break;
+		}
+
+		TEXTURE_CHANGE change;
+		change.index = refinements[i];
+		change.oldTexture = pTexture->textureID;
+		uploadedBytes += SetResidentLevel(pTexture, targetLevels[refinements[i]]);
+		change.newTexture = pTexture->textureID;
+		changes.push_back(change);
+		m_pendingCount--;
+	}
+
+	m_residentBytes = 0;
+	for (int i = 0; i < m_textures.size(); i++)
+	{
+		m_residentBytes += GetChainBytes(m_textures[i], m_textures[i]->residentLevel);
+	}
+}
+
+/***********************************************************
+ *  GetChainBytes()
+ *
+ *  This method is used for getting the bytes of the mip
+ *  levels from the passed in level down to the smallest.
+ ***********************************************************/
+size_t TextureStreamer::GetChainBytes(const STREAMED_TEXTURE* pTexture, int level) const
+{
+	size_t bytes = 0;
+
+	for (int i = level; i < pTexture->levelCount; i++)
+	{
+		bytes += pTexture->levelSizes[i];
+	}
+
+	return(bytes);
+}
+
+/***********************************************************
+ *  SetResidentLevel()
+ *
+ *  This method is used for creating the texture that holds
+ *  the levels from the passed in level to the smallest.  The
+ *  levels the previous texture holds are copied from it on
+ *  the GPU, the others are read from the mapped file.  The
+ *  previous texture is left for the caller to delete.
+ ***********************************************************/
+size_t TextureStreamer::SetResidentLevel(STREAMED_TEXTURE* pTexture, int level)
+{
+	const unsigned char* pData = pTexture->pFile->GetData();
+	GLuint oldTexture = pTexture->textureID;
+	int oldLevel = pTexture->residentLevel;
+	size_t uploadedBytes = 0;
+
+	glGenTextures(1, &pTexture->textureID);
+	glBindTexture(GL_TEXTURE_2D, pTexture->textureID);
+	glTexStorage2D(GL_TEXTURE_2D, pTexture->levelCount - level, pTexture->format,
+		LevelDimension(pTexture->width, level), LevelDimension(pTexture->height, level));
+
+	// set the texture wrapping parameters
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	// set texture filtering parameters
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	for (int i = level; i < pTexture->levelCount; i++)
+	{
+		GLsizei width = LevelDimension(pTexture->width, i);
+		GLsizei height = LevelDimension(pTexture->height, i);
+
+		if ((oldTexture != 0) && (i >= oldLevel) && GLEW_ARB_copy_image)
+		{
+			glCopyImageSubData(oldTexture, GL_TEXTURE_2D, i - oldLevel, 0, 0, 0,
+				pTexture->textureID, GL_TEXTURE_2D, i - level, 0, 0, 0, width, height, 1);
+		}
+		else
+		{
+			glCompressedTexSubImage2D(GL_TEXTURE_2D, i - level, 0, 0, width, height, pTexture->format,
+				pTexture->levelSizes[i], pData + pTexture->levelOffsets[i]);
+			uploadedBytes += pTexture->levelSizes[i];
+		}
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	pTexture->residentLevel = level;
+
+	return(uploadedBytes);
+}
+
+/***********************************************************
+ *  Release()
+ *
+ *  This method is used for unmapping the baked files and
+ *  forgetting the streamed textures.  The textures belong to
+ *  the scene and are deleted there.
+ ***********************************************************/
+void TextureStreamer::Release()
+{
+	for (int i = 0; i < m_textures.size(); i++)
+	{
+		delete m_textures[i]->pFile;
+		delete m_textures[i];
+	}
+	m_textures.clear();
+	m_residentBytes = 0;
+	m_pendingCount = 0;
+}
@@ -0,0 +1,117 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturestreamer.h
+// ============
+// keep only the mip levels of the baked textures that the view needs resident
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class MappedFile;
+
+/***********************************************************
+ *  TextureStreamer
+ *
+ *  This class contains the code for streaming the mip chains
+ *  of the textures baked by TextureBaker.  A texture starts
+ *  out with only its coarse mip levels resident and gets its
+ *  finer levels once the view shows it large enough to need
+ *  them.  While the resident levels of all the textures go
+ *  over the memory budget, the finest levels of the textures
+ *  that need them least are dropped again.
+ *
+ *  The resident levels live in an immutable texture, so every
+ *  change of them creates a new texture - the levels both the
+ *  old and the new texture hold are copied on the GPU, and
+ *  only the new levels are read from the memory mapped file.
+ ***********************************************************/
+class TextureStreamer
+{
+public:
+	// constructor
+	TextureStreamer();
+	// destructor
+	~TextureStreamer();
+
+	// a streamed texture that was replaced by the last update -
+	// the old texture is not deleted by the streamer
+	struct TEXTURE_CHANGE
+	{
+		int index;
+		GLuint oldTexture;
+		GLuint newTexture;
+	};
+
+	// set the memory budget of the resident levels, zero for no limit
+	void SetBudget(size_t budgetBytes);
+	// bytes held by the resident levels of all the textures
+	size_t GetResidentBytes() const { return(m_residentBytes); }
+	// textures the last update left short of the levels the view
+	// asked for, since the upload limit of the frame was reached
+	int GetPendingCount() const { return(m_pendingCount); }
+
+	// open the baked file of an image and make its coarse levels
+	// resident, returns the stream index or -1 without a baked file
+	int Request(const char* filename);
+	// the texture currently holding the resident levels
+	GLuint GetTexture(int index) const;
+
+	// forget the screen sizes passed in for the previous frame
+	void BeginFrame();
+	// pass in the screen size in pixels of one repeat of the texture
+	void RequestScreenSize(int index, float pixelsPerRepeat);
+
+	// change the resident levels to fit the requests and the budget -
+	// must be called on the GL thread, appends the replaced textures
+	void Update(std::vector<TEXTURE_CHANGE>& changes);
+
+	// close the baked files - the textures themselves are not deleted
+	void Release();
+
+private:
+	// one baked texture and its resident levels
+	struct STREAMED_TEXTURE
+	{
+		std::string filename;
+		MappedFile* pFile;
+		GLenum format;
+		uint32_t width;
+		uint32_t height;
+		int levelCount;
+		// file offset and size of every mip level
+		std::vector<size_t> levelOffsets;
+		std::vector<uint32_t> levelSizes;
+		// finest resident level, and the coarsest one it may drop to
+		int residentLevel;
+		int coarsestLevel;
+		// finest level the view asked for this frame
+		int wantedLevel;
+		bool bSeen;
+		GLuint textureID;
+	};
+
+	// all of the streamed textures by stream index
+	std::vector<STREAMED_TEXTURE*> m_textures;
+	// memory budget of the resident levels, zero for no limit
+	size_t m_budgetBytes;
+	size_t m_residentBytes;
+	int m_pendingCount;
+	// the levels picked by the last update and the textures it
+	// refined, kept so the updates reuse their room
+	std::vector<int> m_targetLevels;
+	std::vector<int> m_refinements;
+
+	// read the header and level layout of a baked file
+	bool OpenBakedFile(STREAMED_TEXTURE* pTexture);
+	// bytes of the levels from the passed in level to the smallest
+	size_t GetChainBytes(const STREAMED_TEXTURE* pTexture, int level) const;
+	// make the levels from the passed in level to the smallest resident,
+	// returns the number of bytes read from the file
+	size_t SetResidentLevel(STREAMED_TEXTURE* pTexture, int level);
+};
@@ -0,0 +1,324 @@
+///////////////////////////////////////////////////////////////////////////////
+// transformbatch.cpp
+// ============
+// compose the model matrices of the scene objects four at a time
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TransformBatch.h"
+
+#include <cmath>
+
+// SSE2 is available on every x86 target the project builds for
+#if defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2)) || defined(__SSE2__)
+#define TRANSFORM_BATCH_SSE
+#include <emmintrin.h>
+#endif
+
+// declaration of the global variables and defines
+namespace
+{
+	// groups of four transforms composed by one job
+	const int g_TransformGrainGroups = 128;
+
+	const float g_DegreesToRadians = 0.01745329251994f;
+
+#ifdef TRANSFORM_BATCH_SSE
+	/***********************************************************
+	 *  SinCos()
+	 *
+	 *  This function is used for the sine and cosine of four
+	 *  angles in radians.  The angle is brought into a quarter
+	 *  turn around zero in three steps, so the error stays at
+	 *  a few units of the last place for the angles of a scene,
+	 *  and the result is picked and signed by the quarter.
+	 ***********************************************************/
+	void SinCos(__m128 angle, __m128& sine, __m128& cosine)
+	{
+		__m128i quarter = _mm_cvtps_epi32(_mm_mul_ps(angle, _mm_set1_ps(0.63661977236758f)));
+		__m128 quarterF = _mm_cvtepi32_ps(quarter);
+
+		__m128 r = _mm_sub_ps(angle, _mm_mul_ps(quarterF, _mm_set1_ps(1.5703125f)));
+		r = _mm_sub_ps(r, _mm_mul_ps(quarterF, _mm_set1_ps(4.837512969970703125e-4f)));
+		r = _mm_sub_ps(r, _mm_mul_ps(quarterF, _mm_set1_ps(7.54978995489188216e-8f)));
+
+		__m128 r2 = _mm_mul_ps(r, r);
+
+		// minimax polynomials for the quarter turn around zero
+		__m128 s = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(-1.9515295891e-4f), r2), _mm_set1_ps(8.3321608736e-3f));
+		s = _mm_add_ps(_mm_mul_ps(s, r2), _mm_set1_ps(-1.6666654611e-1f));
+		s = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(s, r2), r), r);
+
+		__m128 c = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(2.443315711809948e-5f), r2), _mm_set1_ps(-1.388731625493765e-3f));
+		c = _mm_add_ps(_mm_mul_ps(c, r2), _mm_set1_ps(4.166664568298827e-2f));
+		c = _mm_mul_ps(_mm_mul_ps(c, r2), r2);
+		c = _mm_add_ps(_mm_sub_ps(c, _mm_mul_ps(r2, _mm_set1_ps(0.5f))), _mm_set1_ps(1.0f));
+
+		// odd quarters swap the sine and the cosine
+		__m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(quarter, _mm_set1_epi32(1)), _mm_set1_epi32(1)));
+		__m128 sinePart = _mm_or_ps(_mm_and_ps(swap, c), _mm_andnot_ps(swap, s));
+		__m128 cosinePart = _mm_or_ps(_mm_and_ps(swap, s), _mm_andnot_ps(swap, c));
+
+		// the sine is negative in quarters two and three, the cosine
+		// in quarters one and two
+		__m128 sineSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(quarter, _mm_set1_epi32(2)), 30));
+		__m128 cosineSign = _mm_castsi128_ps(_mm_slli_epi32(
+			_mm_and_si128(_mm_add_epi32(quarter, _mm_set1_epi32(1)), _mm_set1_epi32(2)), 30));
+
+		sine = _mm_xor_ps(sinePart, sineSign);
+		cosine = _mm_xor_ps(cosinePart, cosineSign);
+	}
+#endif
+}
+
+/***********************************************************
+ *  TransformBatch()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TransformBatch::TransformBatch()
+{
+	m_bAnyDirty = false;
+	m_count = 0;
+}
+
+/***********************************************************
+ *  ComposeTransform()
+ *
+ *  This method is used for writing the model matrix of one
+ *  transform straight from the sines and cosines, which is
+ *  the same matrix as translation * rotationZ * rotationY *
+ *  rotationX * scale without the matrix multiplies.
+ ***********************************************************/
+glm::mat4 TransformBatch::ComposeTransform(const glm::vec3& scale, const glm::vec3& rotationDegrees, const glm::vec3& position)
+{
+	float sx = std::sin(rotationDegrees.x * g_DegreesToRadians);
+	float cx = std::cos(rotationDegrees.x * g_DegreesToRadians);
+	float sy = std::sin(rotationDegrees.y * g_DegreesToRadians);
+	float cy = std::cos(rotationDegrees.y * g_DegreesToRadians);
+	float sz = std::sin(rotationDegrees.z * g_DegreesToRadians);
+	float cz = std::cos(rotationDegrees.z * g_DegreesToRadians);
+	glm::mat4 model;
+
+	// glm matrices are column major - m[column][row]
+	model[0] = glm::vec4(cy * cz, cy * sz, -sy, 0.0f) * scale.x;
+	model[1] = glm::vec4(cz * sy * sx - sz * cx, sz * sy * sx + cz * cx, cy * sx, 0.0f) * scale.y;
+	model[2] = glm::vec4(cz * sy * cx + sz * sx, sz * sy * cx - cz * sx, cy * cx, 0.0f) * scale.z;
+	model[3] = glm::vec4(position, 1.0f);
+
+	return(model);
+}
+
+/***********************************************************
+ *  AddTransform()
+ *
+ *  This method is used for adding a transform.  The arrays
+ *  grow by a whole group of four, and the padding entries
+ *  hold the identity so they compose like any other.
+ ***********************************************************/
+int TransformBatch::AddTransform(const glm::vec3& scale, const glm::vec3& rotationDegrees, const glm::vec3& position)
+{
+	if (m_count == (int)m_scaleX.size())
+	{
+		int paddedCount = m_count + 4;
+
+		m_scaleX.resize(paddedCount, 1.0f);
+		m_scaleY.resize(paddedCount, 1.0f);
+		m_scaleZ.resize(paddedCount, 1.0f);
+		m_rotationX.resize(paddedCount, 0.0f);
+		m_rotationY.resize(paddedCount, 0.0f);
+		m_rotationZ.resize(paddedCount, 0.0f);
+		m_positionX.resize(paddedCount, 0.0f);
+		m_positionY.resize(paddedCount, 0.0f);
+		m_positionZ.resize(paddedCount, 0.0f);
+		m_models.resize(paddedCount, glm::mat4(1.0f));
+		m_dirty.resize(paddedCount, 0);
+	}
+
+	m_count++;
+	SetTransform(m_count - 1, scale, rotationDegrees, position);
+
+	return(m_count - 1);
+}
+
+/***********************************************************
+ *  SetTransform()
+ *
+ *  This method is used for replacing the values of a
+ *  transform and flagging it for the next update.
+ ***********************************************************/
+void TransformBatch::SetTransform(int index, const glm::vec3& scale, const glm::vec3& rotationDegrees, const glm::vec3& position)
+{
+	if ((index < 0) || (index >= m_count))
+	{
+		return;
+	}
+
+	m_scaleX[index] = scale.x;
+	m_scaleY[index] = scale.y;
+	m_scaleZ[index] = scale.z;
+	m_rotationX[index] = rotationDegrees.x;
+	m_rotationY[index] = rotationDegrees.y;
+	m_rotationZ[index] = rotationDegrees.z;
+	m_positionX[index] = position.x;
+	m_positionY[index] = position.y;
+	m_positionZ[index] = position.z;
+	m_dirty[index] = 1;
+	m_bAnyDirty = true;
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing all of the transforms.
+ ***********************************************************/
+void TransformBatch::Clear()
+{
+	m_scaleX.clear();
+	m_scaleY.clear();
+	m_scaleZ.clear();
+	m_rotationX.clear();
+	m_rotationY.clear();
+	m_rotationZ.clear();
+	m_positionX.clear();
+	m_positionY.clear();
+	m_positionZ.clear();
+	m_models.clear();
+	m_dirty.clear();
+	m_changed.clear();
+	m_bAnyDirty = false;
+	m_count = 0;
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for composing the matrices of the
+ *  changed transforms.  With a job system the groups of four
+ *  are split in runs, so no two threads share a group.  The
+ *  flags are cleared afterwards on the calling thread, which
+ *  also lists the changed transforms in order.
+ ***********************************************************/
+int TransformBatch::Update(JobSystem* pJobSystem)
+{
+	m_changed.clear();
+	if (!m_bAnyDirty)
+	{
+		return(0);
+	}
+
+	int groupCount = (m_count + 3) / 4;
+
+	if (NULL != pJobSystem)
+	{
+		pJobSystem->ParallelFor(groupCount, g_TransformGrainGroups,
+			[this](int begin, int end)
+			{
+				UpdateRange(begin * 4, end * 4);
+			});
+	}
+	else
+	{
+		UpdateRange(0, groupCount * 4);
+	}
+
+	for (int i = 0; i < m_count; i++)
+	{
+		if (m_dirty[i] != 0)
+		{
+			m_changed.push_back(i);
+			m_dirty[i] = 0;
+		}
+	}
+	m_bAnyDirty = false;
+
+	return((int)m_changed.size());
+}
+
+/***********************************************************
+ *  UpdateRange()
+ *
+ *  This method is used for composing the groups of a range,
+ *  which starts at a multiple of four.  A group is composed
+ *  as a whole when any of its transforms changed - the others
+ *  come out the same as before, since their values did not.
+ ***********************************************************/
+void TransformBatch::UpdateRange(int begin, int end)
+{
+	for (int i = begin; i < end; i += 4)
+	{
+		if ((m_dirty[i] | m_dirty[i + 1] | m_dirty[i + 2] | m_dirty[i + 3]) == 0)
+		{
+			continue;
+		}
+
+#ifdef TRANSFORM_BATCH_SSE
+		const __m128 degreesToRadians = _mm_set1_ps(g_DegreesToRadians);
+		__m128 sx, cx, sy, cy, sz, cz;
+
+		SinCos(_mm_mul_ps(_mm_loadu_ps(&m_rotationX[i]), degreesToRadians), sx, cx);
+		SinCos(_mm_mul_ps(_mm_loadu_ps(&m_rotationY[i]), degreesToRadians), sy, cy);
+		SinCos(_mm_mul_ps(_mm_loadu_ps(&m_rotationZ[i]), degreesToRadians), sz, cz);
+
+		__m128 scaleX = _mm_loadu_ps(&m_scaleX[i]);
+		__m128 scaleY = _mm_loadu_ps(&m_scaleY[i]);
+		__m128 scaleZ = _mm_loadu_ps(&m_scaleZ[i]);
+		__m128 szsy = _mm_mul_ps(sz, sy);
+		__m128 czsy = _mm_mul_ps(cz, sy);
+
+		// every register holds one matrix entry of the four transforms,
+		// turned into one column of each transform by the transposes
+		__m128 c0x = _mm_mul_ps(_mm_mul_ps(cy, cz), scaleX);
+		__m128 c0y = _mm_mul_ps(_mm_mul_ps(cy, sz), scaleX);
+		__m128 c0z = _mm_mul_ps(_mm_sub_ps(_mm_setzero_ps(), sy), scaleX);
+		__m128 c0w = _mm_setzero_ps();
+		__m128 c1x = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(czsy, sx), _mm_mul_ps(sz, cx)), scaleY);
+		__m128 c1y = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(szsy, sx), _mm_mul_ps(cz, cx)), scaleY);
+		__m128 c1z = _mm_mul_ps(_mm_mul_ps(cy, sx), scaleY);
+		__m128 c1w = _mm_setzero_ps();
+		__m128 c2x = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(czsy, cx), _mm_mul_ps(sz, sx)), scaleZ);
+		__m128 c2y = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(szsy, cx), _mm_mul_ps(cz, sx)), scaleZ);
+		__m128 c2z = _mm_mul_ps(_mm_mul_ps(cy, cx), scaleZ);
+		__m128 c2w = _mm_setzero_ps();
+		__m128 c3x = _mm_loadu_ps(&m_positionX[i]);
+		__m128 c3y = _mm_loadu_ps(&m_positionY[i]);
+		__m128 c3z = _mm_loadu_ps(&m_positionZ[i]);
+		__m128 c3w = _mm_set1_ps(1.0f);
+
+		_MM_TRANSPOSE4_PS(c0x, c0y, c0z, c0w);
+		_MM_TRANSPOSE4_PS(c1x, c1y, c1z, c1w);
+		_MM_TRANSPOSE4_PS(c2x, c2y, c2z, c2w);
+		_MM_TRANSPOSE4_PS(c3x, c3y, c3z, c3w);
+
+		// glm matrices are sixteen floats, column by column
+		float* pModel0 = &m_models[i][0][0];
+		float* pModel1 = &m_models[i + 1][0][0];
+		float* pModel2 = &m_models[i + 2][0][0];
+		float* pModel3 = &m_models[i + 3][0][0];
+
+		_mm_storeu_ps(pModel0, c0x);
+		_mm_storeu_ps(pModel0 + 4, c1x);
+		_mm_storeu_ps(pModel0 + 8, c2x);
+		_mm_storeu_ps(pModel0 + 12, c3x);
+		_mm_storeu_ps(pModel1, c0y);
+		_mm_storeu_ps(pModel1 + 4, c1y);
+		_mm_storeu_ps(pModel1 + 8, c2y);
+		_mm_storeu_ps(pModel1 + 12, c3y);
+		_mm_storeu_ps(pModel2, c0z);
+		_mm_storeu_ps(pModel2 + 4, c1z);
+		_mm_storeu_ps(pModel2 + 8, c2z);
+		_mm_storeu_ps(pModel2 + 12, c3z);
+		_mm_storeu_ps(pModel3, c0w);
+		_mm_storeu_ps(pModel3 + 4, c1w);
+		_mm_storeu_ps(pModel3 + 8, c2w);
+		_mm_storeu_ps(pModel3 + 12, c3w);
+#else
+		for (int j = i; j < i + 4; j++)
+		{
+			m_models[j] = ComposeTransform(
+				glm::vec3(m_scaleX[j], m_scaleY[j], m_scaleZ[j]),
+				glm::vec3(m_rotationX[j], m_rotationY[j], m_rotationZ[j]),
+				glm::vec3(m_positionX[j], m_positionY[j], m_positionZ[j]));
+		}
+#endif
+	}
+}
@@ -0,0 +1,80 @@
+///////////////////////////////////////////////////////////////////////////////
+// transformbatch.h
+// ============
+// compose the model matrices of the scene objects four at a time
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "JobSystem.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  TransformBatch
+ *
+ *  This class contains the code for turning the scale, the
+ *  rotations in degrees about x, y and z, and the position of
+ *  every object into its model matrix.  The values are kept
+ *  in structure-of-arrays form, so the sines, cosines and
+ *  matrix entries of four objects are computed at a time
+ *  with SSE, and the rotation is written out directly rather
+ *  than multiplied together from one matrix per axis.  Only
+ *  the groups of four with a changed object are computed
+ *  again on an update.
+ ***********************************************************/
+class TransformBatch
+{
+public:
+	// constructor
+	TransformBatch();
+
+	// the model matrix of one transform, scaled first, then
+	// rotated about x, y and z, then moved to the position
+	static glm::mat4 ComposeTransform(const glm::vec3& scale, const glm::vec3& rotationDegrees, const glm::vec3& position);
+
+	// add a transform and return its index
+	int AddTransform(const glm::vec3& scale, const glm::vec3& rotationDegrees, const glm::vec3& position);
+	// replace the values of a transform, its matrix changes on the next update
+	void SetTransform(int index, const glm::vec3& scale, const glm::vec3& rotationDegrees, const glm::vec3& position);
+	// remove all of the transforms
+	void Clear();
+
+	// number of transforms
+	int GetCount() const { return(m_count); }
+
+	// compose the matrices of the changed transforms, spread over the
+	// job system when there is one, returns the number of them
+	int Update(JobSystem* pJobSystem = NULL);
+	// the transforms whose matrix the last update composed
+	const std::vector<int>& GetChanged() const { return(m_changed); }
+	// the model matrix of a transform as of the last update
+	const glm::mat4& GetModel(int index) const { return(m_models[index]); }
+
+private:
+	// transform values, padded to a multiple of four entries
+	std::vector<float> m_scaleX;
+	std::vector<float> m_scaleY;
+	std::vector<float> m_scaleZ;
+	std::vector<float> m_rotationX;
+	std::vector<float> m_rotationY;
+	std::vector<float> m_rotationZ;
+	std::vector<float> m_positionX;
+	std::vector<float> m_positionY;
+	std::vector<float> m_positionZ;
+	// the composed matrices, padded like the values
+	std::vector<glm::mat4> m_models;
+	// true for the transforms that changed since the last update
+	std::vector<unsigned char> m_dirty;
+	// true when any transform changed since the last update
+	bool m_bAnyDirty;
+	// the transforms the last update composed
+	std::vector<int> m_changed;
+	// number of transforms without the padding
+	int m_count;
+
+	// compose the groups of four from begin to end that changed
+	void UpdateRange(int begin, int end);
+};
@@ -0,0 +1,66 @@
+///////////////////////////////////////////////////////////////////////////////
+// triplebuffer.h
+// ============
+// hand the latest value from one thread to another without locking
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+
+/***********************************************************
+ *  TripleBuffer
+ *
+ *  This class contains the code for passing a value from one
+ *  writer thread to one reader thread.  The writer fills its
+ *  own copy and swaps it with the spare one, and the reader
+ *  swaps the spare one with its own copy when it is newer,
+ *  so neither side ever waits for the other.  Values the
+ *  reader did not get to in time are skipped, it always sees
+ *  the latest one.
+ ***********************************************************/
+template <typename T>
+class TripleBuffer
+{
+public:
+	// constructor
+	TripleBuffer() : m_buffers(), m_spare(1)
+	{
+		m_writeIndex = 2;
+		m_readIndex = 0;
+	}
+
+	// the copy the writer fills before publishing it
+	T& GetWriteBuffer() { return(m_buffers[m_writeIndex]); }
+	// hand the filled copy to the reader - writer thread only
+	void Publish()
+	{
+		m_writeIndex = m_spare.exchange(m_writeIndex | FRESH_BIT, std::memory_order_acq_rel) & INDEX_MASK;
+	}
+
+	// take the latest published copy, returns false when nothing
+	// was published since the last call - reader thread only
+	bool Update()
+	{
+		if ((m_spare.load(std::memory_order_relaxed) & FRESH_BIT) == 0)
+		{
+			return(false);
+		}
+		m_readIndex = m_spare.exchange(m_readIndex, std::memory_order_acq_rel) & INDEX_MASK;
+		return(true);
+	}
+	// the copy the reader took last
+	const T& GetReadBuffer() const { return(m_buffers[m_readIndex]); }
+
+private:
+	// the spare index is marked while it holds an unread copy
+	static const int INDEX_MASK = 0x3;
+	static const int FRESH_BIT = 0x4;
+
+	T m_buffers[3];
+	// the copy between the writer and the reader
+	std::atomic<int> m_spare;
+	// the copies each side owns
+	int m_writeIndex;
+	int m_readIndex;
+};
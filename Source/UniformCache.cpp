@@ -0,0 +1,216 @@
+///////////////////////////////////////////////////////////////////////////////
+// uniformcache.cpp
+// ============
+// cache the uniform locations of a linked shader program
+///////////////////////////////////////////////////////////////////////////////
+
+#include "UniformCache.h"
+#include "FrameProfiler.h"
+#include "TagHash.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  UniformCache()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+UniformCache::UniformCache()
+{
+	m_programID = 0;
+}
+
+/***********************************************************
+ *  ~UniformCache()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+UniformCache::~UniformCache()
+{
+	m_locations.clear();
+}
+
+/***********************************************************
+ *  AddLocation()
+ *
+ *  This method is used for adding one uniform name and its
+ *  location to the cache.  The names are hashed, so two
+ *  names with the same hash are reported.
+ ***********************************************************/
+void UniformCache::AddLocation(const char* name, GLint location)
+{
+	uint32_t nameHash = TagHash(name);
+	std::unordered_map<uint32_t, GLint>::const_iterator found = m_locations.find(nameHash);
+
+	if ((found != m_locations.end()) && (found->second != location))
+	{
+		std::cout << "Uniform name " << name << " has the same hash as another uniform" << std::endl;
+		return;
+	}
+
+	m_locations[nameHash] = location;
+}
+
+/***********************************************************
+ *  LoadProgram()
+ *
+ *  This method is used for querying every active uniform of
+ *  the passed in linked program and caching its location.
+ *  Array uniforms are cached under both "name[0]" and "name".
+ ***********************************************************/
+void UniformCache::LoadProgram(GLuint programID)
+{
+	GLint uniformCount = 0;
+	GLint maxNameLength = 0;
+
+	m_programID = programID;
+	m_locations.clear();
+
+	glGetProgramiv(programID, GL_ACTIVE_UNIFORMS, &uniformCount);
+	glGetProgramiv(programID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+	std::vector<GLchar> name(maxNameLength + 1);
+
+	for (GLint i = 0; i < uniformCount; i++)
+	{
+		GLsizei nameLength = 0;
+		GLint size = 0;
+		GLenum type = 0;
+
+		glGetActiveUniform(programID, (GLuint)i, (GLsizei)name.size(), &nameLength, &size, &type, name.data());
+
+		// uniforms inside of uniform blocks have no location
+		GLint location = glGetUniformLocation(programID, name.data());
+		if (location < 0)
+		{
+			continue;
+		}
+
+		AddLocation(name.data(), location);
+
+		// arrays are reported as "name[0]", also cache them as "name"
+		std::string arrayName(name.data(), nameLength);
+		if ((arrayName.size() > 3) && (arrayName.compare(arrayName.size() - 3, 3, "[0]") == 0))
+		{
+			arrayName.erase(arrayName.size() - 3);
+			AddLocation(arrayName.c_str(), location);
+		}
+	}
+}
+
+/***********************************************************
+ *  GetLocation()
+ *
+ *  This method is used for getting the cached location of the
+ *  uniform with the passed in name.  It returns -1, which the
+ *  setters ignore, when the uniform is not active.
+ ***********************************************************/
+GLint UniformCache::GetLocation(const char* name) const
+{
+	std::unordered_map<uint32_t, GLint>::const_iterator found = m_locations.find(TagHash(name));
+
+	if (found == m_locations.end())
+	{
+		return(-1);
+	}
+
+	return(found->second);
+}
+
+/***********************************************************
+ *  SetBoolValue()
+ *
+ *  These methods are used for setting uniform values of the
+ *  cached program by location.  They do not depend on which
+ *  program is currently in use.
+ ***********************************************************/
+void UniformCache::SetBoolValue(GLint location, bool value) const
+{
+	FrameProfiler::AddCount(FrameProfiler::COUNTER_UNIFORM_SETS);
+	glProgramUniform1i(m_programID, location, (int)value);
+}
+
+void UniformCache::SetIntValue(GLint location, int value) const
+{
+	FrameProfiler::AddCount(FrameProfiler::COUNTER_UNIFORM_SETS);
+	glProgramUniform1i(m_programID, location, value);
+}
+
+void UniformCache::SetFloatValue(GLint location, float value) const
+{
+	FrameProfiler::AddCount(FrameProfiler::COUNTER_UNIFORM_SETS);
+	glProgramUniform1f(m_programID, location, value);
+}
+
+void UniformCache::SetSampler2DValue(GLint location, int value) const
+{
+	FrameProfiler::AddCount(FrameProfiler::COUNTER_UNIFORM_SETS);
+	glProgramUniform1i(m_programID, location, value);
+}
+
+void UniformCache::SetIntArrayValue(GLint location, const int* pValues, int count) const
+{
+	FrameProfiler::AddCount(FrameProfiler::COUNTER_UNIFORM_SETS);
+	glProgramUniform1iv(m_programID, location, count, pValues);
+}
+
+void UniformCache::SetVec2Value(GLint location, const glm::vec2& value) const
+{
+	FrameProfiler::AddCount(FrameProfiler::COUNTER_UNIFORM_SETS);
+	glProgramUniform2fv(m_programID, location, 1, glm::value_ptr(value));
+}
+
+void UniformCache::SetVec3Value(GLint location, const glm::vec3& value) const
+{
+	FrameProfiler::AddCount(FrameProfiler::COUNTER_UNIFORM_SETS);
+	glProgramUniform3fv(m_programID, location, 1, glm::value_ptr(value));
+}
+
+void UniformCache::SetVec4Value(GLint location, const glm::vec4& value) const
+{
+	FrameProfiler::AddCount(FrameProfiler::COUNTER_UNIFORM_SETS);
+	glProgramUniform4fv(m_programID, location, 1, glm::value_ptr(value));
+}
+
+void UniformCache::SetMat3Value(GLint location, const glm::mat3& value) const
+{
+	FrameProfiler::AddCount(FrameProfiler::COUNTER_UNIFORM_SETS);
+	glProgramUniformMatrix3fv(m_programID, location, 1, GL_FALSE, glm::value_ptr(value));
+}
+
+void UniformCache::SetMat4Value(GLint location, const glm::mat4& value) const
+{
+	FrameProfiler::AddCount(FrameProfiler::COUNTER_UNIFORM_SETS);
+	glProgramUniformMatrix4fv(m_programID, location, 1, GL_FALSE, glm::value_ptr(value));
+}
+
+/***********************************************************
+ *  SetBoolValue()
+ *
+ *  These methods are used for setting uniform values by name
+ *  through the cached locations, for code that only runs
+ *  while the scene is being set up.
+ ***********************************************************/
+void UniformCache::SetBoolValue(const char* name, bool value) const
+{
+	SetBoolValue(GetLocation(name), value);
+}
+
+void UniformCache::SetIntValue(const char* name, int value) const
+{
+	SetIntValue(GetLocation(name), value);
+}
+
+void UniformCache::SetFloatValue(const char* name, float value) const
+{
+	SetFloatValue(GetLocation(name), value);
+}
+
+void UniformCache::SetVec3Value(const char* name, const glm::vec3& value) const
+{
+	SetVec3Value(GetLocation(name), value);
+}
@@ -0,0 +1,65 @@
+///////////////////////////////////////////////////////////////////////////////
+// uniformcache.h
+// ============
+// cache the uniform locations of a linked shader program
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <unordered_map>
+
+/***********************************************************
+ *  UniformCache
+ *
+ *  This class contains the code for resolving every active
+ *  uniform location of a shader program once, right after it
+ *  is linked, and for setting uniform values by location so
+ *  the render loop never asks the driver for a location.
+ ***********************************************************/
+class UniformCache
+{
+public:
+	// constructor
+	UniformCache();
+	// destructor
+	~UniformCache();
+
+	// resolve and cache the locations of all the active uniforms
+	void LoadProgram(GLuint programID);
+	// the program the cached locations belong to
+	GLuint GetProgram() const { return(m_programID); }
+
+	// get a cached uniform location by name, -1 when not active
+	GLint GetLocation(const char* name) const;
+
+	// set uniform values by cached location
+	void SetBoolValue(GLint location, bool value) const;
+	void SetIntValue(GLint location, int value) const;
+	void SetFloatValue(GLint location, float value) const;
+	void SetSampler2DValue(GLint location, int value) const;
+	void SetIntArrayValue(GLint location, const int* pValues, int count) const;
+	void SetVec2Value(GLint location, const glm::vec2& value) const;
+	void SetVec3Value(GLint location, const glm::vec3& value) const;
+	void SetVec4Value(GLint location, const glm::vec4& value) const;
+	void SetMat3Value(GLint location, const glm::mat3& value) const;
+	void SetMat4Value(GLint location, const glm::mat4& value) const;
+
+	// set uniform values by name through the cache - for setup code
+	void SetBoolValue(const char* name, bool value) const;
+	void SetIntValue(const char* name, int value) const;
+	void SetFloatValue(const char* name, float value) const;
+	void SetVec3Value(const char* name, const glm::vec3& value) const;
+
+private:
+	// the program the cached locations belong to
+	GLuint m_programID;
+	// uniform locations keyed by the hash of the uniform name
+	std::unordered_map<uint32_t, GLint> m_locations;
+
+	// add one uniform name and its location to the cache
+	void AddLocation(const char* name, GLint location);
+};
@@ -20,8 +20,6 @@ namespace
 	// Variables for window width and height
 	const int WINDOW_WIDTH = 1000;
 	const int WINDOW_HEIGHT = 800;
-	const char* g_ViewName = "view";
-	const char* g_ProjectionName = "projection";
 
 	// camera object used for viewing and interacting with
 	// the 3D scene
@@ -32,13 +30,18 @@ namespace
 	float gLastY = WINDOW_HEIGHT / 2.0f;
 	bool gFirstMouse = true;
 
-	// time between current frame and last frame
-	float gDeltaTime = 0.0f;
-	float gLastFrame = 0.0f;
+	// running totals of the mouse movement and scrolling, which
+	// the camera simulation applies the new part of on every step
+	double gMouseTotalX = 0.0;
+	double gMouseTotalY = 0.0;
+	double gScrollTotal = 0.0;
 
 	// the following variable is false when orthographic projection
 	// is off and true when it is on
 	bool bOrthographicProjection = false;
+
+	// false while a scripted camera path owns the camera
+	bool gInputEnabled = true;
 }
 
 /***********************************************************
@@ -46,11 +49,14 @@ namespace
  *
  *  The constructor for the class
  ***********************************************************/
-ViewManager::ViewManager(ShaderManager* pShaderManager)
+ViewManager::ViewManager(ShaderManager* pShaderManager, FrameUniforms* pFrameUniforms)
 {
 	// initialize the member variables
 	m_pShaderManager = pShaderManager;
+	m_pFrameUniforms = pFrameUniforms;
 	m_pWindow = NULL;
+	m_viewWidth = WINDOW_WIDTH;
+	m_viewHeight = WINDOW_HEIGHT;
 	g_pCamera = new Camera();
 	// default camera view parameters
 	g_pCamera->Position = glm::vec3(0.0f, 5.0f, 12.0f);
@@ -67,8 +73,12 @@ ViewManager::ViewManager(ShaderManager* pShaderManager)
  ***********************************************************/
 ViewManager::~ViewManager()
 {
+	// the simulation thread has to let go of the camera first
+	m_cameraSimulation.Stop();
+
 	// free up allocated memory
 	m_pShaderManager = NULL;
+	m_pFrameUniforms = NULL;
 	m_pWindow = NULL;
 	if (NULL != g_pCamera)
 	{
@@ -129,6 +139,11 @@ GLFWwindow* ViewManager::CreateDisplayWindow(const char* windowTitle)
  ***********************************************************/
 void ViewManager::Mouse_Position_Callback(GLFWwindow* window, double xMousePos, double yMousePos)
 {
+	if (!gInputEnabled)
+	{
+		return;
+	}
+
 	// when the first mouse move event is received, this needs to be recorded so that
 	// all subsequent mouse moves can correctly calculate the X position offset and Y
 	// position offset for proper operation
@@ -147,8 +162,9 @@ void ViewManager::Mouse_Position_Callback(GLFWwindow* window, double xMousePos,
 	gLastX = xMousePos;
 	gLastY = yMousePos;
 
-	// move the 3D camera according to the calculated offsets
-	g_pCamera->ProcessMouseMovement(xOffset, yOffset);
+	// the camera simulation moves the 3D camera by the offsets
+	gMouseTotalX += xOffset;
+	gMouseTotalY += yOffset;
 }
 
 /***********************************************************
@@ -159,97 +175,58 @@ void ViewManager::Mouse_Position_Callback(GLFWwindow* window, double xMousePos,
  ***********************************************************/
 void ViewManager::Mouse_Scroll_Wheel_Callback(GLFWwindow* window, double x, double yScrollDistance)
 {
-	// call the camera method to handle the mouse wheel scrolling
-	g_pCamera->ProcessMouseScroll(yScrollDistance);
+	if (!gInputEnabled)
+	{
+		return;
+	}
+
+	// the camera simulation handles the mouse wheel scrolling
+	gScrollTotal += yScrollDistance;
 }
 
 /***********************************************************
  *  ProcessKeyboardEvents()
  *
- *  This method is called to process any keyboard events
- *  that may be waiting in the event queue.
+ *  This method is called to sample the keyboard and the
+ *  mouse totals for the camera simulation.  GLFW only reads
+ *  the keys on the main thread, so the simulation thread
+ *  gets them from here.
  ***********************************************************/
 void ViewManager::ProcessKeyboardEvents()
 {
+	// the GLFW keys of the camera simulation input keys
+	const int cameraKeys[][2] =
+	{
+		{ GLFW_KEY_W, CameraSimulation::KEY_FORWARD },
+		{ GLFW_KEY_S, CameraSimulation::KEY_BACKWARD },
+		{ GLFW_KEY_A, CameraSimulation::KEY_LEFT },
+		{ GLFW_KEY_D, CameraSimulation::KEY_RIGHT },
+		{ GLFW_KEY_Q, CameraSimulation::KEY_UP },
+		{ GLFW_KEY_E, CameraSimulation::KEY_DOWN },
+		{ GLFW_KEY_P, CameraSimulation::KEY_VIEW_P },
+		{ GLFW_KEY_O, CameraSimulation::KEY_VIEW_O }
+	};
+	CameraSimulation::INPUT_STATE input;
+
 	// close the window if the escape key has been pressed
 	if (glfwGetKey(m_pWindow, GLFW_KEY_ESCAPE) == GLFW_PRESS)
 	{
 		glfwSetWindowShouldClose(m_pWindow, true);
 	}
 
-	// process camera zooming in and out
-	if (glfwGetKey(m_pWindow, GLFW_KEY_W) == GLFW_PRESS)
-	{
-		g_pCamera->ProcessKeyboard(FORWARD, gDeltaTime);
-	}
-	if (glfwGetKey(m_pWindow, GLFW_KEY_S) == GLFW_PRESS)
-	{
-		g_pCamera->ProcessKeyboard(BACKWARD, gDeltaTime);
-	}
-
-	// process camera panning left and right
-	if (glfwGetKey(m_pWindow, GLFW_KEY_A) == GLFW_PRESS)
-	{
-		g_pCamera->ProcessKeyboard(LEFT, gDeltaTime);
-	}
-	if (glfwGetKey(m_pWindow, GLFW_KEY_D) == GLFW_PRESS)
-	{
-		g_pCamera->ProcessKeyboard(RIGHT, gDeltaTime);
-	}
-
-	// process camera upward and downward movement
-	if (glfwGetKey(m_pWindow, GLFW_KEY_Q) == GLFW_PRESS)
-	{
-		g_pCamera->ProcessKeyboard(UP, gDeltaTime);
-	}
-	if (glfwGetKey(m_pWindow, GLFW_KEY_E) == GLFW_PRESS)
-	{
-		g_pCamera->ProcessKeyboard(DOWN, gDeltaTime);
-	}
-
-	// change between different projection views
-	if (glfwGetKey(m_pWindow, GLFW_KEY_P) == GLFW_PRESS)
-	{
-		// change to a multi-view orthographic projection
-		bOrthographicProjection = true;
-
-		// change the camera settings to show a front orthographic view
-		g_pCamera->Position = glm::vec3(0.0f, 4.0f, 10.0f);
-		g_pCamera->Up = glm::vec3(0.0f, 1.0f, 0.0f);
-		g_pCamera->Front = glm::vec3(0.0f, 0.0f, -1.0f);
-	}
-	if (glfwGetKey(m_pWindow, GLFW_KEY_O) == GLFW_PRESS)
+	input.keys = 0;
+	for (int i = 0; i < sizeof(cameraKeys) / sizeof(cameraKeys[0]); i++)
 	{
-		// change to a multi-view orthographic projection
-		bOrthographicProjection = true;
-
-		// change the camera settings to show a side orthographic view
-		g_pCamera->Position = glm::vec3(10.0f, 4.0f, 0.0f);
-		g_pCamera->Up = glm::vec3(0.0f, 1.0f, 0.0f);
-		g_pCamera->Front = glm::vec3(-1.0f, 0.0f, 0.0f);
-	}
-	if (glfwGetKey(m_pWindow, GLFW_KEY_P) == GLFW_PRESS)
-	{
-		// change to a multi-view orthographic projection
-		bOrthographicProjection = true;
-
-		// change the camera settings to show a top orthographic view
-		g_pCamera->Position = glm::vec3(0.0f, 7.0f, 0.0f);
-		g_pCamera->Up = glm::vec3(-1.0f, 0.0f, 0.0f);
-		g_pCamera->Front = glm::vec3(0.0f, -1.0f, 0.0f);
-	}
-	if (glfwGetKey(m_pWindow, GLFW_KEY_O) == GLFW_PRESS)
-	{
-		// change to perspective projection
-		bOrthographicProjection = true;
-
-		// change the camera settings to show a perspective view
-		g_pCamera->Position = glm::vec3(0.0f, 5.5f, 8.0f);
-		g_pCamera->Front = glm::vec3(0.0f, -0.5f, -2.0f);
-		g_pCamera->Up = glm::vec3(0.0f, 1.0f, 0.0f);
-		g_pCamera->Zoom = 80;
+		if (glfwGetKey(m_pWindow, cameraKeys[i][0]) == GLFW_PRESS)
+		{
+			input.keys |= cameraKeys[i][1];
+		}
 	}
+	input.mouseX = gMouseTotalX;
+	input.mouseY = gMouseTotalY;
+	input.scroll = gScrollTotal;
 
+	m_cameraSimulation.SetInput(input);
 }
 
 /***********************************************************
@@ -263,37 +240,59 @@ void ViewManager::PrepareSceneView()
 {
 	glm::mat4 view;
 	glm::mat4 projection;
+	CameraSimulation::CAMERA_STATE camera;
 
-	// per-frame timing
-	float currentFrame = glfwGetTime();
-	gDeltaTime = currentFrame - gLastFrame;
-	gLastFrame = currentFrame;
+	// the camera is stepped on the simulation thread while the
+	// controls are on, and placed by the caller while they are off
+	if (gInputEnabled && !m_cameraSimulation.IsRunning())
+	{
+		m_cameraSimulation.Start(g_pCamera, bOrthographicProjection);
+	}
 
-	// process any keyboard events that may be waiting in the 
+	// sample any keyboard events that may be waiting in the 
 	// event queue
-	ProcessKeyboardEvents();
+	if (gInputEnabled)
+	{
+		ProcessKeyboardEvents();
+	}
+	else if (glfwGetKey(m_pWindow, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+	{
+		glfwSetWindowShouldClose(m_pWindow, true);
+	}
 
-	// get the current view matrix from the camera
-	view = g_pCamera->GetViewMatrix();
+	// get the current camera, blended between the simulation steps
+	if (m_cameraSimulation.IsRunning())
+	{
+		m_cameraSimulation.GetCameraState(camera);
+	}
+	else
+	{
+		camera.position = g_pCamera->Position;
+		camera.front = g_pCamera->Front;
+		camera.up = g_pCamera->Up;
+		camera.zoom = g_pCamera->Zoom;
+		camera.bOrthographic = bOrthographicProjection;
+	}
+	view = glm::lookAt(camera.position, camera.position + camera.front, camera.up);
 
 	// define the current projection matrix
-	if (bOrthographicProjection == false)
+	if (camera.bOrthographic == false)
 	{
 		// perspective projection
-		projection = glm::perspective(glm::radians(g_pCamera->Zoom), (GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT, 0.1f, 100.0f);
+		projection = glm::perspective(glm::radians(camera.zoom), (GLfloat)m_viewWidth / (GLfloat)m_viewHeight, 0.1f, 100.0f);
 	}
 	else
 	{
 		// front-view orthographic projection with correct aspect ratio
 		double scale = 0.0;
-		if (WINDOW_WIDTH > WINDOW_HEIGHT)
+		if (m_viewWidth > m_viewHeight)
 		{
-			scale = (double)WINDOW_HEIGHT / (double)WINDOW_WIDTH;
+			scale = (double)m_viewHeight / (double)m_viewWidth;
 			projection = glm::ortho(-5.0f, 5.0f, -5.0f * (float)scale, 5.0f * (float)scale, 0.1f, 100.0f);
 		}
-		else if (WINDOW_WIDTH < WINDOW_HEIGHT)
+		else if (m_viewWidth < m_viewHeight)
 		{
-			scale = (double)WINDOW_WIDTH / (double)WINDOW_HEIGHT;
+			scale = (double)m_viewWidth / (double)m_viewHeight;
 			projection = glm::ortho(-5.0f * (float)scale, 5.0f * (float)scale, -5.0f, 5.0f, 0.1f, 100.0f);
 		}
 		else
@@ -302,16 +301,61 @@ void ViewManager::PrepareSceneView()
 		}
 	}
 
-	// if the shader manager object is valid
-	if (NULL != m_pShaderManager)
+	// if the frame uniform block object is valid
+	if (NULL != m_pFrameUniforms)
+	{
+		// set the view and projection matrices and the view position
+		// of the camera into the frame block for proper rendering
+		m_pFrameUniforms->SetCamera(view, projection, camera.position);
+	}
+}
+
+/***********************************************************
+ *  SetCameraView()
+ *
+ *  This method is used for placing the camera at the passed
+ *  in position, looking at the target point with the world
+ *  up direction.
+ ***********************************************************/
+void ViewManager::SetCameraView(const glm::vec3& position, const glm::vec3& target)
+{
+	g_pCamera->Position = position;
+	g_pCamera->Front = glm::normalize(target - position);
+	g_pCamera->Up = glm::vec3(0.0f, 1.0f, 0.0f);
+}
+
+/***********************************************************
+ *  SetViewSize()
+ *
+ *  This method is used for setting the size in pixels the
+ *  projection matches the aspect ratio of.
+ ***********************************************************/
+void ViewManager::SetViewSize(int width, int height)
+{
+	if ((width > 0) && (height > 0))
+	{
+		m_viewWidth = width;
+		m_viewHeight = height;
+	}
+}
+
+/***********************************************************
+ *  SetInputEnabled()
+ *
+ *  This method is used for turning the keyboard and mouse
+ *  camera controls on or off.  Escape still closes the
+ *  window while they are off.  Turning them off stops the
+ *  camera simulation, so the caller can place the camera.
+ ***********************************************************/
+void ViewManager::SetInputEnabled(bool bEnabled)
+{
+	if (!bEnabled && m_cameraSimulation.IsRunning())
 	{
-		// set the view matrix into the shader for proper rendering
-		m_pShaderManager->setMat4Value(g_ViewName, view);
-		// set the view matrix into the shader for proper rendering
-		m_pShaderManager->setMat4Value(g_ProjectionName, projection);
-		// set the view position of the camera into the shader for proper rendering
-		m_pShaderManager->setVec3Value("viewPosition", g_pCamera->Position);
+		m_cameraSimulation.Stop();
+		bOrthographicProjection = m_cameraSimulation.IsOrthographic();
 	}
+
+	gInputEnabled = bEnabled;
 }
 
 /***********************************************************
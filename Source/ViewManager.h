@@ -10,6 +10,8 @@
 #pragma once
 
 #include "ShaderManager.h"
+#include "FrameUniforms.h"
+#include "CameraSimulation.h"
 #include "camera.h"
 
 // GLFW library
@@ -19,7 +21,7 @@ class ViewManager
 {
 public:
 	// constructor
-	ViewManager(ShaderManager* pShaderManager);
+	ViewManager(ShaderManager* pShaderManager, FrameUniforms* pFrameUniforms);
 	// destructor
 	~ViewManager();
 
@@ -35,7 +37,17 @@ public:
 	// prepare the conversion from 3D object display to 2D scene display
 	void PrepareSceneView();
 
-	// Add these method declarations
+	// place the camera at a position looking at a target point
+	void SetCameraView(const glm::vec3& position, const glm::vec3& target);
+	// set the size in pixels the projection is made for, the window
+	// size unless the scene is drawn into an image of another size
+	void SetViewSize(int width, int height);
+	// turn the keyboard and mouse camera controls on or off, the
+	// camera simulation thread only runs while they are on
+	void SetInputEnabled(bool bEnabled);
+
+	// Add these method declarations - they move the camera directly,
+	// so they are only for while the camera controls are off
 	void ProcessKeyboard(Camera_Movement direction, float deltaTime);
 	void ProcessMouseMovement(float xoffset, float yoffset, GLboolean constrainPitch = true);
 	void ProcessMouseScroll(float yoffset);
@@ -43,9 +55,16 @@ public:
 private:
 	// pointer to shader manager object
 	ShaderManager* m_pShaderManager;
+	// pointer to the per-frame uniform block shared by the shaders
+	FrameUniforms* m_pFrameUniforms;
 	// active OpenGL display window
 	GLFWwindow* m_pWindow;
+	// steps the camera from the input apart from the render loop
+	CameraSimulation m_cameraSimulation;
+	// size in pixels of what the scene is drawn into
+	int m_viewWidth;
+	int m_viewHeight;
 
-	// process keyboard events for interaction with the 3D scene
+	// sample the keyboard and mouse for the camera simulation
 	void ProcessKeyboardEvents();
 };
@@ -0,0 +1,463 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturebaker.cpp
+// ============
+// offline tool that bakes texture images into block compressed DDS files
+//
+//  usage: TextureBaker <image> [<image> ...]
+//
+//  every image is written next to itself with the .dds extension, as a full
+//  mip chain in BC1 when it is opaque or BC3 when it has an alpha channel
+///////////////////////////////////////////////////////////////////////////////
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include "DDSFormat.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// declaration of the global variables and defines
+namespace
+{
+	// one RGBA8 image of the mip chain
+	struct IMAGE
+	{
+		int width;
+		int height;
+		std::vector<unsigned char> pixels;
+	};
+
+	/***********************************************************
+	 *  Pack565()
+	 *
+	 *  This function is used for rounding an 8 bit per channel
+	 *  color to the 5:6:5 format of the color endpoints.
+	 ***********************************************************/
+	uint16_t Pack565(const float color[3])
+	{
+		int r = (int)(color[0] * 31.0f / 255.0f + 0.5f);
+		int g = (int)(color[1] * 63.0f / 255.0f + 0.5f);
+		int b = (int)(color[2] * 31.0f / 255.0f + 0.5f);
+
+		r = (r < 0) ? 0 : ((r > 31) ? 31 : r);
+		g = (g < 0) ? 0 : ((g > 63) ? 63 : g);
+		b = (b < 0) ? 0 : ((b > 31) ? 31 : b);
+
+		return((uint16_t)((r << 11) | (g << 5) | b));
+	}
+
+	/***********************************************************
+	 *  Unpack565()
+	 *
+	 *  This function is used for expanding a 5:6:5 endpoint to
+	 *  8 bits per channel the same way the GPU does.
+	 ***********************************************************/
+	void Unpack565(uint16_t packed, int color[3])
+	{
+		int r = (packed >> 11) & 31;
+		int g = (packed >> 5) & 63;
+		int b = packed & 31;
+
+		color[0] = (r << 3) | (r >> 2);
+		color[1] = (g << 2) | (g >> 4);
+		color[2] = (b << 3) | (b >> 2);
+	}
+
+	/***********************************************************
+	 *  EncodeColorBlock()
+	 *
+	 *  This function is used for encoding the colors of a 4x4
+	 *  block into 8 bytes of BC1.  The endpoints are the
+	 *  extremes of the block along its principal color axis,
+	 *  pulled in slightly to reduce the error of the mid tones.
+	 ***********************************************************/
+	void EncodeColorBlock(const unsigned char block[16][4], unsigned char* pOutput)
+	{
+		float mean[3] = { 0.0f, 0.0f, 0.0f };
+		float covariance[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+
+		for (int i = 0; i < 16; i++)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				mean[c] += block[i][c] / 16.0f;
+			}
+		}
+		for (int i = 0; i < 16; i++)
+		{
+			float d[3] = { block[i][0] - mean[0], block[i][1] - mean[1], block[i][2] - mean[2] };
+
+			covariance[0] += d[0] * d[0];
+			covariance[1] += d[0] * d[1];
+			covariance[2] += d[0] * d[2];
+			covariance[3] += d[1] * d[1];
+			covariance[4] += d[1] * d[2];
+			covariance[5] += d[2] * d[2];
+		}
+
+		// a few power iterations find the principal axis
+		float axis[3] = { 1.0f, 1.0f, 1.0f };
+		for (int iteration = 0; iteration < 8; iteration++)
+		{
+			float next[3] =
+			{
+				covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2],
+				covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2],
+				covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2]
+			};
+			float largest = std::max(std::max(std::fabs(next[0]), std::fabs(next[1])), std::fabs(next[2]));
+
+			if (largest < 1.0e-6f)
+			{
+				break;
+			}
+			for (int c = 0; c < 3; c++)
+			{
+				axis[c] = next[c] / largest;
+			}
+		}
+
+		// project the colors onto the axis to find the extremes
+		float minProjection = 1.0e30f;
+		float maxProjection = -1.0e30f;
+		for (int i = 0; i < 16; i++)
+		{
+			float projection =
+				(block[i][0] - mean[0]) * axis[0] +
+				(block[i][1] - mean[1]) * axis[1] +
+				(block[i][2] - mean[2]) * axis[2];
+
+			minProjection = std::min(minProjection, projection);
+			maxProjection = std::max(maxProjection, projection);
+		}
+
+		float axisLengthSquared = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+		float minColor[3];
+		float maxColor[3];
+		for (int c = 0; c < 3; c++)
+		{
+			float scale = (axisLengthSquared > 0.0f) ? axis[c] / axisLengthSquared : 0.0f;
+			float low = mean[c] + minProjection * scale;
+			float high = mean[c] + maxProjection * scale;
+			float inset = (high - low) / 16.0f;
+
+			minColor[c] = low + inset;
+			maxColor[c] = high - inset;
+		}
+
+		uint16_t color0 = Pack565(maxColor);
+		uint16_t color1 = Pack565(minColor);
+
+		// the four color mode needs the first endpoint to be larger
+		if (color0 < color1)
+		{
+			uint16_t swap = color0;
+			color0 = color1;
+			color1 = swap;
+		}
+
+		uint32_t indices = 0;
+		if (color0 != color1)
+		{
+			int palette[4][3];
+
+			Unpack565(color0, palette[0]);
+			Unpack565(color1, palette[1]);
+			for (int c = 0; c < 3; c++)
+			{
+				palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+			}
+
+			for (int i = 0; i < 16; i++)
+			{
+				int bestIndex = 0;
+				int bestError = 1 << 30;
+
+				for (int p = 0; p < 4; p++)
+				{
+					int dr = block[i][0] - palette[p][0];
+					int dg = block[i][1] - palette[p][1];
+					int db = block[i][2] - palette[p][2];
+					int error = dr * dr + dg * dg + db * db;
+
+					if (error < bestError)
+					{
+						bestError = error;
+						bestIndex = p;
+					}
+				}
+				indices |= (uint32_t)bestIndex << (2 * i);
+			}
+		}
+
+		pOutput[0] = (unsigned char)(color0 & 0xFF);
+		pOutput[1] = (unsigned char)(color0 >> 8);
+		pOutput[2] = (unsigned char)(color1 & 0xFF);
+		pOutput[3] = (unsigned char)(color1 >> 8);
+		for (int i = 0; i < 4; i++)
+		{
+			pOutput[4 + i] = (unsigned char)((indices >> (8 * i)) & 0xFF);
+		}
+	}
+
+	/***********************************************************
+	 *  EncodeAlphaBlock()
+	 *
+	 *  This function is used for encoding the alpha values of a
+	 *  4x4 block into the 8 byte alpha part of BC3, using the
+	 *  eight value mode between the block extremes.
+	 ***********************************************************/
+	void EncodeAlphaBlock(const unsigned char block[16][4], unsigned char* pOutput)
+	{
+		int alpha0 = 0;
+		int alpha1 = 255;
+
+		for (int i = 0; i < 16; i++)
+		{
+			alpha0 = std::max(alpha0, (int)block[i][3]);
+			alpha1 = std::min(alpha1, (int)block[i][3]);
+		}
+
+		uint64_t indices = 0;
+		if (alpha0 != alpha1)
+		{
+			int palette[8];
+
+			palette[0] = alpha0;
+			palette[1] = alpha1;
+			for (int p = 1; p < 7; p++)
+			{
+				palette[p + 1] = ((7 - p) * alpha0 + p * alpha1) / 7;
+			}
+
+			for (int i = 0; i < 16; i++)
+			{
+				int bestIndex = 0;
+				int bestError = 1 << 30;
+
+				for (int p = 0; p < 8; p++)
+				{
+					int error = std::abs(block[i][3] - palette[p]);
+
+					if (error < bestError)
+					{
+						bestError = error;
+						bestIndex = p;
+					}
+				}
+				indices |= (uint64_t)bestIndex << (3 * i);
+			}
+		}
+
+		pOutput[0] = (unsigned char)alpha0;
+		pOutput[1] = (unsigned char)alpha1;
+		for (int i = 0; i < 6; i++)
+		{
+			pOutput[2 + i] = (unsigned char)((indices >> (8 * i)) & 0xFF);
+		}
+	}
+
+	/***********************************************************
+	 *  CompressImage()
+	 *
+	 *  This function is used for encoding a whole image block
+	 *  by block.  Blocks past the right or bottom edge repeat
+	 *  the last row and column of the image.
+	 ***********************************************************/
+	void CompressImage(const IMAGE& image, bool bAlpha, std::vector<unsigned char>& output)
+	{
+		int blocksWide = (image.width + 3) / 4;
+		int blocksHigh = (image.height + 3) / 4;
+		int blockBytes = bAlpha ? 16 : 8;
+
+		output.resize((size_t)blocksWide * blocksHigh * blockBytes);
+
+		for (int by = 0; by < blocksHigh; by++)
+		{
+			for (int bx = 0; bx < blocksWide; bx++)
+			{
+				unsigned char block[16][4];
+				unsigned char* pOutput = &output[((size_t)by * blocksWide + bx) * blockBytes];
+
+				for (int y = 0; y < 4; y++)
+				{
+					for (int x = 0; x < 4; x++)
+					{
+						int px = std::min(bx * 4 + x, image.width - 1);
+						int py = std::min(by * 4 + y, image.height - 1);
+
+						memcpy(block[y * 4 + x], &image.pixels[((size_t)py * image.width + px) * 4], 4);
+					}
+				}
+
+				if (bAlpha)
+				{
+					EncodeAlphaBlock(block, pOutput);
+					pOutput += 8;
+				}
+				EncodeColorBlock(block, pOutput);
+			}
+		}
+	}
+
+	/***********************************************************
+	 *  Downsample()
+	 *
+	 *  This function is used for building the next mip level by
+	 *  averaging each 2x2 square of texels.  Odd sizes repeat
+	 *  the last row or column.
+	 ***********************************************************/
+	void Downsample(const IMAGE& source, IMAGE& target)
+	{
+		target.width = std::max(source.width / 2, 1);
+		target.height = std::max(source.height / 2, 1);
+		target.pixels.resize((size_t)target.width * target.height * 4);
+
+		for (int y = 0; y < target.height; y++)
+		{
+			for (int x = 0; x < target.width; x++)
+			{
+				int x0 = std::min(x * 2, source.width - 1);
+				int x1 = std::min(x * 2 + 1, source.width - 1);
+				int y0 = std::min(y * 2, source.height - 1);
+				int y1 = std::min(y * 2 + 1, source.height - 1);
+
+				for (int c = 0; c < 4; c++)
+				{
+					int sum =
+						source.pixels[((size_t)y0 * source.width + x0) * 4 + c] +
+						source.pixels[((size_t)y0 * source.width + x1) * 4 + c] +
+						source.pixels[((size_t)y1 * source.width + x0) * 4 + c] +
+						source.pixels[((size_t)y1 * source.width + x1) * 4 + c];
+
+					target.pixels[((size_t)y * target.width + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+				}
+			}
+		}
+	}
+
+	/***********************************************************
+	 *  BakeTexture()
+	 *
+	 *  This function is used for baking one image file into a
+	 *  DDS file next to it.  Images are flipped vertically the
+	 *  same way the application loads them.
+	 ***********************************************************/
+	bool BakeTexture(const std::string& filename)
+	{
+		int width = 0;
+		int height = 0;
+		int colorChannels = 0;
+
+		unsigned char* pPixels = stbi_load(filename.c_str(), &width, &height, &colorChannels, 4);
+		if (pPixels == NULL)
+		{
+			std::cout << "Could not load image:" << filename << std::endl;
+			return(false);
+		}
+
+		std::vector<IMAGE> levels(1);
+		levels[0].width = width;
+		levels[0].height = height;
+		levels[0].pixels.assign(pPixels, pPixels + (size_t)width * height * 4);
+		stbi_image_free(pPixels);
+
+		// only images with a visible alpha channel need BC3
+		bool bAlpha = false;
+		if (colorChannels == 4)
+		{
+			for (size_t i = 3; i < levels[0].pixels.size(); i += 4)
+			{
+				if (levels[0].pixels[i] != 255)
+				{
+					bAlpha = true;
+					break;
+				}
+			}
+		}
+
+		while ((levels.back().width > 1) || (levels.back().height > 1))
+		{
+			IMAGE next;
+			Downsample(levels.back(), next);
+			levels.push_back(next);
+		}
+
+		uint32_t blockBytes = bAlpha ? 16 : 8;
+		DDS_HEADER header;
+		memset(&header, 0, sizeof(header));
+		header.size = sizeof(DDS_HEADER);
+		header.flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE;
+		header.height = (uint32_t)height;
+		header.width = (uint32_t)width;
+		header.pitchOrLinearSize = DDSLevelSize(width, height, blockBytes);
+		header.mipMapCount = (uint32_t)levels.size();
+		header.pixelFormat.size = sizeof(DDS_PIXELFORMAT);
+		header.pixelFormat.flags = DDPF_FOURCC;
+		header.pixelFormat.fourCC = bAlpha ? DDS_FOURCC_DXT5 : DDS_FOURCC_DXT1;
+		header.caps = DDSCAPS_TEXTURE | DDSCAPS_COMPLEX | DDSCAPS_MIPMAP;
+
+		std::string outputName = BakedTexturePath(filename);
+		FILE* pFile = fopen(outputName.c_str(), "wb");
+		if (pFile == NULL)
+		{
+			std::cout << "Could not write baked texture:" << outputName << std::endl;
+			return(false);
+		}
+
+		fwrite(&DDS_MAGIC, sizeof(DDS_MAGIC), 1, pFile);
+		fwrite(&header, sizeof(header), 1, pFile);
+
+		size_t bakedBytes = 0;
+		std::vector<unsigned char> blocks;
+		for (size_t i = 0; i < levels.size(); i++)
+		{
+			CompressImage(levels[i], bAlpha, blocks);
+			fwrite(blocks.data(), 1, blocks.size(), pFile);
+			bakedBytes += blocks.size();
+		}
+		fclose(pFile);
+
+		std::cout << "Baked " << filename << " -> " << outputName
+			<< " (" << width << "x" << height << ", " << levels.size() << " levels, "
+			<< (bAlpha ? "BC3" : "BC1") << ", " << bakedBytes / 1024 << " KB)" << std::endl;
+
+		return(true);
+	}
+}
+
+/***********************************************************
+ *  main(int, char*)
+ *
+ *  This function bakes every image passed on the command
+ *  line and returns a failure when any of them could not be
+ *  baked.
+ ***********************************************************/
+int main(int argc, char* argv[])
+{
+	bool bSuccess = true;
+
+	if (argc < 2)
+	{
+		std::cout << "usage: TextureBaker <image> [<image> ...]" << std::endl;
+		return(EXIT_FAILURE);
+	}
+
+	// match the orientation the application loads images with
+	stbi_set_flip_vertically_on_load(true);
+
+	for (int i = 1; i < argc; i++)
+	{
+		bSuccess = BakeTexture(argv[i]) && bSuccess;
+	}
+
+	return(bSuccess ? EXIT_SUCCESS : EXIT_FAILURE);
+}
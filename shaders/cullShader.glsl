@@ -0,0 +1,142 @@
+#version 430 core
+layout (local_size_x = 64) in;
+
+// must match the declarations in the vertex shader
+struct LightSource
+{
+    vec3 position;
+    float focalStrength;
+    vec3 diffuseColor;
+    float specularIntensity;
+    vec3 specularColor;
+};
+
+#define TOTAL_LIGHTS 4
+// must match MESH_LOD_COUNT in MeshLod.h
+#define MESH_LOD_COUNT 3
+
+// the camera and lights of the current frame, shared by all programs
+layout(std140) uniform FrameData
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 viewPosition;
+    vec4 globalAmbientColor;
+    LightSource lightSources[TOTAL_LIGHTS];
+};
+
+// one object of the static geometry - must match GpuCuller::DRAW_OBJECT
+struct DrawObject
+{
+    vec4 bounds;
+    uint lodFirstIndex[MESH_LOD_COUNT];
+    uint lodIndexCount[MESH_LOD_COUNT];
+    uint group;
+    uint firstCommand;
+};
+
+// the layout glMultiDrawElementsIndirect reads
+struct DrawCommand
+{
+    uint count;
+    uint instanceCount;
+    uint firstIndex;
+    int baseVertex;
+    uint baseInstance;
+};
+
+layout(std430, binding = 3) readonly buffer DrawObjects
+{
+    DrawObject objects[];
+};
+
+layout(std430, binding = 4) writeonly buffer DrawCommands
+{
+    DrawCommand commands[];
+};
+
+// number of commands written for every group
+layout(std430, binding = 5) buffer DrawCounts
+{
+    uint drawCounts[];
+};
+
+// detail level of every object in the previous frame
+layout(std430, binding = 6) buffer ObjectLods
+{
+    uint objectLods[];
+};
+
+uniform uint objectCount;
+// true when the visible commands are packed at the start of their
+// group and drawn with the count, otherwise culled ones draw nothing
+uniform bool bCompactCommands;
+
+// detail level selection - see SelectMeshLod() in MeshLod.h
+uniform float pixelsPerUnit;
+uniform float lodPixelSizes[MESH_LOD_COUNT - 1];
+uniform float lodHysteresis;
+
+void main()
+{
+   uint index = gl_GlobalInvocationID.x;
+   if(index >= objectCount)
+   {
+      return;
+   }
+
+   DrawObject object = objects[index];
+   bool bVisible = true;
+
+   // the six frustum planes are sums and differences of the matrix rows
+   for(int i = 0; i < 6; i++)
+   {
+      int row = i / 2;
+      float side = ((i % 2) == 0) ? 1.0 : -1.0;
+      vec4 plane = vec4(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]) +
+         side * vec4(viewProjection[0][row], viewProjection[1][row], viewProjection[2][row], viewProjection[3][row]);
+
+      if(dot(plane.xyz, object.bounds.xyz) + plane.w < -object.bounds.w * length(plane.xyz))
+      {
+         bVisible = false;
+      }
+   }
+
+   // culled objects keep their level for when they show up again
+   uint lod = objectLods[index];
+   if(bVisible == true)
+   {
+      float distance = max(length(object.bounds.xyz - viewPosition.xyz) - object.bounds.w, 0.1);
+      float pixels = 2.0 * object.bounds.w * pixelsPerUnit / distance;
+
+      while((lod > 0u) && (pixels > lodPixelSizes[lod - 1u] * (1.0 + lodHysteresis)))
+      {
+         lod--;
+      }
+      while((lod < uint(MESH_LOD_COUNT - 1)) && (pixels < lodPixelSizes[lod] * (1.0 - lodHysteresis)))
+      {
+         lod++;
+      }
+      objectLods[index] = lod;
+   }
+
+   DrawCommand command;
+   command.count = object.lodIndexCount[lod];
+   command.instanceCount = bVisible ? 1u : 0u;
+   command.firstIndex = object.lodFirstIndex[lod];
+   command.baseVertex = 0;
+   command.baseInstance = 0u;
+
+   if(bCompactCommands == true)
+   {
+      if(bVisible == true)
+      {
+         commands[object.firstCommand + atomicAdd(drawCounts[object.group], 1u)] = command;
+      }
+   }
+   else
+   {
+      commands[index] = command;
+   }
+}
@@ -0,0 +1,52 @@
+#version 330 core
+layout (location = 0) in vec3 inVertexPosition;
+// per-instance data - the model matrix takes locations 3 to 6
+layout (location = 3) in mat4 inInstanceModel;
+
+// must match the declarations in the vertex shader
+struct LightSource 
+{
+    vec3 position;
+    float focalStrength;
+    vec3 diffuseColor;
+    float specularIntensity;
+    vec3 specularColor;
+};
+
+#define TOTAL_LIGHTS 4
+
+// the camera and lights of the current frame, shared by all programs
+layout(std140) uniform FrameData
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 viewPosition;
+    vec4 globalAmbientColor;
+    LightSource lightSources[TOTAL_LIGHTS];
+};
+
+// the position must come out exactly as in the vertex shader, or the
+// equal depth test of the shading pass drops the fragments
+invariant gl_Position;
+
+uniform bool bUseInstancing = false;
+uniform bool bUseStaticGeometry = false;
+uniform mat4 model;
+
+void main()
+{
+   mat4 modelMatrix = model;
+
+   if(bUseInstancing == true)
+   {
+      modelMatrix = inInstanceModel;
+   }
+   else if(bUseStaticGeometry == true)
+   {
+      // already in world space
+      modelMatrix = mat4(1.0f);
+   }
+
+   gl_Position = viewProjection * modelMatrix * vec4(inVertexPosition, 1.0f);
+}
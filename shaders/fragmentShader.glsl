@@ -1,7 +1,10 @@
 #version 440 core
+#extension GL_ARB_bindless_texture : enable
 
 struct Material 
 {
+    vec3 ambientColor;
+    float ambientStrength;
     vec3 diffuseColor;
     vec3 specularColor;
     float shininess;
@@ -9,70 +12,153 @@ struct Material
 
 struct LightSource 
 {
-    vec3 position;	
+    vec3 position;
+    float focalStrength;
     vec3 diffuseColor;
+    float specularIntensity;
     vec3 specularColor;
-    float focalStrength;
+};
+
+// one light with a limited range - must match LightClusters::LOCAL_LIGHT
+struct LocalLight
+{
+    vec3 position;
+    float radius;
+    vec3 diffuseColor;
     float specularIntensity;
+    vec3 specularColor;
+    float focalStrength;
 };
 
 #define TOTAL_LIGHTS 4
+// must match LightClusters::MAX_CLUSTER_LIGHTS
+#define MAX_CLUSTER_LIGHTS 32
+#define MAX_MATERIALS 64
+// must match TextureResidency::MAX_BOUND_TEXTURES
+#define MAX_BOUND_TEXTURES 16
 
 in vec3 fragmentPosition;
 in vec3 fragmentVertexNormal;
 in vec2 fragmentTextureCoordinate;
+flat in int fragmentMaterialIndex;
+flat in int fragmentTextureSlot;
+in vec4 fragmentObjectColor;
 
 out vec4 outFragmentColor;
 
-uniform bool bUseTexture=false;
-uniform bool bUseLighting=false;
-uniform vec4 objectColor = vec4(1.0f);
-uniform sampler2D objectTexture;
-uniform vec3 viewPosition;
+// the program is built once for every combination of the features
+// below, see ShaderVariants - USE_TEXTURE samples the object texture
+// instead of the object color, USE_LIGHTING adds the Phong lighting
+
+// true when the local light clusters are filled for this frame
+uniform bool bUseLocalLights=false;
 uniform vec2 UVscale = vec2(1.0f, 1.0f);
-uniform LightSource lightSources[TOTAL_LIGHTS];
-uniform Material material;
-uniform vec3 globalAmbientColor;
+
+// all of the scene materials, indexed by the material index
+layout(std140, binding = 0) uniform MaterialBlock
+{
+    Material materials[MAX_MATERIALS];
+};
+
+// the camera and lights of the current frame, shared by all programs
+layout(std140) uniform FrameData
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 viewPosition;
+    vec4 globalAmbientColor;
+    LightSource lightSources[TOTAL_LIGHTS];
+};
+
+// the scene textures, indexed by the texture slot - every draw
+// uses a single slot today, so the index is dynamically uniform
+#ifdef GL_ARB_bindless_texture
+layout(std430, binding = 2) readonly buffer TextureHandles
+{
+    uvec2 textureHandles[];
+};
+#else
+uniform sampler2D objectTextures[MAX_BOUND_TEXTURES];
+#endif
+
+// the cluster setup of the frame followed by the local lights
+layout(std430, binding = 7) readonly buffer LocalLights
+{
+    mat4 inverseProjection;
+    uvec4 clusterGrid;
+    vec4 clusterScale;
+    vec4 depthRange;
+    LocalLight localLights[];
+};
+
+// for every cluster the light count followed by the light indices
+layout(std430, binding = 8) readonly buffer ClusterLights
+{
+    uint clusterLights[];
+};
+
+// the material of the current fragment
+Material material;
     
 
 // function prototypes
 vec3 CalcLightSource(LightSource light, vec3 lightNormal, vec3 vertexPosition, vec3 viewDirection);
+vec3 CalcLocalLight(LocalLight light, vec3 lightNormal, vec3 vertexPosition, vec3 viewDirection);
+uint FindCluster();
+vec4 SampleObjectTexture(vec2 textureCoordinate);
 
 void main()
 {
-   if(bUseLighting == true)
+#ifdef USE_TEXTURE
+   vec4 surfaceColor = SampleObjectTexture(fragmentTextureCoordinate * UVscale);
+#else
+   vec4 surfaceColor = fragmentObjectColor;
+#endif
+
+#ifdef USE_LIGHTING
+   material = materials[clamp(fragmentMaterialIndex, 0, MAX_MATERIALS - 1)];
+
+   // properties
+   vec3 lightNormal = normalize(fragmentVertexNormal);
+   vec3 viewDirection = normalize(viewPosition.xyz - fragmentPosition);
+   vec3 phongResult = vec3(0.0f);
+
+   for(int i = 0; i < TOTAL_LIGHTS; i++)
    {
-      // properties
-      vec3 lightNormal = normalize(fragmentVertexNormal);
-      vec3 viewDirection = normalize(viewPosition - fragmentPosition);
-      vec3 phongResult = vec3(0.0f);
+      phongResult += CalcLightSource(lightSources[i], lightNormal, fragmentPosition, viewDirection); 
+   }   
 
-      for(int i = 0; i < TOTAL_LIGHTS; i++)
-      {
-         phongResult += CalcLightSource(lightSources[i], lightNormal, fragmentPosition, viewDirection); 
-      }   
-    
-      if(bUseTexture == true)
-      {
-         vec4 textureColor = texture(objectTexture, fragmentTextureCoordinate * UVscale);
-         outFragmentColor = vec4(phongResult * textureColor.xyz, 1.0);
-      }
-      else
-      {
-         outFragmentColor = vec4(phongResult * objectColor.xyz, objectColor.w);
-      }
-   }
-   else 
+   // only the local lights whose range reaches this cluster
+   if(bUseLocalLights == true)
    {
-      if(bUseTexture == true)
-      {
-         outFragmentColor = texture(objectTexture, fragmentTextureCoordinate * UVscale);
-      }
-      else
+      uint base = FindCluster() * uint(MAX_CLUSTER_LIGHTS + 1);
+      uint count = clusterLights[base];
+
+      for(uint i = 0u; i < count; i++)
       {
-         outFragmentColor = objectColor;
+         phongResult += CalcLocalLight(localLights[clusterLights[base + 1u + i]], lightNormal, fragmentPosition, viewDirection);
       }
    }
+
+#ifdef USE_TEXTURE
+   // lit textures are opaque
+   surfaceColor.w = 1.0;
+#endif
+   outFragmentColor = vec4(phongResult * surfaceColor.xyz, surfaceColor.w);
+#else
+   outFragmentColor = surfaceColor;
+#endif
+}
+
+// samples the scene texture in the texture slot of the fragment
+vec4 SampleObjectTexture(vec2 textureCoordinate)
+{
+#ifdef GL_ARB_bindless_texture
+   return texture(sampler2D(textureHandles[max(fragmentTextureSlot, 0)]), textureCoordinate);
+#else
+   return texture(objectTextures[clamp(fragmentTextureSlot, 0, MAX_BOUND_TEXTURES - 1)], textureCoordinate);
+#endif
 }
 
 // calculates the color when using a directional light.
@@ -84,7 +170,7 @@ vec3 CalcLightSource(LightSource light, vec3 lightNormal, vec3 vertexPosition, v
 
    //**Calculate Ambient lighting**
 
-   ambient = globalAmbientColor;
+   ambient = globalAmbientColor.xyz;
 
    //**Calculate Diffuse lighting**
 
@@ -104,4 +190,38 @@ vec3 CalcLightSource(LightSource light, vec3 lightNormal, vec3 vertexPosition, v
    specular = (light.specularIntensity * material.shininess) * specularComponent * material.specularColor;
   
    return(ambient + diffuse + specular);
-}
\ No newline at end of file
+}
+
+// finds the cluster of the fragment from its screen position and view depth
+uint FindCluster()
+{
+   float viewDepth = max(-(view * vec4(fragmentPosition, 1.0)).z, depthRange.x);
+   uvec2 tile = uvec2(gl_FragCoord.xy * clusterScale.xy);
+   uint slice = uint(max(log(viewDepth) * clusterScale.z + clusterScale.w, 0.0));
+
+   tile = min(tile, clusterGrid.xy - 1u);
+   slice = min(slice, clusterGrid.z - 1u);
+
+   return(tile.x + clusterGrid.x * (tile.y + clusterGrid.y * slice));
+}
+
+// calculates the color added by a light that fades out at its radius
+vec3 CalcLocalLight(LocalLight light, vec3 lightNormal, vec3 vertexPosition, vec3 viewDirection)
+{
+   vec3 toLight = light.position - vertexPosition;
+   float distance = length(toLight);
+   vec3 lightDirection = toLight / max(distance, 0.0001);
+
+   // smooth falloff that reaches zero at the radius
+   float falloff = clamp(1.0 - (distance * distance) / (light.radius * light.radius), 0.0, 1.0);
+   falloff *= falloff;
+
+   float impact = max(dot(lightNormal, lightDirection), 0.0);
+   vec3 diffuse = impact * material.diffuseColor * light.diffuseColor;
+
+   vec3 reflectDir = reflect(-lightDirection, lightNormal);
+   float specularComponent = pow(max(dot(viewDirection, reflectDir), 0.0), light.focalStrength);
+   vec3 specular = (light.specularIntensity * material.shininess) * specularComponent * material.specularColor * light.specularColor;
+
+   return(falloff * (diffuse + specular));
+}
@@ -0,0 +1,114 @@
+#version 430 core
+layout (local_size_x = 64) in;
+
+// must match the declarations in the vertex shader
+struct LightSource
+{
+    vec3 position;
+    float focalStrength;
+    vec3 diffuseColor;
+    float specularIntensity;
+    vec3 specularColor;
+};
+
+#define TOTAL_LIGHTS 4
+// must match LightClusters::MAX_CLUSTER_LIGHTS
+#define MAX_CLUSTER_LIGHTS 32
+
+// the camera and lights of the current frame, shared by all programs
+layout(std140) uniform FrameData
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 viewPosition;
+    vec4 globalAmbientColor;
+    LightSource lightSources[TOTAL_LIGHTS];
+};
+
+// one light with a limited range - must match LightClusters::LOCAL_LIGHT
+struct LocalLight
+{
+    vec3 position;
+    float radius;
+    vec3 diffuseColor;
+    float specularIntensity;
+    vec3 specularColor;
+    float focalStrength;
+};
+
+// the cluster setup of the frame followed by the local lights
+layout(std430, binding = 7) readonly buffer LocalLights
+{
+    mat4 inverseProjection;
+    uvec4 clusterGrid;
+    vec4 clusterScale;
+    vec4 depthRange;
+    LocalLight localLights[];
+};
+
+// for every cluster the light count followed by the light indices
+layout(std430, binding = 8) writeonly buffer ClusterLights
+{
+    uint clusterLights[];
+};
+
+// the view space point of a screen position at a view depth, from
+// the points of the position on the near and far planes
+vec3 ViewPointAtDepth(vec2 ndc, float depth)
+{
+   vec4 nearPoint = inverseProjection * vec4(ndc, -1.0, 1.0);
+   vec4 farPoint = inverseProjection * vec4(ndc, 1.0, 1.0);
+   nearPoint /= nearPoint.w;
+   farPoint /= farPoint.w;
+
+   float t = (depth + nearPoint.z) / (nearPoint.z - farPoint.z);
+   return mix(nearPoint.xyz, farPoint.xyz, t);
+}
+
+void main()
+{
+   uint index = gl_GlobalInvocationID.x;
+   uint clusterCount = clusterGrid.x * clusterGrid.y * clusterGrid.z;
+   if(index >= clusterCount)
+   {
+      return;
+   }
+
+   uvec3 cluster = uvec3(index % clusterGrid.x, (index / clusterGrid.x) % clusterGrid.y, index / (clusterGrid.x * clusterGrid.y));
+
+   // the screen rectangle and the depth range of the cluster
+   vec2 ndcMin = vec2(cluster.xy) / vec2(clusterGrid.xy) * 2.0 - 1.0;
+   vec2 ndcMax = vec2(cluster.xy + 1u) / vec2(clusterGrid.xy) * 2.0 - 1.0;
+   float depthRatio = depthRange.y / depthRange.x;
+   float nearDepth = depthRange.x * pow(depthRatio, float(cluster.z) / float(clusterGrid.z));
+   float farDepth = depthRange.x * pow(depthRatio, float(cluster.z + 1u) / float(clusterGrid.z));
+
+   // view space box around the eight corners of the cluster
+   vec3 boxMin = vec3(1.0e30);
+   vec3 boxMax = vec3(-1.0e30);
+   for(int corner = 0; corner < 8; corner++)
+   {
+      vec2 ndc = vec2(((corner & 1) == 0) ? ndcMin.x : ndcMax.x, ((corner & 2) == 0) ? ndcMin.y : ndcMax.y);
+      vec3 point = ViewPointAtDepth(ndc, ((corner & 4) == 0) ? nearDepth : farDepth);
+      boxMin = min(boxMin, point);
+      boxMax = max(boxMax, point);
+   }
+
+   uint base = index * uint(MAX_CLUSTER_LIGHTS + 1);
+   uint count = 0u;
+   for(uint i = 0u; (i < clusterGrid.w) && (count < uint(MAX_CLUSTER_LIGHTS)); i++)
+   {
+      LocalLight light = localLights[i];
+      vec3 center = vec3(view * vec4(light.position, 1.0));
+      vec3 closest = clamp(center, boxMin, boxMax);
+      vec3 offset = center - closest;
+
+      if(dot(offset, offset) <= light.radius * light.radius)
+      {
+         clusterLights[base + 1u + count] = i;
+         count++;
+      }
+   }
+   clusterLights[base] = count;
+}
@@ -2,19 +2,84 @@
 layout (location = 0) in vec3 inVertexPosition;
 layout (location = 1) in vec3 inVertexNormal;
 layout (location = 2) in vec2 inTextureCoordinate;
+// per-instance data - the model matrix takes locations 3 to 6
+layout (location = 3) in mat4 inInstanceModel;
+layout (location = 7) in ivec2 inInstanceIndices;
+// per-vertex color of the baked static geometry, which reads the
+// material index and texture slot from location 7 per vertex
+layout (location = 8) in vec4 inVertexColor;
+// per-instance normal matrix - takes locations 9 to 11
+layout (location = 9) in mat3 inInstanceNormal;
+
+// must match the declarations in the fragment shader
+struct LightSource 
+{
+    vec3 position;
+    float focalStrength;
+    vec3 diffuseColor;
+    float specularIntensity;
+    vec3 specularColor;
+};
+
+#define TOTAL_LIGHTS 4
+
+// the camera and lights of the current frame, shared by all programs
+layout(std140) uniform FrameData
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 viewPosition;
+    vec4 globalAmbientColor;
+    LightSource lightSources[TOTAL_LIGHTS];
+};
+
+// the depth pre-pass computes the same position in its own program
+invariant gl_Position;
 
 out vec3 fragmentPosition;
 out vec3 fragmentVertexNormal;
 out vec2 fragmentTextureCoordinate;
+flat out int fragmentMaterialIndex;
+flat out int fragmentTextureSlot;
+out vec4 fragmentObjectColor;
 
+uniform bool bUseInstancing = false;
+uniform bool bUseStaticGeometry = false;
+uniform vec4 objectColor = vec4(1.0f);
+uniform int materialIndex = 0;
+uniform int textureSlot = -1;
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// worked out per object on the CPU, so no vertex inverts a matrix
+uniform mat3 normalMatrix = mat3(1.0f);
 
 void main()
 {
-   fragmentPosition = vec3(model * vec4(inVertexPosition, 1.0));
-   gl_Position = projection * view * model * vec4(inVertexPosition, 1.0f);
-   fragmentVertexNormal = inVertexNormal;
+   mat4 modelMatrix = model;
+   mat3 objectNormalMatrix = normalMatrix;
+   fragmentMaterialIndex = materialIndex;
+   fragmentTextureSlot = textureSlot;
+   fragmentObjectColor = objectColor;
+
+   if(bUseInstancing == true)
+   {
+      modelMatrix = inInstanceModel;
+      objectNormalMatrix = inInstanceNormal;
+      fragmentMaterialIndex = inInstanceIndices.x;
+      fragmentTextureSlot = inInstanceIndices.y;
+   }
+   else if(bUseStaticGeometry == true)
+   {
+      // already in world space, normals included
+      modelMatrix = mat4(1.0f);
+      objectNormalMatrix = mat3(1.0f);
+      fragmentMaterialIndex = inInstanceIndices.x;
+      fragmentTextureSlot = inInstanceIndices.y;
+      fragmentObjectColor = inVertexColor;
+   }
+
+   fragmentPosition = vec3(modelMatrix * vec4(inVertexPosition, 1.0));
+   gl_Position = viewProjection * modelMatrix * vec4(inVertexPosition, 1.0f);
+   fragmentVertexNormal = objectNormalMatrix * inVertexNormal;
    fragmentTextureCoordinate = inTextureCoordinate;
-}
\ No newline at end of file
+}